@@ -0,0 +1,227 @@
+// Throughput of schedule, cancel and update for every scheduler and queue
+// backend, from 1e3 to 1e7 pending items.
+//
+// Every benchmark takes three arguments: the number of pending items, the
+// delay distribution (0 uniform, 1 exponential, 2 bursty) and the share of
+// items cancelled, in percent. Filter with --benchmark_filter, for example
+// --benchmark_filter='Update<Wheel.*>/100000/'.
+
+#include "../include/Scheduler.h"
+#include "../include/TimedEventScheduler.h"
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Ticks over which the uniform and exponential delays spread out
+constexpr int delaySpan = 4096;
+
+// Ticks that bursty delays land on, so many items share a tick
+constexpr int burstTicks = 8;
+
+enum Distribution { uniform, exponential, bursty };
+
+// Delays of count items, the same for every run of a configuration
+std::vector<int> makeDelays(std::size_t count, int distribution) {
+  std::mt19937 random(12345);
+  std::uniform_int_distribution<int> flat(1, delaySpan);
+  std::exponential_distribution<double> decay(4.0 / delaySpan);
+  std::uniform_int_distribution<int> burst(0, burstTicks - 1);
+  std::vector<int> delays(count);
+  for (int &delay : delays) {
+    switch (distribution) {
+    case exponential:
+      delay = 1 + std::min(static_cast<int>(decay(random)), 8 * delaySpan);
+      break;
+    case bursty:
+      delay = 1 + burst(random) * (delaySpan / burstTicks);
+      break;
+    default:
+      delay = flat(random);
+    }
+  }
+  return delays;
+}
+
+// Positions of the items to cancel, in random order
+std::vector<std::size_t> makeCancels(std::size_t count, int percent) {
+  std::vector<std::size_t> order(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(54321));
+  order.resize(count * static_cast<std::size_t>(percent) / 100);
+  return order;
+}
+
+// Common face of BasicScheduler and TimedEventScheduler for the benchmarks
+template <typename Queue> struct ActionHarness {
+  using Id = ActionID;
+
+  ActionHarness() : entity(registry.create()) {}
+
+  Id schedule(int tick) {
+    return scheduler.schedule(tick, entity, [](entt::entity, entt::registry &) {});
+  }
+  bool cancel(Id id) { return scheduler.cancel(id); }
+  void update(int tick) { scheduler.update(tick, registry, dispatcher); }
+  std::size_t pending() const { return scheduler.pendingCount(); }
+
+  entt::registry registry;
+  EventDispatcher dispatcher;
+  entt::entity entity;
+  BasicScheduler<Queue> scheduler;
+};
+
+struct EventHarness {
+  using Id = EventID;
+
+  Id schedule(int tick) { return scheduler.scheduleFunction(tick, [] {}); }
+  bool cancel(Id id) { return scheduler.cancelEvent(id); }
+  void update(int tick) { scheduler.update(tick); }
+  std::size_t pending() const { return scheduler.pendingCount(); }
+
+  TimedEventScheduler scheduler;
+};
+
+using HeapActions = ActionHarness<HeapQueue<ScheduledAction>>;
+using WheelActions = ActionHarness<TimingWheel<ScheduledAction>>;
+using CalendarActions = ActionHarness<CalendarQueue<ScheduledAction>>;
+
+struct Config {
+  std::size_t count;
+  std::vector<int> delays;
+  std::vector<std::size_t> cancels;
+
+  explicit Config(const benchmark::State &state)
+      : count(static_cast<std::size_t>(state.range(0))),
+        delays(makeDelays(count, static_cast<int>(state.range(1)))),
+        cancels(makeCancels(count, static_cast<int>(state.range(2)))) {}
+};
+
+template <typename Harness>
+std::vector<typename Harness::Id> fill(Harness &harness, const Config &config) {
+  std::vector<typename Harness::Id> ids(config.count);
+  for (std::size_t i = 0; i < config.count; ++i) {
+    ids[i] = harness.schedule(config.delays[i]);
+  }
+  return ids;
+}
+
+// Scheduling count items into an empty scheduler
+template <typename Harness> void Schedule(benchmark::State &state) {
+  Config config(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto harness = std::make_unique<Harness>();
+    state.ResumeTiming();
+    for (std::size_t i = 0; i < config.count; ++i) {
+      benchmark::DoNotOptimize(harness->schedule(config.delays[i]));
+    }
+    state.PauseTiming();
+    harness.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(config.count));
+}
+
+// Cancelling the given share of count pending items
+template <typename Harness> void Cancel(benchmark::State &state) {
+  Config config(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto harness = std::make_unique<Harness>();
+    auto ids = fill(*harness, config);
+    state.ResumeTiming();
+    for (std::size_t i : config.cancels) {
+      benchmark::DoNotOptimize(harness->cancel(ids[i]));
+    }
+    state.PauseTiming();
+    harness.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(config.cancels.size()));
+}
+
+// Running every remaining item, one update per tick
+template <typename Harness> void Update(benchmark::State &state) {
+  Config config(state);
+  int last = *std::max_element(config.delays.begin(), config.delays.end());
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto harness = std::make_unique<Harness>();
+    auto ids = fill(*harness, config);
+    for (std::size_t i : config.cancels) {
+      harness->cancel(ids[i]);
+    }
+    state.ResumeTiming();
+    for (int tick = 0; tick <= last; ++tick) {
+      harness->update(tick);
+    }
+    state.PauseTiming();
+    harness.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(config.count - config.cancels.size()));
+}
+
+// Steady state around count pending items: each tick schedules as many items
+// as it runs and cancels the given share of them again
+template <typename Harness> void Mixed(benchmark::State &state) {
+  Config config(state);
+  Harness harness;
+  auto ids = fill(harness, config);
+  std::size_t perTick = std::max<std::size_t>(1, config.count / delaySpan);
+  std::size_t next = 0;
+  std::size_t cancelEvery = config.cancels.empty() ? 0 : config.count / config.cancels.size();
+  int tick = 0;
+  std::int64_t operations = 0;
+  for (auto _ : state) {
+    ++tick;
+    for (std::size_t i = 0; i < perTick; ++i, ++next) {
+      std::size_t slot = next % config.count;
+      ids[slot] = harness.schedule(tick + config.delays[slot]);
+      if (cancelEvery != 0 && next % cancelEvery == 0) {
+        harness.cancel(ids[(slot + config.count / 2) % config.count]);
+      }
+    }
+    harness.update(tick);
+    operations += static_cast<std::int64_t>(perTick);
+  }
+  state.SetItemsProcessed(operations);
+  state.counters["pending"] = static_cast<double>(harness.pending());
+}
+
+// Pending counts from 1e3 to 1e7 for each distribution, without and with cancellation
+void arguments(benchmark::internal::Benchmark *benchmark) {
+  benchmark->ArgNames({"pending", "delays", "cancel%"});
+  for (std::int64_t count = 1000; count <= 10000000; count *= 10) {
+    for (int distribution : {uniform, exponential, bursty}) {
+      for (int cancel : {0, 50}) {
+        benchmark->Args({count, distribution, cancel});
+      }
+    }
+  }
+}
+
+} // namespace
+
+#define SCHEDULER_BENCHMARKS(harness)                                                          \
+  BENCHMARK_TEMPLATE(Schedule, harness)->Apply(arguments)->Unit(benchmark::kMillisecond);     \
+  BENCHMARK_TEMPLATE(Cancel, harness)->Apply(arguments)->Unit(benchmark::kMillisecond);       \
+  BENCHMARK_TEMPLATE(Update, harness)->Apply(arguments)->Unit(benchmark::kMillisecond);       \
+  BENCHMARK_TEMPLATE(Mixed, harness)->Apply(arguments)
+
+SCHEDULER_BENCHMARKS(HeapActions);
+SCHEDULER_BENCHMARKS(WheelActions);
+SCHEDULER_BENCHMARKS(CalendarActions);
+SCHEDULER_BENCHMARKS(EventHarness);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,60 @@
+// Replays a WorkloadCapture file against every queue backend and prints the
+// throughput and call latency percentiles of each.
+//
+// Usage: WorkloadReplay <capture file>
+
+#include "../include/WorkloadReplay.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+void printLatency(const char *call, std::size_t count, const HistogramSnapshot &latency) {
+  std::cout << "  " << std::left << std::setw(9) << call << std::right << std::setw(10) << count
+            << " calls  p50 " << latency.percentile(0.5) << " ns  p99 "
+            << latency.percentile(0.99) << " ns  p99.9 " << latency.percentile(0.999)
+            << " ns  max " << latency.max() << " ns\n";
+}
+
+void print(const char *name, const ReplayResult &result) {
+  if (result.schedules + result.cancels + result.updates == 0) {
+    return;
+  }
+  std::cout << name << ": " << std::fixed << std::setprecision(0) << result.callsPerSecond()
+            << " calls/s\n";
+  printLatency("schedule", result.schedules, result.scheduleLatency);
+  printLatency("cancel", result.cancels, result.cancelLatency);
+  printLatency("update", result.updates, result.updateLatency);
+}
+
+template <typename Scheduler> void replayActions(const char *name, const WorkloadCapture &capture) {
+  Scheduler scheduler;
+  entt::registry registry;
+  EventDispatcher dispatcher;
+  print(name, WorkloadReplay{capture}.run(scheduler, registry, dispatcher));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr << "usage: " << argv[0] << " <capture file>\n";
+    return 2;
+  }
+  std::ifstream file(argv[1], std::ios::binary);
+  WorkloadCapture capture;
+  if (!capture.load(file)) {
+    std::cerr << argv[1] << ": not a workload capture\n";
+    return 1;
+  }
+  std::cout << capture.records().size() << " records\n";
+
+  replayActions<Scheduler>("Scheduler (heap)", capture);
+  replayActions<WheelScheduler>("WheelScheduler", capture);
+  replayActions<CalendarScheduler>("CalendarScheduler", capture);
+  TimedEventScheduler events;
+  print("TimedEventScheduler", WorkloadReplay{capture}.run(events));
+  return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file ActionBatch.h
+ * @brief Actions whose handler runs once for all the entities due with it.
+ *
+ * When thousands of entities get the same "regen tick" at the same tick,
+ * running one callable per entity repeats the same indirect call and the
+ * same storage lookups thousands of times. A batch handler takes a span of
+ * entities instead, and BasicScheduler::update() hands it every due action
+ * of the same handler at once, so the handler can loop tightly over its
+ * storages.
+ */
+#pragma once
+
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class EntitySpan
+ * @brief Contiguous read-only range of entities, std::span<const entt::entity> for C++17
+ */
+class EntitySpan {
+  public:
+    EntitySpan() noexcept = default;
+
+    /// @brief Views count entities starting at first
+    EntitySpan(const entt::entity *first, std::size_t count) noexcept
+        : first(first), count(count) {}
+
+    const entt::entity *begin() const noexcept { return first; }
+    const entt::entity *end() const noexcept { return first + count; }
+    const entt::entity *data() const noexcept { return first; }
+    std::size_t size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+    entt::entity operator[](std::size_t index) const noexcept { return first[index]; }
+
+  private:
+    const entt::entity *first = nullptr;
+    std::size_t count = 0;
+};
+
+/// @brief Handler run once for a batch of entities whose actions are due together
+///
+/// A plain function or captureless lambda, so that actions of the same
+/// handler can be recognised by comparing pointers. Every entity is valid.
+using BatchFunction = void (*)(EntitySpan, entt::registry &);
+
+/**
+ * @struct BatchCall
+ * @brief An action that runs its handler as part of a batch
+ *
+ * Scheduled like any other action. Run on its own, by updateParallel() or
+ * by code draining actions, it calls the handler with a span of one entity.
+ */
+struct BatchCall {
+    BatchFunction handler; ///< Handler shared by every action of the batch
+
+    /// @brief Runs the handler for this action's entity alone
+    void operator()(entt::entity entity, entt::registry &registry) const {
+        handler(EntitySpan(&entity, 1), registry);
+    }
+};
+
+/// @brief Which due actions of a handler update() runs as one batch
+enum class BatchGrouping : std::uint8_t {
+    off,      ///< Runs every action on its own
+    adjacent, ///< Batches runs of consecutive due actions, keeping queue order
+    tick,     ///< Batches all due actions of the tick at the first one's place
+};
@@ -0,0 +1,191 @@
+/**
+ * @file ActionCoroutine.h
+ * @brief C++20 coroutines that run on a scheduler and suspend for a number of ticks.
+ *
+ * A behavior that spans several ticks can be written as one coroutine instead
+ * of a chain of scheduled lambdas that each carry a copy of the state:
+ *
+ * @code
+ * ActionTask regenerate(Scheduler &scheduler, entt::entity entity, int amount) {
+ *     for (int i = 0; i < 5; ++i) {
+ *         entt::registry &registry = co_await scheduler.delay(10);
+ *         registry.get<Health>(entity).value += amount;
+ *     }
+ * }
+ *
+ * scheduler.spawn(currentTick, npc, regenerate(scheduler, npc, 4));
+ * @endcode
+ *
+ * Only available when the compiler supports coroutines (C++20); otherwise the
+ * header is empty and SCHEDULER_HAS_COROUTINES is not defined.
+ */
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#define SCHEDULER_HAS_COROUTINES 1
+
+#include "BlockPool.h"
+#include "entt/entt.hpp"
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+/**
+ * @class ActionTask
+ * @brief Coroutine that runs on behalf of an entity and is resumed by a scheduler
+ *
+ * An ActionTask starts suspended and does nothing until it is handed to
+ * BasicScheduler::spawn(). After that it runs as a scheduled action and, on
+ * every co_await of delay() or untilTick(), queues its own resumption as the
+ * entity's next action. Each step is a pending action of the entity, so
+ * cancelAll(), entity destruction with connect(), and clear() also destroy the
+ * suspended coroutine and its locals.
+ *
+ * An exception leaving the coroutine propagates out of the update that
+ * resumed it, like one thrown by a plain action.
+ */
+class ActionTask {
+  public:
+    struct promise_type {
+        entt::registry *registry = nullptr; ///< Registry of the step being run
+        entt::entity entity = entt::null;   ///< Entity the coroutine runs for
+        int tick = 0;                       ///< Tick of the step being run
+        std::exception_ptr error;
+
+        ActionTask get_return_object() {
+            return ActionTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+
+        static void *operator new(std::size_t size) { return BlockPool::allocate(size); }
+        static void operator delete(void *pointer, std::size_t size) noexcept {
+            BlockPool::deallocate(pointer, size);
+        }
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    /**
+     * @class Resumer
+     * @brief Scheduled action that runs the next step of a suspended coroutine
+     *
+     * Owns the coroutine while it is queued, so destroying an unrun Resumer
+     * destroys the coroutine.
+     */
+    class Resumer {
+      public:
+        Resumer(handle_type handle, int tick) noexcept : handle(handle), tick(tick) {}
+        Resumer(Resumer &&other) noexcept
+            : handle(std::exchange(other.handle, nullptr)), tick(other.tick) {}
+        Resumer &operator=(Resumer &&) = delete;
+        ~Resumer() {
+            if (handle) {
+                handle.destroy();
+            }
+        }
+
+        void operator()(entt::entity, entt::registry &registry) {
+            handle_type coroutine = std::exchange(handle, nullptr);
+            promise_type &promise = coroutine.promise();
+            promise.registry = &registry;
+            promise.tick = tick;
+            coroutine.resume();
+            if (coroutine.done()) {
+                std::exception_ptr error = std::move(promise.error);
+                coroutine.destroy();
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+
+      private:
+        handle_type handle;
+        int tick;
+    };
+
+    ActionTask(ActionTask &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    ActionTask &operator=(ActionTask &&other) noexcept {
+        if (this != &other) {
+            reset();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~ActionTask() { reset(); }
+
+    /// @brief Checks whether the task still owns a coroutine that has not been spawned
+    explicit operator bool() const { return static_cast<bool>(handle); }
+
+    /**
+     * @brief Hands the coroutine to a resumer for its first step
+     * @param entity The entity the coroutine runs for
+     * @param tick The tick of the first step
+     */
+    Resumer start(entt::entity entity, int tick) {
+        handle_type coroutine = std::exchange(handle, nullptr);
+        coroutine.promise().entity = entity;
+        return Resumer(coroutine, tick);
+    }
+
+  private:
+    explicit ActionTask(handle_type handle) : handle(handle) {}
+
+    void reset() {
+        if (handle) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+
+    handle_type handle;
+};
+
+/**
+ * @class TickAwaiter
+ * @brief Awaitable returned by BasicScheduler::delay() and untilTick()
+ * @tparam Scheduler The scheduler that resumes the coroutine
+ *
+ * Awaiting it in an ActionTask queues the rest of the coroutine as an action
+ * due at the target tick. Awaiting a tick that is not after the current step's
+ * tick does not suspend. The co_await expression yields the registry of the
+ * step that resumed the coroutine.
+ */
+template <typename Scheduler> class TickAwaiter {
+  public:
+    /**
+     * @param scheduler The scheduler to queue the resumption on
+     * @param tick Target tick, or number of ticks to wait if relative
+     * @param relative Whether tick counts from the tick of the current step
+     */
+    TickAwaiter(Scheduler &scheduler, int tick, bool relative)
+        : scheduler(scheduler), tick(tick), relative(relative) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(ActionTask::handle_type coroutine) {
+        ActionTask::promise_type &promise = coroutine.promise();
+        awaiting = &promise;
+        int target = relative ? promise.tick + tick : tick;
+        if (target <= promise.tick) {
+            return false;
+        }
+        scheduler.schedule(target, promise.entity, ActionTask::Resumer(coroutine, target));
+        return true;
+    }
+
+    entt::registry &await_resume() const noexcept { return *awaiting->registry; }
+
+  private:
+    Scheduler &scheduler;
+    int tick;
+    bool relative;
+    ActionTask::promise_type *awaiting = nullptr;
+};
+
+#endif
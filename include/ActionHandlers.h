@@ -0,0 +1,185 @@
+/**
+ * @file ActionHandlers.h
+ * @brief Registered handler functions with plain-data payloads, the saveable form of an action.
+ *
+ * A lambda cannot be written to disk, but a handler ID and the bytes of a
+ * trivially copyable payload can. Handlers are registered once under an ID in
+ * a HandlerTable; binding an ID to a payload yields a small callable that can
+ * be scheduled like any other action and recognised again when a snapshot is
+ * taken. The callable is a function pointer and the payload bytes, trivially
+ * copyable and stored inline in the action, so running it is one indirect
+ * call through the table's trampoline.
+ */
+#pragma once
+
+#include "entt/entt.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/// @brief Largest payload a saved handler call can carry, in bytes
+inline constexpr std::size_t savedPayloadCapacity = 32;
+
+/**
+ * @struct SavedPayload
+ * @brief Handler ID and payload bytes of a saveable call
+ *
+ * Trivially copyable, so it can be written and read as raw bytes.
+ */
+struct SavedPayload {
+    entt::id_type handler = 0;                               ///< ID the handler is registered under
+    std::uint32_t size = 0;                                  ///< Bytes of payload in use
+    std::array<unsigned char, savedPayloadCapacity> bytes{}; ///< The payload
+};
+
+/**
+ * @class HandlerTable
+ * @brief Maps handler IDs to functions taking a payload
+ * @tparam Context Arguments every handler receives before its payload
+ *
+ * Register every handler before binding or loading calls for it. The table
+ * is read-only afterwards and can be shared between threads.
+ *
+ * @code
+ * struct Poison { int damage; };
+ * void poison(entt::entity e, entt::registry &r, const Poison &p) {
+ *     r.get<Health>(e).current -= p.damage;
+ * }
+ *
+ * ActionHandlers handlers;
+ * handlers.add<Poison, &poison>("poison"_hs);
+ * scheduler.schedule(tick, target, handlers.bind("poison"_hs, Poison{5}));
+ * @endcode
+ */
+template <typename... Context> class HandlerTable {
+    using invoke_type = void (*)(Context..., const unsigned char *);
+
+    struct Entry {
+        invoke_type invoke;
+        std::uint32_t size;
+        entt::id_type type; ///< entt::type_hash of the payload
+    };
+
+  public:
+    /**
+     * @class Call
+     * @brief A bound handler call, invocable with the handler's context
+     */
+    class Call {
+      public:
+        /// @brief Runs the handler with the bound payload
+        void operator()(Context... context) const {
+            invoke(std::forward<Context>(context)..., payload.bytes.data());
+        }
+
+        /// @brief Gets the handler ID and payload to save
+        const SavedPayload &saved() const noexcept { return payload; }
+
+      private:
+        friend class HandlerTable;
+
+        Call(invoke_type invoke, const SavedPayload &payload) : invoke(invoke), payload(payload) {}
+
+        invoke_type invoke;
+        SavedPayload payload;
+    };
+
+    /**
+     * @brief Registers a handler
+     * @tparam Payload Trivially copyable payload type
+     * @tparam Fn The handler
+     * @param id ID to register the handler under, stable across runs
+     */
+    template <typename Payload, void (*Fn)(Context..., const Payload &)>
+    void add(entt::id_type id) {
+        static_assert(std::is_trivially_copyable_v<Payload>, "Payloads are saved as raw bytes");
+        static_assert(sizeof(Payload) <= savedPayloadCapacity, "Payload too large");
+        entries.insert_or_assign(id, Entry{&trampoline<Payload, Fn>, sizeof(Payload),
+                                           entt::type_hash<Payload>::value()});
+    }
+
+    /**
+     * @brief Registers a handler under an ID derived from the handler itself
+     * @return The ID, stable across runs of the same build
+     *
+     * Register handlers whose calls are saved or sent to other processes
+     * under an explicit ID instead, so renaming the function or switching
+     * compilers does not change it.
+     */
+    template <typename Payload, void (*Fn)(Context..., const Payload &)> entt::id_type add() {
+        entt::id_type id = defaultId<Payload, Fn>();
+        add<Payload, Fn>(id);
+        return id;
+    }
+
+    /// @brief Gets the ID add() without an ID registers a handler under
+    template <typename Payload, void (*Fn)(Context..., const Payload &)>
+    static entt::id_type defaultId() {
+        return entt::type_hash<std::integral_constant<decltype(Fn), Fn>>::value();
+    }
+
+    /// @brief Checks whether a handler is registered under an ID
+    bool contains(entt::id_type id) const { return entries.find(id) != entries.end(); }
+
+    /**
+     * @brief Binds a registered handler to a payload
+     * @param id ID of the handler
+     * @param payload The payload, copied into the call
+     * @return The call, to be scheduled as an action or event
+     * @throws std::out_of_range if no handler is registered under id, or it
+     *         takes a payload of a different type
+     *
+     * The payload's bytes are saved and hashed as they are, so it may not
+     * have padding: equal payloads must have equal bytes on every node.
+     */
+    template <typename Payload> Call bind(entt::id_type id, const Payload &payload) const {
+        static_assert(std::is_trivially_copyable_v<Payload>, "Payloads are saved as raw bytes");
+        static_assert(std::has_unique_object_representations_v<Payload>,
+                      "Payloads are hashed as raw bytes, so they must not have padding");
+        static_assert(sizeof(Payload) <= savedPayloadCapacity, "Payload too large");
+        SavedPayload saved;
+        saved.handler = id;
+        saved.size = sizeof(Payload);
+        std::memcpy(saved.bytes.data(), &payload, sizeof(Payload));
+        auto it = entries.find(id);
+        if (it == entries.end() || it->second.type != entt::type_hash<Payload>::value()) {
+            throw std::out_of_range("No handler registered for this payload");
+        }
+        return Call(it->second.invoke, saved);
+    }
+
+    /**
+     * @brief Rebuilds a saved call
+     * @param saved Handler ID and payload, for example read from a snapshot
+     * @return The call, or nothing if the handler is unknown or the payload
+     *         size does not match
+     */
+    std::optional<Call> restore(const SavedPayload &saved) const {
+        auto it = entries.find(saved.handler);
+        if (it == entries.end() || it->second.size != saved.size) {
+            return std::nullopt;
+        }
+        return Call(it->second.invoke, saved);
+    }
+
+  private:
+    template <typename Payload, void (*Fn)(Context..., const Payload &)>
+    static void trampoline(Context... context, const unsigned char *bytes) {
+        alignas(Payload) unsigned char storage[sizeof(Payload)];
+        std::memcpy(storage, bytes, sizeof(Payload));
+        Fn(std::forward<Context>(context)..., *std::launder(reinterpret_cast<Payload *>(storage)));
+    }
+
+    entt::dense_map<entt::id_type, Entry> entries;
+};
+
+/// @brief Handlers of saveable scheduler actions
+using ActionHandlers = HandlerTable<entt::entity, entt::registry &>;
+
+/// @brief Handlers of saveable timed events
+using EventHandlers = HandlerTable<>;
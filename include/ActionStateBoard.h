@@ -0,0 +1,202 @@
+/**
+ * @file ActionStateBoard.h
+ * @brief Per-ID atomic state words, so other threads can cancel pending actions.
+ *
+ * A network thread that receives an "interrupt cast" packet wants the cast
+ * to stop right away, not after a message has reached the main thread. The
+ * scheduler's own bookkeeping is not thread-safe, so the board keeps a
+ * separate atomic word per ID slot that any thread can flip from pending to
+ * cancelled. The owner thread claims each action with a compare-and-swap
+ * just before running it, so exactly one of the two wins.
+ */
+#pragma once
+
+#include "SlotMap.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/// @brief Life cycle of an action as seen by ActionStateBoard
+enum class ActionState : std::uint8_t {
+    pending,   ///< Queued, may still be cancelled
+    cancelled, ///< Cancelled from some thread, dropped when the owner reaches it
+    running,   ///< Claimed by the owner thread to run
+    done,      ///< Ran, or was removed by the owner thread
+};
+
+/**
+ * @class ActionStateBoard
+ * @brief Lock-free table of one state word per ID slot
+ * @tparam Id The 32-bit ID type
+ * @tparam Traits Bit layout of the IDs, at most 24 bits of index
+ *
+ * A word packs the full ID, an epoch and the state, so a word left behind by
+ * an earlier action of the same slot, or from before expire(), never matches
+ * the ID being cancelled. Words live in pages allocated by the owner thread
+ * and never moved, so readers need no lock while the table grows.
+ *
+ * Only cancel() and state() may be called from other threads; every other
+ * method belongs to the thread that owns the scheduler.
+ */
+template <typename Id, typename Traits = SlotIdTraits<Id>> class ActionStateBoard {
+    static_assert(sizeof(Id) <= sizeof(std::uint32_t), "The ID must fit in 32 bits");
+    static_assert(Traits::index_bits <= 24, "The page directory covers 24 bits of index");
+
+  public:
+    ActionStateBoard() = default;
+    ActionStateBoard(const ActionStateBoard &) = delete;
+    ActionStateBoard &operator=(const ActionStateBoard &) = delete;
+
+    ~ActionStateBoard() {
+        for (std::size_t i = 0; i < pageCount; ++i) {
+            delete[] pages[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Marks an ID as pending, on the owner thread
+     * @param id The ID of an action just queued
+     * @param periodic Whether the action runs more than once, so that a
+     *        cancel() while it runs still stops its later runs
+     */
+    void publish(Id id, bool periodic) {
+        std::size_t index = id & Traits::index_mask;
+        std::atomic<std::uint64_t> *page = pages[index / pageSize].load(std::memory_order_relaxed);
+        if (page == nullptr) {
+            page = new std::atomic<std::uint64_t>[pageSize]();
+            pages[index / pageSize].store(page, std::memory_order_release);
+        }
+        page[index % pageSize].store(pack(id, ActionState::pending, periodic),
+                                     std::memory_order_release);
+    }
+
+    /**
+     * @brief Cancels a pending action, from any thread
+     * @param id The ID of the action
+     * @return true if the action will not run again, false if it was not
+     *         pending, already cancelled, or is a one-shot action running now
+     */
+    bool cancel(Id id) {
+        std::atomic<std::uint64_t> *word = find(id);
+        if (word == nullptr) {
+            return false;
+        }
+        std::uint64_t current = word->load(std::memory_order_acquire);
+        for (;;) {
+            if (!matches(current, id)) {
+                return false;
+            }
+            ActionState state = stateOf(current);
+            if (state != ActionState::pending &&
+                !(state == ActionState::running && (current & periodicBit) != 0)) {
+                return false;
+            }
+            if (word->compare_exchange_weak(current, with(current, ActionState::cancelled),
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+                return true;
+            }
+        }
+    }
+
+    /**
+     * @brief Claims a pending action to run it, on the owner thread
+     * @return false if the action was cancelled, true otherwise
+     *
+     * Claiming an action already claimed succeeds again.
+     */
+    bool claim(Id id) { return transition(id, ActionState::pending, ActionState::running); }
+
+    /**
+     * @brief Returns a claimed periodic action to pending once re-armed, on the owner thread
+     * @return false if the action was cancelled while it ran
+     */
+    bool requeue(Id id) { return transition(id, ActionState::running, ActionState::pending); }
+
+    /// @brief Marks an action as gone, on the owner thread
+    void retire(Id id) {
+        if (std::atomic<std::uint64_t> *word = find(id)) {
+            std::uint64_t current = word->load(std::memory_order_relaxed);
+            if (matches(current, id)) {
+                word->store(with(current, ActionState::done), std::memory_order_release);
+            }
+        }
+    }
+
+    /// @brief Checks whether an action was cancelled and not dropped yet, from any thread
+    bool cancelled(Id id) const { return state(id) == ActionState::cancelled; }
+
+    /// @brief Gets the state of an ID, from any thread; done for IDs the board does not know
+    ActionState state(Id id) const {
+        const std::atomic<std::uint64_t> *word = find(id);
+        if (word == nullptr) {
+            return ActionState::done;
+        }
+        std::uint64_t current = word->load(std::memory_order_acquire);
+        return matches(current, id) ? stateOf(current) : ActionState::done;
+    }
+
+    /**
+     * @brief Forgets every word at once, on the owner thread
+     *
+     * For BasicScheduler::clear(). Must not run concurrently with cancel().
+     */
+    void expire() {
+        epoch.store((epoch.load(std::memory_order_relaxed) + 1) & epochMask,
+                    std::memory_order_release);
+    }
+
+  private:
+    static constexpr std::size_t pageSize = 4096;
+    static constexpr std::size_t pageCount =
+        (std::size_t{Traits::index_mask} + pageSize) / pageSize;
+    static constexpr std::uint64_t stateMask = 0x3;
+    static constexpr std::uint64_t periodicBit = 0x4;
+    static constexpr std::uint32_t epochMask = 0xFFFFFF;
+
+    std::atomic<std::uint64_t> *find(Id id) const {
+        std::size_t index = id & Traits::index_mask;
+        std::atomic<std::uint64_t> *page = pages[index / pageSize].load(std::memory_order_acquire);
+        return page != nullptr ? page + index % pageSize : nullptr;
+    }
+
+    /// Moves a word of the current epoch from one state to another; false if it was cancelled
+    bool transition(Id id, ActionState from, ActionState to) {
+        std::atomic<std::uint64_t> *word = find(id);
+        if (word == nullptr) {
+            return true;
+        }
+        std::uint64_t current = word->load(std::memory_order_acquire);
+        while (matches(current, id) && stateOf(current) == from) {
+            if (word->compare_exchange_weak(current, with(current, to), std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+                return true;
+            }
+        }
+        return !matches(current, id) || stateOf(current) != ActionState::cancelled;
+    }
+
+    std::uint64_t pack(Id id, ActionState state, bool periodic) const {
+        return (std::uint64_t{id} << 32) |
+               (std::uint64_t{epoch.load(std::memory_order_relaxed)} << 8) |
+               (periodic ? periodicBit : 0) | static_cast<std::uint64_t>(state);
+    }
+
+    bool matches(std::uint64_t word, Id id) const {
+        return static_cast<Id>(word >> 32) == id &&
+               ((word >> 8) & epochMask) == epoch.load(std::memory_order_acquire);
+    }
+
+    static ActionState stateOf(std::uint64_t word) {
+        return static_cast<ActionState>(word & stateMask);
+    }
+
+    static std::uint64_t with(std::uint64_t word, ActionState state) {
+        return (word & ~stateMask) | static_cast<std::uint64_t>(state);
+    }
+
+    std::unique_ptr<std::atomic<std::atomic<std::uint64_t> *>[]> pages{
+        new std::atomic<std::atomic<std::uint64_t> *>[pageCount]()};
+    std::atomic<std::uint32_t> epoch{0};
+};
@@ -0,0 +1,515 @@
+/**
+ * @file AdaptiveQueue.h
+ * @brief Queue backend that picks heap, calendar or wheel from the workload it sees.
+ *
+ * No queue backend is best all day. Quiet hours run long timers, where the
+ * heap does well and the ring of a calendar queue sits empty; raid nights
+ * bring dense bursts a few ticks out, which the calendar queue handles in
+ * O(1), and heavy cancellation, which leaves the calendar's buckets full of
+ * stale entries while the timing wheel unlinks in O(1). AdaptiveQueue samples
+ * the delays of the nodes pushed into it and the share of them cancelled,
+ * and rebuilds itself on another structure, in O(n), at the first tick
+ * boundary after the workload has changed.
+ *
+ * Nodes stay in a pool of their own, so handles survive a rebuild and the
+ * schedulers need not know about it. The structures order small keys that
+ * point into the pool.
+ */
+#pragma once
+
+#include "CalendarQueue.h"
+#include "HeapQueue.h"
+#include "TimingWheel.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/// @brief Structure an AdaptiveQueue currently orders its nodes with
+enum class QueueStructure : std::uint8_t {
+    heap,     ///< HeapQueue, for long or mixed delays
+    calendar, ///< CalendarQueue, for short delays and few cancellations
+    wheel,    ///< TimingWheel, for short delays and many cancellations
+};
+
+/// @brief Gets the name of a queue structure, for logs and metrics
+constexpr const char *queueStructureName(QueueStructure structure) {
+    switch (structure) {
+    case QueueStructure::calendar:
+        return "calendar";
+    case QueueStructure::wheel:
+        return "wheel";
+    default:
+        return "heap";
+    }
+}
+
+/**
+ * @struct AdaptivePolicy
+ * @brief When an AdaptiveQueue changes structure
+ *
+ * Every window of pushes is one sample. A structure is picked as follows:
+ * the heap if the nodes have different ranks, which only the heap orders by,
+ * or if fewer than shortShare of the delays were below shortDelay; otherwise
+ * the wheel if at least cancelShare of the pushes were cancelled, and the
+ * calendar if not. The queue moves only when two samples in a row agree.
+ */
+struct AdaptivePolicy {
+    /// @brief Pushes per sample
+    std::size_t window = 4096;
+
+    /// @brief Delays below this many ticks count as short; also the calendar's horizon
+    int shortDelay = 256;
+
+    /// @brief Share of short delays from which a calendar or a wheel is picked
+    double shortShare = 0.9;
+
+    /// @brief Share of pushes cancelled from which a wheel is picked over a calendar
+    double cancelShare = 0.25;
+
+    /// @brief Fewest queued nodes worth a rebuild
+    std::size_t minimumSize = 256;
+};
+
+/**
+ * @struct AdaptiveQueueStatus
+ * @brief Which structure an AdaptiveQueue uses and the sample that chose it
+ */
+struct AdaptiveQueueStatus {
+    QueueStructure structure = QueueStructure::heap; ///< Structure in use
+    const char *reason = "initial";                  ///< Why it was picked
+    double shortShare = 0.0;     ///< Share of short delays in the last sample
+    double cancelShare = 0.0;    ///< Share of pushes cancelled in the last sample
+    std::size_t samples = 0;     ///< Samples taken
+    std::size_t migrations = 0;  ///< Rebuilds onto another structure
+};
+
+/**
+ * @class AdaptiveQueue
+ * @brief Queue backend that moves between a heap, a calendar queue and a timing wheel
+ * @tparam Node The type stored in the queue
+ * @tparam Traits Ordering traits for Node
+ * @tparam Allocator Allocator of the node pool, rebound for the structures
+ *
+ * Starts as a heap. Nodes leave in the same order whatever the structure:
+ * by tick, then by rank, then in insertion order, a modified node counting
+ * as the latest pushed. Costs one pool lookup per operation more than the
+ * structure it uses.
+ *
+ * @code
+ * AdaptiveScheduler scheduler;
+ * // ...
+ * const AdaptiveQueueStatus &status = scheduler.backend().status();
+ * log("queue: %s (%s)", queueStructureName(status.structure), status.reason);
+ * @endcode
+ */
+template <typename Node, typename Traits = QueueNodeTraits<Node>,
+          typename Allocator = std::allocator<Node>>
+class AdaptiveQueue {
+    /// What the structures order: a node's position in the order and its pool slot
+    struct Key {
+        int tick = 0;
+        std::uint32_t rank = 0;
+        std::uint64_t sequence = 0; ///< Insertion order, kept across rebuilds
+        std::uint32_t slot = 0;
+    };
+
+    struct KeyTraits {
+        static int tick(const Key &key) { return key.tick; }
+        static std::uint32_t rank(const Key &key) { return key.rank; }
+    };
+
+    template <typename Type>
+    using Rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<Type>;
+
+    using Heap = HeapQueue<Key, KeyTraits, 4, Rebind<Key>>;
+    using Calendar = CalendarQueue<Key, KeyTraits>;
+    using Wheel = TimingWheel<Key, 8, 4, KeyTraits, Rebind<Key>>;
+
+    static constexpr std::uint32_t unqueued = ~std::uint32_t{0};
+
+    /// Pooled node and the handle of its key in the structure
+    struct Entry {
+        Node value;
+        std::uint32_t handle = unqueued;
+    };
+
+  public:
+    /// @brief Stable reference to a queued node, kept across rebuilds
+    using handle_type = std::uint32_t;
+
+    /// @brief Allocator the node pool draws from
+    using allocator_type = Allocator;
+
+    AdaptiveQueue() : AdaptiveQueue(allocator_type{}) {}
+
+    /// @brief Constructs an empty queue whose memory comes from an allocator
+    explicit AdaptiveQueue(const allocator_type &allocator, AdaptivePolicy policy = {})
+        : allocator(allocator), entries(Rebind<Entry>(allocator)),
+          freeSlots(Rebind<std::uint32_t>(allocator)), structure(Heap(Rebind<Key>(allocator))),
+          policy(policy) {}
+
+    /// @brief Gets the allocator of the queue
+    allocator_type get_allocator() const { return allocator; }
+
+    /// @brief Sets when the queue changes structure, from the next sample on
+    void setPolicy(const AdaptivePolicy &value) { policy = value; }
+
+    /// @brief Gets the structure in use and why it was picked
+    const AdaptiveQueueStatus &status() const { return state; }
+
+    /**
+     * @brief Rebuilds the queue on a structure now and stops adapting
+     * @param to The structure to use
+     *
+     * For benchmarks and for workloads known in advance. resumeAdapting()
+     * lets the samples decide again.
+     */
+    void pin(QueueStructure to) {
+        pinned = true;
+        if (to != state.structure) {
+            rebuild(to);
+            ++state.migrations;
+        }
+        state.reason = "pinned";
+    }
+
+    /// @brief Lets the samples pick the structure again after pin()
+    void resumeAdapting() { pinned = false; }
+
+    /**
+     * @brief Adds a node to the queue
+     * @param node The node to insert, moved into the queue's node pool
+     * @return Handle that can be used to erase the node
+     */
+    handle_type push(Node &&node) {
+        std::uint32_t slot = allocate(std::move(node));
+        Key key = keyOf(slot, true);
+        entries[slot].handle = visit([&key](auto &queue) { return queue.push(std::move(key)); });
+        ++count;
+        return slot;
+    }
+
+    /**
+     * @brief Adds a range of nodes
+     * @param first Iterator to the first node, nodes are moved from
+     * @param last Iterator past the last node
+     * @param onPush Called with the handle of each node, in range order
+     */
+    template <typename It, typename OnPush> void pushBulk(It first, It last, OnPush &&onPush) {
+        scratch.clear();
+        for (; first != last; ++first) {
+            scratch.push_back(keyOf(allocate(std::move(*first)), true));
+        }
+        std::size_t index = 0;
+        visit([this, &index, &onPush](auto &queue) {
+            queue.pushBulk(scratch.begin(), scratch.end(), [this, &index, &onPush](auto handle) {
+                std::uint32_t slot = scratch[index++].slot;
+                entries[slot].handle = handle;
+                onPush(slot);
+            });
+        });
+        count += scratch.size();
+    }
+
+    /// @brief Reserves room for a number of queued nodes
+    void reserve(std::size_t capacity) {
+        entries.reserve(capacity);
+        visit([capacity](auto &queue) { queue.reserve(capacity); });
+    }
+
+    /**
+     * @brief Removes a queued node immediately
+     * @param handle Handle returned by push()
+     * @return true if the node was queued and has been removed
+     */
+    bool erase(handle_type handle) {
+        if (handle >= entries.size() || entries[handle].handle == unqueued) {
+            return false;
+        }
+        std::uint32_t inner = entries[handle].handle;
+        visit([inner](auto &queue) { queue.erase(inner); });
+        release(handle);
+        --count;
+        ++cancels;
+        return true;
+    }
+
+    /**
+     * @brief Changes a queued node in place and moves it to its new position
+     * @param handle Handle returned by push()
+     * @param fn Called with a reference to the node, may change its tick
+     * @return true if the node was queued and has been modified
+     *
+     * A modified node is not a push: it does not count towards a sample.
+     */
+    template <typename F> bool modify(handle_type handle, F &&fn) {
+        if (handle >= entries.size() || entries[handle].handle == unqueued) {
+            return false;
+        }
+        fn(entries[handle].value);
+        Key key = keyOf(handle, false);
+        return visit([this, handle, &key](auto &queue) {
+            return queue.modify(entries[handle].handle, [&key](Key &stored) { stored = key; });
+        });
+    }
+
+    /**
+     * @brief Removes the next node that is due at or before the given tick
+     * @param currentTick The current system tick
+     * @param out Receives the removed node by move assignment
+     * @return true if a node was removed, false if nothing is due
+     *
+     * A call for a later tick than every call before it is a tick boundary,
+     * where the queue may change structure.
+     */
+    bool popDue(int currentTick, Node &out) {
+        if (!started || currentTick > cursor) {
+            cursor = currentTick;
+            started = true;
+            if (pushes >= policy.window) {
+                sample();
+            }
+        }
+        Key key;
+        if (!visit([currentTick, &key](auto &queue) { return queue.popDue(currentTick, key); })) {
+            return false;
+        }
+        out = std::move(entries[key.slot].value);
+        release(key.slot);
+        --count;
+        return true;
+    }
+
+    /// @brief Gets the tick of the earliest queued node, or nothing if the queue is empty
+    std::optional<int> nextTick() const {
+        return visit([](const auto &queue) { return queue.nextTick(); });
+    }
+
+    /// @brief Counts the queued nodes due at or before a tick
+    std::size_t countDue(int currentTick) const {
+        if (const Heap *heap = std::get_if<Heap>(&structure)) {
+            return heap->countDue(currentTick);
+        }
+        std::size_t due = 0;
+        forEachKey([currentTick, &due](const Key &key) { due += key.tick <= currentTick; });
+        return due;
+    }
+
+    /// @brief Gets the number of queued nodes
+    std::size_t size() const { return count; }
+
+    /// @brief Checks whether the queue is empty
+    bool empty() const { return count == 0; }
+
+    /**
+     * @brief Visits every queued node, in no particular order
+     * @param fn Called with a const reference to each node
+     */
+    template <typename F> void forEach(F &&fn) const {
+        forEachKey([this, &fn](const Key &key) {
+            fn(static_cast<const Node &>(entries[key.slot].value));
+        });
+    }
+
+    /// @brief Gets the number of node slots in the pool, queued or free
+    std::size_t poolSize() const { return entries.size(); }
+
+    /**
+     * @brief Packs the queued nodes into a pool without free slots
+     * @param onMove Called as onMove(node, newHandle) for every queued node
+     *
+     * O(n), and rebuilds the structure. Every handle changes.
+     */
+    template <typename OnMove> void compact(OnMove &&onMove) {
+        std::vector<Entry, Rebind<Entry>> packed{Rebind<Entry>(allocator)};
+        packed.reserve(count);
+        for (Entry &entry : entries) {
+            if (entry.handle != unqueued) {
+                auto slot = static_cast<std::uint32_t>(packed.size());
+                packed.push_back(std::move(entry));
+                entry.handle = slot; // Where the node went, read back below
+                onMove(static_cast<const Node &>(packed.back().value), slot);
+            }
+        }
+        collect();
+        for (Key &key : scratch) {
+            key.slot = entries[key.slot].handle;
+        }
+        entries = std::move(packed);
+        freeSlots.clear();
+        freeSlots.shrink_to_fit();
+        refill(state.structure);
+    }
+
+    /// @brief Removes every queued node, keeping allocated capacity and the structure
+    void clear() {
+        entries.clear();
+        freeSlots.clear();
+        visit([](auto &queue) { queue.clear(); });
+        count = 0;
+    }
+
+  private:
+    template <typename F> decltype(auto) visit(F &&fn) { return std::visit(fn, structure); }
+
+    template <typename F> decltype(auto) visit(F &&fn) const {
+        return std::visit(fn, structure);
+    }
+
+    template <typename F> void forEachKey(F &&fn) const {
+        visit([&fn](const auto &queue) { queue.forEach(fn); });
+    }
+
+    std::uint32_t allocate(Node &&node) {
+        std::uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            entries[slot].value = std::move(node);
+        } else {
+            slot = static_cast<std::uint32_t>(entries.size());
+            entries.push_back(Entry{std::move(node), unqueued});
+        }
+        return slot;
+    }
+
+    void release(std::uint32_t slot) {
+        entries[slot].value = Node{};
+        entries[slot].handle = unqueued;
+        freeSlots.push_back(slot);
+    }
+
+    /// Builds the key of a pooled node and notes its rank; only pushes are sampled
+    Key keyOf(std::uint32_t slot, bool pushed) {
+        const Node &node = entries[slot].value;
+        Key key{Traits::tick(node), Traits::rank(node), sequence++, slot};
+        if (pushed && pushes == 0 && !ranked) {
+            firstRank = key.rank;
+        }
+        // A modified node may change rank too, and only the heap orders by rank
+        ranked = ranked || key.rank != firstRank;
+        if (!pushed) {
+            return key;
+        }
+        if (started && static_cast<std::int64_t>(key.tick) - cursor < policy.shortDelay) {
+            ++shortDelays;
+        }
+        ++pushes;
+        return key;
+    }
+
+    /// Closes a sample and moves to the structure it picks if the last one agreed
+    void sample() {
+        state.shortShare = static_cast<double>(shortDelays) / static_cast<double>(pushes);
+        state.cancelShare =
+            std::min(1.0, static_cast<double>(cancels) / static_cast<double>(pushes));
+        ++state.samples;
+        const char *reason = nullptr;
+        QueueStructure pick = choose(reason);
+        bool agreed = pick == lastPick;
+        lastPick = pick;
+        pushes = 0;
+        shortDelays = 0;
+        cancels = 0;
+        if (pinned || !agreed) {
+            return;
+        }
+        if (pick == state.structure) {
+            state.reason = reason;
+            return;
+        }
+        if (count < policy.minimumSize) {
+            return;
+        }
+        rebuild(pick);
+        state.structure = pick;
+        state.reason = reason;
+        ++state.migrations;
+    }
+
+    QueueStructure choose(const char *&reason) const {
+        if (ranked) {
+            reason = "ranks in use, only the heap orders by rank";
+            return QueueStructure::heap;
+        }
+        if (state.shortShare < policy.shortShare) {
+            reason = "mostly long delays";
+            return QueueStructure::heap;
+        }
+        if (state.cancelShare >= policy.cancelShare) {
+            reason = "short delays with heavy cancellation";
+            return QueueStructure::wheel;
+        }
+        reason = "short delays with few cancellations";
+        return QueueStructure::calendar;
+    }
+
+    /// Moves every key onto a new structure, in the order they leave the queue
+    void rebuild(QueueStructure to) {
+        collect();
+        refill(to);
+        state.structure = to;
+    }
+
+    /// Copies the keys of the structure into scratch, in the order they leave the queue
+    void collect() {
+        scratch.clear();
+        scratch.reserve(count);
+        forEachKey([this](const Key &key) { scratch.push_back(key); });
+        std::sort(scratch.begin(), scratch.end(), [](const Key &a, const Key &b) {
+            if (a.tick != b.tick) {
+                return a.tick < b.tick;
+            }
+            return a.rank != b.rank ? a.rank < b.rank : a.sequence < b.sequence;
+        });
+    }
+
+    /// Replaces the structure by a new one holding the keys in scratch
+    void refill(QueueStructure to) {
+        // The new structure starts at the earliest tick still queued, so nothing is late
+        int start = scratch.empty() ? cursor : std::min(cursor, scratch.front().tick);
+        switch (to) {
+        case QueueStructure::calendar:
+            structure.template emplace<Calendar>(static_cast<std::size_t>(policy.shortDelay),
+                                                 start);
+            break;
+        case QueueStructure::wheel:
+            structure.template emplace<Wheel>(Rebind<Key>(allocator), start);
+            break;
+        default:
+            structure.template emplace<Heap>(Rebind<Key>(allocator));
+            break;
+        }
+        std::size_t index = 0;
+        visit([this, &index](auto &queue) {
+            queue.reserve(scratch.size());
+            queue.pushBulk(scratch.begin(), scratch.end(), [this, &index](auto handle) {
+                entries[scratch[index++].slot].handle = handle;
+            });
+        });
+    }
+
+    allocator_type allocator;
+    std::vector<Entry, Rebind<Entry>> entries;                ///< Node pool
+    std::vector<std::uint32_t, Rebind<std::uint32_t>> freeSlots; ///< Free pool slots
+    std::variant<Heap, Calendar, Wheel> structure;           ///< Orders the keys
+    std::vector<Key> scratch;                                ///< Keys of a bulk push or a rebuild
+    std::size_t count = 0;                                   ///< Queued nodes
+    std::uint64_t sequence = 0;                              ///< Next insertion order
+    AdaptivePolicy policy;
+    AdaptiveQueueStatus state;
+    int cursor = 0;       ///< Latest tick popDue() was called for
+    bool started = false; ///< popDue() was called, so delays can be measured
+    bool pinned = false;  ///< Set by pin()
+    bool ranked = false;  ///< Nodes with different ranks were pushed
+    std::uint32_t firstRank = 0;
+    std::size_t pushes = 0;      ///< Pushes in the current sample
+    std::size_t shortDelays = 0; ///< Pushes of the current sample with a short delay
+    std::size_t cancels = 0;     ///< Erases in the current sample
+    QueueStructure lastPick = QueueStructure::heap; ///< What the previous sample picked
+};
@@ -0,0 +1,314 @@
+/**
+ * @file AllocationCounter.h
+ * @brief Heap allocation counts per scheduler call site, for profiling builds.
+ *
+ * Steady-state ticks are meant to allocate nothing, but nothing showed when
+ * they did. With SCHEDULER_COUNT_ALLOCATIONS defined (the CMake option of the
+ * same name), the scheduler's update, schedule and dispatch paths open an
+ * AllocationCounter::Scope named after the call site, or after the event
+ * type being published or executed, and the global operator new defined by
+ * SCHEDULER_ALLOCATION_HOOKS adds every allocation to each scope open on the
+ * calling thread. report() lists the totals and withinBudget() checks them,
+ * so CI perf jobs can fail a run that allocates.
+ *
+ * Without SCHEDULER_COUNT_ALLOCATIONS the scopes and the hooks expand to
+ * nothing and nothing is counted.
+ */
+#pragma once
+
+#include "entt/core/type_info.hpp"
+
+#if defined(SCHEDULER_COUNT_ALLOCATIONS)
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <string_view>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct AllocationTally
+ * @brief Allocations made while a scope was open
+ */
+struct AllocationTally {
+    std::uint64_t calls = 0;       ///< Times the scope was opened
+    std::uint64_t allocations = 0; ///< Calls to operator new inside it, nested scopes included
+    std::uint64_t bytes = 0;       ///< Bytes those calls asked for
+};
+
+/**
+ * @class AllocationCounter
+ * @brief Process-wide table of allocation tallies keyed by call site
+ *
+ * Sites are identified by their name, which must outlive the program: a
+ * string literal or an entt::type_name. The table holds up to maxSites sites;
+ * later ones are not counted. Counting itself never allocates, so it is safe
+ * inside operator new.
+ *
+ * @code
+ * // In exactly one translation unit
+ * SCHEDULER_ALLOCATION_HOOKS
+ *
+ * // In a CI perf job, after warming up
+ * AllocationCounter::reset();
+ * for (int tick = 0; tick < 1000; ++tick) {
+ *     scheduler.update(tick, registry, dispatcher);
+ *     dispatcher.update();
+ * }
+ * AllocationCounter::report(std::cout);
+ * if (!AllocationCounter::withinBudget("Scheduler::update", 0, 0, &std::cerr)) {
+ *     return 1;
+ * }
+ * @endcode
+ */
+class AllocationCounter {
+    struct Slot;
+
+  public:
+    /// @brief Number of distinct sites the table can hold
+    static constexpr std::size_t maxSites = 256;
+
+    /// @brief Deepest nesting of scopes counted on one thread
+    static constexpr std::size_t maxDepth = 16;
+
+    /**
+     * @class Scope
+     * @brief Counts the allocations of the calling thread until it is destroyed
+     */
+    class Scope {
+      public:
+        explicit Scope(std::string_view site) : slot(find(site)) {
+            Stack &stack = threadStack();
+            if (slot != nullptr) {
+                slot->calls.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (stack.depth < maxDepth) {
+                stack.slots[stack.depth] = slot;
+            }
+            ++stack.depth;
+        }
+
+        ~Scope() { --threadStack().depth; }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        Slot *slot;
+    };
+
+    /// @brief Adds an allocation to every scope open on the calling thread, called by the hooks
+    static void onAllocate(std::size_t bytes) noexcept {
+        Stack &stack = threadStack();
+        std::size_t depth = stack.depth < maxDepth ? stack.depth : maxDepth;
+        for (std::size_t i = 0; i < depth; ++i) {
+            if (Slot *slot = stack.slots[i]) {
+                slot->allocations.fetch_add(1, std::memory_order_relaxed);
+                slot->bytes.fetch_add(bytes, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief Gets the tally of a site, zero if it never ran
+    static AllocationTally get(std::string_view site) {
+        for (Slot &slot : table()) {
+            if (slot.used.load(std::memory_order_acquire) && slot.name == site) {
+                return tally(slot);
+            }
+        }
+        return AllocationTally{};
+    }
+
+    /// @brief Gets every site that ran, in the order they first did
+    static std::vector<std::pair<std::string_view, AllocationTally>> sites() {
+        std::vector<std::pair<std::string_view, AllocationTally>> result;
+        for (Slot &slot : table()) {
+            if (!slot.used.load(std::memory_order_acquire)) {
+                break;
+            }
+            result.emplace_back(slot.name, tally(slot));
+        }
+        return result;
+    }
+
+    /// @brief Writes one line per site: name, calls, allocations, bytes and allocations per call
+    static void report(std::ostream &out) {
+        for (const auto &[name, counts] : sites()) {
+            out << name << ": " << counts.calls << " calls, " << counts.allocations
+                << " allocations, " << counts.bytes << " bytes";
+            if (counts.calls != 0) {
+                out << ", " << static_cast<double>(counts.allocations) / counts.calls
+                    << " per call";
+            }
+            out << '\n';
+        }
+    }
+
+    /**
+     * @brief Checks a site against an allocation budget
+     * @param site The call site or event type
+     * @param allocations Most allocations allowed since the last reset()
+     * @param bytes Most bytes allowed since the last reset()
+     * @param log Optional stream told about a site over budget
+     * @return true if the site stayed within both limits
+     */
+    static bool withinBudget(std::string_view site, std::uint64_t allocations,
+                             std::uint64_t bytes, std::ostream *log = nullptr) {
+        AllocationTally counts = get(site);
+        bool ok = counts.allocations <= allocations && counts.bytes <= bytes;
+        if (!ok && log != nullptr) {
+            *log << site << " allocated " << counts.allocations << " times (" << counts.bytes
+                 << " bytes), budget " << allocations << " (" << bytes << " bytes)\n";
+        }
+        return ok;
+    }
+
+    /// @brief Zeroes every tally, keeping the sites; call while no scope is open
+    static void reset() {
+        for (Slot &slot : table()) {
+            slot.calls.store(0, std::memory_order_relaxed);
+            slot.allocations.store(0, std::memory_order_relaxed);
+            slot.bytes.store(0, std::memory_order_relaxed);
+        }
+    }
+
+  private:
+    struct Slot {
+        std::atomic<bool> used{false};
+        std::atomic<bool> claimed{false};
+        std::string_view name;
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> allocations{0};
+        std::atomic<std::uint64_t> bytes{0};
+    };
+
+    struct Stack {
+        Slot *slots[maxDepth];
+        std::size_t depth = 0;
+    };
+
+    static Slot *slots() {
+        static Slot table[maxSites];
+        return table;
+    }
+
+    /// The fixed table, for range-for
+    struct Table {
+        Slot *begin() const { return slots(); }
+        Slot *end() const { return slots() + maxSites; }
+    };
+
+    static Table table() { return Table{}; }
+
+    static Stack &threadStack() {
+        thread_local Stack stack{};
+        return stack;
+    }
+
+    /// Finds the slot of a site, claiming a free one the first time it is seen
+    static Slot *find(std::string_view site) {
+        for (Slot &slot : table()) {
+            if (!slot.used.load(std::memory_order_acquire)) {
+                bool expected = false;
+                if (slot.claimed.compare_exchange_strong(expected, true)) {
+                    slot.name = site;
+                    slot.used.store(true, std::memory_order_release);
+                    return &slot;
+                }
+                // Another thread is claiming it: wait for its name
+                while (!slot.used.load(std::memory_order_acquire)) {
+                }
+            }
+            if (slot.name == site) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    static AllocationTally tally(const Slot &slot) {
+        return AllocationTally{slot.calls.load(std::memory_order_relaxed),
+                               slot.allocations.load(std::memory_order_relaxed),
+                               slot.bytes.load(std::memory_order_relaxed)};
+    }
+};
+
+/// @brief Counts the allocations of the enclosing block under a site name
+#define SCHEDULER_ALLOCATION_SCOPE(site) AllocationCounter::Scope schedulerAllocationScope_(site)
+
+/**
+ * @brief Replaces the global operator new and delete with counting versions
+ *
+ * Expand it at namespace scope in exactly one translation unit of the program.
+ */
+#define SCHEDULER_ALLOCATION_HOOKS                                                               \
+    void *operator new(std::size_t size) {                                                       \
+        AllocationCounter::onAllocate(size);                                                     \
+        if (void *memory = std::malloc(size != 0 ? size : 1)) {                                  \
+            return memory;                                                                       \
+        }                                                                                        \
+        throw std::bad_alloc();                                                                  \
+    }                                                                                            \
+    void *operator new[](std::size_t size) { return ::operator new(size); }                      \
+    void *operator new(std::size_t size, const std::nothrow_t &) noexcept {                      \
+        AllocationCounter::onAllocate(size);                                                     \
+        return std::malloc(size != 0 ? size : 1);                                                \
+    }                                                                                            \
+    void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {                 \
+        return ::operator new(size, tag);                                                        \
+    }                                                                                            \
+    void *operator new(std::size_t size, std::align_val_t align) {                               \
+        AllocationCounter::onAllocate(size);                                                     \
+        std::size_t alignment = static_cast<std::size_t>(align);                                 \
+        std::size_t rounded = (size + alignment - 1) / alignment * alignment;                    \
+        if (void *memory = std::aligned_alloc(alignment, rounded != 0 ? rounded : alignment)) {  \
+            return memory;                                                                       \
+        }                                                                                        \
+        throw std::bad_alloc();                                                                  \
+    }                                                                                            \
+    void *operator new[](std::size_t size, std::align_val_t align) {                             \
+        return ::operator new(size, align);                                                      \
+    }                                                                                            \
+    void operator delete(void *memory) noexcept { std::free(memory); }                           \
+    void operator delete[](void *memory) noexcept { std::free(memory); }                         \
+    void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }              \
+    void operator delete[](void *memory, std::size_t) noexcept { std::free(memory); }            \
+    void operator delete(void *memory, std::align_val_t) noexcept { std::free(memory); }         \
+    void operator delete[](void *memory, std::align_val_t) noexcept { std::free(memory); }       \
+    void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {                 \
+        std::free(memory);                                                                       \
+    }                                                                                            \
+    void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept {               \
+        std::free(memory);                                                                       \
+    }
+
+#else
+
+#define SCHEDULER_ALLOCATION_SCOPE(site) static_cast<void>(0)
+#define SCHEDULER_ALLOCATION_HOOKS
+
+#endif
+
+/**
+ * @brief Publishes a dispatcher's queues with one allocation scope per event type
+ * @tparam Events Event types published one by one, each counted under its type name
+ * @param dispatcher An entt::dispatcher, whose own update() cannot be instrumented
+ *
+ * Types not listed are published afterwards under "dispatcher.update".
+ * Without SCHEDULER_COUNT_ALLOCATIONS it is a plain update, type by type.
+ */
+template <typename... Events, typename Dispatcher> void countedUpdate(Dispatcher &dispatcher) {
+    (
+        [&dispatcher] {
+            SCHEDULER_ALLOCATION_SCOPE(entt::type_name<Events>::value());
+            dispatcher.template update<Events>();
+        }(),
+        ...);
+    SCHEDULER_ALLOCATION_SCOPE("dispatcher.update");
+    dispatcher.update();
+}
@@ -0,0 +1,309 @@
+/**
+ * @file AsyncResourceLoader.h
+ * @brief Loads entt resources on background threads and hands them back through the event scheduler.
+ *
+ * entt::resource_cache calls its loader on the thread that asks for a
+ * resource, so a MapChangeEvent listener loading a map's assets stalls the
+ * simulation until every file is read and decoded. An AsyncResourceLoader
+ * keeps the resource_cache but fills it from I/O threads: load() queues the
+ * file and returns a ResourceHandle right away, a worker reads and decodes the
+ * file, and the result is submitted to a TimedEventScheduler through the
+ * worker's Inbox. The cache is filled, and the callbacks run, by that event on
+ * the scheduler's thread at the next update.
+ *
+ * On POSIX systems files are mapped with mmap for the decoder; elsewhere, or
+ * with SCHEDULER_NO_MMAP defined, they are read into a buffer.
+ */
+#pragma once
+
+#include "TimedEventScheduler.h"
+#include "entt/entt.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(SCHEDULER_NO_MMAP)
+#define SCHEDULER_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @class ResourceHandle
+ * @brief Future-like handle to a resource being loaded by an AsyncResourceLoader
+ *
+ * Copies share the same state. The state changes only inside the completion
+ * event, so the handle is read from the scheduler's thread.
+ */
+template <typename Type> class ResourceHandle {
+  public:
+    /// @brief An empty handle, never ready
+    ResourceHandle() = default;
+
+    /// @brief Checks whether the load is over, successful or not
+    bool ready() const { return state && state->ready; }
+
+    /// @brief Checks whether the load is over and produced no resource
+    bool failed() const { return ready() && !state->value; }
+
+    /// @brief Gets the resource, empty until ready() and after a failure
+    entt::resource<Type> get() const {
+        return state ? entt::resource<Type>{state->value} : entt::resource<Type>{};
+    }
+
+  private:
+    template <typename, typename> friend class AsyncResourceLoader;
+
+    struct State {
+        std::shared_ptr<Type> value;
+        bool ready = false;
+    };
+
+    explicit ResourceHandle(std::shared_ptr<State> state) : state(std::move(state)) {}
+
+    std::shared_ptr<State> state;
+};
+
+/**
+ * @class AsyncResourceLoader
+ * @brief Fills an entt::resource_cache from files read on background threads
+ * @tparam Type The resource type
+ * @tparam Decoder Callable as std::shared_ptr<Type>(const unsigned char *data,
+ *         std::size_t size), run on the I/O threads; returns nullptr on failure
+ *
+ * The bytes passed to the decoder are only valid during the call. Loads of an
+ * identifier already cached complete at once; loads of an identifier already
+ * in flight share its handle. A file that cannot be read or decoded completes
+ * with an empty resource.
+ *
+ * The loader must be destroyed before the scheduler it submits to. Completion
+ * events still queued when the loader is destroyed do nothing.
+ *
+ * @code
+ * struct MapDecoder {
+ *     std::shared_ptr<MapData> operator()(const unsigned char *data, std::size_t size) const;
+ * };
+ * AsyncResourceLoader<MapData, MapDecoder> maps(events);
+ *
+ * void World::onMapChange(const GameEvents::MapChangeEvent &event) {
+ *     maps.load(tick, event.mapName.value(), mapPath(event.mapName),
+ *               [this](entt::id_type, entt::resource<MapData> map) { enterMap(map); });
+ * }
+ * dispatcher.sink<GameEvents::MapChangeEvent>().connect<&World::onMapChange>(world);
+ *
+ * // Every frame: the simulation keeps running while the map loads
+ * events.update(tick);
+ * @endcode
+ */
+template <typename Type, typename Decoder> class AsyncResourceLoader {
+  public:
+    /// @brief Adopts resources decoded by the I/O threads into the cache
+    struct AdoptLoader {
+        using result_type = std::shared_ptr<Type>;
+
+        result_type operator()(result_type value) const { return value; }
+    };
+
+    /// @brief The cache the loaded resources are kept in
+    using cache_type = entt::resource_cache<Type, AdoptLoader>;
+
+    /// @brief Called on the scheduler's thread once a load completes, with an empty resource on failure
+    using Callback = std::function<void(entt::id_type, entt::resource<Type>)>;
+
+    /**
+     * @brief Starts the I/O threads
+     * @param events The scheduler completions are submitted to, which must outlive the loader
+     * @param decoder Turns file bytes into a resource, called on the I/O threads
+     * @param threads Number of I/O threads, each with its own Inbox
+     *
+     * Opens one Inbox per thread, so it is called on the scheduler's thread.
+     */
+    explicit AsyncResourceLoader(TimedEventScheduler &events, Decoder decoder = {},
+                                 std::size_t threads = 1)
+        : decoder(std::move(decoder)), cache(std::make_shared<cache_type>()) {
+        threads = threads == 0 ? 1 : threads;
+        for (std::size_t i = 0; i < threads; ++i) {
+            TimedEventScheduler::Inbox &inbox = events.openInbox();
+            workers.emplace_back([this, &inbox] { work(inbox); });
+        }
+    }
+
+    AsyncResourceLoader(const AsyncResourceLoader &) = delete;
+    AsyncResourceLoader &operator=(const AsyncResourceLoader &) = delete;
+
+    /// @brief Drops the loads not started yet and waits for the others to be read
+    ~AsyncResourceLoader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            jobs.clear();
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Starts loading a resource, returning at once
+     * @param tick The current tick; completion is scheduled for tick + 1, or
+     *        the next update if reading takes longer
+     * @param id Identifier of the resource in the cache
+     * @param path The file to read
+     * @param onLoaded Optional callback run by the completion event
+     * @return The handle of the load
+     */
+    ResourceHandle<Type> load(int tick, entt::id_type id, std::string path,
+                              Callback onLoaded = nullptr) {
+        if (cache->contains(id)) {
+            auto state = std::make_shared<typename ResourceHandle<Type>::State>();
+            state->value = (*cache)[id].handle();
+            state->ready = true;
+            if (onLoaded) {
+                onLoaded(id, (*cache)[id]);
+            }
+            return ResourceHandle<Type>{std::move(state)};
+        }
+        if (auto found = inFlight.find(id); found != inFlight.end()) {
+            if (onLoaded) {
+                found->second->callbacks.push_back(std::move(onLoaded));
+            }
+            return ResourceHandle<Type>{found->second->state};
+        }
+        auto job = std::make_shared<Job>();
+        job->tick = tick + 1;
+        job->id = id;
+        job->path = std::move(path);
+        job->state = std::make_shared<typename ResourceHandle<Type>::State>();
+        if (onLoaded) {
+            job->callbacks.push_back(std::move(onLoaded));
+        }
+        inFlight.emplace(id, job);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(job);
+        }
+        wake.notify_one();
+        return ResourceHandle<Type>{job->state};
+    }
+
+    /// @brief Checks whether a resource is loading
+    bool loading(entt::id_type id) const { return inFlight.find(id) != inFlight.end(); }
+
+    /// @brief Gets the number of loads not completed yet
+    std::size_t pending() const { return inFlight.size(); }
+
+    /// @brief Gets the cache, filled only on the scheduler's thread
+    cache_type &resources() { return *cache; }
+
+    /// @copydoc resources()
+    const cache_type &resources() const { return *cache; }
+
+  private:
+    /// One load, shared by the I/O thread and the completion event
+    struct Job {
+        int tick = 0;
+        entt::id_type id = 0;
+        std::string path;
+        std::shared_ptr<typename ResourceHandle<Type>::State> state;
+        std::shared_ptr<Type> value;     ///< Set by the I/O thread
+        std::vector<Callback> callbacks; ///< Scheduler's thread only
+    };
+
+    void work(TimedEventScheduler::Inbox &inbox) {
+        for (;;) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job->value = read(job->path);
+            inbox.submitFunction(job->tick,
+                                 [this, target = std::weak_ptr<cache_type>(cache), job] {
+                                     if (!target.expired()) {
+                                         complete(*job);
+                                     }
+                                 });
+        }
+    }
+
+    /// Runs inside the completion event on the scheduler's thread
+    void complete(Job &job) {
+        inFlight.erase(job.id);
+        if (job.value) {
+            cache->force_load(job.id, job.value);
+        }
+        job.state->value = job.value;
+        job.state->ready = true;
+        entt::resource<Type> resource{job.value};
+        for (Callback &callback : job.callbacks) {
+            callback(job.id, resource);
+        }
+    }
+
+    /// Reads a whole file and decodes it, nullptr on failure
+    std::shared_ptr<Type> read(const std::string &path) {
+#if defined(SCHEDULER_HAS_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat info {};
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            return nullptr;
+        }
+        if (info.st_size > 0) {
+            std::size_t size = static_cast<std::size_t>(info.st_size);
+            void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (mapping == MAP_FAILED) {
+                return nullptr;
+            }
+            std::shared_ptr<Type> value = decoder(static_cast<const unsigned char *>(mapping), size);
+            ::munmap(mapping, size);
+            return value;
+        }
+        ::close(fd);
+        // Empty files, and files like pipes that report no size, are read below
+#endif
+        std::FILE *file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            return nullptr;
+        }
+        std::vector<unsigned char> bytes;
+        unsigned char chunk[4096];
+        std::size_t got = 0;
+        while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            bytes.insert(bytes.end(), chunk, chunk + got);
+        }
+        bool ok = std::ferror(file) == 0;
+        std::fclose(file);
+        return ok ? decoder(bytes.data(), bytes.size()) : nullptr;
+    }
+
+    Decoder decoder;
+    std::shared_ptr<cache_type> cache; ///< Shared so queued completions can tell the loader is gone
+    std::unordered_map<entt::id_type, std::shared_ptr<Job>> inFlight;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<Job>> jobs;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
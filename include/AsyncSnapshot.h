@@ -0,0 +1,247 @@
+/**
+ * @file AsyncSnapshot.h
+ * @brief Registry and scheduler snapshots copied in one pass and written in the background.
+ *
+ * entt::snapshot archives a storage one value at a time on the calling thread,
+ * which stalls a large world for seconds. AsyncSnapshot splits a snapshot in
+ * two. capture() copies the packed entity and component arrays of each storage,
+ * page by page, and the saveable pending actions of a scheduler into buffers
+ * owned by the snapshot; this is the only part that runs between two ticks.
+ * start() then lays the sections out on a background thread, several sections
+ * at a time on a TaskPool, and streams them to a sink or a file in capture
+ * order while the game keeps running.
+ *
+ * The bytes are exactly those entt::snapshot and SchedulerSnapshot write
+ * through a BinaryOutputArchive, so the result is loaded with
+ * BinaryInputArchive, entt::snapshot_loader and SchedulerSnapshotLoader.
+ */
+#pragma once
+
+#include "SchedulerSnapshot.h"
+#include "TaskPool.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @class AsyncSnapshot
+ * @brief Snapshot captured on the game thread and serialized on background threads
+ *
+ * Component types must be trivially copyable and use the default swap-and-pop
+ * deletion policy; empty types are saved as entity lists, as entt does. A
+ * snapshot is used once: capture the sections, start() it, then wait() or
+ * poll done() before destroying it. The captured data no longer refers to the
+ * registry or the scheduler, which may change freely once capture() returns.
+ *
+ * @code
+ * AsyncSnapshot snapshot;
+ * snapshot.capture<entt::entity>(registry)
+ *     .capture<Position>(registry)
+ *     .capture<Health>(registry)
+ *     .captureScheduler(scheduler);
+ * snapshot.start("world.snap");
+ * // Ticks keep running; later
+ * if (snapshot.done() && !snapshot.wait()) { reportSaveFailure(); }
+ *
+ * BinaryInputArchive input(mapped, mappedSize);
+ * entt::snapshot_loader{registry}.get<entt::entity>(input).get<Position>(input).get<Health>(input);
+ * SchedulerSnapshotLoader{scheduler, handlers}.get(input);
+ * @endcode
+ */
+class AsyncSnapshot {
+  public:
+    /// @brief Receives the serialized bytes in order, returns false to stop writing
+    using Sink = std::function<bool(const unsigned char *, std::size_t)>;
+
+    /// @param workers Threads serializing sections next to the background thread
+    explicit AsyncSnapshot(std::size_t workers = 1) : pool(workers) {}
+
+    AsyncSnapshot(const AsyncSnapshot &) = delete;
+    AsyncSnapshot &operator=(const AsyncSnapshot &) = delete;
+
+    /// @brief Waits for the background writing to finish
+    ~AsyncSnapshot() { wait(); }
+
+    /**
+     * @brief Copies one storage of a registry
+     * @tparam Type entt::entity for the entities themselves, or a component type
+     * @param registry The registry
+     * @param id Name of the storage within the registry
+     */
+    template <typename Type>
+    AsyncSnapshot &capture(const entt::registry &registry,
+                           entt::id_type id = entt::type_hash<Type>::value()) {
+        static_assert(std::is_trivially_copyable_v<Type>, "Components are copied as raw bytes");
+        Section section;
+        const auto *storage = registry.storage<Type>(id);
+        if (storage == nullptr) {
+            section.kind = Section::Kind::components;
+            sections.push_back(std::move(section));
+            return *this;
+        }
+        const entt::entity *packed = storage->data();
+        section.entities.assign(packed, packed + storage->size());
+        if constexpr (std::is_same_v<Type, entt::entity>) {
+            section.kind = Section::Kind::entities;
+            section.inUse = storage->free_list();
+        } else {
+            using storage_type = entt::registry::storage_for_type<Type>;
+            static_assert(storage_type::storage_policy == entt::deletion_policy::swap_and_pop,
+                          "Storages with tombstones are not supported");
+            section.kind = Section::Kind::components;
+            if constexpr (!std::is_empty_v<Type>) {
+                constexpr std::size_t page = entt::component_traits<Type>::page_size;
+                section.elementSize = sizeof(Type);
+                section.components.resize(storage->size() * sizeof(Type));
+                for (std::size_t first = 0; first < storage->size(); first += page) {
+                    std::size_t count = std::min(page, storage->size() - first);
+                    std::memcpy(section.components.data() + first * sizeof(Type),
+                                storage->raw()[first / page], count * sizeof(Type));
+                }
+            }
+        }
+        sections.push_back(std::move(section));
+        return *this;
+    }
+
+    /**
+     * @brief Copies the saveable pending actions of a scheduler
+     * @param scheduler The scheduler, see SchedulerSnapshot for what is saved
+     */
+    template <typename Queue>
+    AsyncSnapshot &captureScheduler(const BasicScheduler<Queue> &scheduler) {
+        Section section;
+        section.kind = Section::Kind::actions;
+        SchedulerSnapshot<Queue>{scheduler}.collect(section.actions);
+        sections.push_back(std::move(section));
+        return *this;
+    }
+
+    /**
+     * @brief Serializes the captured sections in the background
+     * @param sink Called on the background thread with each section's bytes, in
+     *        capture order, then once with nullptr to mark the end
+     */
+    void start(Sink sink) {
+        wait();
+        finished = false;
+        writer = std::thread([this, sink = std::move(sink)] {
+            succeeded = run(sink);
+            finished = true;
+        });
+    }
+
+    /**
+     * @brief Serializes the captured sections to a file in the background
+     * @param path The file, overwritten
+     */
+    void start(const std::string &path) {
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            succeeded = false;
+            finished = true;
+            return;
+        }
+        start([file, open = true](const unsigned char *data, std::size_t size) mutable {
+            if (data == nullptr) {
+                // End of the snapshot
+                open = open && std::fclose(file) == 0;
+                return open;
+            }
+            return std::fwrite(data, 1, size, file) == size;
+        });
+    }
+
+    /// @brief Checks whether the background writing is over, without blocking
+    bool done() const { return finished; }
+
+    /**
+     * @brief Waits for the background writing to finish
+     * @return true if every byte reached the sink
+     */
+    bool wait() {
+        if (writer.joinable()) {
+            writer.join();
+        }
+        return succeeded;
+    }
+
+  private:
+    struct Section {
+        enum class Kind { entities, components, actions };
+
+        Kind kind = Kind::components;
+        std::vector<entt::entity> entities;
+        std::vector<unsigned char> components; ///< Packed like the entities
+        std::size_t elementSize = 0;           ///< Bytes of one component, 0 for empty types
+        std::size_t inUse = 0;                 ///< Free list position of the entity storage
+        std::vector<SavedActionRecord> actions;
+        std::vector<unsigned char> bytes; ///< Serialized section
+    };
+
+    using Count = entt::entt_traits<entt::entity>::entity_type;
+
+    /// Serializes every section, then hands them to the sink in order
+    bool run(const Sink &sink) {
+        pool.parallelFor(sections.size(), [this](std::size_t i) { serialize(sections[i]); });
+        bool ok = true;
+        for (Section &section : sections) {
+            ok = ok && sink(section.bytes.data(), section.bytes.size());
+            section = Section{};
+        }
+        // A null chunk marks the end, so file sinks can close
+        ok = sink(nullptr, 0) && ok;
+        sections.clear();
+        return ok;
+    }
+
+    static void serialize(Section &section) {
+        if (section.kind == Section::Kind::actions) {
+            BinaryOutputArchive archive;
+            SchedulerSnapshot<HeapQueue<ScheduledAction>>::write(archive, section.actions);
+            section.bytes = archive.data();
+            section.actions = {};
+            return;
+        }
+        const std::size_t count = section.entities.size();
+        const std::size_t record = sizeof(entt::entity) + section.elementSize;
+        bool entities = section.kind == Section::Kind::entities;
+        std::vector<unsigned char> &out = section.bytes;
+        out.resize(sizeof(Count) * (entities ? 2 : 1) + count * record);
+        unsigned char *at = out.data();
+        at = put(at, static_cast<Count>(count));
+        if (entities) {
+            at = put(at, static_cast<Count>(section.inUse));
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            at = put(at, section.entities[i]);
+            if (section.elementSize != 0) {
+                std::memcpy(at, section.components.data() + i * section.elementSize,
+                            section.elementSize);
+                at += section.elementSize;
+            }
+        }
+        section.entities = {};
+        section.components = {};
+    }
+
+    template <typename Value> static unsigned char *put(unsigned char *at, const Value &value) {
+        std::memcpy(at, &value, sizeof(Value));
+        return at + sizeof(Value);
+    }
+
+    std::vector<Section> sections;
+    TaskPool pool;
+    std::thread writer;
+    std::atomic<bool> finished{true};
+    bool succeeded = true;
+};
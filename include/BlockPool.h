@@ -0,0 +1,179 @@
+/**
+ * @file BlockPool.h
+ * @brief Size-class block pool for small objects that are created and destroyed constantly.
+ *
+ * Scheduled events, coroutine frames and action captures too large for an
+ * InlineFunction's buffer live for a few ticks and are then destroyed;
+ * recycling their memory through per-thread free lists turns most allocations
+ * into a list pop and most deallocations into a list push.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <new>
+
+/**
+ * @class BlockPool
+ * @brief Per-thread free lists recycling memory blocks by size class
+ *
+ * Block sizes are rounded up to a multiple of 64 bytes; requests too large for
+ * the biggest class go straight to the global allocator. A block may be
+ * released on a different thread than the one that allocated it, it then
+ * joins the releasing thread's free list. Each list caches a bounded number of
+ * blocks, so a thread that only releases blocks does not hoard memory.
+ */
+class BlockPool {
+  public:
+    /// @brief Size classes are multiples of this many bytes
+    static constexpr std::size_t granularity = 64;
+
+    /// @brief Number of size classes, blocks up to granularity * classes bytes are pooled
+    static constexpr std::size_t classes = 16;
+
+    /// @brief Most free blocks a thread keeps per size class
+    static constexpr std::size_t cacheLimit = 4096;
+
+    /// @brief Gets a block of at least size bytes, aligned like ::operator new
+    static void *allocate(std::size_t size) {
+        std::size_t index = classOf(size);
+        if (index >= classes) {
+            return ::operator new(size);
+        }
+        Lists &free = lists();
+        Block *block = free.heads[index];
+        if (block == nullptr) {
+            return ::operator new((index + 1) * granularity);
+        }
+        free.heads[index] = block->next;
+        --free.counts[index];
+        return block;
+    }
+
+    /// @brief Returns a block obtained from allocate() with the same size
+    static void deallocate(void *pointer, std::size_t size) noexcept {
+        std::size_t index = classOf(size);
+        if (index >= classes) {
+            ::operator delete(pointer);
+            return;
+        }
+        Lists &free = lists();
+        if (free.counts[index] >= cacheLimit) {
+            ::operator delete(pointer);
+            return;
+        }
+        free.heads[index] = ::new (pointer) Block{free.heads[index]};
+        ++free.counts[index];
+    }
+
+    /**
+     * @brief Fills the calling thread's free list of a size class ahead of use
+     * @param size Block size, rounded up to its class like allocate()
+     * @param count Blocks wanted in the list, capped at cacheLimit
+     *
+     * For warming up before a match starts; does nothing for sizes too large
+     * to be pooled.
+     */
+    static void reserve(std::size_t size, std::size_t count) {
+        std::size_t index = classOf(size);
+        if (index >= classes) {
+            return;
+        }
+        Lists &free = lists();
+        count = count < cacheLimit ? count : cacheLimit;
+        while (free.counts[index] < count) {
+            void *block = ::operator new((index + 1) * granularity);
+            free.heads[index] = ::new (block) Block{free.heads[index]};
+            ++free.counts[index];
+        }
+    }
+
+    /// @brief Gets the bytes held in the calling thread's free lists
+    static std::size_t cachedBytes() {
+        const Lists &free = lists();
+        std::size_t bytes = 0;
+        for (std::size_t index = 0; index < classes; ++index) {
+            bytes += free.counts[index] * (index + 1) * granularity;
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Hands every block cached by the calling thread back to the global allocator
+     *
+     * Blocks still in use are not affected and return to the free lists when
+     * released.
+     */
+    static void trim() noexcept { lists().release(); }
+
+  private:
+    struct Block {
+        Block *next;
+    };
+
+    /// Free lists of one thread, handed back to the global allocator at thread exit
+    struct Lists {
+        std::array<Block *, classes> heads{};
+        std::array<std::size_t, classes> counts{};
+
+        ~Lists() { release(); }
+
+        void release() noexcept {
+            for (std::size_t index = 0; index < classes; ++index) {
+                while (Block *head = heads[index]) {
+                    heads[index] = head->next;
+                    ::operator delete(head);
+                }
+                counts[index] = 0;
+            }
+        }
+    };
+
+    static std::size_t classOf(std::size_t size) {
+        return size == 0 ? 0 : (size - 1) / granularity;
+    }
+
+    static Lists &lists() {
+        thread_local Lists free;
+        return free;
+    }
+};
+
+/**
+ * @class PoolAllocator
+ * @brief Standard allocator drawing from BlockPool
+ * @tparam T The allocated type
+ *
+ * Meant for std::allocate_shared and other single-object allocations.
+ * Over-aligned types bypass the pool.
+ *
+ * @code
+ * auto event = std::allocate_shared<FunctionEvent>(PoolAllocator<FunctionEvent>{}, tick, fn);
+ * @endcode
+ */
+template <typename T> class PoolAllocator {
+  public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U> PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t{alignof(T)}));
+        } else {
+            return static_cast<T *>(BlockPool::allocate(n * sizeof(T)));
+        }
+    }
+
+    void deallocate(T *pointer, std::size_t n) noexcept {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(pointer, std::align_val_t{alignof(T)});
+        } else {
+            BlockPool::deallocate(pointer, n * sizeof(T));
+        }
+    }
+
+    template <typename U> bool operator==(const PoolAllocator<U> &) const noexcept { return true; }
+    template <typename U> bool operator!=(const PoolAllocator<U> &) const noexcept { return false; }
+};
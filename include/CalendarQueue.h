@@ -0,0 +1,355 @@
+/**
+ * @file CalendarQueue.h
+ * @brief Calendar-queue backend with a heap for far-future nodes.
+ *
+ * Ticks within a fixed horizon of the cursor live in a ring of per-tick
+ * vectors, so scheduling a few ticks ahead and draining a tick are both O(1)
+ * per node. Only nodes beyond the horizon pay for a heap, and they migrate into
+ * the ring as the cursor reaches them.
+ */
+#pragma once
+
+#include "HeapQueue.h"
+#include "entt/core/bit.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * @class CalendarQueue
+ * @brief Queue backend built on a ring of per-tick buckets
+ * @tparam Node The type stored in the queue
+ * @tparam Traits Ordering traits for Node
+ * @tparam Horizon Ticks covered by the ring, a power of two; 0 to pick it at run time
+ *
+ * The ring covers the ticks [cursor, cursor + horizon). A node due within that
+ * window is appended to the bucket of its tick, a node due later goes to the
+ * far heap, and a node due before the cursor goes to a small heap of late
+ * nodes that is drained first.
+ *
+ * Nodes due at the same tick are returned in insertion order, and nodes
+ * scheduled for a tick the cursor has already passed are returned before
+ * anything later, in tick order, like the other backends. Erasing leaves a
+ * stale entry behind in its bucket that is skipped when the bucket drains.
+ *
+ * With a fixed Horizon the bucket of a tick is a mask of its low bits instead
+ * of a signed modulo by the ring size.
+ *
+ * @code
+ * BasicScheduler<CalendarQueue<ScheduledAction>> scheduler;
+ * scheduler.schedule(currentTick + 3, entity, action);
+ * @endcode
+ */
+template <typename Node, typename Traits = QueueNodeTraits<Node>, std::size_t Horizon = 0>
+class CalendarQueue {
+    static_assert(Horizon == 0 || entt::has_single_bit(Horizon), "Horizon must be a power of two");
+
+    enum class Where : std::uint8_t { free, ring, far, late };
+
+    /// Pooled node and where it is currently queued
+    struct Entry {
+        Node value;
+        std::uint32_t generation = 0; ///< Bumped on release, invalidates bucket entries
+        std::uint32_t heapHandle = 0; ///< Handle in the far or late heap
+        Where where = Where::free;
+    };
+
+    /// Bucket entry, stale once the entry's generation has moved on
+    struct Slot {
+        std::uint32_t handle;
+        std::uint32_t generation;
+    };
+
+    /// Heap node for the far and late heaps, ordered by tick and then insertion
+    struct Pending {
+        int tick = 0;
+        std::uint32_t handle = 0;
+    };
+
+    using PendingHeap = HeapQueue<Pending>;
+
+  public:
+    /// @brief Stable reference to a queued node
+    using handle_type = std::uint32_t;
+
+    /**
+     * @brief Constructs an empty queue
+     * @param horizon Number of ticks covered by the ring, ignored if Horizon is set
+     * @param startTick The tick the cursor starts at
+     */
+    explicit CalendarQueue(std::size_t horizon = 256, int startTick = 0)
+        : ring(Horizon != 0 ? Horizon : (horizon > 0 ? horizon : 1)), base(startTick) {}
+
+    /**
+     * @brief Adds a node to the queue
+     * @param node The node to insert, moved into the queue's node pool
+     * @return Handle that can be used to erase the node
+     */
+    handle_type push(Node &&node) {
+        handle_type handle = allocate(std::move(node));
+        place(handle, Traits::tick(entries[handle].value));
+        ++count;
+        return handle;
+    }
+
+    /**
+     * @brief Adds a range of nodes
+     * @param first Iterator to the first node, nodes are moved from
+     * @param last Iterator past the last node
+     * @param onPush Called with the handle of each node, in range order
+     */
+    template <typename It, typename OnPush> void pushBulk(It first, It last, OnPush &&onPush) {
+        for (; first != last; ++first) {
+            onPush(push(std::move(*first)));
+        }
+    }
+
+    /// @brief Reserves room for a number of queued nodes
+    void reserve(std::size_t capacity) { entries.reserve(capacity); }
+
+    /**
+     * @brief Removes a queued node immediately
+     * @param handle Handle returned by push()
+     * @return true if the node was queued and has been removed
+     */
+    bool erase(handle_type handle) {
+        if (handle >= entries.size() || entries[handle].where == Where::free) {
+            return false;
+        }
+        Entry &entry = entries[handle];
+        if (entry.where == Where::ring) {
+            --ringCount;
+        } else {
+            (entry.where == Where::far ? far : late).erase(entry.heapHandle);
+        }
+        release(handle);
+        --count;
+        return true;
+    }
+
+    /**
+     * @brief Changes a queued node in place and moves it to the bucket of its new tick
+     * @param handle Handle returned by push()
+     * @param fn Called with a reference to the node, may change its tick
+     * @return true if the node was queued and has been modified
+     *
+     * The old bucket entry is left behind as a stale one, as erase() does.
+     */
+    template <typename F> bool modify(handle_type handle, F &&fn) {
+        if (handle >= entries.size() || entries[handle].where == Where::free) {
+            return false;
+        }
+        Entry &entry = entries[handle];
+        if (entry.where == Where::ring) {
+            --ringCount;
+            ++entry.generation;
+        } else {
+            (entry.where == Where::far ? far : late).erase(entry.heapHandle);
+        }
+        fn(entry.value);
+        place(handle, Traits::tick(entry.value));
+        return true;
+    }
+
+    /**
+     * @brief Removes the next node that is due at or before the given tick
+     * @param currentTick The current system tick
+     * @param out Receives the removed node by move assignment
+     * @return true if a node was removed, false if nothing is due
+     *
+     * Moves the cursor towards currentTick as buckets run empty, pulling far
+     * nodes into the ring as they come within the horizon.
+     */
+    bool popDue(int currentTick, Node &out) {
+        for (;;) {
+            if (!late.empty()) {
+                Pending pending;
+                if (!late.popDue(currentTick, pending)) {
+                    return false;
+                }
+                take(pending.handle, out);
+                return true;
+            }
+            if (base > currentTick) {
+                return false;
+            }
+            if (ringCount == 0) {
+                jump(static_cast<std::int64_t>(currentTick) + 1);
+                continue;
+            }
+            std::vector<Slot> &bucket = ring[bucketOf(base)];
+            while (readPos < bucket.size()) {
+                Slot slot = bucket[readPos++];
+                if (entries[slot.handle].generation == slot.generation) {
+                    --ringCount;
+                    take(slot.handle, out);
+                    return true;
+                }
+            }
+            bucket.clear();
+            readPos = 0;
+            ++base;
+            migrate();
+        }
+    }
+
+    /// @brief Gets the number of queued nodes
+    /// @return The queue size
+    std::size_t size() const { return count; }
+
+    /// @brief Checks whether the queue is empty
+    /// @return true if no nodes are queued
+    bool empty() const { return count == 0; }
+
+    /**
+     * @brief Visits every queued node, in no particular order
+     * @param fn Called with a const reference to each node
+     */
+    template <typename F> void forEach(F &&fn) const {
+        for (const Entry &entry : entries) {
+            if (entry.where != Where::free) {
+                fn(entry.value);
+            }
+        }
+    }
+
+    /**
+     * @brief Gets the tick of the earliest queued node
+     * @return The earliest due tick, or nothing if the queue is empty
+     *
+     * Skips the stale entries of erased nodes; walks at most one horizon of
+     * buckets.
+     */
+    std::optional<int> nextTick() const {
+        if (!late.empty()) {
+            return late.nextTick();
+        }
+        if (ringCount > 0) {
+            std::size_t position = readPos;
+            for (std::int64_t tick = base;; ++tick, position = 0) {
+                const std::vector<Slot> &bucket = ring[bucketOf(tick)];
+                for (; position < bucket.size(); ++position) {
+                    const Slot &slot = bucket[position];
+                    if (entries[slot.handle].generation == slot.generation) {
+                        return static_cast<int>(tick);
+                    }
+                }
+            }
+        }
+        return far.nextTick();
+    }
+
+    /// @brief Gets the first tick that has not been drained yet
+    /// @return The cursor tick
+    int cursor() const { return static_cast<int>(base); }
+
+    /// @brief Gets the number of ticks covered by the ring
+    std::size_t horizon() const {
+        if constexpr (Horizon != 0) {
+            return Horizon;
+        } else {
+            return ring.size();
+        }
+    }
+
+    /// @brief Removes every queued node, keeping the cursor and allocated capacity
+    void clear() {
+        entries.clear();
+        freeHandles.clear();
+        for (auto &bucket : ring) {
+            bucket.clear();
+        }
+        far.clear();
+        late.clear();
+        readPos = 0;
+        ringCount = 0;
+        count = 0;
+    }
+
+  private:
+    handle_type allocate(Node &&node) {
+        handle_type handle;
+        if (!freeHandles.empty()) {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            entries[handle].value = std::move(node);
+        } else {
+            handle = static_cast<handle_type>(entries.size());
+            entries.push_back(Entry{std::move(node)});
+        }
+        return handle;
+    }
+
+    void release(handle_type handle) {
+        Entry &entry = entries[handle];
+        entry.value = Node{};
+        ++entry.generation;
+        entry.where = Where::free;
+        freeHandles.push_back(handle);
+    }
+
+    void take(handle_type handle, Node &out) {
+        out = std::move(entries[handle].value);
+        release(handle);
+        --count;
+    }
+
+    std::size_t bucketOf(std::int64_t tick) const {
+        if constexpr (Horizon != 0) {
+            return static_cast<std::size_t>(static_cast<std::uint64_t>(tick) & (Horizon - 1));
+        } else {
+            auto slots = static_cast<std::int64_t>(ring.size());
+            return static_cast<std::size_t>(((tick % slots) + slots) % slots);
+        }
+    }
+
+    /// Queues a stored node relative to the cursor
+    void place(handle_type handle, int tick) {
+        Entry &entry = entries[handle];
+        if (tick < base) {
+            entry.where = Where::late;
+            entry.heapHandle = late.push(Pending{tick, handle});
+        } else if (tick - base < static_cast<std::int64_t>(horizon())) {
+            entry.where = Where::ring;
+            ring[bucketOf(tick)].push_back(Slot{handle, entry.generation});
+            ++ringCount;
+        } else {
+            entry.where = Where::far;
+            entry.heapHandle = far.push(Pending{tick, handle});
+        }
+    }
+
+    /// Moves far nodes that are now within the horizon into the ring
+    void migrate() {
+        if (far.empty()) {
+            return;
+        }
+        auto last = base + static_cast<std::int64_t>(horizon()) - 1;
+        Pending pending;
+        while (far.popDue(static_cast<int>(std::min<std::int64_t>(last, INT32_MAX)), pending)) {
+            place(pending.handle, pending.tick);
+        }
+    }
+
+    /// Moves the cursor of an empty ring to target
+    void jump(std::int64_t target) {
+        auto skipped = static_cast<std::int64_t>(horizon());
+        for (std::int64_t tick = base; tick < target && tick < base + skipped; ++tick) {
+            ring[bucketOf(tick)].clear();
+        }
+        readPos = 0;
+        base = target;
+        migrate();
+    }
+
+    std::vector<Entry> entries;               ///< Node pool indexed by handle
+    std::vector<handle_type> freeHandles;     ///< Released handles ready for reuse
+    std::vector<std::vector<Slot>> ring;      ///< One bucket per tick of the horizon
+    PendingHeap far;                          ///< Nodes beyond the horizon
+    PendingHeap late;                         ///< Nodes due before the cursor
+    std::int64_t base;                        ///< Tick of the bucket being drained
+    std::size_t readPos = 0;                  ///< Next entry of the bucket being drained
+    std::size_t ringCount = 0;                ///< Live nodes in the ring
+    std::size_t count = 0;                    ///< Total queued nodes
+};
@@ -0,0 +1,92 @@
+/**
+ * @file CapacityProfile.h
+ * @brief Container sizes a scheduler reached, saved from one run to size the next.
+ *
+ * Server boot and match start used to grow the queue, the ID slots and the
+ * entity index from nothing, reallocating and rehashing many times in the
+ * first minutes. A CapacityProfile records how large a scheduler's containers
+ * got; written at shutdown and read at the next startup, it lets reserve()
+ * allocate everything once, up front.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+
+/**
+ * @struct CapacityProfile
+ * @brief Most items each container of a scheduler held at once
+ *
+ * Saved as text, one "key value" line per field after a header line, so a
+ * profile stays readable by hand and keys added later are skipped by older
+ * readers.
+ *
+ * @code
+ * // At shutdown
+ * std::ofstream("capacity.txt") << scheduler.capacityProfile();
+ * // At the next startup
+ * std::ifstream file("capacity.txt");
+ * if (auto profile = CapacityProfile::read(file)) {
+ *     scheduler.reserve(*profile);
+ * }
+ * @endcode
+ */
+struct CapacityProfile {
+    std::size_t pending = 0;  ///< Actions or events pending at once, counting inbox reservations
+    std::size_t entities = 0; ///< Entities with pending actions at once
+    std::size_t groups = 0;   ///< Action groups live at once
+    std::size_t due = 0;      ///< Actions or events due in one tick
+
+    /// @brief Keeps the larger value of each field, to combine the profiles of several runs
+    void merge(const CapacityProfile &other) {
+        pending = std::max(pending, other.pending);
+        entities = std::max(entities, other.entities);
+        groups = std::max(groups, other.groups);
+        due = std::max(due, other.due);
+    }
+
+    /// @brief Writes the profile as text
+    friend std::ostream &operator<<(std::ostream &out, const CapacityProfile &profile) {
+        return out << header << '\n'
+                   << "pending " << profile.pending << '\n'
+                   << "entities " << profile.entities << '\n'
+                   << "groups " << profile.groups << '\n'
+                   << "due " << profile.due << '\n';
+    }
+
+    /**
+     * @brief Reads a profile written by operator<<
+     * @param in The stream to read from, read to its end
+     * @return The profile, or nothing if the header is missing or a value is malformed
+     */
+    static std::optional<CapacityProfile> read(std::istream &in) {
+        std::string key;
+        if (!std::getline(in, key) || key != header) {
+            return std::nullopt;
+        }
+        CapacityProfile profile;
+        std::size_t value = 0;
+        while (in >> key) {
+            if (!(in >> value)) {
+                return std::nullopt;
+            }
+            if (key == "pending") {
+                profile.pending = value;
+            } else if (key == "entities") {
+                profile.entities = value;
+            } else if (key == "groups") {
+                profile.groups = value;
+            } else if (key == "due") {
+                profile.due = value;
+            }
+        }
+        return profile;
+    }
+
+    /// @brief First line of a saved profile
+    static constexpr const char *header = "scheduler-capacity-profile 1";
+};
@@ -0,0 +1,175 @@
+/**
+ * @file ComponentTrigger.h
+ * @brief Actions scheduled in reaction to component changes.
+ *
+ * "Run this 30 ticks after Health drops below 20%" used to be a system that
+ * polled every entity each tick and called schedule() when it saw the drop.
+ * A BasicComponentTrigger listens to a registry's construct, update and
+ * destroy signals for one component instead. Changed entities are only
+ * marked, so a burst of patches to one entity costs one predicate check and
+ * at most one scheduling operation when the trigger is flushed, once per tick.
+ */
+#pragma once
+
+#include "InlineFunction.h"
+#include "Scheduler.h"
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/// @brief What a trigger does for an entity whose predicate holds while its action is pending
+enum class TriggerMode : std::uint8_t {
+    once,  ///< Leaves the pending action where it is
+    rearm, ///< Moves the pending action to delay ticks after the latest flush
+};
+
+/**
+ * @class BasicComponentTrigger
+ * @brief Schedules an action delay ticks after a component starts satisfying a predicate
+ * @tparam Component The component watched
+ * @tparam Queue The queue backend of the scheduler
+ *
+ * Construction, replace() and patch() of the component mark the entity, and
+ * flush() checks each marked entity once: if the predicate holds and the
+ * trigger has no action pending for it, an action is scheduled delay ticks
+ * later; if it holds and an action is pending, TriggerMode decides; if it no
+ * longer holds, or the component was removed, the pending action is
+ * cancelled. Changes made through registry.get() do not emit signals and are
+ * not seen.
+ *
+ * Call flush() once per tick before the scheduler's update(). The trigger
+ * must be destroyed before the registry and the scheduler, and cancels its
+ * pending actions when it is.
+ *
+ * @code
+ * ComponentTrigger<Health> lowHealth(scheduler, registry, 30,
+ *     [](const Health &health) { return health.current * 5 < health.max; },
+ *     [](entt::entity entity, entt::registry &registry) { registry.emplace<Fleeing>(entity); });
+ *
+ * registry.patch<Health>(npc, [](Health &health) { health.current -= 80; });
+ * lowHealth.flush(tick);
+ * scheduler.update(tick, registry, dispatcher);
+ * @endcode
+ */
+template <typename Component, typename Queue = HeapQueue<ScheduledAction>>
+class BasicComponentTrigger {
+  public:
+    /// @brief Decides whether a component value should have the action pending
+    using predicate_type = InlineFunction<bool(const Component &)>;
+
+    /// @brief The action run delay ticks after the predicate started holding
+    using action_type = InlineFunction<void(entt::entity, entt::registry &)>;
+
+    /**
+     * @brief Connects to the component's signals
+     * @param scheduler The scheduler the actions are scheduled on
+     * @param registry The registry whose component changes are watched
+     * @param delay Ticks from the flush that saw the change to the action
+     * @param predicate Called once per marked entity and flush
+     * @param action Run for the entity when its delay is over
+     * @param mode What a flush does to an action already pending
+     */
+    BasicComponentTrigger(BasicScheduler<Queue> &scheduler, entt::registry &registry, int delay,
+                          predicate_type predicate, action_type action,
+                          TriggerMode mode = TriggerMode::once)
+        : scheduler(scheduler), registry(registry), delay(delay), mode(mode),
+          predicate(std::move(predicate)), action(std::move(action)) {
+        registry.on_construct<Component>().template connect<&BasicComponentTrigger::mark>(*this);
+        registry.on_update<Component>().template connect<&BasicComponentTrigger::mark>(*this);
+        registry.on_destroy<Component>().template connect<&BasicComponentTrigger::mark>(*this);
+    }
+
+    BasicComponentTrigger(const BasicComponentTrigger &) = delete;
+    BasicComponentTrigger &operator=(const BasicComponentTrigger &) = delete;
+
+    /// @brief Disconnects from the registry and cancels the pending actions
+    ~BasicComponentTrigger() {
+        registry.on_construct<Component>().disconnect(this);
+        registry.on_update<Component>().disconnect(this);
+        registry.on_destroy<Component>().disconnect(this);
+        for (auto [entity, id] : pending) {
+            scheduler.cancel(id);
+        }
+    }
+
+    /**
+     * @brief Checks every entity changed since the last flush, once each
+     * @param currentTick The tick being updated; actions are scheduled at currentTick + delay
+     * @return The number of actions scheduled, moved or cancelled
+     */
+    std::size_t flush(int currentTick) {
+        std::size_t operations = 0;
+        for (entt::entity entity : changed) {
+            operations += apply(entity, currentTick + delay);
+        }
+        changed.clear();
+        marked.clear();
+        return operations;
+    }
+
+    /// @brief Gets the number of entities changed since the last flush
+    std::size_t changedCount() const { return changed.size(); }
+
+    /// @brief Gets the number of actions this trigger has pending
+    std::size_t pendingCount() const { return pending.size(); }
+
+    /// @brief Gets the action pending for an entity, 0 if there is none
+    ActionID pendingAction(entt::entity entity) const {
+        auto it = pending.find(entity);
+        return it != pending.end() && scheduler.isPending(it->second) ? it->second : 0;
+    }
+
+  private:
+    /// Signal handler: remembers the entity once until the next flush
+    void mark(entt::registry &, entt::entity entity) {
+        if (marked.insert(entity).second) {
+            changed.push_back(entity);
+        }
+    }
+
+    /// Brings one entity's pending action in line with its component
+    std::size_t apply(entt::entity entity, int tick) {
+        const Component *component =
+            registry.valid(entity) ? registry.template try_get<Component>(entity) : nullptr;
+        bool holds = component != nullptr && predicate(*component);
+        auto it = pending.find(entity);
+        if (it != pending.end() && !scheduler.isPending(it->second)) {
+            // Cancelled behind the trigger's back, for instance with its entity
+            pending.erase(it);
+            it = pending.end();
+        }
+        if (it == pending.end()) {
+            if (!holds) {
+                return 0;
+            }
+            ActionID id = scheduler.schedule(tick, entity, [this](entt::entity target,
+                                                                  entt::registry &owner) {
+                pending.erase(target);
+                action(target, owner);
+            });
+            pending.emplace(entity, id);
+            return 1;
+        }
+        if (!holds) {
+            scheduler.cancel(it->second);
+            pending.erase(it);
+            return 1;
+        }
+        return mode == TriggerMode::rearm && scheduler.reschedule(it->second, tick) ? 1 : 0;
+    }
+
+    BasicScheduler<Queue> &scheduler;
+    entt::registry &registry;
+    int delay;
+    TriggerMode mode;
+    predicate_type predicate;
+    action_type action;
+    std::vector<entt::entity> changed;                  ///< Marked entities, in change order
+    entt::dense_set<entt::entity> marked;               ///< Same entities, for deduplication
+    entt::dense_map<entt::entity, ActionID> pending;    ///< Actions scheduled by this trigger
+};
+
+/// @brief Component trigger on a heap-backed scheduler
+template <typename Component> using ComponentTrigger = BasicComponentTrigger<Component>;
@@ -0,0 +1,401 @@
+/**
+ * @file DeltaSnapshot.h
+ * @brief Snapshots of what changed in a registry and a scheduler since the last checkpoint.
+ *
+ * A full snapshot of a large world costs a pass over every entity, every
+ * component and every pending action, too much to take as often as recovery
+ * needs. A RegistryDeltaTracker listens to the construct, update and destroy
+ * signals of the tracked components and of entities, and remembers which
+ * entities changed; a SchedulerJournal keeping its records in memory does the
+ * same for the scheduler. A delta snapshot then writes only those, in the
+ * same archives as SchedulerSnapshot.h.
+ *
+ * A chain is a base, written by entt::snapshot and SchedulerDeltaSnapshot::base(),
+ * followed by any number of deltas, loaded in the order they were taken. A
+ * chain is compacted offline by loading it into a scratch registry and
+ * taking a new base, and, for the scheduler, with replayJournal().
+ *
+ * @code
+ * RegistryDeltaTracker changes(registry);
+ * changes.track<Health>().track<Position>();
+ * SchedulerDeltaSnapshot actions(scheduler, journal);
+ *
+ * // Base, with the tracker and journal attached
+ * entt::snapshot{registry}.get<entt::entity>(output).get<Health>(output).get<Position>(output);
+ * actions.base(output, tick);
+ * changes.clear();
+ *
+ * // Every few seconds, after journal.commit(tick)
+ * changes.get<entt::entity>(delta).get<Health>(delta).get<Position>(delta);
+ * actions.delta(delta);
+ * changes.clear();
+ *
+ * // Recovery: the base, then every delta in order
+ * entt::snapshot_loader{registry}.get<entt::entity>(base).get<Health>(base).get<Position>(base);
+ * SchedulerDeltaLoader loader(scheduler, handlers);
+ * loader.get(base);
+ * for (BinaryInputArchive &delta : deltas) {
+ *     RegistryDeltaLoader{registry}.get<entt::entity>(delta).get<Health>(delta)
+ *         .get<Position>(delta);
+ *     loader.get(delta);
+ * }
+ * loader.restore();
+ * @endcode
+ */
+#pragma once
+
+#include "SchedulerJournal.h"
+#include "SchedulerSnapshot.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class RegistryDeltaTracker
+ * @brief Remembers the entities and components of a registry changed since the last clear()
+ *
+ * Entities are tracked from construction; components once passed to track().
+ * emplace(), replace(), patch() and remove() of a tracked component mark its
+ * entity; changes made through registry.get() emit no signal and must be
+ * reported with touch(). Each entity is marked once per component however
+ * often it changes, so a delta holds the latest value only.
+ *
+ * The tracker must be destroyed before the registry.
+ */
+class RegistryDeltaTracker {
+    using size_type = typename entt::entt_traits<entt::entity>::entity_type;
+
+  public:
+    /// @brief Starts tracking the creation and destruction of entities
+    explicit RegistryDeltaTracker(entt::registry &registry) : registry(registry) {
+        connections.emplace_back(registry.on_construct<entt::entity>()
+                                     .template connect<&RegistryDeltaTracker::onCreated>(*this));
+        connections.emplace_back(registry.on_destroy<entt::entity>()
+                                     .template connect<&RegistryDeltaTracker::onDestroyed>(*this));
+    }
+
+    RegistryDeltaTracker(const RegistryDeltaTracker &) = delete;
+    RegistryDeltaTracker &operator=(const RegistryDeltaTracker &) = delete;
+
+    /**
+     * @brief Starts tracking a component
+     * @tparam Type The component
+     * @return This tracker, to chain calls
+     */
+    template <typename Type> RegistryDeltaTracker &track() {
+        auto &changes = components[entt::type_hash<Type>::value()];
+        if (!changes) {
+            changes = std::make_unique<Changes>();
+            connections.emplace_back(
+                registry.on_construct<Type>().template connect<&Changes::onChanged>(*changes));
+            connections.emplace_back(
+                registry.on_update<Type>().template connect<&Changes::onChanged>(*changes));
+            connections.emplace_back(
+                registry.on_destroy<Type>().template connect<&Changes::onRemoved>(*changes));
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Marks a tracked component of an entity as changed
+     * @param entity An entity with the component
+     *
+     * For writes that emit no signal, such as through registry.get().
+     */
+    template <typename Type> void touch(entt::entity entity) {
+        changesOf<Type>().onChanged(registry, entity);
+    }
+
+    /**
+     * @brief Writes what changed of a component, or of entities with entt::entity
+     * @tparam Type A tracked component, or entt::entity
+     * @param archive Output archive. For entt::entity: the destroyed and then the
+     *        created entities, each a count and the entities. For a component:
+     *        the entities it was removed from, then a count and each changed
+     *        entity followed by its component, unless the component is empty.
+     * @return This tracker, to chain calls as with entt::snapshot
+     */
+    template <typename Type, typename Archive>
+    const RegistryDeltaTracker &get(Archive &archive) const {
+        if constexpr (std::is_same_v<Type, entt::entity>) {
+            writeEntities(archive, destroyed);
+            writeEntities(archive, created);
+        } else {
+            const Changes &changes = changesOf<Type>();
+            writeEntities(archive, changes.removed);
+            archive(static_cast<size_type>(changes.changed.size()));
+            const auto &storage = registry.storage<Type>();
+            for (entt::entity entity : changes.changed) {
+                archive(entity);
+                if constexpr (!std::is_empty_v<Type>) {
+                    archive(storage.get(entity));
+                }
+            }
+        }
+        return *this;
+    }
+
+    /// @brief Gets the number of entity and component changes a delta would write
+    std::size_t size() const {
+        std::size_t total = created.size() + destroyed.size();
+        for (const auto &entry : components) {
+            total += entry.second->changed.size() + entry.second->removed.size();
+        }
+        return total;
+    }
+
+    /// @brief Forgets every change, after a delta or a base has been taken
+    void clear() {
+        created.clear();
+        destroyed.clear();
+        for (auto &&entry : components) {
+            entry.second->changed.clear();
+            entry.second->removed.clear();
+        }
+    }
+
+  private:
+    /// Changes of one component, at a stable address for its signals
+    struct Changes {
+        void onChanged(entt::registry &, entt::entity entity) {
+            removed.erase(entity);
+            changed.insert(entity);
+        }
+
+        void onRemoved(entt::registry &, entt::entity entity) {
+            changed.erase(entity);
+            removed.insert(entity);
+        }
+
+        entt::dense_set<entt::entity> changed; ///< Entities whose component was set
+        entt::dense_set<entt::entity> removed; ///< Entities whose component was removed
+    };
+
+    template <typename Type> Changes &changesOf() const {
+        auto it = components.find(entt::type_hash<Type>::value());
+        ENTT_ASSERT(it != components.end(), "Component not tracked");
+        return *it->second;
+    }
+
+    template <typename Archive>
+    static void writeEntities(Archive &archive, const entt::dense_set<entt::entity> &entities) {
+        archive(static_cast<size_type>(entities.size()));
+        for (entt::entity entity : entities) {
+            archive(entity);
+        }
+    }
+
+    void onCreated(entt::registry &, entt::entity entity) { created.insert(entity); }
+
+    void onDestroyed(entt::registry &, entt::entity entity) {
+        // An entity created since the last clear() is not in the previous snapshot
+        if (created.erase(entity) == 0) {
+            destroyed.insert(entity);
+        }
+        for (auto &&entry : components) {
+            entry.second->removed.erase(entity);
+        }
+    }
+
+    entt::registry &registry;
+    entt::dense_set<entt::entity> created;   ///< Entities created and still alive
+    entt::dense_set<entt::entity> destroyed; ///< Entities of the previous snapshot destroyed
+    entt::dense_map<entt::id_type, std::unique_ptr<Changes>> components;
+    std::vector<entt::scoped_connection> connections;
+};
+
+/**
+ * @class RegistryDeltaLoader
+ * @brief Applies a delta written by a RegistryDeltaTracker to a registry
+ *
+ * Entity identifiers are kept, as with entt::snapshot_loader, so the delta
+ * must be applied to the registry its base and earlier deltas were loaded
+ * into. Call get() with the same types, in the same order, as the tracker.
+ */
+class RegistryDeltaLoader {
+    using size_type = typename entt::entt_traits<entt::entity>::entity_type;
+
+  public:
+    explicit RegistryDeltaLoader(entt::registry &registry) : registry(registry) {}
+
+    /**
+     * @brief Reads and applies what changed of a component, or of entities
+     * @tparam Type The component, or entt::entity
+     * @param archive Input archive positioned at the delta of Type
+     * @return This loader, to chain calls as with entt::snapshot_loader
+     */
+    template <typename Type, typename Archive> RegistryDeltaLoader &get(Archive &archive) {
+        size_type count{};
+        entt::entity entity{};
+        archive(count);
+        for (size_type i = 0; i < count; ++i) {
+            archive(entity);
+            if constexpr (std::is_same_v<Type, entt::entity>) {
+                if (registry.valid(entity)) {
+                    registry.destroy(entity);
+                }
+            } else if (registry.valid(entity)) {
+                registry.remove<Type>(entity);
+            }
+        }
+        archive(count);
+        for (size_type i = 0; i < count; ++i) {
+            archive(entity);
+            entity = revive(entity);
+            if constexpr (std::is_empty_v<Type>) {
+                registry.emplace_or_replace<Type>(entity);
+            } else if constexpr (!std::is_same_v<Type, entt::entity>) {
+                Type value{};
+                archive(value);
+                registry.emplace_or_replace<Type>(entity, std::move(value));
+            }
+        }
+        return *this;
+    }
+
+  private:
+    /// Creates an entity under its saved identifier unless it is alive
+    entt::entity revive(entt::entity entity) {
+        return registry.valid(entity) ? entity : registry.create(entity);
+    }
+
+    entt::registry &registry;
+};
+
+/**
+ * @class SchedulerDeltaSnapshot
+ * @brief Writes the saveable pending actions of a scheduler, then what changed of them
+ * @tparam Queue The queue backend of the scheduler
+ *
+ * Reads the changes from the scheduler's journal, which base() sets to keep
+ * its committed records in memory; the journal needs no file for this. Both
+ * writes are a count followed by JournalRecords, which keep action IDs so a
+ * delta can cancel or replace actions of the base. Only actions a journal
+ * records are written, see SchedulerJournal.
+ */
+template <typename Queue> class SchedulerDeltaSnapshot {
+  public:
+    /**
+     * @param scheduler The scheduler
+     * @param journal The journal attached to it with setJournal()
+     */
+    SchedulerDeltaSnapshot(const BasicScheduler<Queue> &scheduler, SchedulerJournal &journal)
+        : scheduler(scheduler), journal(journal) {}
+
+    /**
+     * @brief Writes every saveable pending action and starts a new chain
+     * @param archive Output archive
+     * @param tick The last tick whose update has run to completion
+     * @return The number of records written
+     *
+     * Take it between updates, after merging any inboxes.
+     */
+    template <typename Archive> std::size_t base(Archive &archive, int tick) {
+        journal.setRetaining(false);
+        journal.setRetaining(true);
+        return write(archive, checkpointRecords(scheduler, tick));
+    }
+
+    /**
+     * @brief Writes the journal records committed since the last base() or delta()
+     * @param archive Output archive
+     * @return The number of records written
+     *
+     * Take it after journal.commit(), so the delta ends with a commit of the
+     * last tick that has run. Of the commits, one per tick, only that last
+     * one is written, since replaying a chain only reads the last.
+     */
+    template <typename Archive> std::size_t delta(Archive &archive) {
+        std::vector<JournalRecord> records;
+        journal.takeRetained(records);
+        auto last = std::find_if(records.rbegin(), records.rend(), [](const JournalRecord &r) {
+            return r.kind == JournalRecord::Kind::commit;
+        });
+        if (last != records.rend()) {
+            JournalRecord commit = *last;
+            records.erase(std::remove_if(records.begin(), records.end(),
+                                         [](const JournalRecord &r) {
+                                             return r.kind == JournalRecord::Kind::commit;
+                                         }),
+                          records.end());
+            records.push_back(commit);
+        }
+        return write(archive, records);
+    }
+
+    /**
+     * @brief Writes records in the format of base() and delta()
+     * @param archive Output archive
+     * @param records Records, such as a chain compacted with replayJournal()
+     * @return The number of records written
+     */
+    template <typename Archive>
+    static std::size_t write(Archive &archive, const std::vector<JournalRecord> &records) {
+        archive(static_cast<entt::entt_traits<entt::entity>::entity_type>(records.size()));
+        for (const JournalRecord &record : records) {
+            archive(record);
+        }
+        return records.size();
+    }
+
+  private:
+    const BasicScheduler<Queue> &scheduler;
+    SchedulerJournal &journal;
+};
+
+/**
+ * @class SchedulerDeltaLoader
+ * @brief Restores the actions of a base and deltas written by a SchedulerDeltaSnapshot
+ * @tparam Queue The queue backend of the scheduler
+ *
+ * get() reads the base and then each delta, in order; restore() replays them
+ * with replayJournal() and schedules the actions left pending, with new IDs.
+ */
+template <typename Queue> class SchedulerDeltaLoader {
+  public:
+    SchedulerDeltaLoader(BasicScheduler<Queue> &scheduler, const ActionHandlers &handlers)
+        : loader(scheduler, handlers) {}
+
+    /**
+     * @brief Reads a base or a delta
+     * @param archive Input archive positioned at it
+     * @return This loader, to chain calls
+     */
+    template <typename Archive> SchedulerDeltaLoader &get(Archive &archive) {
+        read(archive, chain);
+        return *this;
+    }
+
+    /// @brief Schedules the actions the chain read so far leaves pending
+    IdRange<ActionID> restore() { return loader.get(chain); }
+
+    /// @brief Gets the records read so far, for example to compact them with replayJournal()
+    const std::vector<JournalRecord> &records() const { return chain; }
+
+    /// @brief Gets the number of records skipped by restore() because their handler is unknown
+    std::size_t skipped() const { return loader.skipped(); }
+
+    /**
+     * @brief Reads a base or a delta without a scheduler
+     * @param archive Input archive positioned at it
+     * @param records Receives the records, appended
+     */
+    template <typename Archive>
+    static void read(Archive &archive, std::vector<JournalRecord> &records) {
+        typename entt::entt_traits<entt::entity>::entity_type count{};
+        archive(count);
+        records.reserve(records.size() + count);
+        JournalRecord record;
+        for (decltype(count) i = 0; i < count; ++i) {
+            archive(record);
+            records.push_back(record);
+        }
+    }
+
+  private:
+    SchedulerJournalLoader<Queue> loader;
+    std::vector<JournalRecord> chain;
+};
@@ -0,0 +1,224 @@
+/**
+ * @file EntityActionScheduler.h
+ * @brief Scheduler whose pending actions live in a registry storage next to their entity.
+ *
+ * BasicScheduler owns its actions and keeps a per-entity index of them, then
+ * checks registry.valid() on every action it runs, because it cannot tell when
+ * an entity is destroyed unless connect() is called. EntityActionScheduler
+ * stores the callables of pending actions as a StoredActions component in a
+ * named storage of the registry instead. The registry's storages are
+ * sigh-mixin pools, so destroying an entity removes its StoredActions and
+ * frees the callables with the rest of its components, and on_destroy
+ * listeners of the pool are told about it. The scheduler itself only keeps a
+ * timeline of small (tick, entity, ID) entries and skips those whose action is
+ * no longer in the storage.
+ */
+#pragma once
+
+#include "GameEvents.h"
+#include "HeapQueue.h"
+#include "Scheduler.h"
+#include "SlotMap.h"
+#include "StaticDispatcher.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct StoredActions
+ * @brief Component holding the actions scheduled on an entity, in scheduling order
+ */
+struct StoredActions {
+    /// @brief One pending action
+    struct Entry {
+        ActionID id;                   ///< ID returned by EntityActionScheduler::schedule()
+        ActionFunction action;         ///< Run when the action is due
+        CompletionFunction onComplete; ///< Run after the action, may be empty
+    };
+
+    // Move-only, so the storage never tries to copy the callables
+    StoredActions() = default;
+    StoredActions(StoredActions &&) = default;
+    StoredActions &operator=(StoredActions &&) = default;
+
+    std::vector<Entry> entries;
+};
+
+/**
+ * @class EntityActionScheduler
+ * @brief Runs one-shot entity actions stored in a registry pool, in tick order
+ *
+ * Actions due at the same tick run in scheduling order and report an
+ * ActionCompletedEvent like a BasicScheduler with CompletionReport::perAction.
+ * Periodic actions, chains, groups and inboxes are not supported; use
+ * BasicScheduler for those.
+ *
+ * The pool is named, so several schedulers can share a registry. Removing the
+ * StoredActions of an entity, by destroying the entity or with
+ * registry.storage<StoredActions>(name).remove(entity), cancels all of its
+ * actions. A cancelled action leaves its timeline entry behind until its tick
+ * comes up; the entry holds no callable.
+ *
+ * @code
+ * entt::registry registry;
+ * EntityActionScheduler scheduler(registry);
+ * scheduler.schedule(5, enemy, [](entt::entity e, entt::registry &r) {
+ *     r.get<Health>(e).current -= 10;
+ * });
+ * registry.destroy(enemy); // The action is gone with the entity
+ * scheduler.update(5, dispatcher);
+ * @endcode
+ */
+class EntityActionScheduler {
+  public:
+    /// @brief The registry pool pending actions are stored in
+    using storage_type = entt::registry::storage_for_type<StoredActions>;
+
+    /**
+     * @brief Constructs a scheduler storing its actions in a registry
+     * @param registry The registry, which must outlive the scheduler
+     * @param name Name of the StoredActions pool within the registry
+     */
+    explicit EntityActionScheduler(entt::registry &registry,
+                                   entt::id_type name = entt::type_hash<StoredActions>::value())
+        : registry(&registry), pool(&registry.storage<StoredActions>(name)) {}
+
+    /**
+     * @brief Schedules an action on an entity
+     * @param tick The tick at which to run the action
+     * @param entity The entity, which must be valid
+     * @param action The function to run
+     * @param onComplete Optional callback run after the action
+     * @return The ID of the action
+     */
+    ActionID schedule(int tick, entt::entity entity, ActionFunction action,
+                      CompletionFunction onComplete = nullptr) {
+        ActionID id = ids.insert(entity);
+        StoredActions &pending = pool->contains(entity) ? pool->get(entity) : pool->emplace(entity);
+        pending.entries.push_back(
+            StoredActions::Entry{id, std::move(action), std::move(onComplete)});
+        timeline.push(TimelineEntry{tick, entity, id});
+        return id;
+    }
+
+    /**
+     * @brief Cancels a pending action
+     * @param id The ID returned by schedule()
+     * @return true if the action was pending and is now cancelled
+     */
+    bool cancel(ActionID id) {
+        const entt::entity *entity = ids.find(id);
+        if (entity == nullptr || !pool->contains(*entity)) {
+            return false;
+        }
+        std::vector<StoredActions::Entry> &entries = pool->get(*entity).entries;
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [id](const StoredActions::Entry &entry) { return entry.id == id; });
+        if (it == entries.end()) {
+            return false;
+        }
+        entries.erase(it);
+        if (entries.empty()) {
+            pool->erase(*entity);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Cancels every pending action of an entity
+     * @param entity The entity
+     * @return The number of actions cancelled
+     */
+    std::size_t cancelAll(entt::entity entity) {
+        std::size_t count = pendingCount(entity);
+        pool->remove(entity);
+        return count;
+    }
+
+    /// @brief Checks whether an action is still waiting to run
+    bool isPending(ActionID id) const { return find(id) != nullptr; }
+
+    /// @brief Gets the number of pending actions of an entity
+    std::size_t pendingCount(entt::entity entity) const {
+        return pool->contains(entity) ? pool->get(entity).entries.size() : 0;
+    }
+
+    /// @brief Gets the tick of the earliest timeline entry, cancelled or not
+    std::optional<int> nextDueTick() const { return timeline.nextTick(); }
+
+    /// @brief Gets the number of timeline entries, including cancelled ones not reached yet
+    std::size_t timelineSize() const { return timeline.size(); }
+
+    /**
+     * @brief Runs every action due at or before a tick
+     * @param current_tick The current system tick
+     * @param dispatcher Dispatcher completion events are enqueued on
+     * @return The number of actions run
+     */
+    std::size_t update(int current_tick, EventDispatcher &dispatcher) {
+        std::size_t ran = 0;
+        TimelineEntry due{};
+        while (timeline.popDue(current_tick, due)) {
+            ids.erase(due.id);
+            if (!pool->contains(due.entity)) {
+                continue; // Destroyed, or every action of the entity was cancelled
+            }
+            std::vector<StoredActions::Entry> &entries = pool->get(due.entity).entries;
+            auto it = std::find_if(entries.begin(), entries.end(), [&due](const auto &entry) {
+                return entry.id == due.id;
+            });
+            if (it == entries.end()) {
+                continue;
+            }
+            // Take the action out first: it may schedule, cancel or destroy its entity
+            StoredActions::Entry entry = std::move(*it);
+            entries.erase(it);
+            if (entries.empty()) {
+                pool->erase(due.entity);
+            }
+            entry.action(due.entity, *registry);
+            dispatcher.enqueue<GameEvents::ActionCompletedEvent>(entry.id, due.entity);
+            if (entry.onComplete) {
+                entry.onComplete(entry.id, due.entity, *registry, dispatcher);
+            }
+            ++ran;
+        }
+        return ran;
+    }
+
+    /// @brief Cancels every pending action and empties the timeline
+    void clear() {
+        pool->clear();
+        timeline.clear();
+        ids.clear();
+    }
+
+  private:
+    /// Reference from the timeline to an action in the pool
+    struct TimelineEntry {
+        int tick;
+        entt::entity entity;
+        ActionID id;
+    };
+
+    const StoredActions::Entry *find(ActionID id) const {
+        const entt::entity *entity = ids.find(id);
+        if (entity == nullptr || !pool->contains(*entity)) {
+            return nullptr;
+        }
+        for (const StoredActions::Entry &entry : pool->get(*entity).entries) {
+            if (entry.id == id) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    entt::registry *registry;
+    storage_type *pool;
+    HeapQueue<TimelineEntry> timeline;
+    SlotMap<entt::entity, ActionID> ids; ///< Entity of each ID until its timeline entry is reached
+};
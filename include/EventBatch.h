@@ -0,0 +1,149 @@
+/**
+ * @file EventBatch.h
+ * @brief Listeners that take every queued event of a type at once, as a span.
+ *
+ * A dispatcher update calls each listener once per event, through a
+ * delegate. For high-rate events such as EntityDamagedEvent, a listener that
+ * gets all of the update's events as one contiguous span pays for one call
+ * instead of thousands, and can loop over the events tightly or vectorize.
+ * Batch listeners connect beside single-event listeners, which keep working.
+ *
+ * StaticDispatcher publishes batches itself, straight from its queues, through
+ * batchSink(). EventBatches adds batch listeners to an entt::dispatcher, whose
+ * queues are not reachable from outside.
+ */
+#pragma once
+
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @class EventSpan
+ * @brief Contiguous read-only range of events, std::span<const Event> for C++17
+ * @tparam Event The event type
+ */
+template <typename Event> class EventSpan {
+  public:
+    EventSpan() noexcept = default;
+
+    /// @brief Views count events starting at first
+    EventSpan(const Event *first, std::size_t count) noexcept : first(first), count(count) {}
+
+    const Event *begin() const noexcept { return first; }
+    const Event *end() const noexcept { return first + count; }
+    const Event *data() const noexcept { return first; }
+    std::size_t size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+    const Event &operator[](std::size_t index) const noexcept { return first[index]; }
+
+  private:
+    const Event *first = nullptr;
+    std::size_t count = 0;
+};
+
+/**
+ * @class EventBatches
+ * @brief Batch listeners for the event types of an entt::dispatcher
+ *
+ * For each event type with batch listeners, one single-event listener copies
+ * the events into a buffer as the dispatcher publishes them. update() runs
+ * dispatcher.update() and then calls each batch listener once with the
+ * buffer. Single-event listeners connected to the dispatcher run first, in
+ * the order they were connected, and the buffer holds the events as they
+ * left them. Event types are published in the order their first batch
+ * listener connected. Must be destroyed before the dispatcher.
+ *
+ * @code
+ * EventBatches batches;
+ * batches.batchSink<GameEvents::EntityDamagedEvent>(dispatcher).connect<&applyDamage>();
+ *
+ * scheduler.update(tick, registry, dispatcher);
+ * batches.update(dispatcher); // Instead of dispatcher.update()
+ * @endcode
+ */
+class EventBatches {
+  public:
+    EventBatches() = default;
+    EventBatches(const EventBatches &) = delete;
+    EventBatches &operator=(const EventBatches &) = delete;
+
+    /**
+     * @brief Gets the sink batch listeners of an event type connect to
+     * @tparam Event The event type
+     * @param dispatcher The dispatcher whose events the listeners get
+     * @return A temporary entt::sink of void(EventSpan<Event>)
+     */
+    template <typename Event> auto batchSink(entt::dispatcher &dispatcher) {
+        return typename entt::sigh<void(EventSpan<Event>)>::sink_type{
+            buffer<Event>(dispatcher).signal};
+    }
+
+    /**
+     * @brief Publishes the queued events of a dispatcher, then the batches
+     * @param dispatcher The dispatcher the batch sinks were taken from
+     */
+    void update(entt::dispatcher &dispatcher) {
+        dispatcher.update();
+        for (auto &buffer : buffers) {
+            buffer->publish();
+        }
+    }
+
+    /// @brief Drops the events collected since the last update(), without publishing them
+    void clear() {
+        for (auto &buffer : buffers) {
+            buffer->clear();
+        }
+    }
+
+  private:
+    struct BasicBuffer {
+        virtual ~BasicBuffer() = default;
+        virtual void publish() = 0;
+        virtual void clear() = 0;
+        entt::id_type type;
+    };
+
+    template <typename Event> struct Buffer final : BasicBuffer {
+        explicit Buffer(entt::dispatcher &dispatcher) : dispatcher(dispatcher) {
+            dispatcher.sink<Event>().template connect<&Buffer::collect>(*this);
+        }
+
+        ~Buffer() override { dispatcher.sink<Event>().disconnect(this); }
+
+        void collect(Event &event) { events.push_back(event); }
+
+        void publish() override {
+            // Events triggered by batch listeners go to the next batch
+            publishing.swap(events);
+            if (!publishing.empty()) {
+                signal.publish(EventSpan<Event>(publishing.data(), publishing.size()));
+                publishing.clear();
+            }
+        }
+
+        void clear() override { events.clear(); }
+
+        entt::dispatcher &dispatcher;
+        entt::sigh<void(EventSpan<Event>)> signal;
+        std::vector<Event> events; ///< Copies of the events published since the last batch
+        std::vector<Event> publishing; ///< The batch being published
+    };
+
+    template <typename Event> Buffer<Event> &buffer(entt::dispatcher &dispatcher) {
+        entt::id_type type = entt::type_hash<Event>::value();
+        for (auto &buffer : buffers) {
+            if (buffer->type == type) {
+                return static_cast<Buffer<Event> &>(*buffer);
+            }
+        }
+        auto created = std::make_unique<Buffer<Event>>(dispatcher);
+        created->type = type;
+        buffers.push_back(std::move(created));
+        return static_cast<Buffer<Event> &>(*buffers.back());
+    }
+
+    std::vector<std::unique_ptr<BasicBuffer>> buffers; ///< One per event type, in connection order
+};
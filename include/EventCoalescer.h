@@ -0,0 +1,148 @@
+/**
+ * @file EventCoalescer.h
+ * @brief Merges same-tick game events with the same key before they reach the dispatcher.
+ *
+ * Damage over time and area attacks can hit one entity dozens of times in a
+ * tick, and catch-up ticks queue a run of moves for the same player. When the
+ * listeners only care about the net result, an EventCoalescer takes those
+ * events instead of the dispatcher, folds events with the same key into one as
+ * they arrive, and hands the merged events to the dispatcher in one flush.
+ */
+#pragma once
+
+#include "FlatMap.h"
+#include "GameEvents.h"
+#include "StaticDispatcher.h"
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @struct CoalescePolicy
+ * @brief How events of a type are keyed and merged, specialized per event type
+ *
+ * A specialization provides a key_type with operator==, a hash functor for it,
+ * key() and merge(). The policies below sum damage per (entity, source, damage
+ * type) and keep the first origin and the last destination of each player's moves.
+ */
+template <typename Event> struct CoalescePolicy;
+
+template <> struct CoalescePolicy<GameEvents::EntityDamagedEvent> {
+    struct key_type {
+        entt::entity entity;
+        entt::entity source;
+        entt::id_type damageType;
+
+        bool operator==(const key_type &other) const {
+            return entity == other.entity && source == other.source &&
+                   damageType == other.damageType;
+        }
+    };
+
+    struct hash {
+        std::size_t operator()(const key_type &key) const {
+            std::uint64_t packed = std::uint64_t{entt::to_integral(key.entity)} << 32 |
+                                   entt::to_integral(key.source);
+            return std::hash<std::uint64_t>{}(packed) ^ (key.damageType * 0x9e3779b9u);
+        }
+    };
+
+    static key_type key(const GameEvents::EntityDamagedEvent &event) {
+        return key_type{event.entity, event.source, event.damageType.value()};
+    }
+
+    static void merge(GameEvents::EntityDamagedEvent &into,
+                      const GameEvents::EntityDamagedEvent &event) {
+        into.damage += event.damage;
+    }
+};
+
+template <> struct CoalescePolicy<GameEvents::PlayerMoveEvent> {
+    using key_type = entt::entity;
+    using hash = std::hash<entt::entity>;
+
+    static key_type key(const GameEvents::PlayerMoveEvent &event) { return event.player; }
+
+    static void merge(GameEvents::PlayerMoveEvent &into, const GameEvents::PlayerMoveEvent &event) {
+        into.toX = event.toX;
+        into.toY = event.toY;
+    }
+};
+
+/**
+ * @class EventCoalescer
+ * @brief Pending events of one type, at most one per key
+ * @tparam Event The event type
+ * @tparam Policy Keying and merging of the events, see CoalescePolicy
+ *
+ * Merged events are flushed in the order their keys first appeared. The
+ * buffers keep their capacity across flushes, so a steady load does not
+ * allocate.
+ *
+ * @code
+ * EventCoalescer<GameEvents::EntityDamagedEvent> damage;
+ * scheduler.schedule(tick, target, [&damage](entt::entity entity, entt::registry &) {
+ *     damage.enqueue({entity, 5, entt::null, "poison"_hs});
+ * });
+ * // Every frame
+ * scheduler.update(tick, registry, dispatcher);
+ * damage.flush(dispatcher);
+ * dispatcher.update();
+ * @endcode
+ */
+template <typename Event, typename Policy = CoalescePolicy<Event>> class EventCoalescer {
+  public:
+    using key_type = typename Policy::key_type;
+
+    /**
+     * @brief Queues an event, merging it into the pending event with the same key
+     * @param event The event
+     * @return true if the event was merged rather than queued on its own
+     */
+    bool enqueue(const Event &event) {
+        auto [it, added] = slots.try_emplace(Policy::key(event), pending.size());
+        if (added) {
+            pending.push_back(event);
+            return false;
+        }
+        Policy::merge(pending[it->second], event);
+        ++mergedCount;
+        return true;
+    }
+
+    /**
+     * @brief Enqueues the pending events on a dispatcher and starts over
+     * @param dispatcher The dispatcher to hand the events to
+     * @return The number of events enqueued
+     */
+    std::size_t flush(EventDispatcher &dispatcher) {
+        std::size_t count = pending.size();
+        for (const Event &event : pending) {
+            dispatcher.enqueue(event);
+        }
+        clear();
+        return count;
+    }
+
+    /// @brief Drops the pending events
+    void clear() {
+        pending.clear();
+        slots.clear();
+    }
+
+    /// @brief Gets the pending events, in the order their keys first appeared
+    const std::vector<Event> &events() const { return pending; }
+
+    /// @brief Gets the number of pending events
+    std::size_t size() const { return pending.size(); }
+
+    /// @brief Gets the number of events merged into another since construction
+    std::size_t merged() const { return mergedCount; }
+
+  private:
+    FlatMap<key_type, std::size_t, typename Policy::hash> slots;
+    std::vector<Event> pending;
+    std::size_t mergedCount = 0;
+};
@@ -0,0 +1,125 @@
+/**
+ * @file EventInbox.h
+ * @brief Lock-free path for raising dispatcher events from worker threads.
+ *
+ * entt::dispatcher::enqueue is not thread-safe, so events raised off the main
+ * thread used to be marshalled through it by hand. Each producer thread opens
+ * its own EventInbox and enqueues into it without locks; the dispatcher's
+ * thread merges every inbox into the dispatcher before dispatcher.update().
+ * Events raised on the dispatcher's own thread keep using the dispatcher
+ * directly.
+ */
+#pragma once
+
+#include "InlineFunction.h"
+#include "SubmissionInbox.h"
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @class EventInbox
+ * @brief Events of any type raised by one producer thread, in the order it raised them
+ *
+ * Obtained from EventInboxes::open(). enqueue() may be called from any thread,
+ * concurrently with EventInboxes::merge(); give each producer thread its own
+ * inbox so producers never touch the same memory.
+ */
+class EventInbox {
+  public:
+    /**
+     * @brief Queues an event for the next merge, from any thread
+     * @param event The event, copied or moved into the inbox
+     */
+    template <typename Event> void enqueue(Event &&event) {
+        using Type = std::decay_t<Event>;
+        box.push(0, Delivery{[event = Type(std::forward<Event>(event))](
+                                 entt::dispatcher &dispatcher) mutable {
+            dispatcher.enqueue<Type>(std::move(event));
+        }});
+    }
+
+    /**
+     * @brief Queues an event built from arguments, like entt::dispatcher::enqueue
+     * @tparam Event The event type
+     * @param args Arguments the event is aggregate or constructor initialized with
+     */
+    template <typename Event, typename... Args> void enqueue(Args &&...args) {
+        if constexpr (std::is_aggregate_v<Event>) {
+            enqueue(Event{std::forward<Args>(args)...});
+        } else {
+            enqueue(Event(std::forward<Args>(args)...));
+        }
+    }
+
+  private:
+    friend class EventInboxes;
+
+    using Delivery = InlineFunction<void(entt::dispatcher &)>;
+
+    EventInbox() : box(1) {}
+
+    /// Hands the queued events to a dispatcher, on its thread
+    std::size_t merge(entt::dispatcher &dispatcher) {
+        std::size_t count = 0;
+        box.drain([&](std::uint32_t, Delivery &&deliver) {
+            deliver(dispatcher);
+            ++count;
+        });
+        return count;
+    }
+
+    SubmissionInbox<Delivery, std::uint32_t> box;
+};
+
+/**
+ * @class EventInboxes
+ * @brief The inboxes of every producer thread feeding one dispatcher
+ *
+ * merge() hands over each inbox's events in the order they were raised, the
+ * inboxes in the order they were opened, so the merged order only depends on
+ * what each producer raised between two merges.
+ *
+ * @code
+ * EventInboxes inboxes;
+ * EventInbox &ai = inboxes.open();
+ * std::thread worker([&] { ai.enqueue(GameEvents::PlayerMoveEvent{npc, 1, 1, 2, 1}); });
+ * // Every frame, on the dispatcher's thread
+ * scheduler.update(tick, registry, dispatcher);
+ * inboxes.merge(dispatcher);
+ * dispatcher.update();
+ * @endcode
+ */
+class EventInboxes {
+  public:
+    /**
+     * @brief Opens an inbox for one producer thread
+     * @return The inbox, valid for the lifetime of this object
+     *
+     * Call on the dispatcher's thread, not concurrently with merge().
+     */
+    EventInbox &open() {
+        inboxes.push_back(std::unique_ptr<EventInbox>(new EventInbox()));
+        return *inboxes.back();
+    }
+
+    /**
+     * @brief Enqueues every event raised since the last merge on a dispatcher
+     * @param dispatcher The dispatcher, on its own thread
+     * @return The number of events merged
+     */
+    std::size_t merge(entt::dispatcher &dispatcher) {
+        std::size_t count = 0;
+        for (auto &inbox : inboxes) {
+            count += inbox->merge(dispatcher);
+        }
+        return count;
+    }
+
+  private:
+    std::vector<std::unique_ptr<EventInbox>> inboxes;
+};
@@ -0,0 +1,402 @@
+/**
+ * @file EventLog.h
+ * @brief Append-only ring file of raw game events, mapped into memory for writers and readers.
+ *
+ * Mirroring events to analytics through hand-written serializers allocates and
+ * copies on every event. An EventLog taps dispatcher sinks instead and copies
+ * each trivially copyable event, behind a fixed header with its type hash,
+ * tick and length, straight into a memory-mapped file. Offline tools map the
+ * same file with EventLogView and read the events in place, with no parsing.
+ * The file is a ring: once full, the oldest records are overwritten.
+ *
+ * On POSIX systems the file is mapped with mmap and flushed with msync in
+ * batches; elsewhere, or with SCHEDULER_NO_MMAP defined, the ring lives in
+ * memory and sync() rewrites the file.
+ */
+#pragma once
+
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(SCHEDULER_NO_MMAP)
+#define SCHEDULER_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @struct EventLogHeader
+ * @brief Start of an event log file, followed by the ring of records
+ *
+ * Offsets count every byte ever appended; a record at offset o lives at
+ * byte o % capacity of the ring.
+ */
+struct EventLogHeader {
+    char magic[4];          ///< "SEVL"
+    std::uint32_t version;  ///< EventLog::version
+    std::uint64_t capacity; ///< Size of the ring in bytes, a multiple of 16
+    std::uint64_t head;     ///< Offset the next record is appended at
+    std::uint64_t tail;     ///< Offset of the oldest record kept
+    std::uint64_t reserved[4];
+};
+
+/**
+ * @struct EventLogRecord
+ * @brief Header of one logged event, followed by its bytes padded to 16
+ */
+struct EventLogRecord {
+    entt::id_type type;   ///< entt::type_hash of the event type, 0 for padding at the ring's end
+    std::int32_t tick;    ///< Tick set on the log when the event was appended
+    std::uint32_t length; ///< Size of the event in bytes
+    std::uint32_t padding;
+
+    /// @brief Gets the bytes of the event
+    const void *payload() const { return this + 1; }
+
+    /// @brief Gets the event if it is of the given type, otherwise nullptr
+    template <typename Event> const Event *as() const {
+        return type == entt::type_hash<Event>::value() && length == sizeof(Event)
+                   ? static_cast<const Event *>(payload())
+                   : nullptr;
+    }
+
+    /// @brief Gets the number of ring bytes the record takes
+    std::uint64_t footprint() const {
+        // In 64 bits, so a length near 4 GiB cannot round to a small footprint
+        return sizeof(EventLogRecord) + ((std::uint64_t{length} + 15) & ~std::uint64_t{15});
+    }
+};
+
+static_assert(sizeof(EventLogHeader) == 64 && sizeof(EventLogRecord) == 16,
+              "Log layout is shared with offline readers");
+
+/**
+ * @class EventLog
+ * @brief Writer of an event log file, fed by dispatcher taps or direct appends
+ *
+ * Only one thread appends. Taps are ordinary sink listeners, so events are
+ * logged in publish order when dispatcher.update() runs. Type hashes are those
+ * of entt::type_hash, which are stable for a given compiler; readers built
+ * with a different compiler should compare against hashes saved by the game.
+ *
+ * @code
+ * EventLog log;
+ * log.open("session.evlog", 64 << 20);
+ * log.tap<GameEvents::EntityDamagedEvent>(dispatcher);
+ * log.tap<GameEvents::EntityDiedEvent>(dispatcher);
+ * // Every frame
+ * log.setTick(tick);
+ * dispatcher.update();
+ * @endcode
+ */
+class EventLog {
+  public:
+    /// @brief Version of the file layout
+    static constexpr std::uint32_t version = 1;
+
+    EventLog() = default;
+    EventLog(const EventLog &) = delete;
+    EventLog &operator=(const EventLog &) = delete;
+    ~EventLog() { close(); }
+
+    /**
+     * @brief Opens or creates a log file
+     * @param path The file
+     * @param capacity Bytes of records kept, rounded up to a multiple of 16
+     * @return false if the file cannot be created or mapped
+     *
+     * An existing log with the same capacity is appended to; any other file
+     * is overwritten with an empty log.
+     */
+    bool open(const std::string &path, std::uint64_t capacity) {
+        close();
+        capacity = (std::max<std::uint64_t>(capacity, 4096) + 15) & ~std::uint64_t{15};
+        std::uint64_t size = sizeof(EventLogHeader) + capacity;
+        filePath = path;
+#if defined(SCHEDULER_HAS_MMAP)
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close();
+            return false;
+        }
+        void *mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close();
+            return false;
+        }
+        base = static_cast<unsigned char *>(mapping);
+#else
+        memory.assign(size, 0);
+        if (std::FILE *file = std::fopen(path.c_str(), "rb")) {
+            std::fread(memory.data(), 1, memory.size(), file);
+            std::fclose(file);
+        }
+        base = memory.data();
+#endif
+        mappedSize = size;
+        EventLogHeader &head = header();
+        if (std::memcmp(head.magic, "SEVL", 4) != 0 || head.version != version ||
+            head.capacity != capacity || head.tail > head.head) {
+            head = EventLogHeader{{'S', 'E', 'V', 'L'}, version, capacity, 0, 0, {}};
+        }
+        return true;
+    }
+
+    /// @brief Flushes and unmaps the file
+    void close() {
+        if (base != nullptr) {
+            sync();
+        }
+#if defined(SCHEDULER_HAS_MMAP)
+        if (base != nullptr) {
+            ::munmap(base, mappedSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#else
+        memory.clear();
+#endif
+        base = nullptr;
+        mappedSize = 0;
+        unsynced = 0;
+    }
+
+    /// @brief Checks whether a file is open
+    bool isOpen() const { return base != nullptr; }
+
+    /// @brief Sets the tick stamped on the records appended from now on
+    void setTick(int tick) { currentTick = tick; }
+
+    /// @brief Sets how many appended bytes trigger a sync(), 0 to only sync explicitly
+    void setSyncInterval(std::uint64_t bytes) { syncInterval = bytes; }
+
+    /**
+     * @brief Logs every event of a type published by a dispatcher
+     * @tparam Event A trivially copyable event type
+     * @param dispatcher The dispatcher to tap
+     */
+    template <typename Event> void tap(entt::dispatcher &dispatcher) {
+        dispatcher.sink<Event>().template connect<&EventLog::append<Event>>(*this);
+    }
+
+    /// @brief Stops logging events of a type published by a dispatcher
+    template <typename Event> void untap(entt::dispatcher &dispatcher) {
+        dispatcher.sink<Event>().template disconnect<&EventLog::append<Event>>(*this);
+    }
+
+    /**
+     * @brief Appends an event at the current tick
+     * @param event The event, copied byte for byte
+     */
+    template <typename Event> void append(const Event &event) {
+        static_assert(std::is_trivially_copyable_v<Event>, "Events are logged as raw bytes");
+        write(entt::type_hash<Event>::value(), &event, sizeof(Event));
+    }
+
+    /**
+     * @brief Appends raw bytes as a record of a type
+     * @param type Type hash stored in the record, not 0
+     * @param data The bytes
+     * @param length Number of bytes, at most a quarter of the capacity
+     * @return false if no file is open or the record is too large
+     */
+    bool write(entt::id_type type, const void *data, std::uint32_t length) {
+        if (base == nullptr) {
+            return false;
+        }
+        EventLogHeader &head = header();
+        EventLogRecord record{type, currentTick, length, 0};
+        std::uint64_t needed = record.footprint();
+        if (needed > head.capacity / 4) {
+            return false;
+        }
+        std::uint64_t position = head.head % head.capacity;
+        if (position + needed > head.capacity) {
+            // Records never wrap; pad out the end of the ring and start over
+            std::uint64_t rest = head.capacity - position;
+            reclaim(head, rest);
+            EventLogRecord pad{0, currentTick, static_cast<std::uint32_t>(rest - sizeof(pad)), 0};
+            std::memcpy(ring() + position, &pad, sizeof(pad));
+            head.head += rest;
+            position = 0;
+        }
+        reclaim(head, needed);
+        unsigned char *at = ring() + position;
+        std::memcpy(at, &record, sizeof(record));
+        std::memcpy(at + sizeof(record), data, length);
+        head.head += needed;
+        unsynced += needed;
+        if (syncInterval != 0 && unsynced >= syncInterval) {
+            sync();
+        }
+        return true;
+    }
+
+    /// @brief Schedules the appended records to be written to the file
+    void sync() {
+        if (base == nullptr) {
+            return;
+        }
+#if defined(SCHEDULER_HAS_MMAP)
+        ::msync(base, mappedSize, MS_ASYNC);
+#else
+        if (std::FILE *file = std::fopen(filePath.c_str(), "wb")) {
+            std::fwrite(memory.data(), 1, memory.size(), file);
+            std::fclose(file);
+        }
+#endif
+        unsynced = 0;
+    }
+
+    /// @brief Gets the header of the open file
+    const EventLogHeader &info() const { return *reinterpret_cast<const EventLogHeader *>(base); }
+
+  private:
+    EventLogHeader &header() { return *reinterpret_cast<EventLogHeader *>(base); }
+
+    unsigned char *ring() { return base + sizeof(EventLogHeader); }
+
+    /// Drops the oldest records until bytes more fit in the ring
+    void reclaim(EventLogHeader &head, std::uint64_t bytes) {
+        while (head.head + bytes - head.tail > head.capacity) {
+            const auto *oldest =
+                reinterpret_cast<const EventLogRecord *>(ring() + head.tail % head.capacity);
+            head.tail += oldest->footprint();
+        }
+    }
+
+    unsigned char *base = nullptr;
+    std::uint64_t mappedSize = 0;
+    std::uint64_t unsynced = 0;
+    std::uint64_t syncInterval = 1 << 20;
+    int currentTick = 0;
+    std::string filePath;
+#if defined(SCHEDULER_HAS_MMAP)
+    int fd = -1;
+#else
+    std::vector<unsigned char> memory;
+#endif
+};
+
+/**
+ * @class EventLogView
+ * @brief Read-only mapping of an event log, iterated in place
+ *
+ * @code
+ * EventLogView view;
+ * view.open("session.evlog");
+ * view.forEach([](const EventLogRecord &record) {
+ *     if (const auto *damage = record.as<GameEvents::EntityDamagedEvent>()) {
+ *         total += damage->damage;
+ *     }
+ * });
+ * @endcode
+ */
+class EventLogView {
+  public:
+    EventLogView() = default;
+    EventLogView(const EventLogView &) = delete;
+    EventLogView &operator=(const EventLogView &) = delete;
+    ~EventLogView() { close(); }
+
+    /**
+     * @brief Maps a log file
+     * @param path The file
+     * @return false if the file cannot be mapped, is not a log of this version,
+     *         has a ring that is empty, not a whole number of 16-byte records
+     *         or larger than the file, or has an unaligned or inverted tail
+     */
+    bool open(const std::string &path) {
+        close();
+#if defined(SCHEDULER_HAS_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat status {};
+        if (::fstat(fd, &status) == 0 && status.st_size >= 0 &&
+            static_cast<std::uint64_t>(status.st_size) >= sizeof(EventLogHeader)) {
+            mappedSize = static_cast<std::uint64_t>(status.st_size);
+            void *mapping = ::mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+            base = mapping == MAP_FAILED ? nullptr : static_cast<const unsigned char *>(mapping);
+        }
+        ::close(fd);
+#else
+        if (std::FILE *file = std::fopen(path.c_str(), "rb")) {
+            unsigned char chunk[4096];
+            for (std::size_t read; (read = std::fread(chunk, 1, sizeof(chunk), file)) != 0;) {
+                memory.insert(memory.end(), chunk, chunk + read);
+            }
+            std::fclose(file);
+        }
+        mappedSize = memory.size();
+        base = mappedSize >= sizeof(EventLogHeader) ? memory.data() : nullptr;
+#endif
+        // forEach() walks the ring modulo its capacity in steps of whole records
+        if (base == nullptr || std::memcmp(info().magic, "SEVL", 4) != 0 ||
+            info().version != EventLog::version || info().capacity == 0 ||
+            info().capacity % sizeof(EventLogRecord) != 0 ||
+            info().capacity > mappedSize - sizeof(EventLogHeader) || info().tail > info().head ||
+            info().tail % sizeof(EventLogRecord) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief Unmaps the file
+    void close() {
+#if defined(SCHEDULER_HAS_MMAP)
+        if (base != nullptr) {
+            ::munmap(const_cast<unsigned char *>(base), mappedSize);
+        }
+#else
+        memory.clear();
+#endif
+        base = nullptr;
+        mappedSize = 0;
+    }
+
+    /// @brief Gets the header of the mapped file
+    const EventLogHeader &info() const { return *reinterpret_cast<const EventLogHeader *>(base); }
+
+    /**
+     * @brief Visits the kept records, oldest first, skipping padding
+     *
+     * A record whose length would reach past the end of the ring, which the
+     * writer never produces, ends the walk.
+     */
+    template <typename F> void forEach(F &&fn) const {
+        const EventLogHeader &head = info();
+        const unsigned char *ring = base + sizeof(EventLogHeader);
+        for (std::uint64_t offset = head.tail; offset < head.head;) {
+            std::uint64_t position = offset % head.capacity;
+            const auto *record = reinterpret_cast<const EventLogRecord *>(ring + position);
+            if (record->footprint() > head.capacity - position) {
+                return;
+            }
+            if (record->type != 0) {
+                fn(*record);
+            }
+            offset += record->footprint();
+        }
+    }
+
+  private:
+    const unsigned char *base = nullptr;
+    std::uint64_t mappedSize = 0;
+#if !defined(SCHEDULER_HAS_MMAP)
+    std::vector<unsigned char> memory;
+#endif
+};
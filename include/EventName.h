@@ -0,0 +1,135 @@
+/**
+ * @file EventName.h
+ * @brief Hashed names for timed and game events, with an optional table for reverse lookup.
+ *
+ * An event name is stored as a 32-bit entt hash instead of a std::string, so
+ * naming an event never allocates. The EventNames table remembers the text of
+ * hashed names when interning is switched on, for debug output and metrics.
+ */
+#pragma once
+
+#include "entt/entt.hpp"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+/**
+ * @class EventNames
+ * @brief Process-wide table mapping name hashes back to their text
+ *
+ * Interning is off by default; while it is off, names are only hashed. The
+ * table is thread-safe, so events can be named on any thread.
+ */
+class EventNames {
+  public:
+    /// @brief Switches recording of hashed names on or off
+    static void setInterning(bool enabled) {
+        interning().store(enabled, std::memory_order_relaxed);
+    }
+
+    /// @brief Checks whether hashed names are being recorded
+    static bool isInterning() { return interning().load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Hashes a name, recording its text if interning is on
+     * @param name The name
+     * @return The hash of the name, 0 for an empty name
+     */
+    static entt::id_type intern(std::string_view name) {
+        if (name.empty()) {
+            return 0;
+        }
+        entt::id_type id = entt::hashed_string::value(name.data(), name.size());
+        if (isInterning()) {
+            State &table = state();
+            std::lock_guard<std::mutex> lock(table.mutex);
+            if (table.names.find(id) == table.names.end()) {
+                table.names.emplace(id, table.texts.emplace_back(name));
+            }
+        }
+        return id;
+    }
+
+    /**
+     * @brief Gets the text of an interned name
+     * @param id The hash of the name
+     * @return The text, or an empty view if the name was not interned
+     *
+     * The view stays valid for the lifetime of the program.
+     */
+    static std::string_view lookup(entt::id_type id) {
+        State &table = state();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        auto it = table.names.find(id);
+        return it == table.names.end() ? std::string_view{} : it->second;
+    }
+
+  private:
+    struct State {
+        std::mutex mutex;
+        std::deque<std::string> texts;                          ///< Stable storage of the text
+        entt::dense_map<entt::id_type, std::string_view> names; ///< Views into texts
+    };
+
+    static std::atomic<bool> &interning() {
+        static std::atomic<bool> enabled{false};
+        return enabled;
+    }
+
+    static State &state() {
+        static State table;
+        return table;
+    }
+};
+
+/**
+ * @class EventName
+ * @brief The name of a timed event, or a name carried by a game event, stored as its hash
+ *
+ * Implicitly built from a string, which is hashed (and interned if
+ * EventNames interning is on), or from an entt::hashed_string, which is
+ * hashed at compile time and never interned.
+ *
+ * @code
+ * using namespace entt::literals;
+ * scheduler.scheduleFunction(tick, spawnWave, "SpawnWave"_hs);
+ * @endcode
+ */
+class EventName {
+  public:
+    /// @brief The empty name
+    constexpr EventName() noexcept = default;
+
+    /// @brief Names an event by a precomputed hash
+    constexpr EventName(const entt::hashed_string &name) noexcept : id(name.value()) {}
+
+    /// @brief Names an event by its text
+    EventName(std::string_view name) : id(EventNames::intern(name)) {}
+
+    /// @brief Names an event by its text
+    EventName(const char *name) : EventName(std::string_view{name}) {}
+
+    /// @brief Names an event by its text
+    EventName(const std::string &name) : EventName(std::string_view{name}) {}
+
+    /// @brief Wraps a hash obtained elsewhere
+    static constexpr EventName fromId(entt::id_type id) noexcept {
+        EventName name;
+        name.id = id;
+        return name;
+    }
+
+    /// @brief Gets the hash of the name, 0 for the empty name
+    constexpr entt::id_type value() const noexcept { return id; }
+
+    /// @brief Gets the text of the name if it was interned, otherwise an empty view
+    std::string_view text() const { return EventNames::lookup(id); }
+
+    constexpr bool operator==(const EventName &other) const noexcept { return id == other.id; }
+    constexpr bool operator!=(const EventName &other) const noexcept { return id != other.id; }
+
+  private:
+    entt::id_type id = 0;
+};
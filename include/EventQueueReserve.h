@@ -0,0 +1,144 @@
+/**
+ * @file EventQueueReserve.h
+ * @brief Keeps the dispatcher's per-type event queues sized for the heaviest frame seen.
+ *
+ * An entt::dispatcher keeps one vector per event type and never shrinks it:
+ * dispatcher.update() empties the queues but leaves their capacity. Enqueueing
+ * therefore only allocates when a frame queues more events of a type than any
+ * frame before it, or when a type is queued for the first time. EventQueueReserve
+ * records the high-water mark of every tracked type and grows the queues to it
+ * plus some headroom between frames, so those allocations happen at a chosen
+ * moment, such as a loading screen, instead of in the middle of a heavy frame.
+ */
+#pragma once
+
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class EventQueueReserve
+ * @brief Per-type high-water marks of a dispatcher's queues, kept across frames
+ *
+ * Track the event types a frame queues, call record() right before
+ * dispatcher.update() and reserve() after it. Marks are kept when the
+ * dispatcher is cleared or replaced, so a profile from an earlier session can
+ * size a new dispatcher up front with setHighWater() and reserve().
+ *
+ * @code
+ * EventQueueReserve queues;
+ * queues.track<GameEvents::ActionCompletedEvent>(4096);
+ * queues.track<GameEvents::EntityDamagedEvent>();
+ * queues.reserve(dispatcher);
+ * // Every frame
+ * scheduler.update(tick, registry, dispatcher);
+ * queues.record(dispatcher);
+ * dispatcher.update();
+ * queues.reserve(dispatcher);
+ * @endcode
+ */
+class EventQueueReserve {
+  public:
+    /// @param headroom Factor applied to a mark when reserving, at least 1
+    explicit EventQueueReserve(double headroom = 1.5) : headroom(std::max(headroom, 1.0)) {}
+
+    /**
+     * @brief Starts tracking an event type
+     * @tparam Event A default constructible event type
+     * @param initial Initial high-water mark
+     */
+    template <typename Event> void track(std::size_t initial = 0) {
+        static_assert(std::is_default_constructible_v<Event>,
+                      "Queues are grown by enqueueing default constructed events");
+        Entry *entry = find(entt::type_hash<Event>::value());
+        if (entry == nullptr) {
+            entries.push_back(Entry{entt::type_hash<Event>::value(), 0, 0, &pendingOf<Event>,
+                                    &growTo<Event>});
+            entry = &entries.back();
+        }
+        entry->mark = std::max(entry->mark, initial);
+    }
+
+    /**
+     * @brief Raises the high-water marks to the events queued right now
+     * @param dispatcher The dispatcher about to be updated
+     */
+    void record(const entt::dispatcher &dispatcher) {
+        for (Entry &entry : entries) {
+            entry.mark = std::max(entry.mark, entry.pending(dispatcher));
+        }
+    }
+
+    /**
+     * @brief Grows the queues of tracked types to their mark plus headroom
+     * @param dispatcher The dispatcher whose queues to grow
+     *
+     * Only empty queues are grown, so call it after dispatcher.update(). Does
+     * nothing for types already reserved for their current mark, which makes
+     * it cheap to call every frame.
+     */
+    void reserve(entt::dispatcher &dispatcher) {
+        for (Entry &entry : entries) {
+            auto wanted = static_cast<std::size_t>(static_cast<double>(entry.mark) * headroom);
+            if (wanted > entry.reserved && entry.pending(dispatcher) == 0) {
+                entry.grow(dispatcher, wanted);
+                entry.reserved = wanted;
+            }
+        }
+    }
+
+    /// @brief Forgets what has been reserved, for a new or cleared dispatcher
+    void resetReserved() {
+        for (Entry &entry : entries) {
+            entry.reserved = 0;
+        }
+    }
+
+    /// @brief Gets the high-water mark of a tracked type, 0 if it is not tracked
+    template <typename Event> std::size_t highWater() const {
+        const Entry *entry = find(entt::type_hash<Event>::value());
+        return entry == nullptr ? 0 : entry->mark;
+    }
+
+    /// @brief Sets the high-water mark of a type, tracking it if needed
+    template <typename Event> void setHighWater(std::size_t mark) {
+        track<Event>();
+        find(entt::type_hash<Event>::value())->mark = mark;
+    }
+
+  private:
+    struct Entry {
+        entt::id_type type;
+        std::size_t mark;     ///< Most events of the type seen queued at once
+        std::size_t reserved; ///< Capacity last reserved in the dispatcher
+        std::size_t (*pending)(const entt::dispatcher &);
+        void (*grow)(entt::dispatcher &, std::size_t);
+    };
+
+    template <typename Event> static std::size_t pendingOf(const entt::dispatcher &dispatcher) {
+        return dispatcher.size<Event>();
+    }
+
+    /// The dispatcher has no reserve, but its queue keeps the capacity clear() leaves
+    template <typename Event> static void growTo(entt::dispatcher &dispatcher, std::size_t size) {
+        for (std::size_t i = 0; i < size; ++i) {
+            dispatcher.enqueue<Event>();
+        }
+        dispatcher.clear<Event>();
+    }
+
+    Entry *find(entt::id_type type) {
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [type](const Entry &entry) { return entry.type == type; });
+        return it == entries.end() ? nullptr : &*it;
+    }
+
+    const Entry *find(entt::id_type type) const {
+        return const_cast<EventQueueReserve *>(this)->find(type);
+    }
+
+    double headroom;
+    std::vector<Entry> entries;
+};
@@ -0,0 +1,240 @@
+/**
+ * @file EventSpill.h
+ * @brief Disk tier for timed events due far in the future.
+ *
+ * Auction expirations, weekly resets and respawn timers can wait for days,
+ * and used to stay in memory the whole time. A TimedEventScheduler given an
+ * EventSpill with setSpill() writes saveable events due beyond the spill's
+ * horizon (see ActionHandlers.h) to files on disk instead, one file per
+ * bucket of ticks. Records are buffered per bucket and appended once per
+ * update. A bucket is read back into the queue in one pass, with the events'
+ * original IDs, during the update one bucket before it comes due.
+ */
+#pragma once
+
+#include "ActionHandlers.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct SpilledEventRecord
+ * @brief On-disk form of an event moved to the disk tier
+ */
+struct SpilledEventRecord {
+    std::uint32_t id;      ///< EventID the event keeps once paged back in
+    std::int32_t tick;     ///< Tick the event is due at
+    std::int32_t priority; ///< Priority within the tick
+    entt::id_type name;    ///< Hash of the event name, 0 if unnamed
+    SavedPayload payload;  ///< Handler and payload of the event
+};
+
+static_assert(std::is_trivially_copyable_v<SpilledEventRecord>,
+              "Records are written as raw bytes");
+
+/**
+ * @class EventSpill
+ * @brief Time-bucketed files holding the far-future events of one scheduler
+ *
+ * Bucket n holds the events due in [n * bucketTicks, (n + 1) * bucketTicks)
+ * and lives in the file "<directory>/<n>.spill". The directory must exist
+ * and belong to one spill; files left by an earlier run are not read, use a
+ * snapshot to keep events across runs. Cancelled events stay in their file
+ * and are dropped when it is read.
+ *
+ * @code
+ * EventSpill spill("spill", 24 * 3600 * 60, 3600 * 60); // Spill past a day, hourly buckets
+ * eventScheduler.setSpill(&spill, &eventHandlers);
+ * eventScheduler.scheduleFunction(tick + weekTicks, eventHandlers.bind("reset"_hs, Reset{}));
+ * @endcode
+ */
+class EventSpill {
+  public:
+    /**
+     * @param directory Directory the bucket files are written to
+     * @param horizon Ticks ahead of the current tick from which events are spilled
+     * @param bucketTicks Ticks covered by one bucket file, at least 1
+     */
+    EventSpill(std::string directory, int horizon, int bucketTicks)
+        : directory(std::move(directory)), horizonTicks(horizon),
+          width(bucketTicks > 0 ? bucketTicks : 1) {}
+
+    EventSpill(const EventSpill &) = delete;
+    EventSpill &operator=(const EventSpill &) = delete;
+
+    ~EventSpill() { clear(); }
+
+    /// @brief Gets the number of ticks ahead from which events are spilled
+    int horizon() const { return horizonTicks; }
+
+    /// @brief Gets the number of ticks covered by one bucket
+    int bucketTicks() const { return width; }
+
+    /// @brief Gets the number of records on disk or buffered, cancelled events included
+    std::size_t size() const { return stored; }
+
+    /**
+     * @brief Checks whether an event due at a tick goes to disk
+     *
+     * Events due beyond the horizon go to disk while their bucket has not
+     * been read back. Once a bucket holds events, later events of the same
+     * bucket follow them there, so events of one tick keep their order.
+     */
+    bool accepts(int tick) const {
+        std::int64_t bucket = bucketOf(tick);
+        if (bucket * width <= loadedThrough) {
+            return false;
+        }
+        return buckets.find(bucket) != buckets.end() ||
+               static_cast<std::int64_t>(tick) - now >= horizonTicks;
+    }
+
+    /// @brief Buffers a record until the next flush(), called by the scheduler
+    void store(const SpilledEventRecord &record) {
+        Bucket &bucket = buckets[bucketOf(record.tick)];
+        bucket.earliest = std::min(bucket.earliest, static_cast<int>(record.tick));
+        bucket.buffered.push_back(record);
+        ++stored;
+    }
+
+    /**
+     * @brief Appends the buffered records to their bucket files
+     * @return false if a file could not be written; the records not written stay buffered
+     */
+    bool flush() {
+        bool ok = true;
+        for (auto &[index, bucket] : buckets) {
+            if (bucket.buffered.empty()) {
+                continue;
+            }
+            std::FILE *file = std::fopen(path(index).c_str(), "ab");
+            if (file == nullptr) {
+                ok = false;
+                continue;
+            }
+            std::size_t written = std::fwrite(bucket.buffered.data(), sizeof(SpilledEventRecord),
+                                              bucket.buffered.size(), file);
+            ok = std::fclose(file) == 0 && written == bucket.buffered.size() && ok;
+            bucket.onDisk += written;
+            bucket.buffered.erase(bucket.buffered.begin(), bucket.buffered.begin() + written);
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Takes every bucket that starts before the end of the next bucket
+     * @param currentTick The tick being updated
+     * @param records Receives the records of those buckets, in bucket and
+     *        storage order
+     * @return false if a bucket file could not be read completely
+     *
+     * The files of the buckets taken are removed. A bucket whose file could
+     * not be read is kept, file and all, and none of its records are given;
+     * nextTick() leaves it out until a later load() reads it. Events due at
+     * or before the end of the loaded buckets are no longer accepted.
+     */
+    bool load(int currentTick, std::vector<SpilledEventRecord> &records) {
+        now = currentTick;
+        loadedThrough = std::max(loadedThrough,
+                                 (bucketOf(currentTick) + 2) * std::int64_t{width} - 1);
+        bool ok = true;
+        for (auto it = buckets.begin();
+             it != buckets.end() && it->first * width <= loadedThrough;) {
+            Bucket &bucket = it->second;
+            if (bucket.onDisk != 0) {
+                bucket.unreadable = !read(it->first, bucket.onDisk, records);
+                if (bucket.unreadable) {
+                    ok = false;
+                    ++it;
+                    continue;
+                }
+                std::remove(path(it->first).c_str());
+            }
+            records.insert(records.end(), bucket.buffered.begin(), bucket.buffered.end());
+            stored -= bucket.onDisk + bucket.buffered.size();
+            it = buckets.erase(it);
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Gets the earliest tick of a spilled event, or nothing if none is spilled
+     *
+     * Buckets the last load() could not read are left out, so a caller
+     * stepping from due tick to due tick moves past them.
+     */
+    std::optional<int> nextTick() const {
+        for (const auto &[index, bucket] : buckets) {
+            if (!bucket.unreadable) {
+                return bucket.earliest;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Gets the number of buckets the last load() could not read
+    std::size_t unreadableCount() const {
+        return static_cast<std::size_t>(
+            std::count_if(buckets.begin(), buckets.end(),
+                          [](const auto &entry) { return entry.second.unreadable; }));
+    }
+
+    /// @brief Drops every spilled event and removes the bucket files
+    void clear() {
+        for (const auto &[index, bucket] : buckets) {
+            if (bucket.onDisk != 0) {
+                std::remove(path(index).c_str());
+            }
+        }
+        buckets.clear();
+        stored = 0;
+    }
+
+  private:
+    struct Bucket {
+        int earliest = std::numeric_limits<int>::max(); ///< Earliest tick stored
+        std::size_t onDisk = 0;                          ///< Records appended to the file
+        std::vector<SpilledEventRecord> buffered;        ///< Records waiting for flush()
+        bool unreadable = false;                         ///< Whether the last load() failed
+    };
+
+    /// Division rounding towards negative infinity
+    std::int64_t bucketOf(int tick) const {
+        std::int64_t quotient = tick / width;
+        return (tick % width != 0 && tick < 0) ? quotient - 1 : quotient;
+    }
+
+    std::string path(std::int64_t index) const {
+        return directory + "/" + std::to_string(index) + ".spill";
+    }
+
+    bool read(std::int64_t index, std::size_t count, std::vector<SpilledEventRecord> &records) {
+        std::FILE *file = std::fopen(path(index).c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        std::size_t first = records.size();
+        records.resize(first + count);
+        std::size_t got = std::fread(records.data() + first, sizeof(SpilledEventRecord), count, file);
+        std::fclose(file);
+        // A short read gives nothing, so a retry does not repeat records
+        records.resize(got == count ? first + got : first);
+        return got == count;
+    }
+
+    std::string directory;
+    int horizonTicks;
+    int width;
+    std::int64_t now = 0;                                       ///< Tick of the last load()
+    std::int64_t loadedThrough = std::numeric_limits<int>::min(); ///< Last tick already read back
+    std::map<std::int64_t, Bucket> buckets;                     ///< Buckets with records, by index
+    std::size_t stored = 0;
+};
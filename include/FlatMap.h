@@ -0,0 +1,557 @@
+/**
+ * @file FlatMap.h
+ * @brief Open-addressing hash map probing sixteen control bytes per step.
+ *
+ * entt::dense_map finds a key by hashing it to a bucket and following a
+ * chain of indices through its packed vector, one dependent load per link.
+ * FlatMap keeps one control byte per slot instead, holding seven bits of
+ * the key's hash, and compares a group of sixteen of them with the hash at
+ * once: with SSE2 on x86-64, NEON on AArch64, plain code elsewhere or with
+ * SCHEDULER_NO_SIMD defined. A lookup usually touches one group of control
+ * bytes and one slot.
+ *
+ * Its interface follows entt::dense_map, so the two swap freely: iterators
+ * yield pairs of references, and the scheduler's per-entity index and the
+ * event coalescers are built on it.
+ */
+#pragma once
+
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if !defined(SCHEDULER_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64)
+#define SCHEDULER_FLAT_MAP_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define SCHEDULER_FLAT_MAP_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+/**
+ * @class FlatMapGroup
+ * @brief Sixteen control bytes compared at once
+ *
+ * A control byte is empty (0x80), deleted (0xFE), or the low seven bits of
+ * the hash of the key in its slot. Matches come back as a bit mask, bit i
+ * standing for byte i.
+ */
+class FlatMapGroup {
+  public:
+    static constexpr std::size_t width = 16;
+    static constexpr std::uint8_t empty = 0x80;
+    static constexpr std::uint8_t deleted = 0xFE;
+
+    /// @brief Loads the group at bytes, which must be 16-byte aligned
+    explicit FlatMapGroup(const std::uint8_t *bytes) : bytes(bytes) {}
+
+    /// @brief Finds the bytes equal to a hash fragment
+    std::uint32_t match(std::uint8_t fragment) const { return equal(fragment); }
+
+    /// @brief Finds the empty bytes
+    std::uint32_t matchEmpty() const { return equal(empty); }
+
+    /// @brief Finds the bytes of slots that hold no element
+    std::uint32_t matchFree() const {
+#if defined(SCHEDULER_FLAT_MAP_SSE2)
+        // Empty and deleted are the only bytes with the top bit set
+        __m128i group = _mm_load_si128(reinterpret_cast<const __m128i *>(bytes));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(group));
+#else
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < width; ++i) {
+            mask |= static_cast<std::uint32_t>(bytes[i] >> 7) << i;
+        }
+        return mask;
+#endif
+    }
+
+  private:
+    std::uint32_t equal(std::uint8_t value) const {
+#if defined(SCHEDULER_FLAT_MAP_SSE2)
+        __m128i group = _mm_load_si128(reinterpret_cast<const __m128i *>(bytes));
+        __m128i same = _mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(value)));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(same));
+#elif defined(SCHEDULER_FLAT_MAP_NEON)
+        static const std::uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                                 1, 2, 4, 8, 16, 32, 64, 128};
+        uint8x16_t same = vceqq_u8(vld1q_u8(bytes), vdupq_n_u8(value));
+        uint8x16_t bits = vandq_u8(same, vld1q_u8(weights));
+        return static_cast<std::uint32_t>(vaddv_u8(vget_low_u8(bits))) |
+               static_cast<std::uint32_t>(vaddv_u8(vget_high_u8(bits))) << 8;
+#else
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < width; ++i) {
+            mask |= static_cast<std::uint32_t>(bytes[i] == value) << i;
+        }
+        return mask;
+#endif
+    }
+
+    const std::uint8_t *bytes;
+};
+
+/**
+ * @class FlatMap
+ * @brief Hash map with SIMD-probed control bytes, a drop-in for entt::dense_map
+ * @tparam Key Key type
+ * @tparam Type Mapped type
+ * @tparam Hash Hash of a key; its result is scrambled, so identity hashes are fine
+ * @tparam KeyEqual Comparison of keys
+ * @tparam Allocator Allocator of std::pair<const Key, Type>, rebound internally
+ *
+ * At most 7/8 of the slots hold elements. Inserting may move elements and
+ * invalidates iterators and references when the map grows; erasing moves
+ * nothing. Iteration order follows the slots, so it depends only on the
+ * keys and the order of insertions and erasures, not on addresses.
+ */
+template <typename Key, typename Type, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<>,
+          typename Allocator = std::allocator<std::pair<const Key, Type>>>
+class FlatMap {
+    using Element = std::pair<Key, Type>;
+
+    struct alignas(FlatMapGroup::width) ControlBlock {
+        std::uint8_t bytes[FlatMapGroup::width];
+    };
+
+    using AllocTraits = std::allocator_traits<Allocator>;
+    using ElementAllocator = typename AllocTraits::template rebind_alloc<Element>;
+    using ElementTraits = std::allocator_traits<ElementAllocator>;
+    using ControlAllocator = typename AllocTraits::template rebind_alloc<ControlBlock>;
+    using ControlTraits = std::allocator_traits<ControlAllocator>;
+
+    template <typename Map, typename Value> class Iterator {
+        friend class FlatMap;
+
+      public:
+        using value_type = std::pair<const Key &, Value &>;
+        using pointer = entt::input_iterator_pointer<value_type>;
+        using reference = value_type;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+
+        /// @brief Converts an iterator to a const_iterator
+        template <typename Other, typename OtherValue,
+                  typename = std::enable_if_t<std::is_const_v<Value> &&
+                                              !std::is_same_v<Value, OtherValue>>>
+        Iterator(const Iterator<Other, OtherValue> &other)
+            : map(other.map), position(other.position) {}
+
+        reference operator*() const {
+            Element &element = map->elements[position];
+            return value_type{element.first, element.second};
+        }
+
+        pointer operator->() const { return operator*(); }
+
+        Iterator &operator++() {
+            position = map->nextFull(position + 1);
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        template <typename Other, typename OtherValue>
+        bool operator==(const Iterator<Other, OtherValue> &other) const {
+            return position == other.position;
+        }
+
+        template <typename Other, typename OtherValue>
+        bool operator!=(const Iterator<Other, OtherValue> &other) const {
+            return position != other.position;
+        }
+
+      private:
+        template <typename, typename> friend class Iterator;
+
+        Iterator(Map *map, std::size_t position) : map(map), position(position) {}
+
+        Map *map = nullptr;
+        std::size_t position = 0;
+    };
+
+  public:
+    using key_type = Key;
+    using mapped_type = Type;
+    using value_type = std::pair<const Key, Type>;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    using iterator = Iterator<FlatMap, Type>;
+    using const_iterator = Iterator<const FlatMap, const Type>;
+
+    FlatMap() : FlatMap(allocator_type{}) {}
+
+    /// @brief Creates an empty map drawing from an allocator
+    explicit FlatMap(const allocator_type &allocator)
+        : elementAllocator(allocator), controlAllocator(allocator) {}
+
+    FlatMap(const FlatMap &other)
+        : hash(other.hash), equal(other.equal),
+          elementAllocator(
+              ElementTraits::select_on_container_copy_construction(other.elementAllocator)),
+          controlAllocator(
+              ControlTraits::select_on_container_copy_construction(other.controlAllocator)) {
+        if (other.elementCount != 0) {
+            reserve(other.elementCount);
+            for (auto [key, value] : other) {
+                emplaceNew(key, value);
+            }
+        }
+    }
+
+    FlatMap(FlatMap &&other) noexcept
+        : hash(std::move(other.hash)), equal(std::move(other.equal)),
+          elementAllocator(std::move(other.elementAllocator)),
+          controlAllocator(std::move(other.controlAllocator)),
+          control(std::exchange(other.control, nullptr)),
+          elements(std::exchange(other.elements, nullptr)),
+          capacity(std::exchange(other.capacity, 0)),
+          elementCount(std::exchange(other.elementCount, 0)),
+          growthLeft(std::exchange(other.growthLeft, 0)) {}
+
+    FlatMap &operator=(const FlatMap &other) {
+        if (this != &other) {
+            FlatMap copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    FlatMap &operator=(FlatMap &&other) noexcept {
+        FlatMap moved(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
+    ~FlatMap() { release(); }
+
+    /// @brief Swaps the contents of two maps with equal allocators
+    void swap(FlatMap &other) noexcept {
+        using std::swap;
+        swap(hash, other.hash);
+        swap(equal, other.equal);
+        swap(elementAllocator, other.elementAllocator);
+        swap(controlAllocator, other.controlAllocator);
+        swap(control, other.control);
+        swap(elements, other.elements);
+        swap(capacity, other.capacity);
+        swap(elementCount, other.elementCount);
+        swap(growthLeft, other.growthLeft);
+    }
+
+    allocator_type get_allocator() const { return allocator_type(elementAllocator); }
+
+    iterator begin() { return iterator{this, nextFull(0)}; }
+    const_iterator begin() const { return const_iterator{this, nextFull(0)}; }
+    const_iterator cbegin() const { return begin(); }
+    iterator end() { return iterator{this, capacity}; }
+    const_iterator end() const { return const_iterator{this, capacity}; }
+    const_iterator cend() const { return end(); }
+
+    bool empty() const { return elementCount == 0; }
+    size_type size() const { return elementCount; }
+
+    /// @brief Gets the number of slots, a power of two of at least 16, or 0
+    size_type bucket_count() const { return capacity; }
+
+    /// @brief Removes every element, keeping the slots
+    void clear() {
+        if (elementCount != 0) {
+            for (std::size_t i = 0; i < capacity; ++i) {
+                if (full(i)) {
+                    ElementTraits::destroy(elementAllocator, elements + i);
+                }
+            }
+        }
+        if (capacity != 0) {
+            std::memset(bytes(), FlatMapGroup::empty, capacity);
+        }
+        elementCount = 0;
+        growthLeft = maxLoad(capacity);
+    }
+
+    /// @brief Makes room for a number of elements without growing
+    void reserve(size_type elementCount) {
+        std::size_t wanted = FlatMapGroup::width;
+        while (maxLoad(wanted) < elementCount) {
+            wanted *= 2;
+        }
+        if (wanted > capacity) {
+            rehash(wanted);
+        }
+    }
+
+    iterator find(const key_type &key) { return iterator{this, locate(key)}; }
+    const_iterator find(const key_type &key) const { return const_iterator{this, locate(key)}; }
+
+    bool contains(const key_type &key) const { return locate(key) != capacity; }
+    size_type count(const key_type &key) const { return contains(key) ? 1 : 0; }
+
+    Type &at(const key_type &key) { return elements[locate(key)].second; }
+    const Type &at(const key_type &key) const { return elements[locate(key)].second; }
+
+    Type &operator[](const key_type &key) { return try_emplace(key).first->second; }
+    Type &operator[](key_type &&key) { return try_emplace(std::move(key)).first->second; }
+
+    /// @brief Inserts an element built from arguments unless the key is present
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace(K &&key, Args &&...args) {
+        Probe probe = probeFor(key);
+        if (probe.found) {
+            return {iterator{this, probe.slot}, false};
+        }
+        std::size_t slot = place(probe, std::forward<K>(key), std::forward<Args>(args)...);
+        return {iterator{this, slot}, true};
+    }
+
+    /// @brief Inserts a key and value unless the key is present
+    template <typename K, typename V> std::pair<iterator, bool> emplace(K &&key, V &&value) {
+        return try_emplace(std::forward<K>(key), std::forward<V>(value));
+    }
+
+    /// @brief Inserts an element unless its key is present
+    std::pair<iterator, bool> insert(const value_type &value) {
+        return try_emplace(value.first, value.second);
+    }
+
+    /// @brief Inserts a value, or assigns it to the element with the same key
+    template <typename V>
+    std::pair<iterator, bool> insert_or_assign(const key_type &key, V &&value) {
+        auto result = try_emplace(key, std::forward<V>(value));
+        if (!result.second) {
+            result.first->second = std::forward<V>(value);
+        }
+        return result;
+    }
+
+    /// @brief Erases an element, returns the iterator past it
+    iterator erase(const_iterator position) {
+        std::size_t slot = position.position;
+        eraseSlot(slot);
+        return iterator{this, nextFull(slot + 1)};
+    }
+
+    /// @brief Erases the element of a key, returns the number of elements erased
+    size_type erase(const key_type &key) {
+        std::size_t slot = locate(key);
+        if (slot == capacity) {
+            return 0;
+        }
+        eraseSlot(slot);
+        return 1;
+    }
+
+    hasher hash_function() const { return hash; }
+    key_equal key_eq() const { return equal; }
+
+  private:
+    struct Probe {
+        std::size_t slot;   ///< Slot of the key if found, else the first free slot seen
+        std::uint8_t fragment;
+        bool found;
+    };
+
+    static constexpr std::size_t maxLoad(std::size_t slots) { return slots - slots / 8; }
+
+    /// Scrambles a hash so that identity hashes spread, and splits it into group and fragment
+    std::uint64_t mixed(const key_type &key) const {
+        std::uint64_t value = static_cast<std::uint64_t>(hash(key)) * 0x9E3779B97F4A7C15ull;
+        return value ^ (value >> 32);
+    }
+
+    std::uint8_t *bytes() const { return control[0].bytes; }
+
+    bool full(std::size_t slot) const { return (bytes()[slot] & 0x80) == 0; }
+
+    std::size_t nextFull(std::size_t slot) const {
+        while (slot < capacity && !full(slot)) {
+            ++slot;
+        }
+        return slot;
+    }
+
+    /// Finds the slot of a key, or capacity; probeFor() without looking for a free slot
+    std::size_t locate(const key_type &key) const {
+        if (elementCount == 0) {
+            return capacity;
+        }
+        std::uint64_t value = mixed(key);
+        auto fragment = static_cast<std::uint8_t>(value & 0x7F);
+        std::size_t groups = capacity / FlatMapGroup::width;
+        std::size_t group = static_cast<std::size_t>(value >> 7) & (groups - 1);
+        for (std::size_t step = 1; step <= groups; ++step) {
+            std::size_t base = group * FlatMapGroup::width;
+            FlatMapGroup bytesOf(bytes() + base);
+            for (std::uint32_t hits = bytesOf.match(fragment); hits != 0; hits &= hits - 1) {
+                std::size_t slot = base + lowestBit(hits);
+                if (equal(elements[slot].first, key)) {
+                    return slot;
+                }
+            }
+            if (bytesOf.matchEmpty() != 0) {
+                break;
+            }
+            group = (group + step) & (groups - 1);
+        }
+        return capacity;
+    }
+
+    /// Walks the groups of a key's probe sequence until it finds the key or an empty byte
+    template <typename K> Probe probeFor(const K &key) const {
+        std::uint64_t value = mixed(key);
+        auto fragment = static_cast<std::uint8_t>(value & 0x7F);
+        Probe probe{capacity, fragment, false};
+        if (capacity == 0) {
+            return probe;
+        }
+        std::size_t groups = capacity / FlatMapGroup::width;
+        std::size_t group = static_cast<std::size_t>(value >> 7) & (groups - 1);
+        for (std::size_t step = 1;; ++step) {
+            std::size_t base = group * FlatMapGroup::width;
+            FlatMapGroup bytesOf(bytes() + base);
+            for (std::uint32_t hits = bytesOf.match(fragment); hits != 0; hits &= hits - 1) {
+                std::size_t slot = base + lowestBit(hits);
+                if (equal(elements[slot].first, key)) {
+                    return Probe{slot, fragment, true};
+                }
+            }
+            if (probe.slot == capacity) {
+                if (std::uint32_t free = bytesOf.matchFree(); free != 0) {
+                    probe.slot = base + lowestBit(free);
+                }
+            }
+            if (bytesOf.matchEmpty() != 0 || step > groups) {
+                return probe;
+            }
+            // Triangular steps visit every group once when the group count is a power of two
+            group = (group + step) & (groups - 1);
+        }
+    }
+
+    static std::size_t lowestBit(std::uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_ctz(mask));
+#else
+        std::size_t bit = 0;
+        while ((mask & 1u) == 0) {
+            mask >>= 1;
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    /// Constructs an element in the free slot a failed probe found, growing first if needed
+    template <typename K, typename... Args>
+    std::size_t place(Probe probe, K &&key, Args &&...args) {
+        if (probe.slot == capacity ||
+            (growthLeft == 0 && bytes()[probe.slot] == FlatMapGroup::empty)) {
+            // Deleted bytes alone fill the table when it is less than half full; drop them
+            bool crowded = elementCount + 1 > maxLoad(capacity) / 2;
+            rehash(capacity == 0 ? FlatMapGroup::width : (crowded ? capacity * 2 : capacity));
+            probe = probeFor(key);
+        }
+        return construct(probe, std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    template <typename K, typename... Args>
+    std::size_t construct(const Probe &probe, K &&key, Args &&...args) {
+        std::size_t slot = probe.slot;
+        ElementTraits::construct(elementAllocator, elements + slot, std::piecewise_construct,
+                                 std::forward_as_tuple(std::forward<K>(key)),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+        if (bytes()[slot] == FlatMapGroup::empty) {
+            --growthLeft;
+        }
+        bytes()[slot] = probe.fragment;
+        ++elementCount;
+        return slot;
+    }
+
+    /// Inserts a key known to be absent into a map with room for it
+    template <typename K, typename V> void emplaceNew(K &&key, V &&value) {
+        construct(probeFor(key), std::forward<K>(key), std::forward<V>(value));
+    }
+
+    void eraseSlot(std::size_t slot) {
+        ElementTraits::destroy(elementAllocator, elements + slot);
+        --elementCount;
+        // A probe stops at the first group with an empty byte, so a group that
+        // already has one can take another without breaking any probe sequence
+        std::size_t base = slot / FlatMapGroup::width * FlatMapGroup::width;
+        if (FlatMapGroup(bytes() + base).matchEmpty() != 0) {
+            bytes()[slot] = FlatMapGroup::empty;
+            ++growthLeft;
+        } else {
+            bytes()[slot] = FlatMapGroup::deleted;
+        }
+    }
+
+    /// Moves every element into a table of a number of slots, dropping deleted bytes
+    void rehash(std::size_t slots) {
+        ControlBlock *oldControl = control;
+        Element *oldElements = elements;
+        std::size_t oldCapacity = capacity;
+
+        control = ControlTraits::allocate(controlAllocator, slots / FlatMapGroup::width);
+        elements = ElementTraits::allocate(elementAllocator, slots);
+        capacity = slots;
+        elementCount = 0;
+        growthLeft = maxLoad(slots);
+        std::memset(bytes(), FlatMapGroup::empty, slots);
+
+        for (std::size_t i = 0; i < oldCapacity; ++i) {
+            if ((oldControl[0].bytes[i] & 0x80) == 0) {
+                Element &element = oldElements[i];
+                emplaceNew(std::move(element.first), std::move(element.second));
+                ElementTraits::destroy(elementAllocator, &element);
+            }
+        }
+        if (oldCapacity != 0) {
+            ControlTraits::deallocate(controlAllocator, oldControl,
+                                      oldCapacity / FlatMapGroup::width);
+            ElementTraits::deallocate(elementAllocator, oldElements, oldCapacity);
+        }
+    }
+
+    void release() {
+        if (capacity == 0) {
+            return;
+        }
+        clear();
+        ControlTraits::deallocate(controlAllocator, control, capacity / FlatMapGroup::width);
+        ElementTraits::deallocate(elementAllocator, elements, capacity);
+        control = nullptr;
+        elements = nullptr;
+        capacity = 0;
+        growthLeft = 0;
+    }
+
+    Hash hash;
+    KeyEqual equal;
+    ElementAllocator elementAllocator;
+    ControlAllocator controlAllocator;
+    ControlBlock *control = nullptr; ///< One byte per slot, in blocks of a group
+    Element *elements = nullptr;     ///< Slots, constructed where the control byte is full
+    std::size_t capacity = 0;        ///< Number of slots
+    std::size_t elementCount = 0;    ///< Number of elements
+    std::size_t growthLeft = 0;      ///< Empty slots that may still be filled before growing
+};
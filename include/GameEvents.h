@@ -1,12 +1,17 @@
 #pragma once
 
+#include "EventName.h"
 #include "entt/entt.hpp"
-#include <string>
+#include <type_traits>
+#include <vector>
 
 // Use the same definition as in Scheduler.h
 using ActionID = uint32_t;
 
 // EnTT event types for game events
+// Names and types are stored as EventName hashes rather than strings, so the
+// events are trivially copyable and enqueueing one never allocates.
+// Call EventNames::setInterning(true) to be able to print them.
 namespace GameEvents {
 
 // Entity attack event
@@ -22,7 +27,7 @@ struct EntityDamagedEvent {
   entt::entity entity;
   int damage;
   entt::entity source;    // Optional source of damage
-  std::string damageType; // "physical", "poison", "fire", etc.
+  EventName damageType;   // "physical", "poison", "fire", etc.
 };
 
 // Entity died event
@@ -36,12 +41,12 @@ struct EntitySpawnEvent {
   entt::entity entity;
   int x;
   int y;
-  std::string entityType;
+  EventName entityType;
 };
 
 // Map change event
 struct MapChangeEvent {
-  std::string mapName;
+  EventName mapName;
   bool isReload;
 };
 
@@ -58,7 +63,7 @@ struct PlayerMoveEvent {
 struct ItemPickupEvent {
   entt::entity player;
   entt::entity item;
-  std::string itemType;
+  EventName itemType;
 };
 
 // Combat start/end events
@@ -78,4 +83,18 @@ struct ActionCompletedEvent {
   entt::entity entity;
 };
 
+static_assert(std::is_trivially_copyable_v<EntityDamagedEvent> &&
+                  std::is_trivially_copyable_v<EntitySpawnEvent> &&
+                  std::is_trivially_copyable_v<MapChangeEvent> &&
+                  std::is_trivially_copyable_v<ItemPickupEvent> &&
+                  std::is_trivially_copyable_v<ActionCompletedEvent>,
+              "Game events are copied in bulk by the dispatcher");
+
+// Every action completed by one scheduler update, in execution order
+// The only event that owns memory: one is sent per update, not per action
+struct ActionsCompletedEvent {
+  int tick; // Tick passed to the update
+  std::vector<ActionCompletedEvent> completed;
+};
+
 } // namespace GameEvents
\ No newline at end of file
@@ -0,0 +1,398 @@
+/**
+ * @file HeapQueue.h
+ * @brief Indexed d-ary heap queue backend for the schedulers.
+ *
+ * Defines the ordering traits shared by every queue backend and the default
+ * heap-based backend used by Scheduler and TimedEventScheduler.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/**
+ * @struct QueueNodeTraits
+ * @brief Describes how a queue backend reads the due tick and ordering of a node.
+ * @tparam Node The type stored in the queue
+ *
+ * The default implementation works for any node exposing an integer `tick`
+ * member. Specialize it, or pass a different traits type to the backend, for
+ * node types that store their tick differently.
+ */
+template <typename Node> struct QueueNodeTraits {
+    /// @brief Gets the tick at which a node becomes due
+    /// @param node The node to inspect
+    /// @return The due tick
+    static int tick(const Node &node) { return node.tick; }
+
+    /// @brief Orders nodes due at the same tick, lower ranks run first
+    /// @param node The node to inspect
+    /// @return The rank, nodes of equal tick and rank run in insertion order
+    static std::uint32_t rank(const Node &) { return 0; }
+};
+
+/**
+ * @brief Maps a priority to a rank so that higher priorities run first
+ * @param priority The priority
+ * @return The rank of the priority
+ */
+constexpr std::uint32_t rankOfPriority(int priority) {
+    return ~(static_cast<std::uint32_t>(priority) ^ 0x80000000u);
+}
+
+/**
+ * @class HeapQueue
+ * @brief Queue backend built on an indexed d-ary heap
+ * @tparam Node The type stored in the queue
+ * @tparam Traits Ordering traits for Node
+ * @tparam Arity Number of children per heap node
+ * @tparam Allocator Allocator of the node pool, rebound for the heap and handle arrays
+ *
+ * Nodes live in a stable pool. The heap itself is a dense array of sort keys
+ * that pack the tick and Traits::rank() into one 64-bit integer, next to an
+ * insertion sequence number and the node's handle, so sifting never touches
+ * the nodes. Nodes with equal tick and rank leave the queue in insertion
+ * order. Every handle knows its heap position, so a queued node can be
+ * removed eagerly in O(log n) instead of being left behind as a tombstone.
+ *
+ * Every queue backend exposes the same interface: push() returning a handle,
+ * erase(handle), modify(handle, fn), popDue(), size(), empty() and clear(). A
+ * handle stays valid until its node is popped, erased or the queue is cleared. Backends that
+ * take an allocator expose allocator_type and a constructor from it.
+ */
+template <typename Node, typename Traits = QueueNodeTraits<Node>, std::size_t Arity = 4,
+          typename Allocator = std::allocator<Node>>
+class HeapQueue {
+    static_assert(Arity >= 2, "A heap needs at least two children per node");
+
+    static constexpr std::uint32_t npos = ~std::uint32_t{0};
+
+    template <typename Type>
+    using Rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<Type>;
+
+  public:
+    /// @brief Stable reference to a queued node
+    using handle_type = std::uint32_t;
+
+    /// @brief Allocator every array of the queue draws from
+    using allocator_type = Allocator;
+
+    HeapQueue() = default;
+
+    /// @brief Constructs an empty queue whose memory comes from an allocator
+    explicit HeapQueue(const allocator_type &allocator)
+        : values(allocator), position(Rebind<std::uint32_t>(allocator)),
+          heap(Rebind<Entry>(allocator)), freeHandles(Rebind<handle_type>(allocator)),
+          pending(Rebind<std::size_t>(allocator)) {}
+
+    /// @brief Gets the allocator of the queue
+    allocator_type get_allocator() const { return values.get_allocator(); }
+
+    /**
+     * @brief Adds a node to the queue
+     * @param node The node to insert, moved into the queue's node pool
+     * @return Handle that can be used to erase the node
+     */
+    handle_type push(Node &&node) {
+        handle_type handle = append(std::move(node));
+        siftUp(heap.size() - 1);
+        return handle;
+    }
+
+    /**
+     * @brief Adds a range of nodes, restoring the heap once at the end
+     * @param first Iterator to the first node, nodes are moved from
+     * @param last Iterator past the last node
+     * @param onPush Called with the handle of each node, in range order
+     *
+     * When the range is at least as large as the current queue the heap is
+     * rebuilt bottom-up in O(n); smaller ranges are sifted in one by one.
+     */
+    template <typename It, typename OnPush> void pushBulk(It first, It last, OnPush &&onPush) {
+        std::size_t before = heap.size();
+        for (; first != last; ++first) {
+            onPush(append(std::move(*first)));
+        }
+        if (heap.size() - before >= before) {
+            // Floyd's construction, starting from the last node that has children
+            if (heap.size() > 1) {
+                for (std::size_t index = (heap.size() - 2) / Arity + 1; index-- > 0;) {
+                    siftDown(index);
+                }
+            }
+        } else {
+            for (std::size_t index = before; index < heap.size(); ++index) {
+                siftUp(index);
+            }
+        }
+    }
+
+    /// @brief Reserves room for a number of queued nodes
+    void reserve(std::size_t capacity) {
+        values.reserve(capacity);
+        position.reserve(capacity);
+        heap.reserve(capacity);
+    }
+
+    /**
+     * @brief Removes a queued node immediately
+     * @param handle Handle returned by push()
+     * @return true if the node was queued and has been removed
+     */
+    bool erase(handle_type handle) {
+        if (handle >= position.size() || position[handle] == npos) {
+            return false;
+        }
+        removeAt(position[handle]);
+        return true;
+    }
+
+    /**
+     * @brief Changes a queued node in place and restores the heap order
+     * @param handle Handle returned by push()
+     * @param fn Called with a reference to the node, may change its tick and rank
+     * @return true if the node was queued and has been modified
+     *
+     * O(log n): only the node's sort key moves, up or down the heap. The
+     * handle stays the same, and among nodes of equal tick and rank the node
+     * now counts as the latest pushed.
+     */
+    template <typename F> bool modify(handle_type handle, F &&fn) {
+        if (handle >= position.size() || position[handle] == npos) {
+            return false;
+        }
+        fn(values[handle]);
+        std::size_t index = position[handle];
+        Entry entry{keyOf(values[handle]), sequence++, handle};
+        bool rises = index > 0 && before(entry, heap[(index - 1) / Arity]);
+        place(index, entry);
+        if (rises) {
+            siftUp(index);
+        } else {
+            siftDown(index);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Removes the next node that is due at or before the given tick
+     * @param currentTick The current system tick
+     * @param out Receives the removed node by move assignment
+     * @return true if a node was removed, false if nothing is due
+     */
+    bool popDue(int currentTick, Node &out) {
+        if (heap.empty() || tickOf(heap.front()) > currentTick) {
+            return false;
+        }
+        handle_type handle = heap.front().handle;
+        out = std::move(values[handle]);
+        removeAt(0);
+        return true;
+    }
+
+    /**
+     * @brief Gets the tick of the earliest queued node
+     * @return The earliest due tick, or nothing if the queue is empty
+     */
+    std::optional<int> nextTick() const {
+        if (heap.empty()) {
+            return std::nullopt;
+        }
+        return tickOf(heap.front());
+    }
+
+    /**
+     * @brief Counts the nodes due at or before the given tick
+     * @param currentTick The current system tick
+     * @return The number of nodes popDue() would return for that tick
+     *
+     * Only visits the due part of the heap, so the cost grows with the result.
+     * Reuses a buffer of the queue, so it must not run beside another call.
+     */
+    std::size_t countDue(int currentTick) const {
+        std::size_t due = 0;
+        pending.clear();
+        if (!heap.empty()) {
+            pending.push_back(0);
+        }
+        while (!pending.empty()) {
+            std::size_t index = pending.back();
+            pending.pop_back();
+            if (tickOf(heap[index]) > currentTick) {
+                continue;
+            }
+            ++due;
+            for (std::size_t child = index * Arity + 1;
+                 child < heap.size() && child <= index * Arity + Arity; ++child) {
+                pending.push_back(child);
+            }
+        }
+        return due;
+    }
+
+    /// @brief Gets the number of queued nodes
+    /// @return The queue size
+    std::size_t size() const { return heap.size(); }
+
+    /// @brief Checks whether the queue is empty
+    /// @return true if no nodes are queued
+    bool empty() const { return heap.empty(); }
+
+    /**
+     * @brief Visits every queued node, in no particular order
+     * @param fn Called with a const reference to each node
+     */
+    template <typename F> void forEach(F &&fn) const {
+        for (const Entry &entry : heap) {
+            fn(values[entry.handle]);
+        }
+    }
+
+    /// @brief Gets the number of node slots in the pool, queued or free
+    std::size_t poolSize() const { return values.size(); }
+
+    /**
+     * @brief Packs the queued nodes into a pool without free slots
+     * @param onMove Called as onMove(node, newHandle) for every queued node
+     *
+     * Runs in O(n): the nodes are renumbered in heap order, so the heap itself
+     * stays valid and is not rebuilt. Every handle changes, so the caller must
+     * update the handles it stored from onMove. Memory held by free slots is
+     * released.
+     */
+    template <typename OnMove> void compact(OnMove &&onMove) {
+        std::vector<Node, Allocator> packed(values.get_allocator());
+        packed.reserve(heap.size());
+        for (std::size_t index = 0; index < heap.size(); ++index) {
+            packed.push_back(std::move(values[heap[index].handle]));
+            heap[index].handle = static_cast<handle_type>(index);
+            onMove(static_cast<const Node &>(packed.back()), static_cast<handle_type>(index));
+        }
+        values = std::move(packed);
+        position.resize(heap.size());
+        position.shrink_to_fit();
+        for (std::size_t index = 0; index < heap.size(); ++index) {
+            position[index] = static_cast<std::uint32_t>(index);
+        }
+        freeHandles.clear();
+        freeHandles.shrink_to_fit();
+    }
+
+    /// @brief Removes every queued node, keeping allocated capacity
+    void clear() {
+        values.clear();
+        position.clear();
+        heap.clear();
+        freeHandles.clear();
+        sequence = 0;
+    }
+
+  private:
+    /// Heap element: packed sort key followed by what it refers to
+    struct Entry {
+        std::uint64_t key;       ///< Biased tick in the high half, rank in the low half
+        std::uint32_t sequence;  ///< Insertion order among equal keys
+        handle_type handle;      ///< Node the entry refers to
+    };
+
+    static std::uint64_t keyOf(const Node &node) {
+        auto tick = static_cast<std::uint32_t>(Traits::tick(node)) ^ 0x80000000u;
+        return (std::uint64_t{tick} << 32) | Traits::rank(node);
+    }
+
+    static int tickOf(const Entry &entry) {
+        return static_cast<int>(static_cast<std::uint32_t>(entry.key >> 32) ^ 0x80000000u);
+    }
+
+    /// Sequence numbers are compared modulo 2^32, so they may wrap around
+    static bool before(const Entry &a, const Entry &b) {
+        return a.key != b.key ? a.key < b.key
+                              : static_cast<std::int32_t>(a.sequence - b.sequence) < 0;
+    }
+
+    /// Stores a node and appends its handle to the heap array without sifting
+    handle_type append(Node &&node) {
+        handle_type handle;
+        if (!freeHandles.empty()) {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            values[handle] = std::move(node);
+        } else {
+            handle = static_cast<handle_type>(values.size());
+            values.push_back(std::move(node));
+            position.push_back(npos);
+        }
+        position[handle] = static_cast<std::uint32_t>(heap.size());
+        heap.push_back(Entry{keyOf(values[handle]), sequence++, handle});
+        return handle;
+    }
+
+    void place(std::size_t index, const Entry &entry) {
+        heap[index] = entry;
+        position[entry.handle] = static_cast<std::uint32_t>(index);
+    }
+
+    void siftUp(std::size_t index) {
+        Entry entry = heap[index];
+        while (index > 0) {
+            std::size_t parent = (index - 1) / Arity;
+            if (!before(entry, heap[parent])) {
+                break;
+            }
+            place(index, heap[parent]);
+            index = parent;
+        }
+        place(index, entry);
+    }
+
+    void siftDown(std::size_t index) {
+        Entry entry = heap[index];
+        for (;;) {
+            std::size_t first = index * Arity + 1;
+            if (first >= heap.size()) {
+                break;
+            }
+            std::size_t last = first + Arity < heap.size() ? first + Arity : heap.size();
+            std::size_t best = first;
+            for (std::size_t child = first + 1; child < last; ++child) {
+                if (before(heap[child], heap[best])) {
+                    best = child;
+                }
+            }
+            if (!before(heap[best], entry)) {
+                break;
+            }
+            place(index, heap[best]);
+            index = best;
+        }
+        place(index, entry);
+    }
+
+    void removeAt(std::size_t index) {
+        handle_type handle = heap[index].handle;
+        Entry last = heap.back();
+        heap.pop_back();
+        if (index < heap.size()) {
+            place(index, last);
+            if (index > 0 && before(last, heap[(index - 1) / Arity])) {
+                siftUp(index);
+            } else {
+                siftDown(index);
+            }
+        }
+        position[handle] = npos;
+        values[handle] = Node{};
+        freeHandles.push_back(handle);
+    }
+
+    std::vector<Node, Allocator> values;                        ///< Node pool indexed by handle
+    std::vector<std::uint32_t, Rebind<std::uint32_t>> position; ///< Heap index of each handle
+    std::vector<Entry, Rebind<Entry>> heap;                     ///< Sort keys, smallest first
+    std::vector<handle_type, Rebind<handle_type>> freeHandles;  ///< Released handles for reuse
+    std::uint32_t sequence = 0;                                 ///< Sequence of the next push
+
+    /// Heap indices countDue() has still to visit, reused across calls
+    mutable std::vector<std::size_t, Rebind<std::size_t>> pending;
+};
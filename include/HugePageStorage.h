@@ -0,0 +1,290 @@
+/**
+ * @file HugePageStorage.h
+ * @brief Component storages with tunable page sizes, backed by 2 MB huge pages.
+ *
+ * Actions that touch Health and other components across millions of
+ * entities miss the TLB on almost every registry.get(): the default packed
+ * page holds 1024 components, and every 4 KB of it needs its own TLB entry.
+ * PagedComponentTraits sizes a component's pages in bytes instead, and
+ * HugePageAllocator maps every allocation of a huge page or more with 2 MB
+ * pages, so one TLB entry covers a whole page of components.
+ *
+ * SCHEDULER_HUGE_PAGE_STORAGE(Type) sets up both for one component type. It
+ * must be used at global scope, before the type is first used:
+ *
+ * @code
+ * SCHEDULER_HUGE_PAGE_STORAGE(Health)
+ *
+ * HugePages::setMode(HugePageMode::reserved); // Optional, see HugePageMode
+ * registry.emplace<Health>(entity, 100);      // Pages of 2 MB, on huge pages
+ * @endcode
+ *
+ * Huge pages are mapped on Linux with mmap; elsewhere, or with
+ * SCHEDULER_NO_MMAP defined, HugePageAllocator only allocates from the heap
+ * and the page size alone is tuned. The sparse arrays mapping entities to
+ * components use the global ENTT_SPARSE_PAGE, which can be raised to 524288
+ * so that their pages are 2 MB as well.
+ */
+#pragma once
+
+#include "entt/entt.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__) && !defined(SCHEDULER_NO_MMAP)
+#include <sys/mman.h>
+#if defined(MADV_HUGEPAGE)
+#define SCHEDULER_HAS_HUGE_PAGES 1
+#endif
+#endif
+
+/// @brief How HugePages backs a mapping
+enum class HugePageMode : std::uint8_t {
+    off,         ///< Regular pages, mapped with mmap all the same
+    transparent, ///< Transparent huge pages, asked for with madvise; the default
+    reserved,    ///< Pages reserved through vm.nr_hugepages, then transparent ones if none are left
+};
+
+/**
+ * @class HugePages
+ * @brief Maps and unmaps memory in multiples of 2 MB, aligned to 2 MB
+ *
+ * The mode only affects mappings made after it is set, and may be changed
+ * at any time.
+ */
+class HugePages {
+  public:
+    /// @brief Size of a huge page, and the granularity of every mapping
+    static constexpr std::size_t size = std::size_t{2} << 20;
+
+    /// @brief Sets how later mappings are backed
+    static void setMode(HugePageMode mode) { state().mode.store(mode, std::memory_order_relaxed); }
+
+    /// @brief Gets how mappings are backed
+    static HugePageMode mode() { return state().mode.load(std::memory_order_relaxed); }
+
+    /// @brief Gets the number of bytes currently mapped, over every thread
+    static std::size_t mappedBytes() { return state().mapped.load(std::memory_order_relaxed); }
+
+    /// @brief Rounds a number of bytes up to a multiple of size
+    static constexpr std::size_t roundUp(std::size_t bytes) {
+        return (bytes + size - 1) / size * size;
+    }
+
+#if defined(SCHEDULER_HAS_HUGE_PAGES)
+    /**
+     * @brief Maps memory for an allocation
+     * @param bytes The size of the allocation, rounded up to a multiple of size
+     * @return The memory, aligned to size, or nullptr if it could not be mapped
+     */
+    static void *map(std::size_t bytes) {
+        bytes = roundUp(bytes);
+        HugePageMode current = mode();
+        void *memory = MAP_FAILED;
+        if (current == HugePageMode::reserved) {
+            memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (memory == MAP_FAILED) {
+            memory = mapAligned(bytes);
+            if (memory == nullptr) {
+                return nullptr;
+            }
+            if (current != HugePageMode::off) {
+                ::madvise(memory, bytes, MADV_HUGEPAGE);
+            }
+        }
+        state().mapped.fetch_add(bytes, std::memory_order_relaxed);
+        return memory;
+    }
+
+    /// @brief Unmaps memory returned by map() for an allocation of the same size
+    static void unmap(void *memory, std::size_t bytes) {
+        bytes = roundUp(bytes);
+        ::munmap(memory, bytes);
+        state().mapped.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+#endif
+
+  private:
+    struct State {
+        std::atomic<HugePageMode> mode{HugePageMode::transparent};
+        std::atomic<std::size_t> mapped{0};
+    };
+
+    static State &state() {
+        static State instance;
+        return instance;
+    }
+
+#if defined(SCHEDULER_HAS_HUGE_PAGES)
+    /// Maps regular pages aligned to size, so that the kernel can back them with huge pages
+    static void *mapAligned(std::size_t bytes) {
+        void *memory = ::mmap(nullptr, bytes + size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+        auto address = reinterpret_cast<std::uintptr_t>(memory);
+        std::uintptr_t aligned = (address + size - 1) / size * size;
+        if (aligned != address) {
+            ::munmap(memory, aligned - address);
+        }
+        if (std::size_t tail = address + size - aligned; tail != 0) {
+            ::munmap(reinterpret_cast<void *>(aligned + bytes), tail);
+        }
+        return reinterpret_cast<void *>(aligned);
+    }
+#endif
+};
+
+/**
+ * @class HugePageAllocator
+ * @brief Allocator that maps allocations of a huge page or more with HugePages
+ * @tparam T The allocated type
+ *
+ * Smaller allocations come from operator new. Stateless, and constructible
+ * from std::allocator, so that SCHEDULER_HUGE_PAGE_STORAGE can make it the
+ * std::allocator of a component type.
+ */
+template <typename T> class HugePageAllocator {
+  public:
+    using value_type = T;
+
+    HugePageAllocator() noexcept = default;
+
+    template <typename U> HugePageAllocator(const HugePageAllocator<U> &) noexcept {}
+
+    template <typename U> HugePageAllocator(const std::allocator<U> &) noexcept {}
+
+    T *allocate(std::size_t count) {
+        if (count > max_size()) {
+            throw std::bad_array_new_length();
+        }
+#if defined(SCHEDULER_HAS_HUGE_PAGES)
+        if (mapped(count)) {
+            if (void *memory = HugePages::map(count * sizeof(T))) {
+                return static_cast<T *>(memory);
+            }
+            throw std::bad_alloc();
+        }
+#endif
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return static_cast<T *>(
+                ::operator new(count * sizeof(T), std::align_val_t{alignof(T)}));
+        } else {
+            return static_cast<T *>(::operator new(count * sizeof(T)));
+        }
+    }
+
+    void deallocate(T *pointer, std::size_t count) noexcept {
+#if defined(SCHEDULER_HAS_HUGE_PAGES)
+        if (mapped(count)) {
+            HugePages::unmap(pointer, count * sizeof(T));
+            return;
+        }
+#endif
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(pointer, std::align_val_t{alignof(T)});
+        } else {
+            ::operator delete(pointer);
+        }
+    }
+
+    /// @brief Constructs an object in place, for std::allocator_traits<std::allocator<T>>
+    template <typename U, typename... Args> void construct(U *pointer, Args &&...args) {
+        ::new (static_cast<void *>(pointer)) U(std::forward<Args>(args)...);
+    }
+
+    /// @brief Destroys an object in place, for std::allocator_traits<std::allocator<T>>
+    template <typename U> void destroy(U *pointer) { pointer->~U(); }
+
+    std::size_t max_size() const noexcept { return static_cast<std::size_t>(-1) / sizeof(T); }
+
+    template <typename U> bool operator==(const HugePageAllocator<U> &) const noexcept {
+        return true;
+    }
+
+    template <typename U> bool operator!=(const HugePageAllocator<U> &) const noexcept {
+        return false;
+    }
+
+  private:
+    /// Whether an allocation of count elements is mapped rather than taken from the heap
+    static constexpr bool mapped(std::size_t count) {
+        return alignof(T) <= HugePages::size && count * sizeof(T) >= HugePages::size;
+    }
+};
+
+/**
+ * @brief Gets the largest power of two of components that fits in a number of bytes
+ * @tparam Type The component type
+ * @param bytes The size of a page in bytes
+ *
+ * EnTT needs page sizes that are powers of two. At least one component fits.
+ */
+template <typename Type> constexpr std::size_t componentsPerPage(std::size_t bytes) {
+    std::size_t count = 1;
+    while (count * 2 * sizeof(Type) <= bytes) {
+        count *= 2;
+    }
+    return count;
+}
+
+/**
+ * @struct PagedComponentTraits
+ * @brief entt::component_traits with a page size given in bytes
+ * @tparam Type The component type, not empty
+ * @tparam Bytes The size of a packed page, a huge page by default
+ * @tparam InPlaceDelete Whether components keep their address when others are removed
+ *
+ * Derive an entt::component_traits specialization from it, or let
+ * SCHEDULER_HUGE_PAGE_STORAGE do it:
+ *
+ * @code
+ * // 64 KB pages for a component only some entities have
+ * template <> struct entt::component_traits<Buff> : PagedComponentTraits<Buff, 64 * 1024> {};
+ * @endcode
+ */
+template <typename Type, std::size_t Bytes = HugePages::size, bool InPlaceDelete = false>
+struct PagedComponentTraits {
+    static_assert(!std::is_empty_v<Type>, "Empty components have no pages");
+
+    using element_type = Type;
+    using entity_type = entt::entity;
+
+    static constexpr bool in_place_delete = InPlaceDelete;
+    static constexpr std::size_t page_size = componentsPerPage<Type>(Bytes);
+};
+
+/**
+ * @def SCHEDULER_HUGE_PAGE_STORAGE
+ * @brief Gives a component type pages of one huge page, allocated with HugePageAllocator
+ *
+ * A registry's storages all share one base type, which depends on the
+ * registry's allocator, so a storage cannot take an allocator type of its
+ * own. The macro specializes std::allocator for the component type instead,
+ * which the storage allocates its packed pages through, and
+ * entt::component_traits for the page size. Containers of the component
+ * type elsewhere, such as a std::vector<Type>, map their large buffers too.
+ *
+ * Must be used at global scope, before the type is first used with a
+ * registry or a standard container, in every translation unit that uses it.
+ */
+#define SCHEDULER_HUGE_PAGE_STORAGE(Type)                                                         \
+    template <>                                                                                   \
+    struct entt::component_traits<Type, entt::entity> : PagedComponentTraits<Type> {};           \
+    template <> class std::allocator<Type> : public HugePageAllocator<Type> {                    \
+      public:                                                                                     \
+        using size_type = std::size_t;                                                            \
+        using difference_type = std::ptrdiff_t;                                                   \
+        using propagate_on_container_move_assignment = std::true_type;                            \
+        using is_always_equal = std::true_type;                                                   \
+        using HugePageAllocator<Type>::HugePageAllocator;                                         \
+        allocator() noexcept = default;                                                           \
+    };
@@ -0,0 +1,245 @@
+/**
+ * @file InlineFunction.h
+ * @brief Move-only type-erased callable with inline storage.
+ *
+ * InlineFunction is a replacement for std::function on the scheduling hot path.
+ * Callables that fit in the inline buffer are stored in place, so scheduling a
+ * typical lambda (an entity and a couple of ints) never touches the heap.
+ * Bigger callables, such as lambdas capturing a target list, are stored in a
+ * BlockPool block, so their memory is recycled through per-thread size-class
+ * free lists instead of fragmenting the heap over a long session.
+ */
+#pragma once
+
+#include "BlockPool.h"
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// @brief Default inline buffer size of InlineFunction, in bytes
+///
+/// Define SCHEDULER_INLINE_FUNCTION_CAPACITY to change it for the whole build,
+/// which resizes every ActionFunction and CompletionFunction.
+#ifdef SCHEDULER_INLINE_FUNCTION_CAPACITY
+inline constexpr std::size_t inlineFunctionCapacity = SCHEDULER_INLINE_FUNCTION_CAPACITY;
+#else
+inline constexpr std::size_t inlineFunctionCapacity = 48;
+#endif
+
+template <typename Signature, std::size_t Capacity = inlineFunctionCapacity> class InlineFunction;
+
+/**
+ * @class InlineFunction
+ * @brief Move-only callable wrapper with a fixed-size inline buffer
+ * @tparam R Return type of the call
+ * @tparam Args Argument types of the call
+ * @tparam Capacity Size of the inline buffer in bytes
+ *
+ * Unlike entt::delegate, which only refers to callables owned elsewhere,
+ * InlineFunction owns its target. Unlike std::function it cannot be copied,
+ * which lets it hold move-only captures and keeps moves cheap.
+ *
+ * @code
+ * InlineFunction<void(int)> print = [prefix = 42](int value) {
+ *     std::cout << prefix << ": " << value << std::endl;
+ * };
+ * print(7);
+ * @endcode
+ */
+template <typename R, typename... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+    static_assert(Capacity >= sizeof(void *), "Inline buffer must be able to hold a pointer");
+
+    struct Ops {
+        R (*invoke)(void *, Args &&...);
+        void (*relocate)(void *from, void *to) noexcept;
+        void (*destroy)(void *) noexcept;
+        bool onHeap;
+    };
+
+    template <typename F>
+    static constexpr bool storedInline = sizeof(F) <= Capacity &&
+                                         alignof(F) <= alignof(std::max_align_t) &&
+                                         std::is_nothrow_move_constructible_v<F>;
+
+    /// Operations for a callable living in the inline buffer
+    template <typename F> struct InlineOps {
+        static R invoke(void *target, Args &&...args) {
+            return std::invoke(*static_cast<F *>(target), std::forward<Args>(args)...);
+        }
+
+        static void relocate(void *from, void *to) noexcept {
+            F *source = static_cast<F *>(from);
+            ::new (to) F(std::move(*source));
+            source->~F();
+        }
+
+        static void destroy(void *target) noexcept { static_cast<F *>(target)->~F(); }
+
+        static constexpr Ops ops{&invoke, &relocate, &destroy, false};
+    };
+
+    /// Operations for a pooled callable whose pointer lives in the buffer
+    template <typename F> struct HeapOps {
+        /// Callables aligned beyond what BlockPool guarantees use plain new
+        static constexpr bool pooled = alignof(F) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+        template <typename G> static F *create(G &&callable) {
+            if constexpr (pooled) {
+                void *memory = BlockPool::allocate(sizeof(F));
+                try {
+                    return ::new (memory) F(std::forward<G>(callable));
+                } catch (...) {
+                    BlockPool::deallocate(memory, sizeof(F));
+                    throw;
+                }
+            } else {
+                return new F(std::forward<G>(callable));
+            }
+        }
+
+        static R invoke(void *target, Args &&...args) {
+            return std::invoke(**static_cast<F **>(target), std::forward<Args>(args)...);
+        }
+
+        static void relocate(void *from, void *to) noexcept {
+            ::new (to) F *(*static_cast<F **>(from));
+        }
+
+        static void destroy(void *target) noexcept {
+            F *callable = *static_cast<F **>(target);
+            if constexpr (pooled) {
+                callable->~F();
+                BlockPool::deallocate(callable, sizeof(F));
+            } else {
+                delete callable;
+            }
+        }
+
+        static constexpr Ops ops{&invoke, &relocate, &destroy, true};
+    };
+
+    template <typename F> static bool isNull(const F &) { return false; }
+    template <typename F> static bool isNull(F *pointer) { return pointer == nullptr; }
+    template <typename Sig> static bool isNull(const std::function<Sig> &function) {
+        return !function;
+    }
+
+  public:
+    /// @brief Constructs an empty callable
+    InlineFunction() noexcept = default;
+
+    /// @brief Constructs an empty callable
+    InlineFunction(std::nullptr_t) noexcept {}
+
+    /**
+     * @brief Wraps a callable
+     * @tparam F Type of the callable
+     * @param callable The callable to store
+     *
+     * Null function pointers and empty std::function objects produce an empty
+     * InlineFunction.
+     */
+    template <typename F, typename Decayed = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<Decayed, InlineFunction> &&
+                                          std::is_invocable_r_v<R, Decayed &, Args...>>>
+    InlineFunction(F &&callable) {
+        if (isNull(callable)) {
+            return;
+        }
+        if constexpr (storedInline<Decayed>) {
+            ::new (static_cast<void *>(storage)) Decayed(std::forward<F>(callable));
+            ops = &InlineOps<Decayed>::ops;
+        } else {
+            Decayed *pooled = HeapOps<Decayed>::create(std::forward<F>(callable));
+            ::new (static_cast<void *>(storage)) Decayed *(pooled);
+            ops = &HeapOps<Decayed>::ops;
+        }
+    }
+
+    /// @brief Move constructor, leaves the source empty
+    InlineFunction(InlineFunction &&other) noexcept : ops(other.ops) {
+        if (ops != nullptr) {
+            ops->relocate(other.storage, storage);
+            other.ops = nullptr;
+        }
+    }
+
+    /// @brief Move assignment, leaves the source empty
+    InlineFunction &operator=(InlineFunction &&other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops != nullptr) {
+                other.ops->relocate(other.storage, storage);
+                ops = other.ops;
+                other.ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    /// @brief Destroys the stored callable, if any
+    InlineFunction &operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction &) = delete;
+    InlineFunction &operator=(const InlineFunction &) = delete;
+
+    ~InlineFunction() { reset(); }
+
+    /**
+     * @brief Invokes the stored callable
+     * @param args Arguments forwarded to the callable
+     * @return Whatever the callable returns
+     * @throws std::bad_function_call if the InlineFunction is empty
+     */
+    R operator()(Args... args) const {
+        if (ops == nullptr) {
+            throw std::bad_function_call();
+        }
+        return ops->invoke(storage, std::forward<Args>(args)...);
+    }
+
+    /// @brief Checks whether a callable is stored
+    explicit operator bool() const noexcept { return ops != nullptr; }
+
+    /// @brief Checks whether the stored callable lives in the inline buffer
+    /// @return true if a callable is stored without a heap allocation
+    bool isInline() const noexcept { return ops != nullptr && !ops->onHeap; }
+
+    /**
+     * @brief Gets the stored callable if it has a given type
+     * @tparam T The type to check for
+     * @return Pointer to the stored callable, or nullptr if it is not a T
+     */
+    template <typename T> const T *target() const noexcept {
+        if (ops == &InlineOps<T>::ops) {
+            return reinterpret_cast<const T *>(storage);
+        }
+        if (ops == &HeapOps<T>::ops) {
+            return *reinterpret_cast<T *const *>(storage);
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Identifies the type of the stored callable
+     * @return The same address for every InlineFunction holding the same type, nullptr when empty
+     */
+    const void *kind() const noexcept { return ops; }
+
+  private:
+    void reset() noexcept {
+        if (ops != nullptr) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) mutable unsigned char storage[Capacity]; ///< Inline buffer
+    const Ops *ops = nullptr; ///< Operations of the stored callable, nullptr when empty
+};
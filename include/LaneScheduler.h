@@ -0,0 +1,290 @@
+/**
+ * @file LaneScheduler.h
+ * @brief Priority lanes sharing one update budget, with load shedding under overload.
+ *
+ * A single queue orders actions by tick alone, so when a world-boss spike
+ * overruns the tick budget, critical combat actions run late along with the
+ * footstep decals. A BasicLaneScheduler keeps one BasicScheduler per priority
+ * lane and updates the lanes from the most to the least important, each with
+ * what the lanes before it left of the budget. A lane that does not get
+ * through its due actions is handled by its overload policy: its backlog is
+ * deferred to the next update, coalesced to one action per entity or
+ * dropped, and the shed work is counted per lane.
+ */
+#pragma once
+
+#include "Scheduler.h"
+#include "UpdateBudget.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+/// @brief Priority lane of an action, from the most to the least important
+enum class Lane : std::uint8_t {
+    critical,   ///< Combat and anything players notice when it is late
+    gameplay,   ///< Regular game logic
+    cosmetic,   ///< Effects that can be skipped without changing the game
+    background, ///< Housekeeping that can wait
+};
+
+/// @brief Number of lanes
+inline constexpr std::size_t laneCount = 4;
+
+/// @brief What happens to the due actions of a lane the budget did not reach
+enum class OverloadPolicy : std::uint8_t {
+    exempt,   ///< Never shed: the lane runs everything due, whatever the budget
+    defer,    ///< Left queued, to run first at the next update
+    coalesce, ///< One action per entity stays queued, the others are dropped
+    drop,     ///< Dropped without running, see BasicScheduler::dropDue()
+};
+
+/**
+ * @struct LaneStats
+ * @brief Work a lane shed since it was created or reset
+ */
+struct LaneStats {
+    std::size_t executed = 0;  ///< Actions run
+    std::size_t overloads = 0; ///< Updates that left the lane with due actions
+    std::size_t deferred = 0;  ///< Actions of the interrupted tick left queued, per overload
+    std::size_t dropped = 0;   ///< Runs dropped by coalescing or dropping
+};
+
+/// @typedef LaneActionID
+/// @brief Identifier of an action in a lane scheduler
+///
+/// Holds the lane in the upper 32 bits and the lane's ActionID in the lower
+/// 32 bits; 0 means no action.
+using LaneActionID = std::uint64_t;
+
+/**
+ * @class BasicLaneScheduler
+ * @brief Runs actions by priority lane, shedding the lower lanes when over budget
+ * @tparam Queue The queue backend of every lane
+ *
+ * By default the critical lane is exempt, gameplay and background are
+ * deferred and cosmetic is dropped. An exempt lane still uses up the budget
+ * it runs on, so the lanes after it get what is left. Lanes share the
+ * registry and dispatcher given to update(), and each lane reports its own
+ * completions.
+ *
+ * @code
+ * LaneScheduler scheduler;
+ * scheduler.schedule(Lane::critical, tick + 1, boss, strike);
+ * scheduler.schedule(Lane::cosmetic, tick + 1, boss, sparkle);
+ *
+ * scheduler.update(tick, registry, dispatcher, UpdateBudget::time(std::chrono::milliseconds(4)));
+ * metrics.gauge("cosmetic.dropped", scheduler.stats(Lane::cosmetic).dropped);
+ * @endcode
+ */
+template <typename Queue = HeapQueue<ScheduledAction>> class BasicLaneScheduler {
+  public:
+    /// @brief The scheduler type of every lane
+    using lane_type = BasicScheduler<Queue>;
+
+    BasicLaneScheduler() = default;
+    BasicLaneScheduler(const BasicLaneScheduler &) = delete;
+    BasicLaneScheduler &operator=(const BasicLaneScheduler &) = delete;
+
+    /// @brief Gets the scheduler of a lane, for everything not forwarded here
+    lane_type &lane(Lane id) { return lanes[index(id)].scheduler; }
+
+    /// @brief Gets the scheduler of a lane
+    const lane_type &lane(Lane id) const { return lanes[index(id)].scheduler; }
+
+    /// @brief Sets what happens to a lane the budget does not reach
+    void setPolicy(Lane id, OverloadPolicy policy) { lanes[index(id)].policy = policy; }
+
+    /// @brief Gets the overload policy of a lane
+    OverloadPolicy policy(Lane id) const { return lanes[index(id)].policy; }
+
+    /// @brief Gets the work a lane ran and shed
+    const LaneStats &stats(Lane id) const { return lanes[index(id)].stats; }
+
+    /// @brief Zeroes the statistics of every lane
+    void resetStats() {
+        for (LaneState &state : lanes) {
+            state.stats = LaneStats{};
+        }
+    }
+
+    /**
+     * @brief Schedules an action in a lane
+     * @param id The lane
+     * @param tick The tick at which to run the action
+     * @param entity The entity passed to the action
+     * @param action The action
+     * @param onComplete Optional callback run after the action
+     * @return The ID of the action
+     */
+    LaneActionID schedule(Lane id, int tick, entt::entity entity, ActionFunction action,
+                          CompletionFunction onComplete = nullptr) {
+        return pack(id, lane(id).schedule(tick, entity, std::move(action), std::move(onComplete)));
+    }
+
+    /// @brief Schedules an action repeating every interval ticks in a lane
+    /// @see BasicScheduler::schedulePeriodic
+    LaneActionID schedulePeriodic(Lane id, int firstTick, int interval, int count,
+                                  entt::entity entity, ActionFunction action,
+                                  CompletionFunction onComplete = nullptr) {
+        return pack(id, lane(id).schedulePeriodic(firstTick, interval, count, entity,
+                                                  std::move(action), std::move(onComplete)));
+    }
+
+    /**
+     * @brief Cancel a scheduled action
+     * @param id The ID returned by schedule()
+     * @return true if the action was found and cancelled, false otherwise
+     */
+    bool cancel(LaneActionID id) {
+        std::size_t at = static_cast<std::size_t>(id >> 32);
+        return at < laneCount && lanes[at].scheduler.cancel(static_cast<ActionID>(id));
+    }
+
+    /// @brief Move a pending action to another tick, keeping its ID and lane
+    /// @see BasicScheduler::reschedule
+    bool reschedule(LaneActionID id, int tick) {
+        std::size_t at = static_cast<std::size_t>(id >> 32);
+        return at < laneCount && lanes[at].scheduler.reschedule(static_cast<ActionID>(id), tick);
+    }
+
+    /// @brief Checks whether an action is still pending
+    bool isPending(LaneActionID id) const {
+        std::size_t at = static_cast<std::size_t>(id >> 32);
+        return at < laneCount && lanes[at].scheduler.isPending(static_cast<ActionID>(id));
+    }
+
+    /// @brief Cancel every pending action of an entity, in every lane
+    /// @return The number of actions cancelled
+    std::size_t cancelAll(entt::entity entity) {
+        std::size_t cancelled = 0;
+        for (LaneState &state : lanes) {
+            cancelled += state.scheduler.cancelAll(entity);
+        }
+        return cancelled;
+    }
+
+    /// @brief Gets the number of pending actions in every lane
+    std::size_t pendingCount() const {
+        std::size_t count = 0;
+        for (const LaneState &state : lanes) {
+            count += state.scheduler.pendingCount();
+        }
+        return count;
+    }
+
+    /// @brief Gets the earliest tick at which some lane has an action due
+    std::optional<int> nextDueTick() const {
+        std::optional<int> earliest;
+        for (const LaneState &state : lanes) {
+            if (std::optional<int> tick = state.scheduler.nextDueTick()) {
+                earliest = earliest ? std::min(*earliest, *tick) : *tick;
+            }
+        }
+        return earliest;
+    }
+
+    /**
+     * @brief Updates the lanes in priority order within a shared budget
+     * @param current_tick The current system tick
+     * @param registry The registry passed to the actions
+     * @param dispatcher The dispatcher completion events go to
+     * @param budget Limits the work of the whole update
+     * @return The actions run, and the backlog left queued by deferred and coalesced lanes
+     *
+     * Each lane gets what the lanes before it left of the budget, as a
+     * budgeted BasicScheduler::update() would; an exempt lane runs everything
+     * due and its work counts against the budget too. Once a lane stops
+     * short, it and every later lane with due actions are handled by their
+     * overload policy.
+     */
+    UpdateResult update(int current_tick, entt::registry &registry, EventDispatcher &dispatcher,
+                        const UpdateBudget &budget = UpdateBudget{}) {
+        UpdateResult total;
+        const UpdateBudget::clock::time_point deadline =
+            budget.timed() ? UpdateBudget::clock::now() + budget.duration
+                           : UpdateBudget::clock::time_point::max();
+        bool overloaded = false;
+        for (LaneState &state : lanes) {
+            UpdateBudget share;
+            if (state.policy != OverloadPolicy::exempt) {
+                // Past an overload a lane runs nothing, which still reports its backlog
+                share = overloaded ? UpdateBudget::count(0)
+                                   : remaining(budget, total.executed, deadline);
+            }
+            UpdateResult result = state.scheduler.update(current_tick, registry, dispatcher, share);
+            state.stats.executed += result.executed;
+            total.executed += result.executed;
+            if (result.backlog != 0) {
+                overloaded = true;
+                total.backlog += shed(state, current_tick, result.backlog);
+            }
+        }
+        return total;
+    }
+
+    /// @brief Clears every lane, keeping the policies and statistics
+    void clear() {
+        for (LaneState &state : lanes) {
+            state.scheduler.clear();
+        }
+    }
+
+  private:
+    struct LaneState {
+        explicit LaneState(OverloadPolicy policy) : policy(policy) {}
+
+        OverloadPolicy policy;
+        LaneStats stats;
+        lane_type scheduler;
+    };
+
+    static std::size_t index(Lane id) { return static_cast<std::size_t>(id); }
+
+    static LaneActionID pack(Lane id, ActionID action) {
+        return action == 0 ? 0 : (static_cast<LaneActionID>(id) << 32) | action;
+    }
+
+    /// What the lanes run so far left of the budget
+    static UpdateBudget remaining(const UpdateBudget &budget, std::size_t used,
+                                  UpdateBudget::clock::time_point deadline) {
+        UpdateBudget rest = budget;
+        rest.items = budget.items > used ? budget.items - used : 0;
+        if (budget.timed()) {
+            UpdateBudget::clock::time_point now = UpdateBudget::clock::now();
+            rest.duration = deadline > now ? deadline - now : UpdateBudget::clock::duration::zero();
+        }
+        return rest;
+    }
+
+    /// Applies a lane's policy to the backlog its update left, returning the backlog kept
+    static std::size_t shed(LaneState &state, int current_tick, std::size_t backlog) {
+        ++state.stats.overloads;
+        switch (state.policy) {
+        case OverloadPolicy::coalesce: {
+            // Only the actions coalescing keeps are left for the next update
+            std::size_t dropped = state.scheduler.coalesceDue(current_tick);
+            state.stats.dropped += dropped;
+            backlog -= std::min(dropped, backlog);
+            break;
+        }
+        case OverloadPolicy::drop:
+            state.stats.dropped += state.scheduler.dropDue(current_tick);
+            return 0;
+        default:
+            break;
+        }
+        state.stats.deferred += backlog;
+        return backlog;
+    }
+
+    std::array<LaneState, laneCount> lanes{
+        LaneState{OverloadPolicy::exempt}, LaneState{OverloadPolicy::defer},
+        LaneState{OverloadPolicy::drop}, LaneState{OverloadPolicy::defer}};
+};
+
+/// @brief Lane scheduler with heap-backed lanes
+using LaneScheduler = BasicLaneScheduler<>;
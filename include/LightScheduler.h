@@ -0,0 +1,233 @@
+/**
+ * @file LightScheduler.h
+ * @brief Scheduler for services without an ECS: plain callbacks, no registry, no events.
+ *
+ * Networking, session and timer services want Scheduler's IDs, cancellation
+ * and periodic runs, but have no entities to check and nobody listening for
+ * ActionCompletedEvent. BasicLightScheduler runs on the same BasicTimerQueue
+ * as Scheduler, over a node of an ID, a tick, a callable and the repeat
+ * state, and passes each callable a context of the caller's choosing. Nothing
+ * else is kept per action, so an update is a pop, a call and, for periodic
+ * actions, a push.
+ */
+#pragma once
+
+#include "HeapQueue.h"
+#include "InlineFunction.h"
+#include "TimerQueue.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @struct LightCall
+ * @brief Callable type of the actions of a BasicLightScheduler
+ * @tparam Context The type actions get a reference to, or void for actions without arguments
+ */
+template <typename Context> struct LightCall {
+    using type = InlineFunction<void(Context &)>;
+};
+
+/// @cond
+template <> struct LightCall<void> {
+    using type = InlineFunction<void()>;
+};
+/// @endcond
+
+/**
+ * @struct LightAction
+ * @brief Queue node of a BasicLightScheduler
+ * @tparam Context The type actions get a reference to, or void
+ */
+template <typename Context> struct LightAction {
+    std::uint32_t id = 0;                   ///< ID of the action
+    int tick = 0;                           ///< Tick at which the action runs next
+    typename LightCall<Context>::type call; ///< The callable
+    int interval = 0;                       ///< Ticks between two runs, 0 for a one-shot action
+    int repeats = 0;                        ///< Runs left after the next one, or forever
+
+    /// @brief Value of repeats for a periodic action that runs until cancelled
+    static constexpr int forever = -1;
+
+    /// @brief Checks whether the action will be re-armed after its next run
+    bool rearms() const { return interval > 0 && repeats != 0; }
+};
+
+/**
+ * @class BasicLightScheduler
+ * @brief Tick-ordered callbacks on a context, with Scheduler's ID and cancel semantics
+ * @tparam Context The type actions get a reference to, or void for actions without arguments
+ * @tparam Queue The queue backend (HeapQueue, TimingWheel or CalendarQueue)
+ *
+ * IDs are handed out, reused and invalidated exactly as by Scheduler: a
+ * cancelled or finished ID never matches a later action. Actions of a tick
+ * run in the order they were scheduled. An action may schedule, cancel and
+ * reschedule others while it runs; those due by the tick being updated run in
+ * the same update.
+ *
+ * @code
+ * struct Session { void sendPing(); void close(); };
+ *
+ * using SessionTimers = BasicLightScheduler<Session>;
+ * SessionTimers timers;
+ * auto ping = timers.schedulePeriodic(now + 30, 30, SessionTimers::forever,
+ *                                     [](Session &s) { s.sendPing(); });
+ * auto timeout = timers.schedule(now + 600, [](Session &s) { s.close(); });
+ * timers.update(now, session);
+ * timers.cancel(timeout); // On every packet, then schedule a new timeout
+ * @endcode
+ */
+template <typename Context = void, typename Queue = HeapQueue<LightAction<Context>>>
+class BasicLightScheduler {
+    using Timers = BasicTimerQueue<LightAction<Context>, Queue>;
+
+  public:
+    /// @brief The queue node type
+    using action_type = LightAction<Context>;
+
+    /// @brief The callable type of an action
+    using function_type = typename LightCall<Context>::type;
+
+    /// @brief The ID type, laid out as the queue backend asks
+    using id_type = typename Timers::id_type;
+
+    /// @brief The queue backend type
+    using queue_type = Queue;
+
+    /// @brief Allocator of the queue backend, or std::allocator if it takes none
+    using allocator_type = typename Timers::allocator_type;
+
+    /// @brief Value of the count of schedulePeriodic() for an action that runs until cancelled
+    static constexpr int forever = action_type::forever;
+
+    BasicLightScheduler() = default;
+
+    /// @brief Constructs a scheduler whose queue and ID slots draw from an allocator
+    explicit BasicLightScheduler(const allocator_type &allocator) : timers(allocator) {}
+
+    /// @brief Gets the allocator of the pending actions
+    allocator_type get_allocator() const { return timers.get_allocator(); }
+
+    /**
+     * @brief Schedules an action to run once
+     * @param tick The tick at which to run it
+     * @param call The callable
+     * @return The ID of the action
+     */
+    id_type schedule(int tick, function_type call) {
+        action_type action;
+        action.tick = tick;
+        action.call = std::move(call);
+        return timers.insert(std::move(action));
+    }
+
+    /**
+     * @brief Schedules an action that repeats at a fixed interval
+     * @param firstTick The tick of the first run
+     * @param interval Ticks between two runs, must be positive
+     * @param count Total number of runs, or forever
+     * @param call The callable, run on each run
+     * @return The ID of the action, shared by all of its runs, or 0 if count is 0
+     *
+     * If update() is called past several due runs, each of them runs in order
+     * within that update.
+     */
+    id_type schedulePeriodic(int firstTick, int interval, int count, function_type call) {
+        if (count == 0) {
+            return 0;
+        }
+        action_type action;
+        action.tick = firstTick;
+        action.call = std::move(call);
+        action.interval = interval > 0 ? interval : 0;
+        action.repeats = count == forever ? forever : count - 1;
+        return timers.insert(std::move(action));
+    }
+
+    /**
+     * @brief Cancels a pending action
+     * @param id The ID of the action
+     * @return true if the action was pending and will not run again
+     *
+     * As with Scheduler, cancelling a one-shot action while it runs returns
+     * false, and cancelling a periodic action from inside one of its runs
+     * stops its later runs.
+     */
+    bool cancel(id_type id) { return timers.cancel(id); }
+
+    /**
+     * @brief Moves a queued action to another tick, keeping its ID
+     * @param id The ID of the action
+     * @param tick The tick at which the action now runs
+     * @return false if the action is not queued, such as while it runs
+     */
+    bool reschedule(id_type id, int tick) {
+        return timers.modify(id, [tick](action_type &action) { action.tick = tick; });
+    }
+
+    /// @brief Checks whether an action is pending: queued, or a periodic action running now
+    bool isPending(id_type id) const { return timers.contains(id); }
+
+    /**
+     * @brief Runs every action due at or before a tick
+     * @param currentTick The current tick
+     * @param context Passed to every action, for a Context other than void
+     * @return The number of runs
+     */
+    template <typename... Args> std::size_t update(int currentTick, Args &...context) {
+        static_assert(sizeof...(Args) == (std::is_void_v<Context> ? 0 : 1),
+                      "update() takes a context unless Context is void");
+        std::size_t runs = 0;
+        action_type action;
+        while (timers.popDue(currentTick, action)) {
+            // A periodic action keeps its ID while it runs so it can be re-armed
+            bool periodic = action.rearms();
+            if (!periodic) {
+                timers.release(action.id);
+            }
+            action.call(context...);
+            ++runs;
+            if (periodic && timers.contains(action.id)) {
+                action.tick += action.interval;
+                if (action.repeats != forever) {
+                    --action.repeats;
+                }
+                timers.enqueue(std::move(action));
+            } else {
+                action.call = nullptr; // Frees the capture now rather than at the next pop
+            }
+        }
+        return runs;
+    }
+
+    /// @brief Gets the tick of the earliest queued action, or nothing if none is queued
+    std::optional<int> nextTick() const { return timers.nextTick(); }
+
+    /// @brief Gets the number of queued actions
+    std::size_t size() const { return timers.size(); }
+
+    /// @brief Checks whether no action is queued
+    bool empty() const { return timers.empty(); }
+
+    /// @brief Reserves room for a number of pending actions
+    void reserve(std::size_t capacity) { timers.reserve(capacity); }
+
+    /**
+     * @brief Drops every pending action in O(1), keeping allocated capacity
+     *
+     * As with Scheduler::clear(), the old actions are destroyed as update()
+     * reaches their ticks, or all together by reclaim().
+     */
+    void clear() { timers.expire(); }
+
+    /// @brief Destroys the actions clear() left in the queue, returns the IDs released
+    std::size_t reclaim() { return timers.reclaim(); }
+
+  private:
+    Timers timers;
+};
+
+/// @brief BasicLightScheduler of callables that take no arguments
+using LightScheduler = BasicLightScheduler<>;
@@ -0,0 +1,351 @@
+/**
+ * @file LockstepScheduler.h
+ * @brief Replicates a scheduler to follower nodes as a per-tick stream of schedule and cancel commands.
+ *
+ * Nodes running the same simulation for failover used to need the same
+ * schedule() calls delivered to each of them, because the scheduled actions
+ * were closures. A LockstepScheduler only schedules ActionHandlers calls, a
+ * handler ID and a plain-data payload, so each schedule or cancel is a fixed
+ * size record. The leader applies its commands and batches them into one
+ * frame per tick; followers apply the frame's commands in the same order and
+ * run the same update, which leaves them with the same queue and the same
+ * action IDs. Every frame carries a rolling checksum of the queue, so a
+ * follower notices divergence at the tick it happens without any state being
+ * shipped.
+ */
+#pragma once
+
+#include "ActionHandlers.h"
+#include "Scheduler.h"
+#include "SchedulerSnapshot.h"
+#include "StaticDispatcher.h"
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @struct LockstepCommand
+ * @brief One replicated scheduler call
+ */
+struct LockstepCommand {
+    enum class Kind : std::uint32_t {
+        schedule,  ///< Schedules record under id
+        cancel,    ///< Cancels id
+        cancelAll, ///< Cancels every action of record.entity
+    };
+
+    Kind kind = Kind::schedule;
+    ActionID id = 0;          ///< ID the leader got, or the ID to cancel
+    SavedActionRecord record; ///< The action to schedule, or the entity whose actions are cancelled
+};
+
+/**
+ * @struct LockstepFrameHeader
+ * @brief Start of a frame, followed by its commands
+ */
+struct LockstepFrameHeader {
+    std::int32_t tick;      ///< Tick the frame's update runs
+    std::uint32_t commands; ///< Number of LockstepCommand records that follow
+    std::uint64_t checksum; ///< Rolling checksum after the update
+};
+
+/// @brief Outcome of applying a frame on a follower
+enum class LockstepStatus {
+    ok,        ///< Applied, and the checksum matches the leader's
+    diverged,  ///< Applied, but the follower's queue differs from the leader's
+    malformed, ///< Truncated frame, nothing was applied
+};
+
+/**
+ * @class LockstepScheduler
+ * @brief Leader or follower side of a deterministic replicated scheduler
+ * @tparam Queue The queue backend of the scheduler
+ *
+ * A node is a leader when it calls schedule(), cancel() and update(), and a
+ * follower when it calls apply() with the leader's frames, in order. Every
+ * node starts from the same scheduler state, usually empty or restored from
+ * the same snapshot, registers the same handlers, and lets nothing else touch
+ * the scheduler. Actions run on followers exactly as on the leader, so they
+ * must be deterministic; they must not schedule through the LockstepScheduler
+ * themselves, since those calls would only be replicated after the update.
+ *
+ * The checksum folds in each frame's commands, the number of actions run, the
+ * pending count, the next due tick and the scheduler's incremental
+ * BasicScheduler::stateHash() of pending IDs, entities and ticks. Every
+ * setFullCheckInterval() ticks it also folds in a full hash of every pending
+ * action including its payload, which catches differences the IDs and ticks
+ * do not show.
+ *
+ * @code
+ * // Leader
+ * LockstepScheduler<> leader(scheduler, handlers);
+ * leader.schedule(tick + 30, npc, "heal"_hs, Heal{10});
+ * std::vector<unsigned char> frame;
+ * leader.update(tick, registry, dispatcher, frame);
+ * broadcast(frame);
+ *
+ * // Follower
+ * LockstepScheduler<> follower(replicaScheduler, handlers);
+ * if (follower.apply(frame.data(), frame.size(), replicaRegistry, dispatcher) !=
+ *     LockstepStatus::ok) {
+ *     resynchronize();
+ * }
+ * @endcode
+ */
+template <typename Queue = HeapQueue<ScheduledAction>> class LockstepScheduler {
+  public:
+    /**
+     * @param scheduler The replicated scheduler, which must outlive this object
+     * @param handlers Handlers the commands' payloads are bound to
+     */
+    LockstepScheduler(BasicScheduler<Queue> &scheduler, const ActionHandlers &handlers)
+        : scheduler(scheduler), handlers(handlers) {}
+
+    /**
+     * @brief Schedules a handler call on the leader
+     * @param tick The tick at which to run the action
+     * @param entity The entity to run it on
+     * @param handler ID of the handler in ActionHandlers
+     * @param payload Argument of the handler
+     * @return The ID of the action, the same on every node
+     */
+    template <typename Payload>
+    ActionID schedule(int tick, entt::entity entity, entt::id_type handler,
+                      const Payload &payload) {
+        return schedulePeriodic(tick, 0, 1, entity, handler, payload);
+    }
+
+    /**
+     * @brief Schedules a repeating handler call on the leader
+     * @param firstTick The tick of the first run
+     * @param interval Ticks between two runs
+     * @param count Total number of runs, or ScheduledAction::forever
+     * @param entity The entity to run it on
+     * @param handler ID of the handler in ActionHandlers
+     * @param payload Argument of the handler
+     * @return The ID of the action, or 0 if count is 0
+     */
+    template <typename Payload>
+    ActionID schedulePeriodic(int firstTick, int interval, int count, entt::entity entity,
+                              entt::id_type handler, const Payload &payload) {
+        if (count == 0) {
+            return 0;
+        }
+        LockstepCommand command{};
+        command.record.tick = firstTick;
+        command.record.entity = entt::to_integral(entity);
+        command.record.interval = interval > 0 ? interval : 0;
+        command.record.repeats =
+            count == ScheduledAction::forever ? ScheduledAction::forever : count - 1;
+        command.record.payload = handlers.bind(handler, payload).saved();
+        command.id = execute(command);
+        commands.push_back(command);
+        return command.id;
+    }
+
+    /**
+     * @brief Cancels an action on the leader
+     * @param id The ID returned by schedule()
+     * @return true if the action was pending and is now cancelled
+     */
+    bool cancel(ActionID id) {
+        LockstepCommand command{};
+        command.kind = LockstepCommand::Kind::cancel;
+        command.id = id;
+        if (execute(command) == 0) {
+            return false;
+        }
+        commands.push_back(command);
+        return true;
+    }
+
+    /**
+     * @brief Cancels every action of an entity on the leader
+     * @param entity The entity
+     * @return The number of actions cancelled
+     */
+    std::size_t cancelAll(entt::entity entity) {
+        LockstepCommand command{};
+        command.kind = LockstepCommand::Kind::cancelAll;
+        command.record.entity = entt::to_integral(entity);
+        std::size_t cancelled = execute(command);
+        if (cancelled != 0) {
+            commands.push_back(command);
+        }
+        return cancelled;
+    }
+
+    /**
+     * @brief Runs the leader's tick and writes its frame
+     * @param tick The current tick
+     * @param registry Registry the actions run on
+     * @param dispatcher Dispatcher completion events are enqueued on
+     * @param frame Buffer the frame is appended to, to send to every follower
+     * @return The checksum after the update
+     */
+    std::uint64_t update(int tick, entt::registry &registry, EventDispatcher &dispatcher,
+                         std::vector<unsigned char> &frame) {
+        for (const LockstepCommand &command : commands) {
+            fold(command);
+        }
+        advance(tick, registry, dispatcher);
+        LockstepFrameHeader header{tick, static_cast<std::uint32_t>(commands.size()), rolling};
+        append(frame, &header, sizeof(header));
+        append(frame, commands.data(), commands.size() * sizeof(LockstepCommand));
+        commands.clear();
+        return rolling;
+    }
+
+    /**
+     * @brief Applies one of the leader's frames on a follower
+     * @param data The frame
+     * @param size Bytes available at data, which may hold further frames
+     * @param registry Registry the actions run on
+     * @param dispatcher Dispatcher completion events are enqueued on
+     * @param consumed Optional, receives the size of the frame
+     * @return Whether the follower still matches the leader
+     *
+     * After a divergence the follower keeps the state it reached; it should be
+     * restored from a leader snapshot before applying more frames.
+     */
+    LockstepStatus apply(const unsigned char *data, std::size_t size, entt::registry &registry,
+                         EventDispatcher &dispatcher, std::size_t *consumed = nullptr) {
+        LockstepFrameHeader header{};
+        if (size < sizeof(header)) {
+            return LockstepStatus::malformed;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        std::size_t length = sizeof(header) + std::size_t{header.commands} * sizeof(LockstepCommand);
+        if (size < length) {
+            return LockstepStatus::malformed;
+        }
+        bool matches = true;
+        LockstepCommand command{};
+        for (std::uint32_t i = 0; i < header.commands; ++i) {
+            std::memcpy(&command, data + sizeof(header) + i * sizeof(LockstepCommand),
+                        sizeof(command));
+            std::size_t result = execute(command);
+            if (command.kind == LockstepCommand::Kind::schedule) {
+                // The leader's ID comes from the same slot map operations
+                matches = matches && result == command.id;
+            } else {
+                matches = matches && result != 0;
+            }
+            fold(command);
+        }
+        advance(header.tick, registry, dispatcher);
+        if (consumed != nullptr) {
+            *consumed = length;
+        }
+        return matches && rolling == header.checksum ? LockstepStatus::ok
+                                                     : LockstepStatus::diverged;
+    }
+
+    /**
+     * @brief Sets how often the checksum includes every pending action
+     * @param ticks Interval in ticks, 0 to only fold in counts; must match on every node
+     */
+    void setFullCheckInterval(int ticks) { fullCheckInterval = ticks > 0 ? ticks : 0; }
+
+    /// @brief Gets the rolling checksum after the last update() or apply()
+    std::uint64_t checksum() const { return rolling; }
+
+    /**
+     * @brief Hashes every pending action, independently of queue order
+     * @return The hash, equal on nodes whose queues hold the same actions
+     */
+    std::uint64_t stateHash() const {
+        std::uint64_t sum = 0;
+        scheduler.forEachPending([&sum](const ScheduledAction &action) {
+            std::uint64_t hash = mix(mix(mix(mix(mix(offset, action.id),
+                                                 static_cast<std::uint32_t>(action.tick)),
+                                             entt::to_integral(action.entity)),
+                                         static_cast<std::uint32_t>(action.interval)),
+                                     static_cast<std::uint32_t>(action.repeats));
+            if (const auto *call = action.action.template target<ActionHandlers::Call>()) {
+                hash = bytes(hash, &call->saved(), sizeof(SavedPayload));
+            }
+            sum += hash;
+        });
+        return sum;
+    }
+
+    /// @brief Gets the commands issued on the leader since its last update()
+    const std::vector<LockstepCommand> &queued() const { return commands; }
+
+  private:
+    static constexpr std::uint64_t offset = 14695981039346656037ull; ///< FNV-1a basis
+    static constexpr std::uint64_t prime = 1099511628211ull;
+
+    static std::uint64_t mix(std::uint64_t hash, std::uint64_t value) {
+        return (hash ^ value) * prime;
+    }
+
+    static std::uint64_t bytes(std::uint64_t hash, const void *data, std::size_t size) {
+        const auto *at = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash = mix(hash, at[i]);
+        }
+        return hash;
+    }
+
+    /// Applies a command; returns the new ID, or how many actions were cancelled
+    std::size_t execute(const LockstepCommand &command) {
+        switch (command.kind) {
+        case LockstepCommand::Kind::schedule: {
+            std::optional<ActionHandlers::Call> call = handlers.restore(command.record.payload);
+            if (!call) {
+                return 0;
+            }
+            ScheduledAction action{0, command.record.tick, entt::entity{command.record.entity},
+                                   *call, nullptr};
+            action.interval = command.record.interval;
+            action.repeats = command.record.repeats;
+            return scheduler.schedule(std::move(action));
+        }
+        case LockstepCommand::Kind::cancel:
+            return scheduler.cancel(command.id) ? 1 : 0;
+        case LockstepCommand::Kind::cancelAll:
+            return scheduler.cancelAll(entt::entity{command.record.entity});
+        }
+        return 0;
+    }
+
+    void fold(const LockstepCommand &command) {
+        rolling = bytes(rolling, &command, sizeof(command));
+    }
+
+    /// Runs the update and folds its outcome into the checksum
+    void advance(int tick, entt::registry &registry, EventDispatcher &dispatcher) {
+        UpdateResult result = scheduler.update(tick, registry, dispatcher, UpdateBudget{});
+        std::optional<int> next = scheduler.nextDueTick();
+        rolling = mix(rolling, static_cast<std::uint32_t>(tick));
+        rolling = mix(rolling, result.executed);
+        rolling = mix(rolling, scheduler.pendingCount());
+        rolling = mix(rolling, next ? static_cast<std::uint32_t>(*next) + 1ull : 0ull);
+        rolling = mix(rolling, scheduler.stateHash());
+        if (fullCheckInterval != 0 && tick % fullCheckInterval == 0) {
+            rolling = mix(rolling, stateHash());
+        }
+    }
+
+    static void append(std::vector<unsigned char> &out, const void *data, std::size_t size) {
+        const auto *at = static_cast<const unsigned char *>(data);
+        out.insert(out.end(), at, at + size);
+    }
+
+    static_assert(std::is_trivially_copyable_v<LockstepCommand> &&
+                      sizeof(LockstepCommand) ==
+                          2 * sizeof(std::uint32_t) + sizeof(SavedActionRecord),
+                  "Commands are sent as raw bytes, without padding");
+
+    BasicScheduler<Queue> &scheduler;
+    const ActionHandlers &handlers;
+    std::vector<LockstepCommand> commands; ///< Leader commands not sent yet
+    std::uint64_t rolling = offset;
+    int fullCheckInterval = 60;
+};
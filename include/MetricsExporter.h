@@ -0,0 +1,326 @@
+/**
+ * @file MetricsExporter.h
+ * @brief Scheduler and dispatcher metrics in the OpenMetrics text format.
+ *
+ * A MetricsExporter renders the counters, queue depth gauges and histograms
+ * of any number of SchedulerStats, and the per-event-type queue sizes kept by
+ * DispatcherGauges, as an OpenMetrics exposition that Prometheus scrapes
+ * directly. Everything it reads is a relaxed atomic written by the owning
+ * thread, so rendering from an HTTP or metrics thread never waits on, and
+ * never delays, an update.
+ */
+#pragma once
+
+#include "SchedulerStats.h"
+#include "StaticDispatcher.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @class DispatcherGauges
+ * @brief Queue sizes of a dispatcher, sampled on its thread for reading on any other
+ *
+ * Dispatchers are not thread-safe, so the exporter cannot ask them for their
+ * queue sizes. Instead the dispatcher's thread calls sample(), typically just
+ * before dispatcher.update(), which copies the size of every tracked event
+ * queue into a relaxed atomic.
+ *
+ * @code
+ * DispatcherGauges gauges;
+ * gauges.track<GameEvents::EntityDamagedEvent>("entity_damaged");
+ * // Once per tick, on the dispatcher's thread
+ * gauges.sample(dispatcher);
+ * dispatcher.update();
+ * @endcode
+ */
+class DispatcherGauges {
+  public:
+    DispatcherGauges() = default;
+    DispatcherGauges(const DispatcherGauges &) = delete;
+    DispatcherGauges &operator=(const DispatcherGauges &) = delete;
+
+    /**
+     * @brief Adds an event type to the sampled queues
+     * @tparam Event The event type, which the dispatcher must know
+     * @param name Value of the event label in the exported metrics
+     *
+     * Must be called before the gauges are sampled or exported.
+     */
+    template <typename Event> void track(std::string name) {
+        gauges.emplace_back(std::move(name), [](const EventDispatcher &dispatcher) {
+            return static_cast<std::uint64_t>(dispatcher.template size<Event>());
+        });
+    }
+
+    /// @brief Copies the size of every tracked queue, on the dispatcher's thread
+    void sample(const EventDispatcher &dispatcher) {
+        for (Gauge &gauge : gauges) {
+            gauge.size.store(gauge.read(dispatcher), std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Gets the number of tracked event types
+    std::size_t size() const { return gauges.size(); }
+
+    /// @brief Gets the label of a tracked event type
+    std::string_view name(std::size_t index) const { return gauges[index].name; }
+
+    /// @brief Gets the queue size of a tracked event type at the last sample, from any thread
+    std::uint64_t queued(std::size_t index) const {
+        return gauges[index].size.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Gauge {
+        Gauge(std::string name, std::uint64_t (*read)(const EventDispatcher &))
+            : name(std::move(name)), read(read) {}
+
+        std::string name;
+        std::uint64_t (*read)(const EventDispatcher &);
+        std::atomic<std::uint64_t> size{0};
+    };
+
+    std::deque<Gauge> gauges; ///< A deque, since the atomics cannot move
+};
+
+/**
+ * @class MetricsExporter
+ * @brief Renders scheduler and dispatcher metrics as OpenMetrics text
+ *
+ * Each added source becomes one label value: scheduler="..." on the
+ * scheduler metrics and dispatcher="..." on the queue sizes. Sources are
+ * added during setup and must outlive the exporter; write() may then be
+ * called from any thread, as often as the scrapes come.
+ *
+ * Histograms are exported with fixed bucket bounds, in ticks for lateness and
+ * in nanoseconds for durations, which are exported in seconds. A
+ * SchedulerStats histogram bucket is counted under the first bound at or
+ * above its largest value, so a bound that falls inside a bucket reports it
+ * under the next bound up; bucket widths are at most 1/16 of their values.
+ *
+ * Metrics written:
+ * - scheduler_updates_total, scheduler_executed_total, scheduler_skipped_total,
+ *   scheduler_cancelled_total: the counters of StatsSnapshot
+ * - scheduler_queue_depth, scheduler_peak_queue_depth: gauges
+ * - scheduler_lateness_ticks, scheduler_action_duration_seconds: histograms
+ * - dispatcher_queued_events: gauge labelled with dispatcher and event
+ *
+ * @code
+ * MetricsExporter exporter;
+ * exporter.addScheduler("combat", combatStats);
+ * exporter.addDispatcher("main", gauges);
+ * // On the HTTP thread, answering GET /metrics
+ * response.setHeader("Content-Type", MetricsExporter::contentType);
+ * response.setBody(exporter.render());
+ * @endcode
+ */
+class MetricsExporter {
+  public:
+    /// @brief Content-Type of the rendered text
+    static constexpr const char *contentType =
+        "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+    /// @brief Default lateness bucket bounds, in ticks
+    static std::vector<std::uint64_t> defaultLatenessBounds() {
+        return {0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024};
+    }
+
+    /// @brief Default duration bucket bounds, in nanoseconds: 1 us to 1 s by decades
+    static std::vector<std::uint64_t> defaultDurationBounds() {
+        return {1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+    }
+
+    /**
+     * @brief Creates an exporter with the given histogram bucket bounds
+     * @param latenessBounds Increasing lateness bounds, in ticks
+     * @param durationBounds Increasing duration bounds, in nanoseconds
+     */
+    explicit MetricsExporter(std::vector<std::uint64_t> latenessBounds = defaultLatenessBounds(),
+                             std::vector<std::uint64_t> durationBounds = defaultDurationBounds())
+        : latenessBounds(std::move(latenessBounds)), durationBounds(std::move(durationBounds)) {}
+
+    /// @brief Exports a scheduler's statistics under scheduler="name"
+    void addScheduler(std::string name, const SchedulerStats &stats) {
+        schedulers.emplace_back(std::move(name), &stats);
+    }
+
+    /// @brief Exports a dispatcher's sampled queue sizes under dispatcher="name"
+    void addDispatcher(std::string name, const DispatcherGauges &gauges) {
+        dispatchers.emplace_back(std::move(name), &gauges);
+    }
+
+    /// @brief Writes the exposition, ending with # EOF, from any thread
+    void write(std::ostream &out) const {
+        std::vector<StatsSnapshot> snapshots;
+        snapshots.reserve(schedulers.size());
+        for (const auto &source : schedulers) {
+            snapshots.push_back(source.second->snapshot());
+        }
+
+        writeCounter(out, "scheduler_updates", "Calls to update()", snapshots,
+                     &StatsSnapshot::updates);
+        writeCounter(out, "scheduler_executed", "Work items run", snapshots,
+                     &StatsSnapshot::executed);
+        writeCounter(out, "scheduler_skipped", "Due work items dropped without running",
+                     snapshots, &StatsSnapshot::skipped);
+        writeCounter(out, "scheduler_cancelled", "Successful cancellations", snapshots,
+                     &StatsSnapshot::cancelled);
+        writeGauge(out, "scheduler_queue_depth", "Queued work items at the end of the last update",
+                   snapshots, &StatsSnapshot::queueDepth);
+        writeGauge(out, "scheduler_peak_queue_depth",
+                   "Most queued work items seen at the start of an update", snapshots,
+                   &StatsSnapshot::peakQueueDepth);
+        writeHistogram(out, "scheduler_lateness_ticks", "ticks",
+                       "Ticks from the due tick to the tick a work item ran at", snapshots,
+                       &StatsSnapshot::lateness, latenessBounds, false);
+        writeHistogram(out, "scheduler_action_duration_seconds", "seconds",
+                       "Time spent running a work item, sequential runs only", snapshots,
+                       &StatsSnapshot::duration, durationBounds, true);
+
+        if (!dispatchers.empty()) {
+            out << "# TYPE dispatcher_queued_events gauge\n"
+                   "# HELP dispatcher_queued_events Events queued at the last sample\n";
+            for (const auto &[name, gauges] : dispatchers) {
+                for (std::size_t i = 0; i < gauges->size(); ++i) {
+                    out << "dispatcher_queued_events{dispatcher=\"";
+                    writeLabel(out, name);
+                    out << "\",event=\"";
+                    writeLabel(out, gauges->name(i));
+                    out << "\"} " << gauges->queued(i) << '\n';
+                }
+            }
+        }
+        out << "# EOF\n";
+    }
+
+    /// @brief Renders the exposition into a string
+    std::string render() const {
+        std::ostringstream out;
+        write(out);
+        return out.str();
+    }
+
+  private:
+    using Source = std::pair<std::string, const SchedulerStats *>;
+    using Field = std::uint64_t StatsSnapshot::*;
+
+    /// Escapes a label value as the text format requires
+    static void writeLabel(std::ostream &out, std::string_view value) {
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                out << '\\' << c;
+            } else if (c == '\n') {
+                out << "\\n";
+            } else {
+                out << c;
+            }
+        }
+    }
+
+    /// Writes nanoseconds as exact decimal seconds, without trailing zeros
+    static void writeSeconds(std::ostream &out, std::uint64_t nanoseconds) {
+        out << nanoseconds / 1000000000u;
+        std::uint64_t fraction = nanoseconds % 1000000000u;
+        if (fraction == 0) {
+            return;
+        }
+        char digits[9];
+        for (int i = 8; i >= 0; --i) {
+            digits[i] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        std::size_t length = 9;
+        while (digits[length - 1] == '0') {
+            --length;
+        }
+        out << '.';
+        out.write(digits, static_cast<std::streamsize>(length));
+    }
+
+    void writeSample(std::ostream &out, std::string_view metric, std::size_t source) const {
+        out << metric << "{scheduler=\"";
+        writeLabel(out, schedulers[source].first);
+        out << '"';
+    }
+
+    void writeCounter(std::ostream &out, const char *name, const char *help,
+                      const std::vector<StatsSnapshot> &snapshots, Field field) const {
+        out << "# TYPE " << name << " counter\n# HELP " << name << ' ' << help << '\n';
+        for (std::size_t i = 0; i < snapshots.size(); ++i) {
+            writeSample(out, std::string(name) + "_total", i);
+            out << "} " << snapshots[i].*field << '\n';
+        }
+    }
+
+    void writeGauge(std::ostream &out, const char *name, const char *help,
+                    const std::vector<StatsSnapshot> &snapshots, Field field) const {
+        out << "# TYPE " << name << " gauge\n# HELP " << name << ' ' << help << '\n';
+        for (std::size_t i = 0; i < snapshots.size(); ++i) {
+            writeSample(out, name, i);
+            out << "} " << snapshots[i].*field << '\n';
+        }
+    }
+
+    void writeHistogram(std::ostream &out, const char *name, const char *unit, const char *help,
+                        const std::vector<StatsSnapshot> &snapshots,
+                        HistogramSnapshot StatsSnapshot::*field,
+                        const std::vector<std::uint64_t> &bounds, bool inSeconds) const {
+        out << "# TYPE " << name << " histogram\n# UNIT " << name << ' ' << unit << "\n# HELP "
+            << name << ' ' << help << '\n';
+        std::string bucketName = std::string(name) + "_bucket";
+        std::vector<std::uint64_t> counts(bounds.size() + 1);
+        for (std::size_t i = 0; i < snapshots.size(); ++i) {
+            const HistogramSnapshot &histogram = snapshots[i].*field;
+            counts.assign(bounds.size() + 1, 0);
+            std::size_t next = 0;
+            for (std::size_t bucket = 0; bucket < HistogramSnapshot::bucketCount; ++bucket) {
+                std::uint64_t count = histogram.bucket(bucket);
+                if (count == 0) {
+                    continue;
+                }
+                std::uint64_t top = HistogramSnapshot::upperBound(bucket);
+                while (next < bounds.size() && bounds[next] < top) {
+                    ++next;
+                }
+                counts[next] += count;
+            }
+            std::uint64_t cumulative = 0;
+            for (std::size_t bound = 0; bound <= bounds.size(); ++bound) {
+                cumulative += counts[bound];
+                writeSample(out, bucketName, i);
+                out << ",le=\"";
+                if (bound == bounds.size()) {
+                    out << "+Inf";
+                } else if (inSeconds) {
+                    writeSeconds(out, bounds[bound]);
+                } else {
+                    out << bounds[bound];
+                }
+                out << "\"} " << cumulative << '\n';
+            }
+            writeSample(out, std::string(name) + "_count", i);
+            out << "} " << cumulative << '\n';
+            writeSample(out, std::string(name) + "_sum", i);
+            out << "} ";
+            if (inSeconds) {
+                writeSeconds(out, histogram.sum());
+            } else {
+                out << histogram.sum();
+            }
+            out << '\n';
+        }
+    }
+
+    std::vector<std::uint64_t> latenessBounds;
+    std::vector<std::uint64_t> durationBounds;
+    std::vector<Source> schedulers;
+    std::vector<std::pair<std::string, const DispatcherGauges *>> dispatchers;
+};
@@ -0,0 +1,125 @@
+/**
+ * @file ParallelDispatch.h
+ * @brief Drains an entt::dispatcher with independent event types published in parallel.
+ *
+ * dispatcher.update() publishes one event type after the other on the calling
+ * thread. When the listeners of several types are heavy and touch disjoint
+ * state, ParallelDispatch publishes those types concurrently on a TaskPool,
+ * one type per task, and everything else in a fixed order on the caller.
+ * Listeners are connected through the dispatcher's sinks exactly as before.
+ */
+#pragma once
+
+#include "TaskPool.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class ParallelDispatch
+ * @brief Publishing plan of a dispatcher's event types
+ *
+ * update() runs in three phases:
+ * 1. Types marked independent() that have queued events are published
+ *    concurrently, each type on one thread, in its own enqueue order.
+ * 2. Types marked ordered() are published on the calling thread in the order
+ *    they were marked, so a type can rely on the types marked before it.
+ * 3. dispatcher.update() publishes every remaining type, as it would without
+ *    a plan.
+ *
+ * Listeners of independent types run on worker threads: they must not share
+ * unsynchronised state with each other, and may only enqueue events of their
+ * own type on the dispatcher being drained.
+ *
+ * @code
+ * ParallelDispatch drain;
+ * drain.independent<GameEvents::EntityDamagedEvent>();
+ * drain.independent<GameEvents::PlayerMoveEvent>();
+ * drain.independent<GameEvents::ItemPickupEvent>();
+ * drain.ordered<GameEvents::EntityDiedEvent>(); // Reads the health damage listeners wrote
+ *
+ * scheduler.update(tick, registry, dispatcher);
+ * drain.update(dispatcher, pool);
+ * @endcode
+ */
+class ParallelDispatch {
+  public:
+    /**
+     * @brief Marks an event type as safe to publish concurrently with other independent types
+     * @tparam Event The event type
+     * @param id Name of the queue within the dispatcher
+     */
+    template <typename Event>
+    ParallelDispatch &independent(entt::id_type id = entt::type_hash<Event>::value()) {
+        add(parallel, makeQueue<Event>(id));
+        return *this;
+    }
+
+    /**
+     * @brief Marks an event type to be published on the calling thread after the independent ones
+     * @tparam Event The event type
+     * @param id Name of the queue within the dispatcher
+     */
+    template <typename Event>
+    ParallelDispatch &ordered(entt::id_type id = entt::type_hash<Event>::value()) {
+        add(serial, makeQueue<Event>(id));
+        return *this;
+    }
+
+    /**
+     * @brief Publishes every queued event of a dispatcher
+     * @param dispatcher The dispatcher to drain
+     * @param pool Pool the independent types are published on
+     */
+    void update(entt::dispatcher &dispatcher, TaskPool &pool) {
+        // Create missing queues here, so workers only ever look existing ones up
+        busy.clear();
+        for (const Queue &queue : parallel) {
+            if (queue.prepare(dispatcher, queue.id) != 0) {
+                busy.push_back(&queue);
+            }
+        }
+        pool.parallelFor(busy.size(), [this, &dispatcher](std::size_t i) {
+            busy[i]->publish(dispatcher, busy[i]->id);
+        });
+
+        for (const Queue &queue : serial) {
+            queue.publish(dispatcher, queue.id);
+        }
+        dispatcher.update();
+    }
+
+  private:
+    struct Queue {
+        entt::id_type type;
+        entt::id_type id;
+        std::size_t (*prepare)(entt::dispatcher &, entt::id_type); ///< Returns the queued count
+        void (*publish)(entt::dispatcher &, entt::id_type);
+    };
+
+    template <typename Event> static Queue makeQueue(entt::id_type id) {
+        return Queue{entt::type_hash<Event>::value(), id,
+                     [](entt::dispatcher &dispatcher, entt::id_type name) {
+                         static_cast<void>(dispatcher.sink<Event>(name));
+                         return dispatcher.size<Event>(name);
+                     },
+                     [](entt::dispatcher &dispatcher, entt::id_type name) {
+                         dispatcher.update<Event>(name);
+                     }};
+    }
+
+    /// Adds a queue to a phase, moving it out of the other phase if it was there
+    void add(std::vector<Queue> &phase, const Queue &queue) {
+        auto same = [&queue](const Queue &other) {
+            return other.type == queue.type && other.id == queue.id;
+        };
+        parallel.erase(std::remove_if(parallel.begin(), parallel.end(), same), parallel.end());
+        serial.erase(std::remove_if(serial.begin(), serial.end(), same), serial.end());
+        phase.push_back(queue);
+    }
+
+    std::vector<Queue> parallel;
+    std::vector<Queue> serial;
+    std::vector<const Queue *> busy; ///< Independent queues with events, rebuilt by update()
+};
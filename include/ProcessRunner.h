@@ -0,0 +1,152 @@
+/**
+ * @file ProcessRunner.h
+ * @brief Runs long entt::process work in slices across ticks, within a per-tick budget.
+ *
+ * Pathfinding, procedural generation and similar jobs are too heavy for one
+ * tick and used to be split into many scheduled actions by hand. A
+ * ProcessRunner keeps such jobs as entt::process objects in an
+ * entt::basic_scheduler. Every tick it gives each live process one update
+ * after the other, round after round, until the tick's UpdateBudget is spent,
+ * so processes share the budget fairly however many there are. Continuations
+ * are chained with entt's then(), and a scheduled action can launch a process
+ * through launch().
+ */
+#pragma once
+
+#include "Scheduler.h"
+#include "StaticDispatcher.h"
+#include "UpdateBudget.h"
+#include "entt/entt.hpp"
+#include <chrono>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+/**
+ * @struct ProcessContext
+ * @brief What a process receives as the data pointer of its update()
+ */
+struct ProcessContext {
+    int tick;                    ///< Tick passed to ProcessRunner::update()
+    entt::registry &registry;    ///< Registry passed to ProcessRunner::update()
+    EventDispatcher &dispatcher; ///< Dispatcher passed to ProcessRunner::update()
+
+    /// @brief Gets the context from the data pointer of a process update
+    static ProcessContext &of(void *data) { return *static_cast<ProcessContext *>(data); }
+};
+
+/**
+ * @class ProcessRunner
+ * @brief Time-sliced entt::process scheduler driven by the game tick
+ *
+ * Processes derive from entt::process<Derived, int>. Their update(delta,
+ * data) should do one small slice of work and return, calling succeed() or
+ * fail() when done. delta is the number of ticks since the previous
+ * ProcessRunner::update() on the first round of a tick and 0 on later rounds;
+ * data points to a ProcessContext. A round always runs, so every process
+ * advances at least once per tick; more rounds follow while the budget lasts.
+ *
+ * A failed or aborted process drops the continuations chained after it.
+ *
+ * @code
+ * struct PathSearch : entt::process<PathSearch, int> {
+ *     PathSearch(entt::entity npc, Cell goal);
+ *     void update(int, void *data) {
+ *         auto &context = ProcessContext::of(data);
+ *         if (expandNodes(context.registry, 64)) { succeed(); }
+ *     }
+ * };
+ *
+ * ProcessRunner processes(UpdateBudget::time(std::chrono::milliseconds(2)));
+ * scheduler.schedule(tick + 1, npc, processes.launch<PathSearch>(goal));
+ * // Every frame
+ * scheduler.update(tick, registry, dispatcher);
+ * processes.update(tick, registry, dispatcher);
+ * @endcode
+ */
+class ProcessRunner {
+  public:
+    /// @brief The entt scheduler holding the processes
+    using scheduler_type = entt::basic_scheduler<int>;
+
+    /// @param budget Time and rounds each update() may spend, 1 ms by default
+    explicit ProcessRunner(UpdateBudget budget = UpdateBudget::time(std::chrono::milliseconds(1)))
+        : budget(budget) {}
+
+    /**
+     * @brief Starts a process
+     * @tparam Proc The process type
+     * @param args Arguments to construct the process
+     * @return The entt scheduler, to chain continuations with then()
+     */
+    template <typename Proc, typename... Args> scheduler_type &attach(Args &&...args) {
+        return processes.attach<Proc>(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Starts a process running a callable
+     * @param func Called as func(delta, data, succeed, fail), see entt::process_adaptor
+     * @return The entt scheduler, to chain continuations with then()
+     */
+    template <typename Func> scheduler_type &attach(Func &&func) {
+        return processes.attach(std::forward<Func>(func));
+    }
+
+    /**
+     * @brief Makes an action that starts a process on its entity when it runs
+     * @tparam Proc The process type, constructed from the entity followed by args
+     * @param args Further constructor arguments, copied into the action
+     * @return The action, to pass to BasicScheduler::schedule()
+     *
+     * The runner must outlive the scheduled action.
+     */
+    template <typename Proc, typename... Args> ActionFunction launch(Args... args) {
+        return [this, args = std::make_tuple(std::move(args)...)](entt::entity entity,
+                                                                  entt::registry &) {
+            std::apply([this, entity](const auto &...values) { attach<Proc>(entity, values...); },
+                       args);
+        };
+    }
+
+    /**
+     * @brief Advances the processes in rounds until the budget is spent
+     * @param tick The current tick
+     * @param registry Registry handed to the processes
+     * @param dispatcher Dispatcher handed to the processes
+     * @return Rounds run as executed, and processes still running as backlog
+     */
+    UpdateResult update(int tick, entt::registry &registry, EventDispatcher &dispatcher) {
+        ProcessContext context{tick, registry, dispatcher};
+        BudgetMeter meter(budget);
+        int delta = started ? tick - lastTick : 0;
+        started = true;
+        lastTick = tick;
+        while (!processes.empty() && !meter.exhausted()) {
+            processes.update(delta, &context);
+            meter.consume();
+            delta = 0;
+        }
+        return UpdateResult{meter.consumed(), processes.size()};
+    }
+
+    /// @brief Sets the budget of later updates
+    void setBudget(UpdateBudget value) { budget = value; }
+
+    /// @brief Gets the number of running processes, not counting continuations
+    std::size_t size() const { return processes.size(); }
+
+    /// @brief Checks whether no process is running
+    bool empty() const { return processes.empty(); }
+
+    /**
+     * @brief Aborts every process
+     * @param immediate Whether to abort now rather than on the next update
+     */
+    void abort(bool immediate = false) { processes.abort(immediate); }
+
+  private:
+    scheduler_type processes;
+    UpdateBudget budget;
+    int lastTick = 0;
+    bool started = false;
+};
@@ -0,0 +1,513 @@
+/**
+ * @file ReplicationCodec.h
+ * @brief Compact binary encoding of game events for replication, generated from entt::meta.
+ *
+ * Replicating events used to take a hand-written serializer per struct, run
+ * for each event as listeners saw it. A ReplicationCodec registers the fields
+ * of an event type once, with entt::meta, and derives from them a byte-level
+ * plan of offsets and field kinds. Events are collected during the tick,
+ * either straight from a StaticDispatcher queue or through a dispatcher sink,
+ * and flush() encodes every collected event of every type in one pass into a
+ * single packet.
+ *
+ * Each event is delta-encoded against the previous event of its type: a
+ * varint mask names the fields that changed, integers are written as
+ * zigzag varints of their difference, entities are packed (null is 0) and
+ * handled the same way, and booleans cost nothing beyond their mask bit.
+ */
+#pragma once
+
+#include "GameEvents.h"
+#include "StaticDispatcher.h"
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @class ReplicationCodec
+ * @brief Encodes batches of trivially copyable events into delta-compressed packets
+ *
+ * The sender and the receiver register the same types with the same fields,
+ * and packets must reach the receiver in order and without loss: each one is
+ * decoded against the events of the packets before it. Call reset() on both
+ * sides to start over, for example when a client reconnects.
+ *
+ * Supported field types are entt::entity, integers, enums, bool, EventName
+ * and float; other fields fail to compile. An event type has at most 64
+ * registered fields; fields left unregistered are not sent and are
+ * value-initialized on the receiver.
+ *
+ * @code
+ * using namespace entt::literals;
+ * ReplicationCodec codec;
+ * codec.reflect<GameEvents::PlayerMoveEvent>("PlayerMoveEvent"_hs)
+ *     .field<&GameEvents::PlayerMoveEvent::player>("player"_hs)
+ *     .field<&GameEvents::PlayerMoveEvent::toX>("toX"_hs)
+ *     .field<&GameEvents::PlayerMoveEvent::toY>("toY"_hs);
+ *
+ * // Sender, once per tick, before dispatcher.update()
+ * codec.collect(dispatcher.queued<GameEvents::PlayerMoveEvent>());
+ * std::vector<unsigned char> packet;
+ * codec.flush(packet);
+ *
+ * // Receiver
+ * codec.decode(packet.data(), packet.size(), clientDispatcher);
+ * @endcode
+ */
+class ReplicationCodec {
+    /// How a field is compared and written
+    enum class Kind : std::uint8_t { signedInt, unsignedInt, entity, boolean, raw };
+
+    struct Field {
+        std::size_t offset;
+        std::size_t size;
+        Kind kind;
+    };
+
+    /// Everything known about one registered event type, on raw bytes
+    struct Channel {
+        entt::id_type id = 0;
+        std::size_t eventSize = 0;
+        std::vector<Field> fields;
+        std::vector<unsigned char> previous; ///< Last event encoded or decoded, the delta base
+        std::vector<unsigned char> pending;  ///< Collected events not flushed yet
+        std::size_t pendingCount = 0;
+        void (*deliver)(EventDispatcher &, const unsigned char *) = nullptr;
+        void (*clearBase)(unsigned char *) = nullptr;
+    };
+
+  public:
+    /**
+     * @class Reflector
+     * @brief Registers the fields of one event type, returned by reflect()
+     */
+    template <typename Event> class Reflector {
+      public:
+        /**
+         * @brief Registers a data member, with entt::meta and in the codec
+         * @tparam Member Pointer to the data member
+         * @param id Name of the field in entt::meta
+         */
+        template <auto Member> Reflector &field(entt::id_type id) {
+            using Value = std::remove_cv_t<
+                std::remove_reference_t<decltype(std::declval<Event &>().*Member)>>;
+            factory = factory.template data<Member>(id);
+            Channel &channel = codec->channels[index];
+            // The change mask has one bit per field
+            ENTT_ASSERT(channel.fields.size() < 64, "Too many replicated fields");
+            Event probe{};
+            std::size_t offset = static_cast<std::size_t>(
+                reinterpret_cast<const unsigned char *>(&(probe.*Member)) -
+                reinterpret_cast<const unsigned char *>(&probe));
+            channel.fields.push_back(Field{offset, sizeof(Value), kindOf<Value>()});
+            return *this;
+        }
+
+      private:
+        friend class ReplicationCodec;
+
+        Reflector(ReplicationCodec &codec, std::size_t index, entt::meta_factory<Event> factory)
+            : codec(&codec), index(index), factory(factory) {}
+
+        ReplicationCodec *codec;
+        std::size_t index;
+        entt::meta_factory<Event> factory;
+    };
+
+    /**
+     * @brief Registers an event type with entt::meta and opens a channel for it
+     * @tparam Event A trivially copyable event type
+     * @param id Name of the type in entt::meta, also written in packets
+     * @return A reflector to register the fields with
+     *
+     * Registering a type again drops its previous fields.
+     */
+    template <typename Event> Reflector<Event> reflect(entt::id_type id) {
+        static_assert(std::is_trivially_copyable_v<Event> && std::is_default_constructible_v<Event>,
+                      "Replicated events are copied as raw bytes");
+        std::size_t index = channelOf<Event>();
+        if (index == channels.size()) {
+            channels.emplace_back();
+            types.push_back(entt::type_hash<Event>::value());
+        }
+        Channel &channel = channels[index];
+        channel = Channel{};
+        channel.id = id;
+        channel.eventSize = sizeof(Event);
+        channel.previous.resize(sizeof(Event));
+        channel.deliver = +[](EventDispatcher &dispatcher, const unsigned char *bytes) {
+            Event event;
+            std::memcpy(static_cast<void *>(&event), bytes, sizeof(Event));
+            dispatcher.enqueue(std::move(event));
+        };
+        channel.clearBase = +[](unsigned char *bytes) {
+            Event empty{};
+            std::memcpy(bytes, static_cast<const void *>(&empty), sizeof(Event));
+        };
+        channel.clearBase(channel.previous.data());
+        return Reflector<Event>(*this, index, entt::meta_factory<Event>{}.type(id));
+    }
+
+    /**
+     * @brief Adds events to the next packet
+     * @param events The events, for example a StaticDispatcher queue
+     */
+    template <typename Event> void collect(const Event *events, std::size_t count) {
+        Channel &channel = registered<Event>();
+        const auto *bytes = reinterpret_cast<const unsigned char *>(events);
+        channel.pending.insert(channel.pending.end(), bytes, bytes + count * sizeof(Event));
+        channel.pendingCount += count;
+    }
+
+    /// @copydoc collect()
+    template <typename Event> void collect(const std::vector<Event> &events) {
+        collect(events.data(), events.size());
+    }
+
+    /// @brief Adds one event to the next packet, usable as a dispatcher listener
+    template <typename Event> void collectEvent(const Event &event) { collect(&event, 1); }
+
+    /**
+     * @brief Collects every event of a type published by a dispatcher
+     * @param dispatcher The dispatcher, whose listeners copy each event into the codec
+     *
+     * Use it with entt::dispatcher, whose queues cannot be read; with a
+     * StaticDispatcher, collect(dispatcher.queued<Event>()) copies the queue
+     * at once.
+     */
+    template <typename Event> void track(EventDispatcher &dispatcher) {
+        dispatcher.template sink<Event>().template connect<&ReplicationCodec::collectEvent<Event>>(
+            *this);
+    }
+
+    /// @brief Stops collecting the events of a type published by a dispatcher
+    template <typename Event> void untrack(EventDispatcher &dispatcher) {
+        dispatcher.template sink<Event>()
+            .template disconnect<&ReplicationCodec::collectEvent<Event>>(*this);
+    }
+
+    /**
+     * @brief Encodes every collected event into a packet
+     * @param out Buffer the packet is appended to
+     * @return The number of events encoded
+     *
+     * Types are written in registration order, each type's events in
+     * collection order. A packet with no events is a single 0 byte.
+     */
+    std::size_t flush(std::vector<unsigned char> &out) {
+        std::size_t types = 0;
+        for (const Channel &channel : channels) {
+            types += channel.pendingCount != 0 ? 1 : 0;
+        }
+        std::size_t total = 0;
+        putVarint(out, types);
+        for (Channel &channel : channels) {
+            if (channel.pendingCount == 0) {
+                continue;
+            }
+            putRaw(out, channel.id);
+            putVarint(out, channel.pendingCount);
+            for (std::size_t i = 0; i < channel.pendingCount; ++i) {
+                encode(channel, channel.pending.data() + i * channel.eventSize, out);
+            }
+            total += channel.pendingCount;
+            channel.pending.clear();
+            channel.pendingCount = 0;
+        }
+        return total;
+    }
+
+    /**
+     * @brief Decodes a packet and enqueues its events on a dispatcher
+     * @param data The packet
+     * @param size Size of the packet in bytes
+     * @param dispatcher Receives the events, in packet order
+     * @return false if the packet is truncated or names an unknown type; the
+     *         events before the error are enqueued and reset() is needed
+     */
+    bool decode(const unsigned char *data, std::size_t size, EventDispatcher &dispatcher) {
+        Reader reader{data, data + size};
+        std::uint64_t types = 0;
+        if (!reader.varint(types)) {
+            return false;
+        }
+        std::vector<unsigned char> event;
+        for (std::uint64_t t = 0; t < types; ++t) {
+            entt::id_type id = 0;
+            std::uint64_t count = 0;
+            if (!reader.raw(&id, sizeof(id)) || !reader.varint(count)) {
+                return false;
+            }
+            Channel *channel = find(id);
+            if (channel == nullptr) {
+                return false;
+            }
+            event.resize(channel->eventSize);
+            for (std::uint64_t i = 0; i < count; ++i) {
+                if (!decodeOne(*channel, reader, event.data())) {
+                    return false;
+                }
+                channel->deliver(dispatcher, event.data());
+            }
+        }
+        return reader.at == reader.end;
+    }
+
+    /// @brief Forgets the delta bases and the collected events, on both sides of a connection
+    void reset() {
+        for (Channel &channel : channels) {
+            channel.clearBase(channel.previous.data());
+            channel.pending.clear();
+            channel.pendingCount = 0;
+        }
+    }
+
+    /// @brief Gets the number of collected events not flushed yet
+    std::size_t pending() const {
+        std::size_t count = 0;
+        for (const Channel &channel : channels) {
+            count += channel.pendingCount;
+        }
+        return count;
+    }
+
+  private:
+    struct Reader {
+        const unsigned char *at;
+        const unsigned char *end;
+
+        bool varint(std::uint64_t &value) {
+            value = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7) {
+                if (at == end) {
+                    return false;
+                }
+                unsigned char byte = *at++;
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool raw(void *value, std::size_t size) {
+            if (static_cast<std::size_t>(end - at) < size) {
+                return false;
+            }
+            std::memcpy(value, at, size);
+            at += size;
+            return true;
+        }
+    };
+
+    template <typename Value> static constexpr Kind kindOf() {
+        if constexpr (std::is_same_v<Value, entt::entity>) {
+            return Kind::entity;
+        } else if constexpr (std::is_same_v<Value, bool>) {
+            return Kind::boolean;
+        } else if constexpr (std::is_same_v<Value, EventName> || std::is_floating_point_v<Value>) {
+            // Hashes and floats do not shrink as differences
+            return Kind::raw;
+        } else if constexpr (std::is_enum_v<Value>) {
+            return kindOf<std::underlying_type_t<Value>>();
+        } else {
+            static_assert(std::is_integral_v<Value> && sizeof(Value) <= 8,
+                          "Unsupported replicated field type");
+            return std::is_signed_v<Value> ? Kind::signedInt : Kind::unsignedInt;
+        }
+    }
+
+    template <typename Event> std::size_t channelOf() const {
+        const entt::id_type type = entt::type_hash<Event>::value();
+        std::size_t index = 0;
+        while (index < types.size() && types[index] != type) {
+            ++index;
+        }
+        return index;
+    }
+
+    template <typename Event> Channel &registered() {
+        std::size_t index = channelOf<Event>();
+        ENTT_ASSERT(index < channels.size(), "Event type was not reflected");
+        return channels[index];
+    }
+
+    Channel *find(entt::id_type id) {
+        for (Channel &channel : channels) {
+            if (channel.id == id) {
+                return &channel;
+            }
+        }
+        return nullptr;
+    }
+
+    /// Reads a field widened to 64 bits, entities packed so that null is 0
+    static std::uint64_t load(const Field &field, const unsigned char *event) {
+        if (field.kind == Kind::entity) {
+            entt::entity entity;
+            std::memcpy(&entity, event + field.offset, sizeof(entity));
+            return entity == entt::null ? 0 : std::uint64_t{entt::to_integral(entity)} + 1;
+        }
+        std::uint64_t value = 0;
+        std::memcpy(&value, event + field.offset, field.size); // Little-endian hosts
+        if (field.kind == Kind::signedInt && field.size < 8 &&
+            (value >> (field.size * 8 - 1)) != 0) {
+            value |= ~std::uint64_t{0} << (field.size * 8); // Sign-extend
+        }
+        return value;
+    }
+
+    static void store(const Field &field, unsigned char *event, std::uint64_t value) {
+        if (field.kind == Kind::entity) {
+            entt::entity entity =
+                value == 0 ? entt::entity{entt::null}
+                           : static_cast<entt::entity>(
+                                 static_cast<entt::id_type>(value - 1));
+            std::memcpy(event + field.offset, &entity, sizeof(entity));
+            return;
+        }
+        std::memcpy(event + field.offset, &value, field.size);
+    }
+
+    void encode(Channel &channel, const unsigned char *event, std::vector<unsigned char> &out) {
+        unsigned char *base = channel.previous.data();
+        std::uint64_t mask = 0;
+        for (std::size_t f = 0; f < channel.fields.size(); ++f) {
+            const Field &field = channel.fields[f];
+            if (std::memcmp(event + field.offset, base + field.offset, field.size) != 0) {
+                mask |= std::uint64_t{1} << f;
+            }
+        }
+        putVarint(out, mask);
+        for (std::size_t f = 0; f < channel.fields.size(); ++f) {
+            const Field &field = channel.fields[f];
+            if ((mask >> f & 1) == 0) {
+                continue;
+            }
+            switch (field.kind) {
+            case Kind::boolean:
+                break; // A changed bool is the other value
+            case Kind::raw:
+                out.insert(out.end(), event + field.offset, event + field.offset + field.size);
+                break;
+            default:
+                putVarint(out, zigzag(load(field, event) - load(field, base)));
+                break;
+            }
+            std::memcpy(base + field.offset, event + field.offset, field.size);
+        }
+    }
+
+    static bool decodeOne(Channel &channel, Reader &reader, unsigned char *event) {
+        unsigned char *base = channel.previous.data();
+        std::uint64_t mask = 0;
+        if (!reader.varint(mask)) {
+            return false;
+        }
+        for (std::size_t f = 0; f < channel.fields.size(); ++f) {
+            const Field &field = channel.fields[f];
+            if ((mask >> f & 1) == 0) {
+                continue;
+            }
+            switch (field.kind) {
+            case Kind::boolean:
+                base[field.offset] = base[field.offset] != 0 ? 0 : 1;
+                break;
+            case Kind::raw:
+                if (!reader.raw(base + field.offset, field.size)) {
+                    return false;
+                }
+                break;
+            default: {
+                std::uint64_t delta = 0;
+                if (!reader.varint(delta)) {
+                    return false;
+                }
+                store(field, base, load(field, base) + unzigzag(delta));
+                break;
+            }
+            }
+        }
+        // Unregistered fields keep the value-initialized bytes of the base
+        std::memcpy(event, base, channel.eventSize);
+        return true;
+    }
+
+    static std::uint64_t zigzag(std::uint64_t delta) {
+        return (delta << 1) ^ (std::uint64_t{0} - (delta >> 63));
+    }
+
+    static std::uint64_t unzigzag(std::uint64_t value) {
+        return (value >> 1) ^ (std::uint64_t{0} - (value & 1));
+    }
+
+    static void putVarint(std::vector<unsigned char> &out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    template <typename Value> static void putRaw(std::vector<unsigned char> &out, Value value) {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(Value));
+    }
+
+    std::vector<Channel> channels;
+    std::vector<entt::id_type> types; ///< entt::type_hash of each channel's event type
+};
+
+/**
+ * @brief Registers every trivially copyable GameEvents type and all of its fields
+ * @param codec The codec, on the sending or the receiving side
+ */
+inline void reflectGameEvents(ReplicationCodec &codec) {
+    using namespace GameEvents;
+    using namespace entt::literals;
+    codec.reflect<EntityAttackEvent>("EntityAttackEvent"_hs)
+        .field<&EntityAttackEvent::attacker>("attacker"_hs)
+        .field<&EntityAttackEvent::target>("target"_hs)
+        .field<&EntityAttackEvent::damage>("damage"_hs)
+        .field<&EntityAttackEvent::critical>("critical"_hs);
+    codec.reflect<EntityDamagedEvent>("EntityDamagedEvent"_hs)
+        .field<&EntityDamagedEvent::entity>("entity"_hs)
+        .field<&EntityDamagedEvent::damage>("damage"_hs)
+        .field<&EntityDamagedEvent::source>("source"_hs)
+        .field<&EntityDamagedEvent::damageType>("damageType"_hs);
+    codec.reflect<EntityDiedEvent>("EntityDiedEvent"_hs)
+        .field<&EntityDiedEvent::entity>("entity"_hs)
+        .field<&EntityDiedEvent::killer>("killer"_hs);
+    codec.reflect<EntitySpawnEvent>("EntitySpawnEvent"_hs)
+        .field<&EntitySpawnEvent::entity>("entity"_hs)
+        .field<&EntitySpawnEvent::x>("x"_hs)
+        .field<&EntitySpawnEvent::y>("y"_hs)
+        .field<&EntitySpawnEvent::entityType>("entityType"_hs);
+    codec.reflect<MapChangeEvent>("MapChangeEvent"_hs)
+        .field<&MapChangeEvent::mapName>("mapName"_hs)
+        .field<&MapChangeEvent::isReload>("isReload"_hs);
+    codec.reflect<PlayerMoveEvent>("PlayerMoveEvent"_hs)
+        .field<&PlayerMoveEvent::player>("player"_hs)
+        .field<&PlayerMoveEvent::fromX>("fromX"_hs)
+        .field<&PlayerMoveEvent::fromY>("fromY"_hs)
+        .field<&PlayerMoveEvent::toX>("toX"_hs)
+        .field<&PlayerMoveEvent::toY>("toY"_hs);
+    codec.reflect<ItemPickupEvent>("ItemPickupEvent"_hs)
+        .field<&ItemPickupEvent::player>("player"_hs)
+        .field<&ItemPickupEvent::item>("item"_hs)
+        .field<&ItemPickupEvent::itemType>("itemType"_hs);
+    codec.reflect<CombatStartEvent>("CombatStartEvent"_hs)
+        .field<&CombatStartEvent::initiator>("initiator"_hs)
+        .field<&CombatStartEvent::target>("target"_hs);
+    codec.reflect<CombatEndEvent>("CombatEndEvent"_hs)
+        .field<&CombatEndEvent::winner>("winner"_hs)
+        .field<&CombatEndEvent::fled>("fled"_hs);
+    codec.reflect<ActionCompletedEvent>("ActionCompletedEvent"_hs)
+        .field<&ActionCompletedEvent::actionId>("actionId"_hs)
+        .field<&ActionCompletedEvent::entity>("entity"_hs);
+}
@@ -0,0 +1,235 @@
+/**
+ * @file RoutedScheduler.h
+ * @brief Routes actions aimed at entities owned by other processes through per-node outboxes.
+ *
+ * When the world is split across processes, an action whose target lives on
+ * another node cannot be scheduled on the local Scheduler, and sending an RPC
+ * per action costs a round trip and a message each. A RoutedScheduler
+ * schedules actions on local targets directly and appends the others, as
+ * ActionHandlers calls, to one outbox per destination node. Once per tick,
+ * flush() ships every outbox as a single batch; the receiving node inserts the
+ * whole batch into its scheduler at once, at the logical tick each action was
+ * scheduled for. Routed ticks are pushed back to at least the configured
+ * latency after the flush, so an action never arrives after its tick as long
+ * as the network delivers within that budget.
+ */
+#pragma once
+
+#include "ActionHandlers.h"
+#include "Scheduler.h"
+#include "SchedulerSnapshot.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <vector>
+
+/// @brief Identifier of a process owning part of the world
+using NodeID = std::uint32_t;
+
+/**
+ * @struct RemoteEntity
+ * @brief An entity together with the node whose registry owns it
+ */
+struct RemoteEntity {
+    NodeID node;          ///< Owning node
+    std::uint32_t entity; ///< entt::to_integral of the entity in the owner's registry
+};
+
+/**
+ * @struct RoutedBatchHeader
+ * @brief Start of a batch shipped by flush(), followed by its SavedActionRecords
+ */
+struct RoutedBatchHeader {
+    NodeID source;          ///< Node that sent the batch
+    std::int32_t sentTick;  ///< Tick passed to flush()
+    std::uint32_t count;    ///< Number of records that follow
+    std::uint32_t reserved; ///< Zero
+};
+
+/**
+ * @class RoutedScheduler
+ * @brief Schedules handler actions on local or remote entities
+ * @tparam Queue The queue backend of the local scheduler
+ *
+ * Both nodes register the same ActionHandlers. Routed actions get no ID on
+ * the sending node and cannot be cancelled from it; the handler on the owner
+ * should check that its entity is still the one it was aimed at, as
+ * BasicScheduler does with registry.valid(). Batches may arrive in any order
+ * relative to other nodes' batches; within a batch, and between batches of
+ * the same sender, actions keep the order they were scheduled in.
+ *
+ * @code
+ * RoutedScheduler<> router(scheduler, handlers, thisNode, 2); // 2 ticks of latency budget
+ * router.schedule(tick + 1, RemoteEntity{targetNode, targetId}, "attack"_hs, Attack{15});
+ *
+ * // Once per tick
+ * router.flush(tick, [&](NodeID node, const unsigned char *data, std::size_t size) {
+ *     transport.send(node, data, size);
+ * });
+ * for (const Message &message : transport.received()) {
+ *     router.receive(message.data(), message.size(), tick);
+ * }
+ * scheduler.update(tick, registry, dispatcher);
+ * @endcode
+ */
+template <typename Queue = HeapQueue<ScheduledAction>> class RoutedScheduler {
+  public:
+    /// @brief Ships one batch to a node
+    using Send = std::function<void(NodeID, const unsigned char *, std::size_t)>;
+
+    /**
+     * @param scheduler The local scheduler, which must outlive the router
+     * @param handlers Handlers routed actions are bound to on arrival
+     * @param node The local node
+     * @param latency Ticks a batch may take to arrive, at least 0
+     */
+    RoutedScheduler(BasicScheduler<Queue> &scheduler, const ActionHandlers &handlers, NodeID node,
+                    int latency)
+        : scheduler(scheduler), handlers(handlers), self(node),
+          latencyBudget(latency > 0 ? latency : 0) {}
+
+    /// @brief Gets the local node
+    NodeID node() const { return self; }
+
+    /// @brief Names a local entity for other nodes
+    RemoteEntity local(entt::entity entity) const {
+        return RemoteEntity{self, entt::to_integral(entity)};
+    }
+
+    /**
+     * @brief Schedules a handler call on an entity of any node
+     * @param tick The tick at which to run the action
+     * @param target The entity and its owner
+     * @param handler ID of the handler in ActionHandlers
+     * @param payload Argument of the handler
+     * @return The action's ID if the target is local, 0 if it was routed
+     */
+    template <typename Payload>
+    ActionID schedule(int tick, RemoteEntity target, entt::id_type handler,
+                      const Payload &payload) {
+        ActionHandlers::Call call = handlers.bind(handler, payload);
+        if (target.node == self) {
+            return scheduler.schedule(tick, entt::entity{target.entity}, call);
+        }
+        outboxFor(target.node).push_back(
+            SavedActionRecord{tick, target.entity, 0, 0, call.saved()});
+        return 0;
+    }
+
+    /**
+     * @brief Ships every outbox, one batch per destination
+     * @param tick The current tick
+     * @param send Called once per node with pending actions, in node order
+     * @return The number of actions shipped
+     *
+     * Actions due before tick + latency are moved to that tick.
+     */
+    std::size_t flush(int tick, const Send &send) {
+        std::size_t shipped = 0;
+        const int earliest = tick + latencyBudget;
+        for (Outbox &outbox : outboxes) {
+            if (outbox.records.empty()) {
+                continue;
+            }
+            RoutedBatchHeader header{self, tick, static_cast<std::uint32_t>(outbox.records.size()),
+                                     0};
+            packet.resize(sizeof(header) + outbox.records.size() * sizeof(SavedActionRecord));
+            std::memcpy(packet.data(), &header, sizeof(header));
+            unsigned char *at = packet.data() + sizeof(header);
+            for (SavedActionRecord &record : outbox.records) {
+                record.tick = std::max(record.tick, earliest);
+                std::memcpy(at, &record, sizeof(record));
+                at += sizeof(record);
+            }
+            send(outbox.node, packet.data(), packet.size());
+            shipped += outbox.records.size();
+            outbox.records.clear();
+        }
+        return shipped;
+    }
+
+    /**
+     * @brief Inserts a batch shipped by another node
+     * @param data The batch
+     * @param size Size of the batch in bytes
+     * @param tick The current tick; actions whose tick has passed run at the next update
+     * @return The number of actions scheduled, or 0 if the batch is truncated
+     */
+    std::size_t receive(const unsigned char *data, std::size_t size, int tick) {
+        RoutedBatchHeader header{};
+        if (size < sizeof(header)) {
+            return 0;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (size < sizeof(header) + std::size_t{header.count} * sizeof(SavedActionRecord)) {
+            return 0;
+        }
+        arrivals.clear();
+        SavedActionRecord record;
+        for (std::uint32_t i = 0; i < header.count; ++i) {
+            std::memcpy(&record, data + sizeof(header) + i * sizeof(record), sizeof(record));
+            std::optional<ActionHandlers::Call> call = handlers.restore(record.payload);
+            if (!call) {
+                ++skippedCount;
+                continue;
+            }
+            if (record.tick < tick) {
+                // Over the latency budget: run as soon as possible
+                ++lateCount;
+            }
+            arrivals.push_back(ScheduledAction{0, std::max(record.tick, tick),
+                                               entt::entity{record.entity}, *call, nullptr});
+        }
+        scheduler.scheduleBulk(arrivals.begin(), arrivals.end());
+        std::size_t scheduled = arrivals.size();
+        arrivals.clear();
+        return scheduled;
+    }
+
+    /// @brief Gets the number of routed actions waiting for the next flush()
+    std::size_t pending() const {
+        std::size_t count = 0;
+        for (const Outbox &outbox : outboxes) {
+            count += outbox.records.size();
+        }
+        return count;
+    }
+
+    /// @brief Gets the number of received actions that arrived after their tick
+    std::size_t late() const { return lateCount; }
+
+    /// @brief Gets the number of received actions whose handler is not registered
+    std::size_t skipped() const { return skippedCount; }
+
+  private:
+    struct Outbox {
+        NodeID node;
+        std::vector<SavedActionRecord> records;
+    };
+
+    /// Outboxes stay sorted by node, so flush() ships them in a stable order
+    std::vector<SavedActionRecord> &outboxFor(NodeID node) {
+        auto it = std::lower_bound(outboxes.begin(), outboxes.end(), node,
+                                   [](const Outbox &outbox, NodeID value) {
+                                       return outbox.node < value;
+                                   });
+        if (it == outboxes.end() || it->node != node) {
+            it = outboxes.insert(it, Outbox{node, {}});
+        }
+        return it->records;
+    }
+
+    BasicScheduler<Queue> &scheduler;
+    const ActionHandlers &handlers;
+    NodeID self;
+    int latencyBudget;
+    std::vector<Outbox> outboxes;
+    std::vector<unsigned char> packet;     ///< Reused by flush()
+    std::vector<ScheduledAction> arrivals; ///< Reused by receive()
+    std::size_t lateCount = 0;
+    std::size_t skippedCount = 0;
+};
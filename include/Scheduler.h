@@ -8,22 +8,156 @@
  */
 #pragma once
 
+#include "ActionBatch.h"
+#include "AdaptiveQueue.h"
+#include "ActionStateBoard.h"
+#include "ActionCoroutine.h"
+#include "AllocationCounter.h"
+#include "ActionHandlers.h"
+#include "CalendarQueue.h"
+#include "CapacityProfile.h"
+#include "FlatMap.h"
 #include "GameEvents.h"
+#include "HeapQueue.h"
+#include "InlineFunction.h"
+#include "SchedulerJournal.h"
+#include "SchedulerStats.h"
+#include "SchedulerTrace.h"
+#include "SchedulerWatchdog.h"
+#include "SlotMap.h"
+#include "StateHash.h"
+#include "StaticDispatcher.h"
+#include "SubmissionInbox.h"
+#include "TaskPool.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
+#include "UpdateBudget.h"
+#include "WorkloadCapture.h"
 #include "entt/entt.hpp"
-#include <functional>
-#include <queue>
-#include <unordered_set>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SCHEDULER_PREFETCH(address) __builtin_prefetch(address)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define SCHEDULER_PREFETCH(address)                                                               \
+    _mm_prefetch(reinterpret_cast<const char *>(address), _MM_HINT_T0)
+#else
+#define SCHEDULER_PREFETCH(address) static_cast<void>(address)
+#endif
 
 /// @typedef ActionID
 /// @brief Unique identifier for scheduled actions
+///
+/// Packs a slot index and a generation (see SlotMap), so an ID is never
+/// mistaken for a later action that reuses the same slot.
 using ActionID = uint32_t;
 
+/// @typedef ActionGroup
+/// @brief Handle of a batch of actions scheduled with BasicScheduler::scheduleGroup(), or of
+/// a cancellation token made with BasicScheduler::createGroup()
+///
+/// A SlotMap ID like ActionID, so a handle of a finished or cancelled group
+/// never matches a later group. 0 means no group.
+using ActionGroup = uint32_t;
+
+/// @typedef ActionFunction
+/// @brief Callable run when a scheduled action executes
+using ActionFunction = InlineFunction<void(entt::entity, entt::registry &)>;
+
+/// @typedef CompletionFunction
+/// @brief Callable run after a scheduled action has executed
+using CompletionFunction =
+    InlineFunction<void(ActionID, entt::entity, entt::registry &, EventDispatcher &)>;
+
+/**
+ * @struct ActionAccess
+ * @brief Components an action reads and writes, so it can run in parallel
+ *
+ * Declared the same way entt::organizer reads system signatures: a const
+ * component type is read-only, a non-const one is written. Descriptors are
+ * created once per type list and shared by every action that uses them.
+ *
+ * A local access promises that the action only touches components of its own
+ * entity, which lets actions on different entities write the same component
+ * type concurrently. A shared access may touch those components on any entity.
+ *
+ * @code
+ * // Reads Armor and writes Health of the target entity only
+ * const ActionAccess &hit = ActionAccess::local<const Armor, Health>();
+ * @endcode
+ */
+struct ActionAccess {
+    /// @brief One component touched by an action
+    struct Component {
+        entt::id_type type; ///< entt::type_hash of the component
+        bool write;         ///< true if the component is written
+    };
+
+    const Component *components; ///< Components touched by the action
+    std::size_t size;            ///< Number of components
+    bool selfOnly;               ///< true if only the action's own entity is touched
+
+    /// @brief Creates the storage of every component, so workers never have to
+    void (*prepare)(entt::registry &);
+
+    /// @brief Access to components of the action's own entity only
+    template <typename... Type> static const ActionAccess &local() {
+        return descriptor<true, Type...>();
+    }
+
+    /// @brief Access to components of any entity
+    template <typename... Type> static const ActionAccess &shared() {
+        return descriptor<false, Type...>();
+    }
+
+  private:
+    template <bool Local, typename... Type> static const ActionAccess &descriptor() {
+        static const std::array<Component, sizeof...(Type)> list{
+            {{entt::type_hash<std::remove_const_t<Type>>::value(), !std::is_const_v<Type>}...}};
+        static const ActionAccess access{
+            list.data(), list.size(), Local,
+            [](entt::registry &registry) { (registry.storage<std::remove_const_t<Type>>(), ...); }};
+        return access;
+    }
+};
+
+/**
+ * @struct ChainStep
+ * @brief One step of an action chain
+ * @see BasicScheduler::scheduleChain
+ */
+struct ChainStep {
+    int delay;             ///< Ticks after the previous step, or after the chain's start tick
+    ActionFunction action; ///< The step to run
+};
+
+/**
+ * @struct ActionChain
+ * @brief Steps of a chain that have not been queued yet
+ */
+struct ActionChain {
+    std::vector<ChainStep> steps; ///< Every step of the chain
+    std::size_t next = 0;         ///< Index of the step queued after the current one
+};
+
 /**
  * @struct ScheduledAction
  * @brief Represents an action scheduled to be executed at a specific tick.
  *
  * A ScheduledAction contains the action to perform on an entity, the tick at which to
  * execute it, and optional completion callback logic.
+ *
+ * Both callables are move-only InlineFunctions, so a ScheduledAction can be
+ * moved but not copied. Typical lambdas are stored without heap allocation.
  */
 struct ScheduledAction {
     ActionID id;         ///< Unique identifier for the action
@@ -33,14 +167,40 @@ struct ScheduledAction {
     /// @brief The main action function to execute
     /// @param entity The entity to operate on
     /// @param registry The EnTT registry containing components
-    std::function<void(entt::entity, entt::registry &)> action;
+    ActionFunction action;
 
     /// @brief Optional callback called after the action completes
     /// @param id The ID of the completed action
     /// @param entity The entity the action was performed on
     /// @param registry The EnTT registry containing components
     /// @param dispatcher The EnTT event dispatcher for emitting events
-    std::function<void(ActionID, entt::entity, entt::registry &, entt::dispatcher &)> onComplete;
+    CompletionFunction onComplete;
+
+    /// @brief Ticks between two runs of a periodic action, 0 for a one-shot action
+    int interval = 0;
+
+    /// @brief Runs left after the next one, or ScheduledAction::forever
+    int repeats = 0;
+
+    /// @brief Components the action touches, or nullptr if it must run alone
+    /// @see BasicScheduler::updateParallel
+    const ActionAccess *access = nullptr;
+
+    /// @brief Remaining steps if the action is the current step of a chain
+    std::unique_ptr<ActionChain> chain = nullptr;
+
+    /// @brief Ticks the action may run late by, so that the scheduler can spread load
+    /// @see BasicScheduler::enableSpreading
+    int slack = 0;
+
+    /// @brief Value of repeats for a periodic action that runs until cancelled
+    static constexpr int forever = -1;
+
+    /// @brief Checks whether the action will be re-armed after its next run
+    /// @return true if the action is periodic and has runs left, or is a chain with steps left
+    bool rearms() const {
+        return (interval > 0 && repeats != 0) || (chain && chain->next < chain->steps.size());
+    }
 
     /**
      * @brief Comparison operator for priority queue ordering
@@ -55,17 +215,80 @@ struct ScheduledAction {
 };
 
 /**
- * @class Scheduler
+ * @struct PendingActions
+ * @brief Component a scheduler keeps on entities that have pending actions
+ * @see BasicScheduler::trackPending
+ *
+ * Present exactly while the entity has pending actions, so an
+ * entt::exclude_t<PendingActions> view skips busy entities and a group lists
+ * them without touching the scheduler.
+ */
+struct PendingActions {
+    std::uint32_t count; ///< Pending actions of the entity
+    int nextTick;        ///< Earliest tick one of them is due at
+};
+
+/**
+ * @enum CompletionReport
+ * @brief How a scheduler reports completed actions through the dispatcher
+ */
+enum class CompletionReport : std::uint8_t {
+    /// One ActionCompletedEvent per completed action
+    perAction,
+    /// Like perAction, but nothing is enqueued if ActionCompletedEvent has no listeners
+    ifListened,
+    /// One ActionsCompletedEvent per update, only if it has listeners
+    batched
+};
+
+/**
+ * @struct CatchUpOptions
+ * @brief How BasicScheduler::catchUp() runs a stretch of missed ticks
+ */
+struct CatchUpOptions {
+    /// @brief Update the dispatcher after every tick that had due actions, instead of once at the end
+    bool flushPerTick = false;
+
+    /// @brief Run a periodic action once for all its runs due in the stretch, see missedRuns()
+    bool collapsePeriodic = false;
+};
+
+/**
+ * @struct SpreadOptions
+ * @brief How BasicScheduler::enableSpreading() places actions with slack
+ */
+struct SpreadOptions {
+    /// @brief Ticks of load kept, rounded up to a power of two; slack is capped below it
+    std::size_t window = 4096;
+
+    /// @brief Give periodic actions without slack a slack of interval - 1, spreading their phase
+    bool phasePeriodic = true;
+};
+
+/**
+ * @class BasicScheduler
  * @brief Manages and executes time-based actions on entities within an EnTT framework.
+ * @tparam Queue The queue backend holding pending actions (HeapQueue or TimingWheel)
  *
  * The Scheduler maintains a queue of actions to be executed at specific ticks,
  * operating on entities within an EnTT registry. It supports scheduling, cancelling,
  * and executing actions with completion callbacks and event dispatching.
+ * Cancelled actions are removed from the queue immediately, so the queue only
+ * ever holds live work.
+ *
+ * The queue backend only changes the cost of the operations, never the order in
+ * which actions run. Use the Scheduler alias for the heap backend, or
+ * WheelScheduler when most actions are due within a few hundred ticks.
+ *
+ * The pending actions, their IDs, the per-entity index and the groups use the
+ * allocator of the queue backend. Give the backend a
+ * std::pmr::polymorphic_allocator, as PmrScheduler does, to keep a game
+ * instance's timers in its own memory resource.
  *
  * @code
  * // Example usage:
  * entt::registry registry;
- * entt::dispatcher dispatcher;
+ * EventDispatcher dispatcher;
  * Scheduler scheduler;
  *
  * // Create an entity
@@ -85,29 +308,376 @@ struct ScheduledAction {
  * scheduler.update(currentTick, registry, dispatcher);
  * @endcode
  */
-class Scheduler {
+template <typename Queue = HeapQueue<ScheduledAction>> class BasicScheduler {
   public:
+    /// @brief The queue backend type
+    using queue_type = Queue;
+
+    /// @brief Allocator of the queue backend, or std::allocator if it takes none
+    using allocator_type = typename QueueAllocator<Queue, ScheduledAction>::type;
+
+    /**
+     * @class Inbox
+     * @brief Lock-free submission path for threads other than the scheduler's own
+     *
+     * Obtained from openInbox(). Its methods may be called from any thread,
+     * concurrently with each other and with update(). Submitted actions join
+     * the queue at the start of the next update, in submission order, after
+     * the inboxes opened before this one.
+     */
+    class Inbox {
+      public:
+        /**
+         * @brief Submit an action from any thread
+         * @param action The action to schedule
+         * @return The ID of the action, or 0 if the inbox ran out of reserved IDs
+         *
+         * The returned ID can be cancelled from the scheduler's thread even
+         * before the action has been merged. A submission that got no ID is
+         * still scheduled and receives its ID when it is merged.
+         */
+        ActionID submit(ScheduledAction &&action) {
+            ActionID id = box.reserveId();
+            box.push(id, std::move(action));
+            return id;
+        }
+
+        /// @brief Convenience overload of submit() building the ScheduledAction
+        ActionID submit(int tick, entt::entity entity, ActionFunction action,
+                        CompletionFunction onComplete = nullptr) {
+            return submit(
+                ScheduledAction{0, tick, entity, std::move(action), std::move(onComplete)});
+        }
+
+      private:
+        friend class BasicScheduler;
+
+        Inbox(std::size_t idReserve, bool mergeOnUpdate)
+            : box(idReserve), automatic(mergeOnUpdate) {}
+
+        SubmissionInbox<ScheduledAction, ActionID> box;
+        bool automatic; ///< Merged by update()
+    };
+
     /**
      * @brief Constructs a new Scheduler
      */
-    Scheduler() : nextActionId(1) {}
+    BasicScheduler() = default;
+
+    /**
+     * @brief Constructs a Scheduler whose pending actions draw from an allocator
+     * @param allocator Allocator of the queue, the ID slots, the entity index and the groups
+     */
+    explicit BasicScheduler(const allocator_type &allocator)
+        : timers(allocator), entityIndex(EntityAllocator(allocator)),
+          groups(GroupAllocator(allocator)) {}
+
+    /// @brief Gets the allocator of the pending actions
+    allocator_type get_allocator() const { return timers.get_allocator(); }
 
     /**
      * @brief Schedule an action and get its ID
      * @param action The ScheduledAction to schedule
      * @return The ID of the scheduled action, which can be used for cancellation
      *
-     * Takes a pre-constructed ScheduledAction and adds it to the queue.
+     * Takes a pre-constructed ScheduledAction and moves it into the queue.
+     * ScheduledAction is move-only, so pass a temporary or use std::move.
      */
-    ActionID schedule(const ScheduledAction &action) {
-        ActionID actionId = nextActionId++;
-        ScheduledAction actionWithId = action;
-        actionWithId.id = actionId;
-        queue.push(actionWithId);
-        activeActions.insert(actionId);
+    ActionID schedule(ScheduledAction &&action) {
+        SCHEDULER_ALLOCATION_SCOPE("Scheduler::schedule");
+        ActionID actionId = timers.acquire();
+        action.id = actionId;
+        spread(action);
+        link(actionId, action.entity, action.tick, action.rearms());
+        if (capture) {
+            captureSchedule(action);
+        }
+        if (journal) {
+            journalSchedule(action);
+        }
+        timers.enqueue(std::move(action));
         return actionId;
     }
 
+    /**
+     * @brief Open a submission inbox for a producer thread
+     * @param idReserve Number of IDs the inbox can hand out between two updates
+     * @param mergeOnUpdate Whether update() merges the inbox, otherwise only
+     *        mergeInboxes() does
+     * @return The inbox, which lives as long as the scheduler
+     *
+     * Call it from the scheduler's thread. Give each producer thread its own
+     * inbox: merged actions are ordered by inbox and then by submission, which
+     * keeps the merge deterministic for a given set of submissions. Merging
+     * manually lets a caller pick the point in time at which submissions are
+     * taken in, for example a barrier between two ticks.
+     *
+     * @code
+     * auto &inbox = scheduler.openInbox();
+     * std::thread worker([&] { inbox.submit(tick + 5, npc, planRoute); });
+     * @endcode
+     */
+    Inbox &openInbox(std::size_t idReserve = 256, bool mergeOnUpdate = true) {
+        inboxes.push_back(std::unique_ptr<Inbox>(new Inbox(idReserve, mergeOnUpdate)));
+        Inbox &inbox = *inboxes.back();
+        inbox.box.refill([this] { return timers.acquire(); });
+        return inbox;
+    }
+
+    /**
+     * @brief Move submitted actions of every inbox into the queue and top up the inbox IDs
+     *
+     * update() and updateParallel() merge the inboxes opened with
+     * mergeOnUpdate first. Call this before drainDue() when draining manually.
+     */
+    void mergeInboxes() {
+        for (auto &inbox : inboxes) {
+            merge(*inbox);
+        }
+    }
+
+    /**
+     * @brief Schedule a batch of actions at once
+     * @tparam It Forward iterator over ScheduledAction
+     * @param first Iterator to the first action, actions are moved from
+     * @param last Iterator past the last action
+     * @return The contiguous range of IDs given to the actions, in input order
+     *
+     * Reserves room for the whole batch, hands out its IDs as one block and
+     * restores the queue order once, instead of paying for each insertion
+     * separately.
+     *
+     * @code
+     * std::vector<ScheduledAction> wave;
+     * for (auto mob : mobs) {
+     *     wave.push_back(ScheduledAction{0, currentTick + 1, mob, think});
+     * }
+     * IdRange<ActionID> ids = scheduler.scheduleBulk(wave.begin(), wave.end());
+     * @endcode
+     */
+    template <typename It> IdRange<ActionID> scheduleBulk(It first, It last) {
+        SCHEDULER_ALLOCATION_SCOPE("Scheduler::scheduleBulk");
+        return timers.insertBulk(first, last, [this](ScheduledAction &action) {
+            spread(action);
+            link(action.id, action.entity, action.tick, action.rearms());
+            if (capture) {
+                captureSchedule(action);
+            }
+            if (journal) {
+                journalSchedule(action);
+            }
+        });
+    }
+
+    /**
+     * @brief Schedule a batch of actions as one group that can be cancelled at once
+     * @tparam It Forward iterator over ScheduledAction
+     * @param first Iterator to the first action, actions are moved from
+     * @param last Iterator past the last action
+     * @return The handle of the group, or 0 if the range is empty
+     *
+     * The actions are inserted like scheduleBulk() and keep their own IDs,
+     * which can still be cancelled one by one. The group handle stays valid
+     * until its last action has run or been cancelled.
+     *
+     * @code
+     * ActionGroup burn = scheduler.scheduleGroup(hits.begin(), hits.end());
+     * // The fire is put out
+     * scheduler.cancelGroup(burn);
+     * @endcode
+     */
+    template <typename It> ActionGroup scheduleGroup(It first, It last) {
+        SCHEDULER_ALLOCATION_SCOPE("Scheduler::scheduleGroup");
+        auto count = static_cast<std::size_t>(std::distance(first, last));
+        if (count == 0) {
+            return 0;
+        }
+        ActionGroup group = groups.insert(GroupState{count});
+        timers.insertBulk(first, last, [this, group](ScheduledAction &action) {
+            spread(action);
+            link(action.id, action.entity, action.tick, action.rearms());
+            timers.get(action.id).group = group;
+            if (capture) {
+                captureSchedule(action);
+            }
+            if (journal) {
+                journalSchedule(action);
+            }
+        });
+        return group;
+    }
+
+    /**
+     * @brief Create an empty group to attach actions to as they are scheduled
+     * @param parent Group the new one is nested in, 0 for none
+     * @return The handle of the group, or 0 if the parent is no longer live
+     *
+     * A group made here works as a cancellation token: actions join it
+     * through scheduleIn() or join(), including actions scheduled at runtime
+     * by other actions and completion callbacks, and child groups nest under
+     * it. Cancelling it cancels every action of it and of its descendants at
+     * once. The group stays live, even without actions, until it is cancelled
+     * or releaseGroup() is called, and then until its last action and child
+     * group are gone.
+     *
+     * @code
+     * ActionGroup spell = scheduler.createGroup();
+     * ActionGroup channel = scheduler.createGroup(spell);
+     * scheduler.scheduleIn(channel, tick + 1, caster, channelTick);
+     * scheduler.scheduleIn(spell, tick + 10, target, explode);
+     * // The caster is interrupted
+     * scheduler.cancelGroup(spell);
+     * @endcode
+     */
+    ActionGroup createGroup(ActionGroup parent = 0) {
+        if (parent != 0 && !groups.contains(parent)) {
+            return 0;
+        }
+        GroupState state;
+        state.parent = parent;
+        state.held = true;
+        ActionGroup group = groups.insert(state);
+        if (parent != 0) {
+            GroupState &up = groups.get(parent);
+            groups.get(group).next = up.child;
+            if (up.child != 0) {
+                groups.get(up.child).prev = group;
+            }
+            up.child = group;
+        }
+        return group;
+    }
+
+    /**
+     * @brief Let a group made by createGroup() go once it has no actions or child groups left
+     * @param group The handle returned by createGroup()
+     * @return true if the group was live and held
+     *
+     * Its pending actions are not affected. No action can join the group
+     * after it is gone.
+     */
+    bool releaseGroup(ActionGroup group) {
+        GroupState *state = groups.find(group);
+        if (state == nullptr || !state->held) {
+            return false;
+        }
+        state->held = false;
+        collapse(group);
+        return true;
+    }
+
+    /**
+     * @brief Schedule an action as part of a group
+     * @param group A live group, usually made by createGroup()
+     * @param tick The tick at which to execute the action
+     * @param entity The entity on which to perform the action
+     * @param action The action to perform
+     * @param onComplete Optional callback to execute after the action completes
+     * @return The ID of the scheduled action, or 0 if the group is no longer live
+     */
+    ActionID scheduleIn(ActionGroup group, int tick, entt::entity entity, ActionFunction action,
+                        CompletionFunction onComplete = nullptr) {
+        if (!groups.contains(group)) {
+            return 0;
+        }
+        ActionID id = schedule(tick, entity, std::move(action), std::move(onComplete));
+        join(id, group);
+        return id;
+    }
+
+    /**
+     * @brief Move a pending action into a group
+     * @param id The ID of the action, scheduled in any way
+     * @param group A live group
+     * @return true if the action now belongs to the group
+     *
+     * For periodic actions, chains and bulk schedules, which have no
+     * scheduleIn() of their own. The action leaves the group it was in.
+     * Actions waiting in an inbox cannot join a group until merged.
+     */
+    bool join(ActionID id, ActionGroup group) {
+        ActionSlot *slot = timers.find(id);
+        GroupState *state = groups.find(group);
+        if (slot == nullptr || state == nullptr || slot->handle == inboxed || lapsed(*slot)) {
+            return false;
+        }
+        if (slot->group == group) {
+            return true;
+        }
+        ++state->pending;
+        ActionGroup previous = slot->group;
+        slot->group = group;
+        if (previous != 0) {
+            leaveGroup(previous);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Cancel every pending action of a group and of its nested groups in O(1)
+     * @param group The handle returned by scheduleGroup() or createGroup()
+     * @return true if the group was live, its actions are now cancelled
+     *
+     * Only the group handles are released right away, one per nested group.
+     * The actions are no longer pending and never run, but leave the queue
+     * lazily: when their tick is drained, or when cancelAll() reaches their
+     * entity. Group cancellations are not written to an attached
+     * WorkloadCapture.
+     */
+    bool cancelGroup(ActionGroup group) {
+        GroupState *root = groups.find(group);
+        if (root == nullptr) {
+            return false;
+        }
+        ActionGroup parent = root->parent;
+        if (parent != 0) {
+            unlink(group);
+            root->parent = 0;
+        }
+        // Erases the subtree children first, without a stack: a group is
+        // erased once its last child is, then its next sibling is visited
+        std::size_t cancelled = 0;
+        for (ActionGroup at = group;;) {
+            GroupState &state = groups.get(at);
+            if (state.child != 0) {
+                at = state.child;
+                continue;
+            }
+            cancelled += state.pending;
+            ActionGroup next = state.next;
+            ActionGroup up = state.parent;
+            groups.erase(at);
+            if (at == group) {
+                break;
+            }
+            if (next != 0) {
+                at = next;
+            } else {
+                groups.get(up).child = 0;
+                at = up;
+            }
+        }
+        lapsedCount += cancelled;
+        if (stats) {
+            stats->recordCancel(cancelled);
+        }
+        if (parent != 0) {
+            collapse(parent);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Get the number of pending actions of a group
+     * @param group The handle returned by scheduleGroup() or createGroup()
+     * @return The number of actions of the group that have neither run nor been cancelled,
+     * not counting those of its nested groups
+     */
+    std::size_t groupPendingCount(ActionGroup group) const {
+        const GroupState *state = groups.find(group);
+        return state == nullptr ? 0 : state->pending;
+    }
+
     /**
      * @brief Convenience method to create and schedule an action
      * @param tick The tick at which to execute the action
@@ -125,7 +695,7 @@ class Scheduler {
      *     auto &health = r.get<Health>(e);
      *     health.value -= 10;
      *   },
-     *   [](ActionID id, entt::entity e, entt::registry &r, entt::dispatcher &d) {
+     *   [](ActionID id, entt::entity e, entt::registry &r, EventDispatcher &d) {
      *     // Check if entity died from the damage
      *     if (r.get<Health>(e).value <= 0) {
      *       d.enqueue<GameEvents::EntityDiedEvent>(e);
@@ -134,91 +704,2009 @@ class Scheduler {
      * );
      * @endcode
      */
-    ActionID
-    schedule(int tick, entt::entity entity,
-             std::function<void(entt::entity, entt::registry &)> action,
-             std::function<void(ActionID, entt::entity, entt::registry &, entt::dispatcher &)>
-                 onComplete = nullptr) {
-        ScheduledAction scheduledAction{0, tick, entity, std::move(action), std::move(onComplete)};
-        return schedule(scheduledAction);
+    ActionID schedule(int tick, entt::entity entity, ActionFunction action,
+                      CompletionFunction onComplete = nullptr) {
+        return schedule(
+            ScheduledAction{0, tick, entity, std::move(action), std::move(onComplete)});
     }
 
     /**
-     * @brief Cancel a scheduled action
-     * @param id The ID of the action to cancel
-     * @return true if the action was found and cancelled, false otherwise
+     * @brief Registers a handler in the scheduler's handler table
+     * @tparam Payload Trivially copyable argument of the handler
+     * @tparam Fn The handler
+     * @param id ID to register it under; defaults to one derived from Fn
+     * @return The ID, to pass to schedule()
+     *
+     * Handler actions carry a function pointer and their payload inline,
+     * with no closure, and can be saved, journaled and routed. Pass
+     * handlers() to SchedulerSnapshotLoader, SchedulerJournalLoader or
+     * RoutedScheduler to restore them.
      *
-     * Note: This only marks the action as inactive; it will be skipped when
-     * its turn comes up in the action queue.
+     * @code
+     * entt::id_type poison = scheduler.registerHandler<Poison, &poison>("poison"_hs);
+     * scheduler.schedule(tick + 30, target, poison, Poison{5});
+     * @endcode
      */
-    bool cancel(ActionID id) {
-        if (activeActions.find(id) != activeActions.end()) {
-            // We can't remove from the priority queue directly, so we mark it as
-            // inactive
-            activeActions.erase(id);
-            return true;
-        }
-        return false;
+    template <typename Payload, void (*Fn)(entt::entity, entt::registry &, const Payload &)>
+    entt::id_type registerHandler(entt::id_type id = ActionHandlers::defaultId<Payload, Fn>()) {
+        handlerTable.add<Payload, Fn>(id);
+        return id;
     }
 
+    /// @brief Gets the handlers registered with registerHandler()
+    const ActionHandlers &handlers() const { return handlerTable; }
+
     /**
-     * @brief Process all actions scheduled up to the given tick
-     * @param current_tick The current system tick
-     * @param registry The EnTT registry for component access
-     * @param dispatcher The EnTT event dispatcher for emitting events
+     * @brief Schedules a call of a registered handler
+     * @param tick The tick at which to run the handler
+     * @param entity The entity passed to the handler
+     * @param handler ID returned by registerHandler()
+     * @param payload Argument of the handler, copied into the action
+     * @return The ID of the scheduled action
+     * @throws std::out_of_range if no handler taking Payload is registered under handler
+     */
+    template <typename Payload>
+    ActionID schedule(int tick, entt::entity entity, entt::id_type handler,
+                      const Payload &payload) {
+        return schedule(tick, entity, handlerTable.bind(handler, payload));
+    }
+
+    /**
+     * @brief Convenience method to schedule an action that declares its component access
+     * @param tick The tick at which to execute the action
+     * @param entity The entity on which to perform the action
+     * @param access The components the action reads and writes
+     * @param action The function to execute on the entity
+     * @param onComplete Optional callback when the action completes
+     * @return The ID of the scheduled action
      *
-     * This method executes all actions that are due at or before the current tick.
-     * For each action:
-     * 1. Checks if the action is still active (not cancelled)
-     * 2. Verifies that the target entity still exists
-     * 3. Executes the main action function
-     * 4. Dispatches a standard completion event
-     * 5. Calls the custom onComplete callback if provided
-     */
-    void update(int current_tick, entt::registry &registry, entt::dispatcher &dispatcher) {
-        while (!queue.empty() && queue.top().tick <= current_tick) {
-            ScheduledAction action = queue.top();
-            queue.pop();
-
-            // Skip if the action was cancelled
-            if (activeActions.find(action.id) == activeActions.end()) {
-                continue;
-            }
+     * Declaring the access only matters to updateParallel(); update() runs the
+     * action exactly like any other.
+     */
+    ActionID schedule(int tick, entt::entity entity, const ActionAccess &access,
+                      ActionFunction action, CompletionFunction onComplete = nullptr) {
+        ScheduledAction scheduled{0, tick, entity, std::move(action), std::move(onComplete)};
+        scheduled.access = &access;
+        return schedule(std::move(scheduled));
+    }
 
-            // Execute the action if the entity is still valid
-            if (registry.valid(action.entity)) {
-                // Execute main action
-                action.action(action.entity, registry);
+    /**
+     * @brief Schedule an action that repeats at a fixed interval
+     * @param firstTick The tick of the first run
+     * @param interval Ticks between two runs, must be positive
+     * @param count Total number of runs, or ScheduledAction::forever
+     * @param entity The entity on which to perform the action
+     * @param action The function to execute on each run
+     * @param onComplete Optional callback after each run
+     * @return The ID of the periodic action, shared by all of its runs
+     *
+     * The action occupies a single queue entry that is re-armed in place after
+     * each run, instead of one entry per occurrence. Cancelling the returned ID
+     * stops every remaining run. A periodic action stops when its entity is
+     * destroyed. If update() is called past several due runs, each of them runs
+     * in order within that update.
+     *
+     * @code
+     * // Aura ticking once per second (60 ticks) until cancelled
+     * ActionID aura = scheduler.schedulePeriodic(currentTick + 60, 60,
+     *     ScheduledAction::forever, player, [](entt::entity e, entt::registry &r) {
+     *         r.get<Health>(e).current += 1;
+     *     });
+     * @endcode
+     */
+    ActionID schedulePeriodic(int firstTick, int interval, int count, entt::entity entity,
+                              ActionFunction action, CompletionFunction onComplete = nullptr) {
+        if (count == 0) {
+            return 0;
+        }
+        ScheduledAction periodic{0, firstTick, entity, std::move(action), std::move(onComplete)};
+        periodic.interval = interval > 0 ? interval : 0;
+        periodic.repeats = count == ScheduledAction::forever ? ScheduledAction::forever : count - 1;
+        return schedule(std::move(periodic));
+    }
 
-                // Trigger standard completion event
-                dispatcher.enqueue<GameEvents::ActionCompletedEvent>(action.id, action.entity);
+    /**
+     * @brief Schedule an action that may run up to some ticks late, to spread load
+     * @param tick The earliest tick at which to run the action
+     * @param slack Ticks the action may be delayed by
+     * @param entity The entity on which to perform the action
+     * @param action The function to execute on the entity
+     * @param onComplete Optional callback when the action completes
+     * @return The ID of the scheduled action
+     *
+     * Once enableSpreading() was called, the action is placed at the tick of
+     * [tick, tick + slack] with the fewest pending actions. Without it, the
+     * action runs at tick. Set ScheduledAction::slack for other ways of
+     * scheduling, such as scheduleBulk() and scheduleGroup().
+     */
+    ActionID scheduleSpread(int tick, int slack, entt::entity entity, ActionFunction action,
+                            CompletionFunction onComplete = nullptr) {
+        ScheduledAction scheduled{0, tick, entity, std::move(action), std::move(onComplete)};
+        scheduled.slack = slack;
+        return schedule(std::move(scheduled));
+    }
 
-                // Call custom onComplete if provided
-                if (action.onComplete) {
-                    action.onComplete(action.id, action.entity, registry, dispatcher);
-                }
+    /**
+     * @brief Spread actions with slack over the least loaded ticks of their window
+     * @param options The load window and whether periodic actions are spread too
+     *
+     * Raid-wide buffs, respawn waves and periodic actions started on the same
+     * tick otherwise line up on the same ticks forever. From this call on,
+     * the scheduler counts pending actions per tick, and places each new
+     * action whose ScheduledAction::slack is positive at the tick of
+     * [tick, tick + slack] with the fewest of them, the earliest on ties. A
+     * periodic action keeps the phase it was placed at, so spreading its
+     * first run spreads all of them; with SpreadOptions::phasePeriodic, a
+     * periodic action without slack gets a slack of one interval less one.
+     * Actions already pending are counted but not moved. Ticks a window
+     * apart share a count, so keep slack well below the window.
+     *
+     * @code
+     * scheduler.enableSpreading();
+     * for (auto player : raid) {
+     *     scheduler.scheduleSpread(tick + 30, 10, player, refreshBuff); // Over 11 ticks
+     * }
+     * @endcode
+     */
+    void enableSpreading(const SpreadOptions &options = {}) {
+        std::size_t window = 1;
+        while (window < options.window && window < (std::size_t{1} << 24)) {
+            window *= 2;
+        }
+        spreadOptions = options;
+        tickLoad.assign(window, 0u);
+        timers.forEach([this](const ScheduledAction &action) { ++loadOf(action.tick); });
+        for (const ScheduledAction &action : drained) {
+            if (unsettled(action)) {
+                ++loadOf(timers.get(action.id).tick);
             }
+        }
+    }
 
-            // Remove from active actions
-            activeActions.erase(action.id);
+    /**
+     * @brief Schedule a sequence of steps that queue each other one at a time
+     * @param startTick Tick the first step's delay counts from
+     * @param entity The entity to run the steps on
+     * @param steps The steps, each with its delay after the previous one
+     * @param onComplete Optional callback run after every step
+     * @return The ID of the chain, or 0 if steps is empty
+     *
+     * Only the current step is queued. It queues its successor once it has
+     * run, under the same ID, so cancel() drops whatever is left of the chain
+     * in O(1) and the queue holds a single node however long the chain is.
+     * Delays count from the tick the previous step was scheduled for; negative
+     * delays are treated as 0.
+     *
+     * @code
+     * std::vector<ChainStep> phases;
+     * phases.push_back({0, enrage});
+     * phases.push_back({120, summonAdds});
+     * phases.push_back({300, finalPhase});
+     * ActionID fight = scheduler.scheduleChain(currentTick, boss, std::move(phases));
+     * // ...
+     * scheduler.cancel(fight); // stops the phases that have not run yet
+     * @endcode
+     */
+    ActionID scheduleChain(int startTick, entt::entity entity, std::vector<ChainStep> steps,
+                           CompletionFunction onComplete = nullptr) {
+        if (steps.empty()) {
+            return 0;
+        }
+        for (ChainStep &step : steps) {
+            step.delay = step.delay > 0 ? step.delay : 0;
         }
+        ScheduledAction head{0, startTick + steps.front().delay, entity,
+                             std::move(steps.front().action), std::move(onComplete)};
+        head.chain = std::make_unique<ActionChain>(ActionChain{std::move(steps), 1});
+        return schedule(std::move(head));
     }
 
+#ifdef SCHEDULER_HAS_COROUTINES
     /**
-     * @brief Clear all pending actions
+     * @brief Start a coroutine as a sequence of actions of an entity
+     * @param tick Tick at which the coroutine starts running
+     * @param entity The entity the coroutine runs for
+     * @param task The coroutine, which must not have been spawned before
+     * @return The ID of the coroutine's first step
      *
-     * This removes all scheduled actions from the queue and active list.
-     * Useful when transitioning between game states or resetting the system.
+     * Every later step gets its own ID when the coroutine suspends; use
+     * cancelAll() to stop a suspended coroutine.
+     *
+     * @code
+     * ActionTask blink(Scheduler &scheduler, entt::entity lamp) {
+     *     for (;;) {
+     *         entt::registry &registry = co_await scheduler.delay(30);
+     *         registry.get<Light>(lamp).on ^= true;
+     *     }
+     * }
+     * scheduler.spawn(currentTick, lamp, blink(scheduler, lamp));
+     * @endcode
      */
-    void clear() {
-        // Clear the queue - we have to rebuild it
-        std::priority_queue<ScheduledAction> empty;
-        std::swap(queue, empty);
-        activeActions.clear();
+    ActionID spawn(int tick, entt::entity entity, ActionTask task) {
+        return schedule(tick, entity, task.start(entity, tick));
     }
 
-  private:
-    std::priority_queue<ScheduledAction> queue; ///< Queue of pending actions, ordered by tick
-    std::unordered_set<ActionID> activeActions; ///< Set of active action IDs
-    ActionID nextActionId;                      ///< Next available action ID
-};
+    /// @brief Awaitable suspending an ActionTask for a number of ticks after the current step
+    TickAwaiter<BasicScheduler> delay(int ticks) {
+        return TickAwaiter<BasicScheduler>(*this, ticks, true);
+    }
+
+    /// @brief Awaitable suspending an ActionTask until a tick, no-op if it has been reached
+    TickAwaiter<BasicScheduler> untilTick(int tick) {
+        return TickAwaiter<BasicScheduler>(*this, tick, false);
+    }
+#endif
+
+    /**
+     * @brief Cancel a scheduled action
+     * @param id The ID of the action to cancel
+     * @return true if the action was found and cancelled, false otherwise
+     *
+     * The action is removed from the queue right away. Cancelling a one-shot
+     * action that has already started executing has no effect and returns
+     * false. Cancelling a periodic action from inside one of its own runs
+     * prevents it from being re-armed.
+     */
+    bool cancel(ActionID id) {
+        const ActionSlot *slot = timers.find(id);
+        if (slot == nullptr) {
+            return false;
+        }
+        if (lapsed(*slot)) {
+            // Its group was cancelled, so only the cleanup cancelGroup() deferred is left
+            timers.dequeue(id);
+            retire(id);
+            return false;
+        }
+        if (board != nullptr && board->cancelled(id) && timers.dequeue(id)) {
+            // Cancelled by another thread and still queued, so only the cleanup is left
+            dropCancelled(id);
+            return false;
+        }
+        recordCancel(id);
+        if (slot->handle == inboxed) {
+            // Submitted through an inbox and not merged yet, so not linked either
+            timers.release(id);
+            return true;
+        }
+        timers.dequeue(id);
+        retire(id);
+        return true;
+    }
+
+    /**
+     * @brief Let other threads cancel actions with cancelFromAnyThread()
+     *
+     * Call it from the scheduler's thread, before handing IDs to other
+     * threads. From then on every action gets an atomic state word, which
+     * update() claims with a compare-and-swap right before the action runs.
+     */
+    void enableConcurrentCancel() {
+        if (board != nullptr) {
+            return;
+        }
+        board = std::make_unique<ActionStateBoard<ActionID>>();
+        timers.forEach([this](const ScheduledAction &action) {
+            board->publish(action.id, action.rearms());
+        });
+        for (const ScheduledAction &action : drained) {
+            if (unsettled(action)) {
+                board->publish(action.id, action.rearms());
+            }
+        }
+    }
+
+    /**
+     * @brief Cancel an action from any thread, concurrently with update()
+     * @param id The ID of the action to cancel
+     * @return true if the action will not run again, false if it was not
+     *         pending, or is a one-shot action already running
+     *
+     * Needs enableConcurrentCancel(), and returns false without it. Only the
+     * action's state word changes: the action stays in the queue, and in
+     * pendingCount(), until update() reaches it and drops it without running
+     * it, or until cancel() is called for it on the scheduler's thread.
+     * Actions submitted through an inbox can be cancelled once merged. Must
+     * not run concurrently with clear().
+     *
+     * @code
+     * scheduler.enableConcurrentCancel();
+     * // On the network thread
+     * if (packet.type == Packet::interruptCast) {
+     *     scheduler.cancelFromAnyThread(packet.actionId);
+     * }
+     * @endcode
+     */
+    bool cancelFromAnyThread(ActionID id) const { return board != nullptr && board->cancel(id); }
+
+    /**
+     * @brief Move a pending action to another tick, keeping its ID
+     * @param id The ID of the action
+     * @param tick The tick at which the action now runs
+     * @return true if the action was queued and has been moved
+     *
+     * For haste, slow and pushback effects. The action is moved within the
+     * queue without being copied, so its ID stays valid. Among actions of the
+     * new tick it runs last, as if it had just been scheduled. A periodic
+     * action keeps its interval from the new tick on. An action that is
+     * running, waiting in an inbox, or whose group was cancelled cannot be
+     * moved.
+     */
+    bool reschedule(ActionID id, int tick) {
+        ActionSlot *slot = timers.find(id);
+        if (slot == nullptr || lapsed(*slot) || (board != nullptr && board->cancelled(id))) {
+            return false;
+        }
+        bool moved = timers.modify(id, [this, tick](ScheduledAction &action) {
+            if (capture) {
+                captureCall(WorkloadRecord::Kind::cancel, 0, action.id);
+            }
+            action.tick = tick;
+            if (capture) {
+                captureSchedule(action);
+            }
+            if (journal) {
+                // Replayed as a cancel of the old record followed by the new one
+                JournalRecord record;
+                record.kind = JournalRecord::Kind::cancel;
+                record.id = action.id;
+                journal->record(record);
+                journalSchedule(action);
+            }
+        });
+        if (!moved) {
+            return false;
+        }
+        moveTick(*slot, id, tick);
+        if (tracked != nullptr) {
+            refreshPending(slot->entity);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Cancel every pending action of an entity
+     * @param entity The entity whose actions to cancel
+     * @return The number of actions that were cancelled
+     *
+     * Walks the per-entity index, so the cost is proportional to the number
+     * of actions of that entity rather than to the size of the queue.
+     */
+    std::size_t cancelAll(entt::entity entity) {
+        auto it = entityIndex.find(entity);
+        if (it == entityIndex.end()) {
+            return 0;
+        }
+        std::size_t cancelled = 0;
+        ActionID id = it->second.head;
+        while (id != 0) {
+            ActionID next = timers.get(id).next;
+            cancelled += cancel(id) ? 1 : 0;
+            id = next;
+        }
+        return cancelled;
+    }
+
+    /**
+     * @brief Get the number of pending actions
+     * @return The number of scheduled actions that have neither run nor been cancelled
+     *
+     * Actions still waiting in an inbox are not counted.
+     */
+    std::size_t pendingCount() const {
+        std::size_t count = timers.size();
+        for (const ScheduledAction &action : drained) {
+            count += unsettled(action) ? 1 : 0;
+        }
+        return count - lapsedCount;
+    }
+
+    /**
+     * @brief Get the tick of the earliest pending action
+     * @return The earliest due tick, or nothing if no action is pending
+     *
+     * Cancelled actions are never counted. A host loop can sleep until this
+     * tick instead of calling update() on every idle tick. Actions still
+     * waiting in an inbox are not considered.
+     */
+    std::optional<int> nextDueTick() const {
+        std::optional<int> next = timers.nextTick();
+        if (interrupted) {
+            // The rest of an interrupted tick is due before anything queued after it
+            for (std::size_t i = resumeAt; i < drained.size(); ++i) {
+                if (unsettled(drained[i])) {
+                    return next && *next < drained[i].tick ? *next : drained[i].tick;
+                }
+            }
+        }
+        return next;
+    }
+
+    /**
+     * @brief Process every action due up to a tick, skipping the idle ticks in between
+     * @param targetTick The tick to catch up to
+     * @param registry The EnTT registry for component access
+     * @param dispatcher The EnTT event dispatcher for emitting events
+     * @return The number of ticks at which actions ran
+     *
+     * Calls update() once for each tick that has due actions, in tick order,
+     * so the result is the same as updating every tick up to targetTick while
+     * idle stretches cost nothing.
+     */
+    std::size_t advanceTo(int targetTick, entt::registry &registry, EventDispatcher &dispatcher) {
+        mergeAutomatic();
+        std::size_t ticks = 0;
+        for (std::optional<int> next = nextDueTick(); next && *next <= targetTick;
+             next = nextDueTick()) {
+            update(*next, registry, dispatcher);
+            ++ticks;
+        }
+        return ticks;
+    }
+
+    /**
+     * @brief Run every action due in a stretch of missed ticks in one pass
+     * @param fromTick The first missed tick; actions due earlier run at it
+     * @param toTick The last missed tick, usually the current one
+     * @param registry The EnTT registry for component access
+     * @param dispatcher The EnTT event dispatcher, updated as options say
+     * @param options Whether to flush the dispatcher per tick and to collapse periodic actions
+     * @return The number of ticks at which actions ran
+     *
+     * Runs the actions in the same tick order as calling update() for every
+     * tick of [fromTick, toTick], but visits only the ticks that have due
+     * actions and looks up the listeners once. Unlike update(), it also
+     * updates the dispatcher: after each such tick with flushPerTick, once at
+     * the end otherwise, and an ActionsCompletedEvent is enqueued per tick.
+     *
+     * With collapsePeriodic, a periodic action with several runs due by
+     * toTick runs only once, at the last of them, and missedRuns() tells it
+     * how many runs it skipped. Chains are never collapsed.
+     *
+     * @code
+     * // After a 200 ms stall at 60 ticks per second
+     * scheduler.catchUp(lastTick + 1, tick, registry, dispatcher,
+     *                   CatchUpOptions{false, true});
+     * @endcode
+     */
+    std::size_t catchUp(int fromTick, int toTick, entt::registry &registry,
+                        EventDispatcher &dispatcher, const CatchUpOptions &options = {}) {
+        SCHEDULER_ALLOCATION_SCOPE("Scheduler::catchUp");
+        mergeAutomatic();
+        beginReport(dispatcher);
+        if (stats) {
+            stats->beginUpdate(timers.size());
+        }
+        std::size_t ticks = 0;
+        for (std::optional<int> next = nextDueTick(); next && *next <= toTick;
+             next = nextDueTick()) {
+            int tick = std::max(*next, fromTick);
+            if (capture) {
+                captureCall(WorkloadRecord::Kind::update, tick, 0);
+            }
+            bool ran = false;
+            for (ScheduledAction &action : drainDue(tick)) {
+                if (!timers.contains(action.id) || dropLapsed(action.id)) {
+                    if (stats) {
+                        stats->recordSkip();
+                    }
+                    continue;
+                }
+                if (options.collapsePeriodic && postpone(action, toTick)) {
+                    continue;
+                }
+                auto skipped = missed.find(action.id);
+                if (skipped != missed.end()) {
+                    missedCount = skipped->second;
+                    missed.erase(skipped);
+                }
+                if (observed()) {
+                    executeObserved(action, tick, registry, dispatcher);
+                } else {
+                    execute(action, registry, dispatcher);
+                }
+                missedCount = 0;
+                ran = true;
+            }
+            endReport(tick, dispatcher);
+            if (ran) {
+                ++ticks;
+                if (options.flushPerTick) {
+                    dispatcher.update();
+                }
+            }
+        }
+        // Collapsed actions cancelled before their last run leave entries behind
+        missed.clear();
+        if (stats) {
+            stats->endUpdate(timers.size());
+        }
+        if (!options.flushPerTick) {
+            dispatcher.update();
+        }
+        return ticks;
+    }
+
+    /**
+     * @brief Get the number of runs the running periodic action skipped
+     * @return The runs collapsed into this one by catchUp(), 0 outside of it
+     */
+    int missedRuns() const { return missedCount; }
+
+    /**
+     * @brief Get the number of pending actions of an entity
+     * @param entity The entity to query
+     * @return The number of actions targeting the entity that have not run yet
+     *
+     * Actions of a cancelled group are counted until they leave the queue.
+     */
+    std::size_t pendingCount(entt::entity entity) const {
+        auto it = entityIndex.find(entity);
+        return it == entityIndex.end() ? 0 : it->second.count;
+    }
+
+    /**
+     * @brief Cancel actions of entities as soon as they are destroyed
+     * @param registry The registry whose entity destruction to observe
+     *
+     * Hooks registry.on_destroy<entt::entity>() so destroyed entities release
+     * their pending actions right away, instead of leaving them queued until
+     * update() finds the entity invalid. Call disconnect() before either the
+     * registry or the scheduler goes away.
+     */
+    void connect(entt::registry &registry) {
+        registry.on_destroy<entt::entity>().template connect<&BasicScheduler::onDestroyed>(*this);
+    }
+
+    /**
+     * @brief Stop observing entity destruction in a registry
+     * @param registry A registry previously passed to connect()
+     */
+    void disconnect(entt::registry &registry) {
+        registry.on_destroy<entt::entity>().disconnect(this);
+    }
+
+    /**
+     * @brief Keep a PendingActions component on every entity with pending actions
+     * @param registry The registry holding the entities, or nullptr to stop
+     *
+     * Entities that already have pending actions get their component right
+     * away. From then on the component is added, updated and removed as
+     * actions are scheduled, run, re-armed and cancelled, so systems can use
+     * views and groups of busy entities and read an entity's next due tick in
+     * O(1). Stopping removes every PendingActions component of the registry.
+     *
+     * @code
+     * scheduler.trackPending(&registry);
+     * // AI only thinks for idle entities
+     * for (auto npc : registry.view<Brain>(entt::exclude<PendingActions>)) { think(npc); }
+     * @endcode
+     */
+    void trackPending(entt::registry *registry) {
+        if (tracked != nullptr) {
+            tracked->clear<PendingActions>();
+        }
+        tracked = registry;
+        if (tracked == nullptr) {
+            return;
+        }
+        for (const auto &[entity, index] : entityIndex) {
+            if (tracked->valid(entity)) {
+                tracked->emplace<PendingActions>(entity, 0u, 0);
+                refreshPending(entity);
+            }
+        }
+    }
+
+    /**
+     * @brief Choose how completed actions are reported
+     * @param report The reporting mode, CompletionReport::perAction by default
+     *
+     * Listeners are looked up once at the start of each update, so a listener
+     * connected from inside an action only sees the completions of later
+     * updates. onComplete callbacks run in every mode.
+     *
+     * @code
+     * scheduler.setCompletionReport(CompletionReport::batched);
+     * dispatcher.sink<GameEvents::ActionsCompletedEvent>().connect<&onTickDone>();
+     * @endcode
+     */
+    void setCompletionReport(CompletionReport report) { completionReport = report; }
+
+    /// @brief Get the way completed actions are reported
+    CompletionReport getCompletionReport() const { return completionReport; }
+
+    /**
+     * @brief Attach statistics that later updates fill in
+     * @param target The statistics, or nullptr to stop recording
+     *
+     * The scheduler does not own the statistics, which must outlive it or be
+     * detached first. Sequential updates time every action; updateParallel()
+     * records lateness only, since its actions share one wall-clock span.
+     */
+    void setStats(SchedulerStats *target) { stats = target; }
+
+    /// @brief Copy the attached statistics, from any thread; empty if none are attached
+    StatsSnapshot snapshotStats() const { return stats ? stats->snapshot() : StatsSnapshot{}; }
+
+    /**
+     * @brief Attach a trace that records the start and end of every action run
+     * @param target The trace, or nullptr to stop tracing
+     *
+     * Each thread running actions writes to its own buffer of the trace:
+     * the calling thread in update(), the workers in updateParallel(). Actions
+     * are recorded with their ID, entity and due tick.
+     */
+    void setTrace(SchedulerTrace *target) { trace = target; }
+
+    /**
+     * @brief Attach a watchdog that attributes sampled run times to handlers
+     * @param target The watchdog, or nullptr to stop sampling
+     *
+     * Handler actions are attributed to their handler ID, batched actions to
+     * their BatchCall handler and other actions to the type of their callable.
+     * Runs over the watchdog's threshold are logged with their tick and entity.
+     * See SchedulerWatchdog.h.
+     */
+    void setWatchdog(SchedulerWatchdog *target) { watchdog = target; }
+
+    /**
+     * @brief Attach a capture that logs every schedule, cancel and update call
+     * @param target The capture, or nullptr to stop capturing
+     *
+     * See WorkloadCapture.h; replay a capture with WorkloadReplay.
+     */
+    void setCapture(WorkloadCapture *target) { capture = target; }
+
+    /**
+     * @brief Attach a write-ahead log of saveable schedules and cancels
+     * @param target The journal, or nullptr to stop logging
+     *
+     * Records are buffered in the journal and written by its commit(); see
+     * SchedulerJournal.h. Actions already pending are not logged, so attach
+     * it right after recovering, or take a checkpoint.
+     */
+    void setJournal(SchedulerJournal *target) { journal = target; }
+
+    /**
+     * @brief Run the actions of each tick in the storage order of a component
+     * @tparam Component The component whose storage orders the entities,
+     *         usually the one the tick's actions touch most
+     * @param prefetch How many actions ahead update() prefetches the
+     *         component of, 0 for none
+     *
+     * Queue order is unrelated to where entities sit in their storages, so
+     * each registry.get() of an action is likely a cache miss. From now on
+     * update() stably sorts each tick's due actions by the index of their
+     * entity in the storage of Component, entities without one last, and
+     * prefetches the component of the action prefetch places ahead before
+     * running each one. Actions of the same entity keep their order, but an
+     * action may now run before one scheduled earlier on another entity, so
+     * only enable it when the actions of a tick do not depend on each other.
+     * Other ways of running actions keep queue order.
+     *
+     * @code
+     * scheduler.orderByEntity<Health>();
+     * @endcode
+     */
+    template <typename Component> void orderByEntity(std::size_t prefetch = 4) {
+        entityOrder = EntityOrder{&hintStorage<std::remove_const_t<Component>>,
+                                  &prefetchRow<std::remove_const_t<Component>>, prefetch};
+    }
+
+    /// @brief Go back to running the actions of each tick in queue order
+    void clearEntityOrder() { entityOrder = EntityOrder{}; }
+
+    /**
+     * @brief Schedule an action whose handler runs once per batch of due entities
+     * @param tick The tick at which to execute the action
+     * @param entity The entity passed to the handler, with the rest of its batch
+     * @param handler The batch handler
+     * @param onComplete Optional callback run after the batch the action ran in
+     * @return The ID of the scheduled action
+     *
+     * Same as scheduling BatchCall{handler}; see setBatching().
+     *
+     * @code
+     * void regen(EntitySpan entities, entt::registry &registry) {
+     *     auto &health = registry.storage<Health>();
+     *     for (entt::entity entity : entities) {
+     *         health.get(entity).current += 1;
+     *     }
+     * }
+     * for (entt::entity npc : npcs) {
+     *     scheduler.scheduleBatched(tick + 10, npc, &regen);
+     * }
+     * @endcode
+     */
+    ActionID scheduleBatched(int tick, entt::entity entity, BatchFunction handler,
+                             CompletionFunction onComplete = nullptr) {
+        return schedule(tick, entity, BatchCall{handler}, std::move(onComplete));
+    }
+
+    /**
+     * @brief Choose how update() gathers due BatchCall actions into batches
+     * @param grouping Which actions of the same handler share a batch, adjacent by default
+     * @param maxBatch Most actions per batch, at least 1; 1024 by default
+     *
+     * A batch runs its handler once with the entities of its actions that
+     * are still valid, then reports each action and runs its onComplete and
+     * re-arming, in batch order. An action cancelled by another action of its
+     * own batch, or by an onComplete of it, has already run. With
+     * BatchGrouping::tick, actions of a handler run together at the place of
+     * its first due action, ahead of unrelated actions queued between them,
+     * so only use it for handlers that do not depend on those actions. An
+     * item budget counts each action of a batch; a time budget is checked
+     * between batches. updateParallel() runs batch actions one at a time.
+     */
+    void setBatching(BatchGrouping grouping, std::size_t maxBatch = 1024) {
+        batching = grouping;
+        batchLimit = maxBatch < 1 ? 1 : maxBatch;
+    }
+
+    /**
+     * @brief Checks whether an action is still waiting to run
+     * @param id The ID of the action
+     * @return true if the action is queued and has not been cancelled
+     */
+    bool isPending(ActionID id) const {
+        const ActionSlot *slot = timers.find(id);
+        return slot != nullptr && !lapsed(*slot) && (board == nullptr || !board->cancelled(id));
+    }
+
+    /**
+     * @brief Visit every queued action
+     * @param fn Called with a const reference to each queued ScheduledAction, in no particular order
+     *
+     * Actions still waiting in an inbox, or handed out by drainDue() and not
+     * settled yet, are not visited.
+     */
+    template <typename F> void forEachPending(F &&fn) const { timers.forEach(fn); }
+
+    /**
+     * @brief Gets an order-independent hash of the pending actions
+     * @return The sum of a hash of each pending action's ID, entity and tick; 0 when none is pending
+     *
+     * Kept up to date by every schedule, cancel, reschedule and run, so
+     * reading it costs nothing. Two schedulers given the same operations
+     * have the same hash, whatever their queue backend. Actions waiting in
+     * an inbox count once merged. See StateHash.h for component storages.
+     */
+    std::uint64_t stateHash() const { return pendingHash; }
+
+    /**
+     * @brief Take the actions of the earliest due tick out of the queue
+     * @param current_tick The current system tick
+     * @return The actions due at the earliest tick at or before current_tick, in
+     *         execution order, or an empty buffer if nothing is due
+     *
+     * The caller owns execution: nothing is run, checked or dispatched. Call it
+     * until it returns an empty buffer to process every due tick in order, for
+     * example to sort a tick's actions by entity before running them.
+     *
+     * The buffer belongs to the scheduler and is recycled by the next call to
+     * drainDue(), update() or updateParallel(), so steady state allocates
+     * nothing. If a budgeted update() ran out of budget in the middle of a tick,
+     * the next call returns the rest of that tick. Until then the drained actions stay pending: cancel() still
+     * succeeds on them, and the caller should skip actions whose ID is no
+     * longer pending. Recycling re-arms the periodic actions that are still
+     * pending and releases every other ID.
+     * Must not be called from inside a running action or callback.
+     *
+     * @code
+     * for (auto *due = &scheduler.drainDue(tick); !due->empty(); due = &scheduler.drainDue(tick)) {
+     *     for (ScheduledAction &action : *due) {
+     *         if (scheduler.isPending(action.id) && registry.valid(action.entity)) {
+     *             action.action(action.entity, registry);
+     *         }
+     *     }
+     * }
+     * @endcode
+     */
+    std::vector<ScheduledAction> &drainDue(int current_tick) {
+        if (interrupted) {
+            // Hand out what an interrupted update left of its tick first
+            settle(0, resumeAt);
+            drained.erase(drained.begin(), drained.begin() + resumeAt);
+            // Actions already run in a batch have their ID cleared
+            drained.erase(std::remove_if(drained.begin(), drained.end(),
+                                         [](const ScheduledAction &action) {
+                                             return action.id == 0;
+                                         }),
+                          drained.end());
+            interrupted = false;
+            return drained;
+        }
+        recycle();
+        ScheduledAction action{};
+        for (int limit = current_tick; timers.popDue(limit, action);) {
+            if (lapsed(timers.get(action.id))) {
+                retire(action.id);
+                continue;
+            }
+            // Later ticks, including those of re-armed actions, go to the next call
+            limit = action.tick;
+            drained.push_back(std::move(action));
+        }
+        peakDue = std::max(peakDue, drained.size());
+        return drained;
+    }
+
+    /**
+     * @brief Drops the runs of every action due up to a tick, without running them
+     * @param current_tick The current system tick
+     * @return The number of runs dropped
+     *
+     * Sheds load under overload. One-shot actions are released as if they had
+     * run; periodic actions skip to their first run after current_tick, and
+     * chains skip the dropped steps. No completion is reported and no
+     * callback runs. Must not be called from inside a running action or callback.
+     */
+    std::size_t dropDue(int current_tick) {
+        std::size_t dropped = 0;
+        for (;;) {
+            std::vector<ScheduledAction> &due = drainDue(current_tick);
+            if (due.empty()) {
+                return dropped;
+            }
+            for (const ScheduledAction &action : due) {
+                if (unsettled(action)) {
+                    ++dropped;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Keeps one due action per entity and drops the other runs due up to a tick
+     * @param current_tick The current system tick
+     * @return The number of runs dropped
+     *
+     * Of the actions of an entity due at or before current_tick, the one
+     * that would have run last stays queued at its tick, so the next update
+     * runs it first; the others are dropped as by dropDue(). Must not be
+     * called from inside a running action or callback.
+     */
+    std::size_t coalesceDue(int current_tick) {
+        std::size_t dropped = 0;
+        kept.clear();
+        keptIndex.clear();
+        for (;;) {
+            std::vector<ScheduledAction> &due = drainDue(current_tick);
+            if (due.empty()) {
+                break;
+            }
+            for (ScheduledAction &action : due) {
+                if (!unsettled(action)) {
+                    continue;
+                }
+                auto [it, added] = keptIndex.try_emplace(action.entity, kept.size());
+                if (added) {
+                    // The empty action left behind has ID 0, so it is never settled
+                    kept.push_back(std::exchange(action, ScheduledAction{}));
+                } else {
+                    // The earlier action takes its place in the buffer and is dropped with it
+                    std::swap(kept[it->second], action);
+                    ++dropped;
+                }
+            }
+        }
+        for (ScheduledAction &action : kept) {
+            timers.enqueue(std::move(action));
+        }
+        kept.clear();
+        return dropped;
+    }
+
+    /**
+     * @brief Process all actions scheduled up to the given tick
+     * @param current_tick The current system tick
+     * @param registry The EnTT registry for component access
+     * @param dispatcher The EnTT event dispatcher for emitting events
+     *
+     * This method executes all actions that are due at or before the current tick.
+     * For each action:
+     * 1. Verifies that the target entity still exists
+     * 2. Executes the main action function
+     * 3. Dispatches a standard completion event
+     * 4. Calls the custom onComplete callback if provided
+     * 5. Re-arms the action at its next tick if it is periodic
+     */
+    void update(int current_tick, entt::registry &registry, EventDispatcher &dispatcher) {
+        update(current_tick, registry, dispatcher, UpdateBudget{});
+    }
+
+    /**
+     * @brief Process actions scheduled up to the given tick within a budget
+     * @param current_tick The current system tick
+     * @param registry The EnTT registry for component access
+     * @param dispatcher The EnTT event dispatcher for emitting events
+     * @param budget Limits on the time spent and the number of actions run
+     * @return How many actions ran and how many due actions were left over
+     *
+     * Runs actions exactly like update() until the budget is used up. The rest
+     * of the due actions stay queued in order and run first on the next call,
+     * even if that call is for the same tick. The reported backlog counts the
+     * actions left in the interrupted tick; later due ticks are not counted.
+     */
+    UpdateResult update(int current_tick, entt::registry &registry, EventDispatcher &dispatcher,
+                        const UpdateBudget &budget) {
+        SCHEDULER_ALLOCATION_SCOPE("Scheduler::update");
+        mergeAutomatic();
+        beginReport(dispatcher);
+        if (capture) {
+            captureCall(WorkloadRecord::Kind::update, current_tick, 0);
+        }
+        if (stats) {
+            stats->beginUpdate(timers.size());
+        }
+        UpdateResult result = runDue(current_tick, registry, dispatcher, budget);
+        endReport(current_tick, dispatcher);
+        if (stats) {
+            stats->endUpdate(timers.size());
+        }
+        return result;
+    }
+    /**
+     * @brief Process all actions scheduled up to the given tick on a worker pool
+     * @param current_tick The current system tick
+     * @param registry The EnTT registry for component access
+     * @param dispatcher The EnTT event dispatcher for emitting events
+     * @param pool The workers that run the actions
+     *
+     * Actions due at the same tick are split into waves of actions whose
+     * declared ActionAccess does not conflict, and each wave runs on the pool.
+     * Two actions conflict when one writes a component the other reads or
+     * writes, on the same entity if both accesses are local. An action without
+     * an access descriptor runs alone, so ticks made only of undeclared actions
+     * behave exactly like update().
+     *
+     * Actions that conflict run in the order they were taken from the queue.
+     * Completion events, onComplete callbacks and periodic re-arming happen on
+     * the calling thread after each wave, in that same order, so the
+     * dispatcher receives a deterministic event sequence.
+     *
+     * While a wave runs, actions may only use the component storages they
+     * declared and must not create or destroy entities, add or remove
+     * components, or call into the scheduler. Completion callbacks have no such
+     * restriction, but a cancellation they issue only affects later waves.
+     * If an action throws, the exception is rethrown once its wave is done.
+     * The unfinished one-shot actions of that tick are dropped and the
+     * unfinished periodic ones skip to their next run.
+     */
+    void updateParallel(int current_tick, entt::registry &registry, EventDispatcher &dispatcher,
+                        TaskPool &pool) {
+        SCHEDULER_ALLOCATION_SCOPE("Scheduler::updateParallel");
+        mergeAutomatic();
+        beginReport(dispatcher);
+        if (capture) {
+            captureCall(WorkloadRecord::Kind::update, current_tick, 0);
+        }
+        if (stats) {
+            stats->beginUpdate(timers.size());
+        }
+        for (;;) {
+            std::vector<ScheduledAction> &due = drainDue(current_tick);
+            if (due.empty()) {
+                endReport(current_tick, dispatcher);
+                if (stats) {
+                    stats->endUpdate(timers.size());
+                }
+                return;
+            }
+            try {
+                for (std::size_t begin = 0; begin < due.size();) {
+                    std::size_t end = waveEnd(begin, registry);
+                    runWave(current_tick, begin, end, registry, dispatcher, pool);
+                    begin = end;
+                }
+            } catch (...) {
+                recycle();
+                throw;
+            }
+        }
+    }
+
+    /**
+     * @brief Reserve room for a number of pending actions
+     * @param expectedPending Actions expected to be pending at once
+     *
+     * Reserves the queue, the ID slots and the entity index, the latter for
+     * one action per entity, so scheduling up to expectedPending actions
+     * does not reallocate them. Use a CapacityProfile for a closer fit.
+     */
+    void reserve(std::size_t expectedPending) {
+        reserve(CapacityProfile{expectedPending, expectedPending, 0, 0});
+    }
+
+    /**
+     * @brief Reserve room for the sizes a profile records
+     * @param profile Typically capacityProfile() saved at the end of an earlier run
+     *
+     * Reserves the queue and ID slots, the entity index, the groups and the
+     * buffer each tick's due actions are drained into. Captures too large for
+     * the inline buffer come from BlockPool, which BlockPool::reserve() warms.
+     */
+    void reserve(const CapacityProfile &profile) {
+        timers.reserve(profile.pending);
+        entityIndex.reserve(profile.entities);
+        groups.reserve(profile.groups);
+        drained.reserve(profile.due);
+        reserved.merge(profile);
+    }
+
+    /**
+     * @brief Gets how large the containers reserve() sizes have grown
+     * @return The most pending actions, entities, groups and due actions held at once,
+     * or the reserved sizes if larger
+     */
+    CapacityProfile capacityProfile() const {
+        CapacityProfile profile;
+        profile.pending = timers.slotCount();
+        profile.entities = peakEntities;
+        profile.groups = groups.slotCount();
+        profile.due = peakDue;
+        profile.merge(reserved);
+        return profile;
+    }
+
+    /**
+     * @brief Clear all pending actions
+     *
+     * This removes all scheduled actions from the queue and active list.
+     * Useful when transitioning between game states or resetting the system.
+     * Actions waiting in inboxes are dropped too, so no producer may submit
+     * while clear() runs.
+     *
+     * The cost does not depend on the number of pending actions: the queue
+     * starts a new epoch, so every old ID stops being pending at once, and
+     * the old actions are destroyed as update() reaches their ticks, or all
+     * together by reclaim(). Allocated capacity is kept for the next match.
+     */
+    void clear() {
+        timers.expire();
+        if (board != nullptr) {
+            board->expire();
+        }
+        entityIndex.clear();
+        pendingHash = 0;
+        std::fill(tickLoad.begin(), tickLoad.end(), 0u);
+        if (tracked != nullptr) {
+            tracked->clear<PendingActions>();
+        }
+        groups.clear();
+        lapsedCount = 0;
+        for (auto &inbox : inboxes) {
+            inbox->box.reset();
+            inbox->box.refill([this] { return timers.acquire(); });
+        }
+    }
+
+    /**
+     * @brief Destroy the actions clear() left in the queue and release their IDs
+     * @return The number of IDs released
+     *
+     * O(n) in the ID slots; call it at a quiet moment, such as a loading
+     * screen, outside of update(). Until then the old actions hold their
+     * captures, and nextDueTick() may report one of their ticks. Captures too
+     * large for the inline buffer go back to this thread's BlockPool free
+     * lists; call BlockPool::trim() afterwards to hand them to the global
+     * allocator.
+     */
+    std::size_t reclaim() { return timers.reclaim(); }
+
+    /// @brief Gets the queue backend, for operations specific to it
+    const Queue &backend() const { return timers.backend(); }
+
+    /// @brief Gets the queue backend to tune it, such as AdaptiveQueue::setPolicy()
+    /// Actions must not be added or removed through it.
+    Queue &backend() { return timers.backend(); }
+
+  private:
+    /// Bookkeeping of a pending action, addressed by its ActionID
+    struct ActionSlot {
+        typename Queue::handle_type handle{}; ///< Queue handle, or running
+        entt::entity entity = entt::null;     ///< Target entity
+        int tick = 0;                         ///< Tick the action is queued for
+        ActionID prev = 0;                    ///< Previous action of the same entity
+        ActionID next = 0;                    ///< Next action of the same entity
+        ActionGroup group = 0;                ///< Group of the action, 0 for none
+        std::uint32_t epoch = 0;              ///< Set by the queue, see BasicTimerQueue::expire()
+    };
+
+    /// Storage and prefetch distance set by orderByEntity()
+    struct EntityOrder {
+        const entt::sparse_set *(*storage)(const entt::registry &) = nullptr;
+        void (*prefetch)(const entt::sparse_set &, entt::entity) = nullptr;
+        std::size_t distance = 0;
+    };
+
+    /// Bookkeeping of a group, addressed by its ActionGroup
+    struct GroupState {
+        std::size_t pending = 0; ///< Actions of the group not retired yet
+        ActionGroup parent = 0;  ///< Group this one is nested in
+        ActionGroup child = 0;   ///< First group nested in this one
+        ActionGroup prev = 0;    ///< Previous group nested in the same parent
+        ActionGroup next = 0;    ///< Next group nested in the same parent
+        bool held = false;       ///< Made by createGroup() and not released yet
+    };
+
+    /// Head of the intrusive list of an entity's pending actions
+    struct EntityActions {
+        ActionID head = 0;
+        std::size_t count = 0;
+    };
+
+    using Timers =
+        BasicTimerQueue<ScheduledAction, Queue, TimerNodeIds<ScheduledAction>, ActionSlot>;
+
+    template <typename Type>
+    using Rebind = typename std::allocator_traits<allocator_type>::template rebind_alloc<Type>;
+
+    using EntityAllocator = Rebind<std::pair<const entt::entity, EntityActions>>;
+    using EntityIndex = FlatMap<entt::entity, EntityActions, std::hash<entt::entity>,
+                                std::equal_to<>, EntityAllocator>;
+    using GroupAllocator = Rebind<GroupState>;
+
+    /// Marks the slot of an ID reserved by an inbox whose action is not merged yet
+    static constexpr auto inboxed = Timers::inboxed;
+
+    void link(ActionID id, entt::entity entity, int tick, bool periodic) {
+        EntityActions &index = entityIndex[entity];
+        if (index.count == 0) {
+            peakEntities = std::max(peakEntities, entityIndex.size());
+        }
+        ActionSlot &slot = timers.get(id);
+        slot.entity = entity;
+        slot.tick = tick;
+        pendingHash += entryHash(id, entity, tick);
+        if (!tickLoad.empty()) {
+            ++loadOf(tick);
+        }
+        slot.prev = 0;
+        slot.next = index.head;
+        if (index.head != 0) {
+            timers.get(index.head).prev = id;
+        }
+        index.head = id;
+        ++index.count;
+        if (tracked != nullptr && tracked->valid(entity)) {
+            auto &pending = tracked->get_or_emplace<PendingActions>(entity, 0u, tick);
+            ++pending.count;
+            pending.nextTick = std::min(pending.nextTick, tick);
+        }
+        if (board != nullptr) {
+            board->publish(id, periodic);
+        }
+    }
+
+    /// Unlinks an action from its entity and releases its ID
+    void retire(ActionID id) {
+        ActionSlot &slot = timers.get(id);
+        pendingHash -= entryHash(id, slot.entity, slot.tick);
+        if (!tickLoad.empty()) {
+            --loadOf(slot.tick);
+        }
+        if (slot.group != 0) {
+            leaveGroup(slot.group);
+        }
+        auto it = entityIndex.find(slot.entity);
+        if (slot.prev != 0) {
+            timers.get(slot.prev).next = slot.next;
+        } else {
+            it->second.head = slot.next;
+        }
+        if (slot.next != 0) {
+            timers.get(slot.next).prev = slot.prev;
+        }
+        entt::entity entity = slot.entity;
+        if (--it->second.count == 0) {
+            entityIndex.erase(it);
+        }
+        if (board != nullptr) {
+            board->retire(id);
+        }
+        timers.release(id);
+        if (tracked != nullptr) {
+            refreshPending(entity);
+        }
+    }
+
+    /// Contribution of one pending action to stateHash()
+    static std::uint64_t entryHash(ActionID id, entt::entity entity, int tick) {
+        std::uint64_t key = (std::uint64_t{id} << 32) | entt::to_integral(entity);
+        return stateHashMix(key ^ stateHashMix(static_cast<std::uint32_t>(tick)));
+    }
+
+    /// Records the new tick of a linked action
+    void moveTick(ActionSlot &slot, ActionID id, int tick) {
+        pendingHash += entryHash(id, slot.entity, tick) - entryHash(id, slot.entity, slot.tick);
+        if (!tickLoad.empty()) {
+            --loadOf(slot.tick);
+            ++loadOf(tick);
+        }
+        slot.tick = tick;
+    }
+
+    /// Number of pending actions whose tick falls in the same slot of the load window as a tick
+    std::uint32_t &loadOf(int tick) {
+        return tickLoad[static_cast<std::size_t>(static_cast<unsigned>(tick)) &
+                        (tickLoad.size() - 1)];
+    }
+
+    /// Moves an action with slack to the least loaded tick of [tick, tick + slack]
+    void spread(ScheduledAction &action) {
+        if (tickLoad.empty()) {
+            return;
+        }
+        int slack = action.slack;
+        if (slack <= 0 && spreadOptions.phasePeriodic && action.interval > 0 && !action.chain) {
+            slack = action.interval - 1;
+        }
+        slack = std::min(slack, static_cast<int>(tickLoad.size()) - 1);
+        int best = action.tick;
+        std::uint32_t bestLoad = loadOf(best);
+        // Ties go to the earliest tick, so an idle window adds no delay
+        for (int offset = 1; offset <= slack && bestLoad != 0; ++offset) {
+            if (std::uint32_t load = loadOf(action.tick + offset); load < bestLoad) {
+                best = action.tick + offset;
+                bestLoad = load;
+            }
+        }
+        action.tick = best;
+    }
+
+    /// Brings the PendingActions of an entity in line with its remaining actions
+    void refreshPending(entt::entity entity) {
+        auto &storage = tracked->storage<PendingActions>();
+        if (!storage.contains(entity)) {
+            return; // Being destroyed, or tracked after it was scheduled
+        }
+        auto it = entityIndex.find(entity);
+        if (it == entityIndex.end()) {
+            storage.remove(entity);
+            return;
+        }
+        int next = timers.get(it->second.head).tick;
+        for (ActionID id = timers.get(it->second.head).next; id != 0; id = timers.get(id).next) {
+            next = std::min(next, timers.get(id).tick);
+        }
+        tracked->replace<PendingActions>(entity, static_cast<std::uint32_t>(it->second.count),
+                                         next);
+    }
+
+    /// Counts a retired action out of its group, releasing the group with its last action
+    void leaveGroup(ActionGroup group) {
+        GroupState *state = groups.find(group);
+        if (state == nullptr) {
+            --lapsedCount;
+        } else {
+            --state->pending;
+            collapse(group);
+        }
+    }
+
+    /// Releases a group and then its ancestors while each has nothing left to hold it
+    void collapse(ActionGroup group) {
+        while (group != 0) {
+            const GroupState &state = groups.get(group);
+            if (state.pending != 0 || state.child != 0 || state.held) {
+                return;
+            }
+            ActionGroup parent = state.parent;
+            if (parent != 0) {
+                unlink(group);
+            }
+            groups.erase(group);
+            group = parent;
+        }
+    }
+
+    /// Takes a nested group out of its parent's list of children
+    void unlink(ActionGroup group) {
+        GroupState &state = groups.get(group);
+        if (state.prev != 0) {
+            groups.get(state.prev).next = state.next;
+        } else {
+            groups.get(state.parent).child = state.next;
+        }
+        if (state.next != 0) {
+            groups.get(state.next).prev = state.prev;
+        }
+    }
+
+    /// Checks whether a pending action belongs to a cancelled group
+    bool lapsed(const ActionSlot &slot) const {
+        return slot.group != 0 && !groups.contains(slot.group);
+    }
+
+    /**
+     * Retires a pending action if its group was cancelled or another thread
+     * cancelled it, true if it did. Otherwise claims it on the state board,
+     * so it has to run or be re-armed next.
+     */
+    bool dropLapsed(ActionID id) {
+        if (lapsed(timers.get(id))) {
+            retire(id);
+            return true;
+        }
+        if (board != nullptr && !board->claim(id)) {
+            dropCancelled(id);
+            return true;
+        }
+        return false;
+    }
+
+    /// Retires an action cancelled through cancelFromAnyThread(), logging the cancel here
+    void dropCancelled(ActionID id) {
+        recordCancel(id);
+        retire(id);
+    }
+
+    /// Counts and logs a cancel
+    void recordCancel(ActionID id) {
+        if (stats) {
+            stats->recordCancel();
+        }
+        if (capture) {
+            captureCall(WorkloadRecord::Kind::cancel, 0, id);
+        }
+        if (journal) {
+            JournalRecord record;
+            record.kind = JournalRecord::Kind::cancel;
+            record.id = id;
+            journal->record(record);
+        }
+    }
+
+    void onDestroyed(entt::registry &, entt::entity entity) { cancelAll(entity); }
+
+    /// Checks whether a drained action is still pending and has not been handled yet
+    bool unsettled(const ScheduledAction &action) const {
+        return timers.isRunning(action.id);
+    }
+
+    /// Moves the submissions of one inbox into the queue and refills its IDs
+    void merge(Inbox &inbox) {
+        inbox.box.drain([this](ActionID id, ScheduledAction &&action) {
+            if (id == 0) {
+                id = timers.acquire();
+            } else if (!timers.contains(id)) {
+                return; // Cancelled before it was merged
+            }
+            action.id = id;
+            spread(action);
+            link(id, action.entity, action.tick, action.rearms());
+            if (capture) {
+                captureSchedule(action);
+            }
+            if (journal) {
+                journalSchedule(action);
+            }
+            timers.enqueue(std::move(action));
+        });
+        inbox.box.refill([this] { return timers.acquire(); });
+    }
+
+    /// Merges the inboxes that update() is responsible for
+    void mergeAutomatic() {
+        for (auto &inbox : inboxes) {
+            if (inbox->automatic) {
+                merge(*inbox);
+            }
+        }
+    }
+
+    /// Runs due actions until nothing is due or the budget is spent
+    UpdateResult runDue(int current_tick, entt::registry &registry, EventDispatcher &dispatcher,
+                        const UpdateBudget &budget) {
+        BudgetMeter meter(budget);
+        const entt::sparse_set *hint =
+            entityOrder.storage != nullptr ? entityOrder.storage(registry) : nullptr;
+        // Each tick is drained into the reusable buffer and run from there
+        for (;;) {
+            bool resumed = interrupted;
+            std::vector<ScheduledAction> &due = drainDue(current_tick);
+            if (due.empty()) {
+                return UpdateResult{meter.consumed(), 0};
+            }
+            if (hint != nullptr && !resumed) {
+                // The rest of an interrupted tick is already sorted
+                sortByEntity(due, *hint);
+            }
+            for (std::size_t i = 0; i < due.size(); ++i) {
+                if (due[i].id == 0) {
+                    continue; // Ran in the batch of an earlier action
+                }
+                if (hint != nullptr && entityOrder.distance != 0 &&
+                    i + entityOrder.distance < due.size()) {
+                    entityOrder.prefetch(*hint, due[i + entityOrder.distance].entity);
+                }
+                // Checked first, so an action is only claimed right before it runs
+                if (meter.exhausted()) {
+                    interrupted = true;
+                    resumeAt = i;
+                    return UpdateResult{meter.consumed(), due.size() - i};
+                }
+                // Skip actions cancelled by an earlier action of the same tick
+                if (!timers.contains(due[i].id) || dropLapsed(due[i].id)) {
+                    if (stats) {
+                        stats->recordSkip();
+                    }
+                    continue;
+                }
+                if (batching != BatchGrouping::off) {
+                    if (const auto *call = due[i].action.template target<BatchCall>()) {
+                        meter.consume(executeBatch(due, i, call->handler, meter.remaining(),
+                                                   current_tick, registry, dispatcher));
+                        continue;
+                    }
+                }
+                if (observed()) {
+                    executeObserved(due[i], current_tick, registry, dispatcher);
+                } else {
+                    execute(due[i], registry, dispatcher);
+                }
+                meter.consume();
+            }
+        }
+    }
+
+    /// Stably sorts a tick's actions by the index of their entity in a storage
+    void sortByEntity(std::vector<ScheduledAction> &due, const entt::sparse_set &hint) {
+        if (due.size() < 2) {
+            return;
+        }
+        entityRanks.clear();
+        for (std::size_t i = 0; i < due.size(); ++i) {
+            entt::entity entity = due[i].entity;
+            entityRanks.emplace_back(hint.contains(entity) ? hint.index(entity) : hint.size(), i);
+        }
+        if (std::is_sorted(entityRanks.begin(), entityRanks.end())) {
+            return;
+        }
+        // Ties are broken by position, which keeps the sort stable
+        std::sort(entityRanks.begin(), entityRanks.end());
+        sortedDue.clear();
+        for (const auto &rank : entityRanks) {
+            sortedDue.push_back(std::move(due[rank.second]));
+        }
+        due.swap(sortedDue);
+    }
+
+    template <typename Component>
+    static const entt::sparse_set *hintStorage(const entt::registry &registry) {
+        return registry.storage<Component>();
+    }
+
+    template <typename Component>
+    static void prefetchRow(const entt::sparse_set &hint, entt::entity entity) {
+        if constexpr (entt::component_traits<Component>::page_size != 0u) {
+            if (hint.contains(entity)) {
+                SCHEDULER_PREFETCH(
+                    &static_cast<const entt::registry::storage_for_type<Component> &>(hint).get(entity));
+            }
+        }
+    }
+
+    /// Looks up the listeners of the current reporting mode
+    void beginReport(EventDispatcher &dispatcher) {
+        reportEach = completionReport == CompletionReport::perAction ||
+                     (completionReport == CompletionReport::ifListened &&
+                      !dispatcher.sink<GameEvents::ActionCompletedEvent>().empty());
+        reportBatch = completionReport == CompletionReport::batched &&
+                      !dispatcher.sink<GameEvents::ActionsCompletedEvent>().empty();
+    }
+
+    /// Reports one completed action according to beginReport()
+    void report(const ScheduledAction &action, EventDispatcher &dispatcher) {
+        if (reportEach) {
+            dispatcher.enqueue<GameEvents::ActionCompletedEvent>(action.id, action.entity);
+        } else if (reportBatch) {
+            completed.push_back(GameEvents::ActionCompletedEvent{action.id, action.entity});
+        }
+    }
+
+    /// Enqueues the batch collected since beginReport(), if any
+    void endReport(int current_tick, EventDispatcher &dispatcher) {
+        if (!completed.empty()) {
+            dispatcher.enqueue(GameEvents::ActionsCompletedEvent{current_tick, std::move(completed)});
+            completed.clear();
+        }
+    }
+
+    /// Runs one drained action that is still pending, false if its entity is gone
+    bool execute(ScheduledAction &action, entt::registry &registry, EventDispatcher &dispatcher) {
+        // A periodic action keeps its ID while it runs so it can be re-armed
+        bool periodic = action.rearms();
+        if (!periodic) {
+            retire(action.id);
+        }
+
+        // Execute the action if the entity is still valid
+        if (!registry.valid(action.entity)) {
+            if (periodic) {
+                retire(action.id);
+            }
+            return false;
+        }
+
+        // Execute main action
+        action.action(action.entity, registry);
+
+        // Trigger standard completion event
+        report(action, dispatcher);
+
+        // Call custom onComplete if provided
+        if (action.onComplete) {
+            action.onComplete(action.id, action.entity, registry, dispatcher);
+        }
+
+        // Re-arm periodic actions unless they were cancelled while running
+        if (periodic && timers.contains(action.id) && !dropLapsed(action.id)) {
+            rearm(action);
+        }
+        return true;
+    }
+
+    /// Runs the batch of the pending BatchCall action due[first], returns the actions run
+    std::size_t executeBatch(std::vector<ScheduledAction> &due, std::size_t first,
+                             BatchFunction handler, std::size_t limit, int current_tick,
+                             entt::registry &registry, EventDispatcher &dispatcher) {
+        limit = std::min(limit, batchLimit);
+        batchMembers.clear();
+        batchMembers.push_back(first);
+        for (std::size_t i = first + 1; i < due.size() && batchMembers.size() < limit; ++i) {
+            const ScheduledAction &action = due[i];
+            const BatchCall *call = nullptr;
+            if (action.id != 0 && timers.contains(action.id) && !lapsed(timers.get(action.id))) {
+                call = action.action.template target<BatchCall>();
+            }
+            if (call != nullptr && call->handler == handler) {
+                if (board == nullptr || board->claim(action.id)) {
+                    batchMembers.push_back(i);
+                } else {
+                    dropCancelled(action.id);
+                }
+            } else if (batching == BatchGrouping::adjacent) {
+                break;
+            }
+        }
+
+        // Members whose entity is gone are skipped, as execute() would
+        batchEntities.clear();
+        std::size_t kept = 0;
+        for (std::size_t member : batchMembers) {
+            ScheduledAction &action = due[member];
+            bool periodic = action.rearms();
+            if (!periodic) {
+                retire(action.id);
+            }
+            if (!registry.valid(action.entity)) {
+                if (periodic) {
+                    retire(action.id);
+                }
+                if (stats) {
+                    stats->recordSkip();
+                }
+                action.id = 0;
+                continue;
+            }
+            batchEntities.push_back(action.entity);
+            batchMembers[kept++] = member;
+        }
+        batchMembers.resize(kept);
+        if (kept == 0) {
+            return 0;
+        }
+
+        bool timed = observed();
+        std::uint64_t begin = timed ? SchedulerTrace::now() : 0;
+        handler(EntitySpan(batchEntities.data(), batchEntities.size()), registry);
+        std::uint64_t end = timed ? SchedulerTrace::now() : 0;
+        const ScheduledAction &lead = due[batchMembers.front()];
+        if (trace) {
+            trace->local().record(TraceRecord{begin, end, lead.id, 0,
+                                              entt::to_integral(lead.entity), lead.tick,
+                                              TraceRecord::Source::action});
+        }
+        if (watchdog && timed) {
+            watchdog->record(CostKey{CostSource::batch, reinterpret_cast<std::uintptr_t>(handler)},
+                             begin, end, lead.id, entt::to_integral(lead.entity), lead.tick);
+        }
+
+        for (std::size_t member : batchMembers) {
+            ScheduledAction &action = due[member];
+            if (stats) {
+                stats->recordRun(current_tick - action.tick,
+                                 std::chrono::nanoseconds((end - begin) / kept));
+            }
+            report(action, dispatcher);
+            if (action.onComplete) {
+                action.onComplete(action.id, action.entity, registry, dispatcher);
+            }
+            if (action.rearms() && timers.contains(action.id) && !dropLapsed(action.id)) {
+                rearm(action);
+            }
+            action.id = 0;
+        }
+        return kept;
+    }
+
+    /// Logs a newly queued action in the attached capture
+    void captureSchedule(const ScheduledAction &action) {
+        const auto *call = action.action.template target<ActionHandlers::Call>();
+        WorkloadRecord record;
+        record.kind = WorkloadRecord::Kind::schedule;
+        record.tick = action.tick;
+        record.id = action.id;
+        record.entity = entt::to_integral(action.entity);
+        record.handler = call != nullptr ? call->saved().handler : 0;
+        record.interval = action.interval;
+        record.repeats = action.repeats;
+        capture->record(record);
+    }
+
+    /// Logs a newly queued action in the attached journal if it can be restored
+    void journalSchedule(const ScheduledAction &action) {
+        const auto *call = action.action.template target<ActionHandlers::Call>();
+        if (call == nullptr || action.onComplete || action.chain) {
+            return;
+        }
+        JournalRecord record;
+        record.kind = JournalRecord::Kind::schedule;
+        record.id = action.id;
+        record.tick = action.tick;
+        record.entity = entt::to_integral(action.entity);
+        record.interval = action.interval;
+        record.repeats = action.repeats;
+        record.payload = call->saved();
+        journal->record(record);
+    }
+
+    /// Logs a cancel or update call in the attached capture
+    void captureCall(WorkloadRecord::Kind kind, int tick, ActionID id) {
+        WorkloadRecord record;
+        record.kind = kind;
+        record.tick = tick;
+        record.id = id;
+        capture->record(record);
+    }
+
+    /// Checks whether the next run is timed, for the attached stats, trace or watchdog
+    bool observed() { return stats || trace || (watchdog && watchdog->sample()); }
+
+    /// Gets what the watchdog attributes the run of an action to
+    static CostKey costKey(const ScheduledAction &action) {
+        if (const auto *call = action.action.template target<ActionHandlers::Call>()) {
+            return CostKey{CostSource::handler, call->saved().handler};
+        }
+        if (const auto *call = action.action.template target<BatchCall>()) {
+            return CostKey{CostSource::batch, reinterpret_cast<std::uintptr_t>(call->handler)};
+        }
+        return CostKey{CostSource::callable,
+                       reinterpret_cast<std::uintptr_t>(action.action.kind())};
+    }
+
+    /// Runs a drained action like execute(), filling in the attached stats, trace and watchdog
+    void executeObserved(ScheduledAction &action, int current_tick, entt::registry &registry,
+                         EventDispatcher &dispatcher) {
+        // Read before running, since re-arming moves the action away
+        TraceRecord record{0, 0, action.id, 0, entt::to_integral(action.entity), action.tick,
+                           TraceRecord::Source::action};
+        CostKey key = watchdog ? costKey(action) : CostKey{};
+        record.begin = SchedulerTrace::now();
+        bool ran = execute(action, registry, dispatcher);
+        record.end = SchedulerTrace::now();
+        if (stats) {
+            if (ran) {
+                stats->recordRun(current_tick - record.tick,
+                                 std::chrono::nanoseconds(record.end - record.begin));
+            } else {
+                stats->recordSkip();
+            }
+        }
+        if (trace && ran) {
+            trace->local().record(record);
+        }
+        if (watchdog && ran) {
+            watchdog->record(key, record.begin, record.end, record.id, record.entity,
+                             record.tick);
+        }
+    }
+
+    /// Queues a periodic action that has just run at its next tick
+    void rearm(ScheduledAction &action) {
+        if (board != nullptr && !board->requeue(action.id)) {
+            dropCancelled(action.id); // Cancelled by another thread while it ran
+            return;
+        }
+        if (action.chain && action.chain->next < action.chain->steps.size()) {
+            ChainStep &step = action.chain->steps[action.chain->next++];
+            action.tick += step.delay;
+            action.action = std::move(step.action);
+        } else {
+            action.tick += action.interval;
+            if (action.repeats != ScheduledAction::forever) {
+                --action.repeats;
+            }
+        }
+        moveTick(timers.get(action.id), action.id, action.tick);
+        if (tracked != nullptr) {
+            refreshPending(action.entity);
+        }
+        timers.enqueue(std::move(action));
+    }
+
+    /// Moves a periodic action to its last run due by a tick, for catchUp()
+    bool postpone(ScheduledAction &action, int lastTick) {
+        if (action.chain || action.interval <= 0 || action.repeats == 0 ||
+            action.tick >= lastTick) {
+            return false;
+        }
+        int runs = (lastTick - action.tick) / action.interval;
+        if (action.repeats != ScheduledAction::forever) {
+            runs = std::min(runs, action.repeats);
+            action.repeats -= runs;
+        }
+        if (runs == 0) {
+            return false;
+        }
+        missed[action.id] += runs;
+        action.tick += runs * action.interval;
+        moveTick(timers.get(action.id), action.id, action.tick);
+        if (tracked != nullptr) {
+            refreshPending(action.entity);
+        }
+        timers.enqueue(std::move(action));
+        return true;
+    }
+
+    /// Settles the actions left in the drain buffer and empties it
+    void recycle() {
+        settle(0, drained.size());
+        drained.clear();
+        interrupted = false;
+    }
+
+    /// Re-arms or releases the drained actions in [first, last) that are still pending
+    void settle(std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i) {
+            ScheduledAction &action = drained[i];
+            if (!unsettled(action) || dropLapsed(action.id)) {
+                continue;
+            }
+            if (action.rearms()) {
+                rearm(action);
+            } else {
+                retire(action.id);
+            }
+        }
+    }
+
+    /// Access flags recorded per component while a wave is formed
+    enum : unsigned char { readFlag = 1, writeFlag = 2 };
+
+    static bool conflicts(unsigned char held, unsigned char wanted) {
+        return ((held & writeFlag) && wanted) || ((wanted & writeFlag) && held);
+    }
+
+    /// Finds the end of the wave starting at begin, preparing storages on the way
+    std::size_t waveEnd(std::size_t begin, entt::registry &registry) {
+        if (drained[begin].access == nullptr) {
+            return begin + 1;
+        }
+        sharedUse.clear();
+        localUse.clear();
+        entityUse.clear();
+        std::size_t end = begin;
+        for (; end < drained.size() && drained[end].access != nullptr; ++end) {
+            const ActionAccess &access = *drained[end].access;
+            auto entity = static_cast<std::uint64_t>(entt::to_integral(drained[end].entity)) << 32;
+            bool clash = false;
+            for (std::size_t i = 0; i < access.size && !clash; ++i) {
+                const auto &component = access.components[i];
+                unsigned char wanted = component.write ? writeFlag : readFlag;
+                clash = conflicts(lookup(sharedUse, component.type), wanted) ||
+                        (access.selfOnly
+                             ? conflicts(lookup(entityUse, entity | component.type), wanted)
+                             : conflicts(lookup(localUse, component.type), wanted));
+            }
+            if (clash) {
+                break;
+            }
+            for (std::size_t i = 0; i < access.size; ++i) {
+                const auto &component = access.components[i];
+                unsigned char flag = component.write ? writeFlag : readFlag;
+                if (access.selfOnly) {
+                    localUse[component.type] |= flag;
+                    entityUse[entity | component.type] |= flag;
+                } else {
+                    sharedUse[component.type] |= flag;
+                }
+            }
+            access.prepare(registry);
+        }
+        return end;
+    }
+
+    template <typename Map, typename Key> static unsigned char lookup(const Map &map, Key key) {
+        auto it = map.find(key);
+        return it == map.end() ? 0 : it->second;
+    }
+
+    /// Runs drained[begin, end) on the pool, then finishes the actions in order
+    void runWave(int current_tick, std::size_t begin, std::size_t end, entt::registry &registry,
+                 EventDispatcher &dispatcher, TaskPool &pool) {
+        // Drop actions cancelled by earlier waves and actions of destroyed entities
+        for (std::size_t i = begin; i < end; ++i) {
+            ScheduledAction &action = drained[i];
+            if (!timers.contains(action.id) || dropLapsed(action.id)) {
+                action.action = nullptr;
+            } else if (!registry.valid(action.entity)) {
+                retire(action.id);
+                action.action = nullptr;
+            }
+            if (stats) {
+                if (action.action) {
+                    stats->recordRun(current_tick - action.tick);
+                } else {
+                    stats->recordSkip();
+                }
+            }
+        }
+
+        pool.parallelFor(end - begin, [this, begin, &registry](std::size_t offset) {
+            ScheduledAction &action = drained[begin + offset];
+            if (!action.action) {
+                return;
+            }
+            if (!trace) {
+                action.action(action.entity, registry);
+                return;
+            }
+            TraceRecord record{SchedulerTrace::now(), 0, action.id, 0,
+                               entt::to_integral(action.entity), action.tick,
+                               TraceRecord::Source::action};
+            action.action(action.entity, registry);
+            record.end = SchedulerTrace::now();
+            trace->local().record(record);
+        });
+
+        for (std::size_t i = begin; i < end; ++i) {
+            ScheduledAction &action = drained[i];
+            if (!action.action) {
+                continue;
+            }
+            bool periodic = action.rearms();
+            if (!periodic && timers.contains(action.id)) {
+                retire(action.id);
+            }
+
+            report(action, dispatcher);
+            if (action.onComplete) {
+                action.onComplete(action.id, action.entity, registry, dispatcher);
+            }
+
+            if (periodic && timers.contains(action.id) && !dropLapsed(action.id)) {
+                rearm(action);
+            }
+        }
+    }
+
+    /// Queue of pending actions, ordered by tick, and the bookkeeping of every pending ActionID
+    Timers timers;
+
+    /// Pending actions of each entity that has any
+    EntityIndex entityIndex;
+
+    /// Handlers added with registerHandler()
+    ActionHandlers handlerTable;
+
+    /// Registry given PendingActions components by trackPending(), not owned
+    entt::registry *tracked = nullptr;
+
+    /// Live groups, a cancelled group's handle and those of its nested groups are erased at once
+    SlotMap<GroupState, ActionGroup, SlotIdTraits<ActionGroup>, GroupAllocator> groups;
+
+    /// Actions of cancelled groups still in the queue, left out of pendingCount()
+    std::size_t lapsedCount = 0;
+
+    /// Sum of entryHash() over the linked actions, see stateHash()
+    std::uint64_t pendingHash = 0;
+
+    /// Inboxes handed out by openInbox(), in merge order
+    std::vector<std::unique_ptr<Inbox>> inboxes;
+
+    /// State words read by cancelFromAnyThread(), created by enableConcurrentCancel()
+    std::unique_ptr<ActionStateBoard<ActionID>> board;
+
+    /// Pending actions per tick modulo its size, empty until enableSpreading()
+    std::vector<std::uint32_t> tickLoad;
+    SpreadOptions spreadOptions; ///< Set by enableSpreading()
+
+    /// How completed actions are reported, and what beginReport() found listening
+    CompletionReport completionReport = CompletionReport::perAction;
+    bool reportEach = true;
+    bool reportBatch = false;
+
+    /// Completions collected for the next ActionsCompletedEvent
+    std::vector<GameEvents::ActionCompletedEvent> completed;
+
+    /// Most entities the entity index held at once, for capacityProfile()
+    std::size_t peakEntities = 0;
+
+    /// Most actions drained for one tick, for capacityProfile()
+    std::size_t peakDue = 0;
+
+    /// Sizes given to reserve(), reported by capacityProfile() until outgrown
+    CapacityProfile reserved;
+
+    /// Actions handed out by drainDue(), reused across ticks
+    std::vector<ScheduledAction> drained;
+
+    /// Statistics attached with setStats(), not owned
+    SchedulerStats *stats = nullptr;
+
+    /// Trace attached with setTrace(), not owned
+    SchedulerTrace *trace = nullptr;
+
+    /// Watchdog attached with setWatchdog(), not owned
+    SchedulerWatchdog *watchdog = nullptr;
+
+    /// Capture attached with setCapture(), not owned
+    WorkloadCapture *capture = nullptr;
+
+    /// Journal attached with setJournal(), not owned
+    SchedulerJournal *journal = nullptr;
+
+    /// Order set by orderByEntity(), with the buffers sortByEntity() reuses
+    EntityOrder entityOrder;
+
+    BatchGrouping batching = BatchGrouping::adjacent; ///< Set by setBatching()
+    std::size_t batchLimit = 1024;                    ///< Most actions per batch
+    std::vector<std::size_t> batchMembers;            ///< Indices into the due actions of a batch
+    std::vector<entt::entity> batchEntities;          ///< Entities of a batch, handed to its handler
+    std::vector<std::pair<std::size_t, std::size_t>> entityRanks;
+    std::vector<ScheduledAction> sortedDue;
+
+    /// Actions coalesceDue() keeps, and their index by entity
+    std::vector<ScheduledAction> kept;
+    entt::dense_map<entt::entity, std::size_t> keptIndex;
+
+    /// Set when a budgeted update stopped at drained[resumeAt]
+    bool interrupted = false;
+    std::size_t resumeAt = 0;
+
+    /// Runs skipped by actions catchUp() collapsed, and by the one running
+    entt::dense_map<ActionID, int> missed;
+    int missedCount = 0;
+
+    /// Component use of the wave being formed: by shared actions, by local
+    /// actions of any entity, and by local actions per entity and component
+    entt::dense_map<entt::id_type, unsigned char> sharedUse;
+    entt::dense_map<entt::id_type, unsigned char> localUse;
+    entt::dense_map<std::uint64_t, unsigned char> entityUse;
+};
+
+/// @brief Scheduler backed by a binary heap
+using Scheduler = BasicScheduler<>;
+
+/// @brief Scheduler backed by a hierarchical timing wheel
+using WheelScheduler = BasicScheduler<TimingWheel<ScheduledAction>>;
+
+/// @brief Scheduler backed by a calendar queue of per-tick buckets
+using CalendarScheduler = BasicScheduler<CalendarQueue<ScheduledAction>>;
+
+/// @brief Scheduler whose queue moves between heap, calendar and wheel with the workload
+using AdaptiveScheduler = BasicScheduler<AdaptiveQueue<ScheduledAction>>;
+
+/// @brief Heap-backed Scheduler whose pending actions live in a std::pmr::memory_resource
+using PmrScheduler =
+    BasicScheduler<HeapQueue<ScheduledAction, QueueNodeTraits<ScheduledAction>, 4,
+                             std::pmr::polymorphic_allocator<ScheduledAction>>>;
+
+/// @brief Wheel-backed Scheduler whose pending actions live in a std::pmr::memory_resource
+using PmrWheelScheduler =
+    BasicScheduler<TimingWheel<ScheduledAction, 8, 4, QueueNodeTraits<ScheduledAction>,
+                               std::pmr::polymorphic_allocator<ScheduledAction>>>;
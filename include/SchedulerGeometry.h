@@ -0,0 +1,99 @@
+/**
+ * @file SchedulerGeometry.h
+ * @brief Compile-time queue geometry, in the style of entt::entt_traits.
+ *
+ * Services with different delay distributions want differently shaped queues:
+ * a combat server schedules a few ticks ahead, an economy server days ahead.
+ * A SchedulerGeometry fixes the wheel levels and slots per level, the
+ * calendar horizon and the split of an ActionID into index and generation
+ * bits as template parameters, so slot and bucket indexing compile down to
+ * shifts and masks and each service instantiates the shape it needs.
+ *
+ * The inline buffer of ActionFunction is set for the whole build instead,
+ * with SCHEDULER_INLINE_FUNCTION_CAPACITY, since every scheduler shares the
+ * ScheduledAction type.
+ */
+#pragma once
+
+#include "CalendarQueue.h"
+#include "HeapQueue.h"
+#include "Scheduler.h"
+#include "SlotMap.h"
+#include "TimingWheel.h"
+#include "entt/core/bit.hpp"
+#include <cstddef>
+
+/**
+ * @class GeometryQueue
+ * @brief A queue backend that also sets the ID layout of the timers using it
+ * @tparam Queue The queue backend
+ * @tparam IdTraits ID layout read by BasicTimerQueue, see QueueIdTraits
+ */
+template <typename Queue, typename IdTraits> class GeometryQueue : public Queue {
+  public:
+    /// @brief ID layout of the timers queued here
+    using id_traits = IdTraits;
+
+    using Queue::Queue;
+};
+
+/**
+ * @struct SchedulerGeometry
+ * @brief Queue shape of a scheduler, fixed at compile time
+ * @tparam SlotBits Bits of the tick resolved by each wheel level
+ * @tparam Levels Number of wheel levels
+ * @tparam Horizon Ticks covered by the calendar ring, a power of two
+ * @tparam IndexBits Bits of an ActionID holding the slot index, the rest hold the generation
+ *
+ * The defaults give the same shape as WheelScheduler, CalendarScheduler and
+ * Scheduler.
+ *
+ * @code
+ * // Economy timers: long delays, few pending at once, many reuses of each ID
+ * using EconomyGeometry = SchedulerGeometry<10, 3, 1024, 16>;
+ * EconomyGeometry::wheel_scheduler economy;
+ *
+ * // Combat: short delays, up to 4M actions pending
+ * SchedulerGeometry<6, 4, 64, 22>::calendar_scheduler combat;
+ * @endcode
+ */
+template <std::size_t SlotBits = 8, std::size_t Levels = 4, std::size_t Horizon = 256,
+          std::size_t IndexBits = 20>
+struct SchedulerGeometry {
+    static_assert(entt::has_single_bit(Horizon), "Horizon must be a power of two");
+
+    /// @brief Bits of the tick resolved by each wheel level
+    static constexpr std::size_t wheel_slot_bits = SlotBits;
+    /// @brief Number of wheel levels
+    static constexpr std::size_t wheel_levels = Levels;
+    /// @brief Slots of each wheel level
+    static constexpr std::size_t wheel_slots = std::size_t{1} << SlotBits;
+    /// @brief Ticks ahead the wheel holds before parking actions in its overflow list
+    static constexpr std::size_t wheel_span = std::size_t{1} << (SlotBits * Levels);
+    /// @brief Ticks covered by the calendar ring
+    static constexpr std::size_t calendar_horizon = Horizon;
+    /// @brief Bits of an ActionID holding the slot index
+    static constexpr std::size_t id_index_bits = IndexBits;
+
+    /// @brief ID layout of every scheduler of this geometry
+    using id_traits = PackedIdTraits<ActionID, IndexBits>;
+
+    /// @brief Most actions pending at once: slot 0 and the all-ones index are reserved
+    static constexpr std::size_t max_pending = std::size_t{id_traits::index_mask} - 1;
+
+    /// @brief Heap backend, which has no geometry of its own beyond the ID layout
+    using heap_queue = GeometryQueue<HeapQueue<ScheduledAction>, id_traits>;
+    /// @brief Timing-wheel backend
+    using wheel_queue =
+        GeometryQueue<TimingWheel<ScheduledAction, SlotBits, Levels>, id_traits>;
+    /// @brief Calendar backend with a fixed ring
+    using calendar_queue = GeometryQueue<
+        CalendarQueue<ScheduledAction, QueueNodeTraits<ScheduledAction>, Horizon>, id_traits>;
+
+    /// @brief Scheduler on the heap backend
+    using heap_scheduler = BasicScheduler<heap_queue>;
+    /// @brief Scheduler on the timing-wheel backend
+    using wheel_scheduler = BasicScheduler<wheel_queue>;
+    /// @brief Scheduler on the calendar backend
+    using calendar_scheduler = BasicScheduler<calendar_queue>;
+};
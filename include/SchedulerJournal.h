@@ -0,0 +1,347 @@
+/**
+ * @file SchedulerJournal.h
+ * @brief Write-ahead log of scheduler mutations, group-committed once per tick.
+ *
+ * A crash used to lose every pending timer: quest deadlines, respawns,
+ * auction expirations. A SchedulerJournal attached to a Scheduler with
+ * setJournal() receives a fixed-size record for every saveable action
+ * scheduled (see ActionHandlers.h) and every cancel. Records only go to
+ * memory on the hot path; commit(), called once per tick after the update,
+ * writes the tick's records with a single write and a single fdatasync.
+ * checkpoint() rewrites the log as the live actions alone, so it stays short,
+ * and SchedulerJournalLoader (SchedulerSnapshot.h) replays it into a
+ * scheduler with one bulk insertion.
+ *
+ * On POSIX systems the log is a file descriptor synced with fdatasync (fsync
+ * on Apple); elsewhere it is a C stream that is only flushed. A journal can
+ * also keep its committed records in memory, with or without a file, for the
+ * delta snapshots of DeltaSnapshot.h.
+ */
+#pragma once
+
+#include "ActionHandlers.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SCHEDULER_HAS_FSYNC 1
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @struct JournalRecord
+ * @brief One logged scheduler mutation
+ */
+struct JournalRecord {
+    /// @brief The mutation a record describes
+    enum class Kind : std::uint32_t {
+        schedule, ///< A saveable action was queued under id
+        cancel,   ///< id was cancelled
+        commit,   ///< Every action due at or before tick has run
+    };
+
+    Kind kind = Kind::commit;
+    std::uint32_t id = 0;      ///< ActionID the action got, or the cancelled ActionID
+    std::int32_t tick = 0;     ///< Due tick of the action, or the committed tick
+    std::uint32_t entity = 0;  ///< Entity of the action, as an integral
+    std::int32_t interval = 0; ///< ScheduledAction::interval
+    std::int32_t repeats = 0;  ///< ScheduledAction::repeats
+    SavedPayload payload;      ///< Handler and payload of the action
+};
+
+static_assert(std::is_trivially_copyable_v<JournalRecord>, "Records are written as raw bytes");
+
+/**
+ * @class SchedulerJournal
+ * @brief Append-only log file a scheduler writes its saveable mutations to
+ *
+ * Attach it to one scheduler, updated by one thread. Only actions whose
+ * function is an ActionHandlers::Call, with no completion callback and no
+ * chain, are logged; group cancellations are not, so cancel grouped actions
+ * one by one if they must stay cancelled after a crash. A crash loses at most
+ * the records of the tick that was not committed yet.
+ *
+ * @code
+ * SchedulerJournal journal;
+ * journal.open("world.wal");
+ * SchedulerJournalLoader{scheduler, handlers}.recover(journal); // After a restart
+ * scheduler.setJournal(&journal);
+ *
+ * // Every tick
+ * scheduler.update(tick, registry, dispatcher);
+ * journal.commit(tick);
+ * if (tick % 3600 == 0) {
+ *     checkpointJournal(journal, scheduler, tick);
+ * }
+ * @endcode
+ */
+class SchedulerJournal {
+  public:
+    SchedulerJournal() = default;
+    SchedulerJournal(const SchedulerJournal &) = delete;
+    SchedulerJournal &operator=(const SchedulerJournal &) = delete;
+
+    ~SchedulerJournal() { close(); }
+
+    /**
+     * @brief Opens a log for appending, creating it if needed
+     * @param file Path of the log
+     * @return false if the file cannot be opened
+     */
+    bool open(const std::string &file) {
+        close();
+        path = file;
+#if defined(SCHEDULER_HAS_FSYNC)
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        committedEnd = ::lseek(fd, 0, SEEK_END);
+        torn = committedEnd < 0;
+        return !torn;
+#else
+        stream = std::fopen(path.c_str(), "ab");
+        return stream != nullptr;
+#endif
+    }
+
+    /// @brief Closes the log, dropping records not committed
+    void close() {
+#if defined(SCHEDULER_HAS_FSYNC)
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#else
+        if (stream != nullptr) {
+            std::fclose(stream);
+            stream = nullptr;
+        }
+#endif
+        buffer.clear();
+    }
+
+    /// @brief Checks whether a log is open
+    bool isOpen() const {
+#if defined(SCHEDULER_HAS_FSYNC)
+        return fd >= 0;
+#else
+        return stream != nullptr;
+#endif
+    }
+
+    /// @brief Gets the path of the log
+    const std::string &file() const { return path; }
+
+    /// @brief Buffers a record until the next commit(), called by the scheduler
+    void record(const JournalRecord &entry) { buffer.push_back(entry); }
+
+    /// @brief Gets the number of records waiting for commit()
+    std::size_t pending() const { return buffer.size(); }
+
+    /**
+     * @brief Keeps a copy of every committed record until takeRetained()
+     * @param keep true to start keeping records, false to stop and drop those kept
+     *
+     * A journal that keeps records commits to memory alone when no file is open.
+     */
+    void setRetaining(bool keep) {
+        retaining = keep;
+        if (!keep) {
+            retained.clear();
+        }
+    }
+
+    /// @brief Checks whether committed records are kept
+    bool isRetaining() const { return retaining; }
+
+    /**
+     * @brief Moves out the records committed since the last call
+     * @param records Receives the records, appended in commit order
+     */
+    void takeRetained(std::vector<JournalRecord> &records) {
+        records.insert(records.end(), retained.begin(), retained.end());
+        retained.clear();
+    }
+
+    /**
+     * @brief Makes the buffered records and the update of a tick durable
+     * @param tick Tick whose update has run to completion
+     * @return false if writing or syncing failed; the records stay buffered
+     *         and the log is cut back to its last commit, so a retry
+     *         appends them again from a clean tail
+     *
+     * Pass the previous tick after a budgeted update that left a backlog, so
+     * the actions it did not run are not treated as done on recovery.
+     */
+    bool commit(int tick) {
+        JournalRecord done;
+        done.kind = JournalRecord::Kind::commit;
+        done.tick = tick;
+        buffer.push_back(done);
+        if ((isOpen() || !retaining) &&
+            (!cutTorn() || !append(buffer.data(), buffer.size()) || !sync())) {
+            buffer.pop_back();
+            cutTorn();
+            return false;
+        }
+        if (retaining) {
+            retained.insert(retained.end(), buffer.begin(), buffer.end());
+        }
+        buffer.clear();
+        return true;
+    }
+
+    /**
+     * @brief Replaces the log with a set of records, atomically
+     * @param records The schedule records of every live action, ending with a commit
+     * @return false if the new log could not be written, in which case the old
+     *         one is kept, or if the rename could not be synced
+     *
+     * Writes a temporary file next to the log, syncs it, renames it over the
+     * log and syncs the directory, so a crash cannot bring the old log back
+     * after commits went to the new one. Buffered records are dropped, since
+     * the new records describe the state they led to; kept records are not,
+     * and buffered ones join them. Use checkpointJournal() rather than
+     * calling it.
+     */
+    bool rewrite(const std::vector<JournalRecord> &records) {
+        const std::string temporary = path + ".tmp";
+        std::FILE *file = std::fopen(temporary.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        bool ok = std::fwrite(records.data(), sizeof(JournalRecord), records.size(), file) ==
+                  records.size();
+        ok = std::fflush(file) == 0 && ok;
+#if defined(SCHEDULER_HAS_FSYNC)
+        ok = ok && datasync(::fileno(file));
+#endif
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+        bool durable = syncDirectory();
+        if (retaining) {
+            retained.insert(retained.end(), buffer.begin(), buffer.end());
+        }
+        std::string reopened = path;
+        return open(reopened) && durable;
+    }
+
+    /**
+     * @brief Reads the committed records of a log
+     * @param file Path of the log
+     * @param records Receives every record up to the last commit; a torn or
+     *        uncommitted tail is left out
+     * @return false if the file cannot be read; a missing log reads as empty
+     */
+    static bool read(const std::string &file, std::vector<JournalRecord> &records) {
+        records.clear();
+        std::FILE *stream = std::fopen(file.c_str(), "rb");
+        if (stream == nullptr) {
+            return true;
+        }
+        JournalRecord entry;
+        std::size_t committed = 0;
+        while (std::fread(&entry, sizeof(entry), 1, stream) == 1) {
+            records.push_back(entry);
+            if (entry.kind == JournalRecord::Kind::commit) {
+                committed = records.size();
+            }
+        }
+        bool ok = std::ferror(stream) == 0;
+        std::fclose(stream);
+        records.resize(committed);
+        return ok;
+    }
+
+  private:
+    bool append(const JournalRecord *records, std::size_t count) {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(records);
+        std::size_t size = count * sizeof(JournalRecord);
+#if defined(SCHEDULER_HAS_FSYNC)
+        // Until sync() succeeds, the log may end in part of these records
+        torn = true;
+        while (size > 0 && fd >= 0) {
+            ssize_t written = ::write(fd, bytes, size);
+            if (written <= 0) {
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return size == 0;
+#else
+        return stream != nullptr && std::fwrite(bytes, 1, size, stream) == size;
+#endif
+    }
+
+    bool sync() {
+#if defined(SCHEDULER_HAS_FSYNC)
+        if (!datasync(fd)) {
+            return false;
+        }
+        committedEnd = ::lseek(fd, 0, SEEK_END);
+        torn = committedEnd < 0;
+        return !torn;
+#else
+        return std::fflush(stream) == 0;
+#endif
+    }
+
+    /// Cuts what a failed commit appended after the last commit; false if that failed
+    bool cutTorn() {
+#if defined(SCHEDULER_HAS_FSYNC)
+        if (torn && fd >= 0) {
+            torn = committedEnd < 0 || ::ftruncate(fd, committedEnd) != 0;
+        }
+        return !torn;
+#else
+        return true;
+#endif
+    }
+
+    /// Makes a rename in the log's directory durable
+    bool syncDirectory() const {
+#if defined(SCHEDULER_HAS_FSYNC)
+        std::size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+        int descriptor = ::open(directory.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            return false;
+        }
+        bool ok = ::fsync(descriptor) == 0;
+        ::close(descriptor);
+        return ok;
+#else
+        return true;
+#endif
+    }
+
+#if defined(SCHEDULER_HAS_FSYNC)
+    static bool datasync(int descriptor) {
+#if defined(__APPLE__)
+        return ::fsync(descriptor) == 0;
+#else
+        return ::fdatasync(descriptor) == 0;
+#endif
+    }
+
+    int fd = -1;
+    off_t committedEnd = 0; ///< Size of the log after its last commit
+    bool torn = false;      ///< Whether bytes past committedEnd may be in the log
+#else
+    std::FILE *stream = nullptr;
+#endif
+    std::string path;
+    std::vector<JournalRecord> buffer;   ///< Records of the tick not committed yet
+    std::vector<JournalRecord> retained; ///< Committed records kept for takeRetained()
+    bool retaining = false;
+};
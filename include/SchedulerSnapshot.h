@@ -0,0 +1,516 @@
+/**
+ * @file SchedulerSnapshot.h
+ * @brief Binary snapshots of pending scheduler state, alongside entt registry snapshots.
+ *
+ * Only saveable work is written: actions and events created from a handler
+ * table (see ActionHandlers.h). Pending work is stored as a count followed by
+ * an array of fixed-size plain records, in the same archive as the registry,
+ * so a snapshot is one contiguous buffer that can be written out, mapped back
+ * in and restored with a single bulk insertion per scheduler.
+ *
+ * @code
+ * BinaryOutputArchive output;
+ * entt::snapshot{registry}.get<entt::entity>(output).get<Health>(output);
+ * SchedulerSnapshot{scheduler}.get(output);
+ * EventSchedulerSnapshot{eventScheduler}.get(output);
+ * write(file, output.data());
+ *
+ * BinaryInputArchive input(mapped, mappedSize);
+ * entt::snapshot_loader{registry}.get<entt::entity>(input).get<Health>(input);
+ * SchedulerSnapshotLoader{scheduler, actionHandlers}.get(input);
+ * EventSchedulerSnapshotLoader{eventScheduler, eventHandlers}.get(input);
+ * @endcode
+ */
+#pragma once
+
+#include "ActionHandlers.h"
+#include "Scheduler.h"
+#include "TimedEventScheduler.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @struct SavedActionRecord
+ * @brief On-disk form of a pending scheduler action
+ */
+struct SavedActionRecord {
+    std::int32_t tick = 0;     ///< Tick the action is due at
+    std::uint32_t entity = 0;  ///< Entity identifier, as restored by entt::snapshot_loader
+    std::int32_t interval = 0; ///< ScheduledAction::interval
+    std::int32_t repeats = 0;  ///< ScheduledAction::repeats
+    SavedPayload payload;      ///< Handler and payload of the action
+};
+
+/**
+ * @struct SavedEventRecord
+ * @brief On-disk form of a pending timed event
+ */
+struct SavedEventRecord {
+    std::int32_t tick = 0;     ///< Tick the event is due at
+    std::int32_t priority = 0; ///< Priority within the tick
+    entt::id_type name = 0;    ///< Hash of the event name, 0 if unnamed
+    SavedPayload payload;      ///< Handler and payload of the event
+};
+
+/**
+ * @class BinaryOutputArchive
+ * @brief Archive appending trivially copyable values to a byte buffer
+ *
+ * Works as an output archive for entt::snapshot as long as the saved
+ * components are trivially copyable.
+ */
+class BinaryOutputArchive {
+  public:
+    /// @brief Appends the bytes of a value
+    template <typename Type> void operator()(const Type &value) {
+        static_assert(std::is_trivially_copyable_v<Type>, "Only plain values can be archived");
+        const auto *bytes = reinterpret_cast<const unsigned char *>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(Type));
+    }
+
+    /// @brief Gets the bytes written so far
+    const std::vector<unsigned char> &data() const { return buffer; }
+
+  private:
+    std::vector<unsigned char> buffer;
+};
+
+/**
+ * @class BinaryInputArchive
+ * @brief Archive reading trivially copyable values from memory it does not own
+ *
+ * The memory can be a buffer read from disk or a mapped file. Reading past
+ * the end yields zeroed values and clears good().
+ */
+class BinaryInputArchive {
+  public:
+    /**
+     * @param data First byte of the archive
+     * @param size Size of the archive in bytes
+     */
+    BinaryInputArchive(const void *data, std::size_t size)
+        : position(static_cast<const unsigned char *>(data)), end(position + size) {}
+
+    /// @brief Reads the next value
+    template <typename Type> void operator()(Type &value) {
+        static_assert(std::is_trivially_copyable_v<Type>, "Only plain values can be archived");
+        if (static_cast<std::size_t>(end - position) < sizeof(Type)) {
+            std::memset(static_cast<void *>(&value), 0, sizeof(Type));
+            position = end;
+            failed = true;
+            return;
+        }
+        std::memcpy(static_cast<void *>(&value), position, sizeof(Type));
+        position += sizeof(Type);
+    }
+
+    /// @brief Checks whether every read so far was within the archive
+    bool good() const { return !failed; }
+
+    /// @brief Gets the number of bytes not read yet
+    std::size_t remaining() const { return static_cast<std::size_t>(end - position); }
+
+  private:
+    const unsigned char *position;
+    const unsigned char *end;
+    bool failed = false;
+};
+
+/**
+ * @class SchedulerSnapshot
+ * @brief Writes the saveable pending actions of a scheduler to an archive
+ * @tparam Queue The queue backend of the scheduler
+ *
+ * An action is saveable when its action is an ActionHandlers::Call and it has
+ * no completion callback and no chain. Other actions are left out; so are
+ * access declarations, since the descriptors are process-local. Records are
+ * written in tick order. Take the snapshot between updates, after merging any
+ * inboxes.
+ */
+template <typename Queue> class SchedulerSnapshot {
+  public:
+    explicit SchedulerSnapshot(const BasicScheduler<Queue> &scheduler) : scheduler(scheduler) {}
+
+    /**
+     * @brief Writes the saveable pending actions
+     * @param archive Output archive, called with the record count as the
+     *        entity's underlying type and then with every SavedActionRecord
+     * @return The number of actions written
+     */
+    template <typename Archive> std::size_t get(Archive &archive) const {
+        std::vector<SavedActionRecord> records;
+        collect(records);
+        return write(archive, records);
+    }
+
+    /**
+     * @brief Copies the saveable pending actions, unsorted
+     * @param records Receives the records, appended in no particular order
+     *
+     * Splits get() in two, so the records can be taken between two updates
+     * and sorted and archived later on another thread.
+     */
+    void collect(std::vector<SavedActionRecord> &records) const {
+        scheduler.forEachPending([&records](const ScheduledAction &action) {
+            const auto *call = action.action.template target<ActionHandlers::Call>();
+            if (call == nullptr || action.onComplete || action.chain) {
+                return;
+            }
+            records.push_back(SavedActionRecord{action.tick, entt::to_integral(action.entity),
+                                                action.interval, action.repeats, call->saved()});
+        });
+    }
+
+    /**
+     * @brief Sorts collected records and writes them as get() does
+     * @param archive Output archive
+     * @param records Records from collect(), sorted in place
+     * @return The number of actions written
+     */
+    template <typename Archive>
+    static std::size_t write(Archive &archive, std::vector<SavedActionRecord> &records) {
+        std::stable_sort(records.begin(), records.end(),
+                         [](const SavedActionRecord &a, const SavedActionRecord &b) {
+                             return a.tick < b.tick;
+                         });
+        archive(static_cast<entt::entt_traits<entt::entity>::entity_type>(records.size()));
+        for (const SavedActionRecord &record : records) {
+            archive(record);
+        }
+        return records.size();
+    }
+
+  private:
+    const BasicScheduler<Queue> &scheduler;
+};
+
+/**
+ * @class SchedulerSnapshotLoader
+ * @brief Restores actions written by a SchedulerSnapshot
+ * @tparam Queue The queue backend of the scheduler
+ *
+ * Restored actions are added to whatever the scheduler already holds, with
+ * new IDs, in one bulk insertion. Records whose handler is not registered, or
+ * registered with a different payload size, are skipped.
+ */
+template <typename Queue> class SchedulerSnapshotLoader {
+  public:
+    SchedulerSnapshotLoader(BasicScheduler<Queue> &scheduler, const ActionHandlers &handlers)
+        : scheduler(scheduler), handlers(handlers) {}
+
+    /**
+     * @brief Reads and schedules the saved actions
+     * @param archive Input archive positioned at the snapshot
+     * @return The IDs of the restored actions, in record order
+     */
+    template <typename Archive> IdRange<ActionID> get(Archive &archive) {
+        typename entt::entt_traits<entt::entity>::entity_type count{};
+        archive(count);
+        std::vector<ScheduledAction> actions;
+        actions.reserve(count);
+        SavedActionRecord record;
+        for (decltype(count) i = 0; i < count; ++i) {
+            archive(record);
+            auto call = handlers.restore(record.payload);
+            if (!call) {
+                ++skippedRecords;
+                continue;
+            }
+            ScheduledAction action{0, record.tick, entt::entity{record.entity}, *call, nullptr};
+            action.interval = record.interval;
+            action.repeats = record.repeats;
+            actions.push_back(std::move(action));
+        }
+        return scheduler.scheduleBulk(actions.begin(), actions.end());
+    }
+
+    /// @brief Gets the number of records skipped by get() so far
+    std::size_t skipped() const { return skippedRecords; }
+
+  private:
+    BasicScheduler<Queue> &scheduler;
+    const ActionHandlers &handlers;
+    std::size_t skippedRecords = 0;
+};
+
+/**
+ * @class EventSchedulerSnapshot
+ * @brief Writes the saveable pending events of a TimedEventScheduler to an archive
+ *
+ * An event is saveable when it was scheduled with scheduleFunction() and an
+ * EventHandlers::Call. Other events are left out. Names are saved as their
+ * hash.
+ */
+class EventSchedulerSnapshot {
+  public:
+    explicit EventSchedulerSnapshot(const TimedEventScheduler &scheduler) : scheduler(scheduler) {}
+
+    /**
+     * @brief Writes the saveable pending events
+     * @param archive Output archive, called with the record count as the
+     *        entity's underlying type and then with every SavedEventRecord
+     * @return The number of events written
+     */
+    template <typename Archive> std::size_t get(Archive &archive) const {
+        std::vector<SavedEventRecord> records;
+        scheduler.forEachPending([&records](const TimedEvent &event) {
+            const auto *function = dynamic_cast<const FunctionEvent *>(&event);
+            const auto *call = function != nullptr
+                                   ? function->function().target<EventHandlers::Call>()
+                                   : nullptr;
+            if (call != nullptr) {
+                records.push_back(SavedEventRecord{event.getTick(), event.getPriority(),
+                                                   event.getName().value(), call->saved()});
+            }
+        });
+        std::stable_sort(records.begin(), records.end(),
+                         [](const SavedEventRecord &a, const SavedEventRecord &b) {
+                             return a.tick != b.tick ? a.tick < b.tick : a.priority > b.priority;
+                         });
+        archive(static_cast<entt::entt_traits<entt::entity>::entity_type>(records.size()));
+        for (const SavedEventRecord &record : records) {
+            archive(record);
+        }
+        return records.size();
+    }
+
+  private:
+    const TimedEventScheduler &scheduler;
+};
+
+/**
+ * @class EventSchedulerSnapshotLoader
+ * @brief Restores events written by an EventSchedulerSnapshot
+ *
+ * Restored events are added in one bulk insertion, with new IDs. Records
+ * whose handler is not registered are skipped.
+ */
+class EventSchedulerSnapshotLoader {
+  public:
+    EventSchedulerSnapshotLoader(TimedEventScheduler &scheduler, const EventHandlers &handlers)
+        : scheduler(scheduler), handlers(handlers) {}
+
+    /**
+     * @brief Reads and schedules the saved events
+     * @param archive Input archive positioned at the snapshot
+     * @return The IDs of the restored events, in record order
+     */
+    template <typename Archive> IdRange<EventID> get(Archive &archive) {
+        entt::entt_traits<entt::entity>::entity_type count{};
+        archive(count);
+        std::vector<std::shared_ptr<TimedEvent>> events;
+        events.reserve(count);
+        SavedEventRecord record;
+        for (decltype(count) i = 0; i < count; ++i) {
+            archive(record);
+            auto call = handlers.restore(record.payload);
+            if (!call) {
+                ++skippedRecords;
+                continue;
+            }
+            auto event = TimedEventScheduler::makeEvent<FunctionEvent>(
+                record.tick, *call, EventName::fromId(record.name));
+            event->setPriority(record.priority);
+            events.push_back(std::move(event));
+        }
+        return scheduler.scheduleEvents(events.begin(), events.end());
+    }
+
+    /// @brief Gets the number of records skipped by get() so far
+    std::size_t skipped() const { return skippedRecords; }
+
+  private:
+    TimedEventScheduler &scheduler;
+    const EventHandlers &handlers;
+    std::size_t skippedRecords = 0;
+};
+
+/**
+ * @brief Gets the saveable pending actions of a scheduler as journal records
+ * @param scheduler The scheduler
+ * @param tick The last tick whose update has run to completion
+ * @return A schedule record per action, with its ID, in tick order, then a commit of tick
+ */
+template <typename Queue>
+std::vector<JournalRecord> checkpointRecords(const BasicScheduler<Queue> &scheduler, int tick) {
+    std::vector<JournalRecord> records;
+    scheduler.forEachPending([&records](const ScheduledAction &action) {
+        const auto *call = action.action.template target<ActionHandlers::Call>();
+        if (call == nullptr || action.onComplete || action.chain) {
+            return;
+        }
+        JournalRecord record;
+        record.kind = JournalRecord::Kind::schedule;
+        record.id = action.id;
+        record.tick = action.tick;
+        record.entity = entt::to_integral(action.entity);
+        record.interval = action.interval;
+        record.repeats = action.repeats;
+        record.payload = call->saved();
+        records.push_back(record);
+    });
+    std::stable_sort(records.begin(), records.end(),
+                     [](const JournalRecord &a, const JournalRecord &b) { return a.tick < b.tick; });
+    JournalRecord done;
+    done.kind = JournalRecord::Kind::commit;
+    done.tick = tick;
+    records.push_back(done);
+    return records;
+}
+
+/**
+ * @brief Rewrites a journal as the saveable pending actions of its scheduler
+ * @param journal The journal attached to the scheduler
+ * @param scheduler The scheduler
+ * @param tick The last tick whose update has run to completion
+ * @return false if the new log could not be written; the old one is kept
+ *
+ * Keeps the log from growing without bound. Take it between updates, after
+ * merging any inboxes; the buffered records of the current tick are part of
+ * the checkpoint and need no commit().
+ */
+template <typename Queue>
+bool checkpointJournal(SchedulerJournal &journal, const BasicScheduler<Queue> &scheduler,
+                       int tick) {
+    return journal.rewrite(checkpointRecords(scheduler, tick));
+}
+
+/**
+ * @brief Reduces committed journal records to the actions they leave pending
+ * @param records Committed records, in log order
+ * @return The schedule records of the pending actions, in log order, followed
+ *         by the last commit if there is one
+ *
+ * Schedules are kept unless a later cancel or schedule names their ID, and
+ * every action due at or before the last committed tick is treated as run, so
+ * one-shot actions are dropped and periodic ones skip the runs they made.
+ * Replaying the result gives the same actions as replaying the records, so it
+ * can replace them: this compacts a log, or a chain of delta snapshots,
+ * without a scheduler.
+ */
+inline std::vector<JournalRecord> replayJournal(const std::vector<JournalRecord> &records) {
+    std::vector<JournalRecord> live;
+    entt::dense_map<std::uint32_t, std::size_t> index; ///< Position of each ID in live
+    std::optional<JournalRecord> commit;
+    for (const JournalRecord &record : records) {
+        switch (record.kind) {
+        case JournalRecord::Kind::schedule:
+            if (auto it = index.find(record.id); it != index.end()) {
+                live[it->second].kind = JournalRecord::Kind::cancel; // Superseded
+            }
+            index.insert_or_assign(record.id, live.size());
+            live.push_back(record);
+            break;
+        case JournalRecord::Kind::cancel:
+            if (auto it = index.find(record.id); it != index.end()) {
+                live[it->second].kind = JournalRecord::Kind::cancel;
+                index.erase(it);
+            }
+            break;
+        case JournalRecord::Kind::commit:
+            commit = record;
+            break;
+        }
+    }
+    std::size_t kept = 0;
+    for (JournalRecord &record : live) {
+        if (record.kind != JournalRecord::Kind::schedule) {
+            continue;
+        }
+        if (commit && record.tick <= commit->tick) {
+            // Move the action past the runs it made up to the commit
+            if (record.interval <= 0) {
+                continue;
+            }
+            int runs = (commit->tick - record.tick) / record.interval + 1;
+            if (record.repeats != ScheduledAction::forever) {
+                if (runs > record.repeats) {
+                    continue;
+                }
+                record.repeats -= runs;
+            }
+            record.tick += runs * record.interval;
+        }
+        live[kept++] = record;
+    }
+    live.resize(kept);
+    if (commit) {
+        live.push_back(*commit);
+    }
+    return live;
+}
+
+/**
+ * @class SchedulerJournalLoader
+ * @brief Restores the actions a SchedulerJournal recorded before a crash
+ * @tparam Queue The queue backend of the scheduler
+ *
+ * Replays the committed records as replayJournal() does and adds the
+ * actions left pending in one bulk insertion, with new IDs.
+ */
+template <typename Queue> class SchedulerJournalLoader {
+  public:
+    SchedulerJournalLoader(BasicScheduler<Queue> &scheduler, const ActionHandlers &handlers)
+        : scheduler(scheduler), handlers(handlers) {}
+
+    /**
+     * @brief Replays a log and schedules the actions still pending
+     * @param records Records read with SchedulerJournal::read()
+     * @return The IDs of the restored actions, in log order
+     */
+    IdRange<ActionID> get(const std::vector<JournalRecord> &records) {
+        std::vector<JournalRecord> live = replayJournal(records);
+        std::vector<ScheduledAction> actions;
+        actions.reserve(live.size());
+        for (const JournalRecord &record : live) {
+            if (record.kind != JournalRecord::Kind::schedule) {
+                continue;
+            }
+            auto call = handlers.restore(record.payload);
+            if (!call) {
+                ++skippedRecords;
+                continue;
+            }
+            ScheduledAction action{0, record.tick, entt::entity{record.entity}, *call, nullptr};
+            action.interval = record.interval;
+            action.repeats = record.repeats;
+            actions.push_back(std::move(action));
+        }
+        return scheduler.scheduleBulk(actions.begin(), actions.end());
+    }
+
+    /**
+     * @brief Replays a journal's file, then checkpoints it under the new IDs
+     * @param journal An open journal, not attached to the scheduler yet
+     * @return false if the log could not be read or rewritten
+     */
+    bool recover(SchedulerJournal &journal) {
+        std::vector<JournalRecord> records;
+        if (!SchedulerJournal::read(journal.file(), records)) {
+            return false;
+        }
+        if (records.empty()) {
+            return journal.rewrite(records); // Nothing was committed
+        }
+        get(records);
+        int committed = 0;
+        for (const JournalRecord &record : records) {
+            committed = record.kind == JournalRecord::Kind::commit ? record.tick : committed;
+        }
+        return checkpointJournal(journal, scheduler, committed);
+    }
+
+    /// @brief Gets the number of records skipped because their handler is unknown
+    std::size_t skipped() const { return skippedRecords; }
+
+  private:
+    BasicScheduler<Queue> &scheduler;
+    const ActionHandlers &handlers;
+    std::size_t skippedRecords = 0;
+};
@@ -0,0 +1,244 @@
+/**
+ * @file SchedulerStats.h
+ * @brief Optional counters and histograms describing how a scheduler behaves under load.
+ *
+ * A SchedulerStats object is attached to one scheduler with setStats(). The
+ * scheduler's thread is its only writer and updates it with plain relaxed
+ * stores, so recording does not contend with readers; any other thread can
+ * take a StatsSnapshot at any time without locking. A scheduler without
+ * attached stats only pays for a null check per update and per work item.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class HistogramSnapshot
+ * @brief Copy of a LatencyHistogram, with percentile queries
+ *
+ * Values are grouped into log-linear buckets, like an HDR histogram with
+ * four bits of precision: values below 32 are exact, larger values fall in
+ * buckets no wider than 1/16 of their lower bound.
+ */
+class HistogramSnapshot {
+  public:
+    /// @brief Number of buckets, enough for any 64-bit value
+    static constexpr std::size_t bucketCount = 976;
+
+    /// @brief Gets the bucket a value is counted in
+    static constexpr std::size_t bucketOf(std::uint64_t value) {
+        if (value < 32) {
+            return static_cast<std::size_t>(value);
+        }
+        std::size_t width = 0;
+        for (std::uint64_t rest = value; rest != 0; rest >>= 1) {
+            ++width;
+        }
+        std::size_t shift = width - 5;
+        return 32 + (shift - 1) * 16 + static_cast<std::size_t>((value >> shift) - 16);
+    }
+
+    /// @brief Gets the largest value counted in a bucket
+    static constexpr std::uint64_t upperBound(std::size_t bucket) {
+        if (bucket < 32) {
+            return bucket;
+        }
+        std::size_t shift = (bucket - 32) / 16 + 1;
+        std::uint64_t top = (bucket - 32) % 16 + 16;
+        return ((top + 1) << shift) - 1;
+    }
+
+    /// @brief Gets the number of recorded values
+    std::uint64_t count() const { return total; }
+
+    /// @brief Gets the largest recorded value, 0 if nothing was recorded
+    std::uint64_t max() const { return largest; }
+
+    /// @brief Gets the sum of the recorded values, for the mean
+    std::uint64_t sum() const { return valueSum; }
+
+    /**
+     * @brief Gets a value that a share of the recorded values do not exceed
+     * @param quantile Share between 0 and 1, for example 0.99
+     * @return The upper bound of the bucket holding that rank, at most max()
+     */
+    std::uint64_t percentile(double quantile) const {
+        if (total == 0) {
+            return 0;
+        }
+        auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(total));
+        rank = rank < 1 ? 1 : (rank > total ? total : rank);
+        std::uint64_t seen = 0;
+        for (std::size_t bucket = 0; bucket < bucketCount; ++bucket) {
+            seen += counts[bucket];
+            if (seen >= rank) {
+                std::uint64_t bound = upperBound(bucket);
+                return bound < largest ? bound : largest;
+            }
+        }
+        return largest;
+    }
+
+    /// @brief Gets the number of values counted in a bucket
+    std::uint64_t bucket(std::size_t index) const { return counts[index]; }
+
+  private:
+    friend class LatencyHistogram;
+
+    std::array<std::uint64_t, bucketCount> counts{};
+    std::uint64_t total = 0;
+    std::uint64_t largest = 0;
+    std::uint64_t valueSum = 0;
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-linear histogram with one writer and any number of readers
+ */
+class LatencyHistogram {
+  public:
+    /// @brief Counts a value, called by the owning scheduler's thread only
+    void record(std::uint64_t value) {
+        bump(counts[HistogramSnapshot::bucketOf(value)], 1);
+        bump(valueSum, value);
+        if (value > largest.load(std::memory_order_relaxed)) {
+            largest.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Copies the histogram, from any thread
+    HistogramSnapshot snapshot() const {
+        HistogramSnapshot copy;
+        for (std::size_t i = 0; i < HistogramSnapshot::bucketCount; ++i) {
+            copy.counts[i] = counts[i].load(std::memory_order_relaxed);
+        }
+        // Counted from the copied buckets, which may move on while they are copied
+        copy.total = 0;
+        for (std::uint64_t value : copy.counts) {
+            copy.total += value;
+        }
+        copy.largest = largest.load(std::memory_order_relaxed);
+        copy.valueSum = valueSum.load(std::memory_order_relaxed);
+        return copy;
+    }
+
+    /// @brief Forgets every value, from the owning scheduler's thread
+    void reset() {
+        for (auto &count : counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        largest.store(0, std::memory_order_relaxed);
+        valueSum.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    friend class SchedulerStats;
+
+    /// Single-writer increment: a relaxed load and store, no read-modify-write
+    static void bump(std::atomic<std::uint64_t> &counter, std::uint64_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount,
+                      std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, HistogramSnapshot::bucketCount> counts{};
+    std::atomic<std::uint64_t> largest{0};
+    std::atomic<std::uint64_t> valueSum{0};
+};
+
+/**
+ * @struct StatsSnapshot
+ * @brief Copy of a SchedulerStats taken by SchedulerStats::snapshot()
+ */
+struct StatsSnapshot {
+    std::uint64_t updates = 0;        ///< Calls to update() and updateParallel()
+    std::uint64_t executed = 0;       ///< Work items run
+    std::uint64_t skipped = 0;        ///< Due items dropped: cancelled in their tick, entity gone
+    std::uint64_t cancelled = 0;      ///< Successful cancellations
+    std::uint64_t queueDepth = 0;     ///< Queued items at the end of the last update
+    std::uint64_t peakQueueDepth = 0; ///< Most queued items seen at the start of an update
+    HistogramSnapshot lateness;       ///< Ticks from the due tick to the tick an item ran at
+    HistogramSnapshot duration;       ///< Nanoseconds spent running an item, sequential runs only
+};
+
+/**
+ * @class SchedulerStats
+ * @brief Counters and histograms filled in by the scheduler it is attached to
+ *
+ * @code
+ * SchedulerStats stats;
+ * scheduler.setStats(&stats);
+ * // On the metrics thread:
+ * StatsSnapshot now = stats.snapshot();
+ * report("lateness_p99", now.lateness.percentile(0.99));
+ * @endcode
+ */
+class SchedulerStats {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /// @brief Copies every counter and histogram, from any thread
+    StatsSnapshot snapshot() const {
+        StatsSnapshot copy;
+        copy.updates = updates.load(std::memory_order_relaxed);
+        copy.executed = executed.load(std::memory_order_relaxed);
+        copy.skipped = skipped.load(std::memory_order_relaxed);
+        copy.cancelled = cancelled.load(std::memory_order_relaxed);
+        copy.queueDepth = queueDepth.load(std::memory_order_relaxed);
+        copy.peakQueueDepth = peakQueueDepth.load(std::memory_order_relaxed);
+        copy.lateness = lateness.snapshot();
+        copy.duration = duration.snapshot();
+        return copy;
+    }
+
+    /// @brief Zeroes every counter and histogram, from the scheduler's thread
+    void reset() {
+        for (auto *counter : {&updates, &executed, &skipped, &cancelled, &queueDepth,
+                              &peakQueueDepth}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+        lateness.reset();
+        duration.reset();
+    }
+
+    /// @name Recording, called by the scheduler
+    /// @{
+    void beginUpdate(std::size_t depth) {
+        LatencyHistogram::bump(updates, 1);
+        if (depth > peakQueueDepth.load(std::memory_order_relaxed)) {
+            peakQueueDepth.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    void endUpdate(std::size_t depth) { queueDepth.store(depth, std::memory_order_relaxed); }
+
+    void recordRun(int lateTicks, clock::duration spent) {
+        LatencyHistogram::bump(executed, 1);
+        lateness.record(lateTicks > 0 ? static_cast<std::uint64_t>(lateTicks) : 0);
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(spent).count();
+        duration.record(nanoseconds > 0 ? static_cast<std::uint64_t>(nanoseconds) : 0);
+    }
+
+    void recordRun(int lateTicks) {
+        LatencyHistogram::bump(executed, 1);
+        lateness.record(lateTicks > 0 ? static_cast<std::uint64_t>(lateTicks) : 0);
+    }
+
+    void recordSkip() { LatencyHistogram::bump(skipped, 1); }
+
+    void recordCancel(std::uint64_t count = 1) { LatencyHistogram::bump(cancelled, count); }
+    /// @}
+
+  private:
+    std::atomic<std::uint64_t> updates{0};
+    std::atomic<std::uint64_t> executed{0};
+    std::atomic<std::uint64_t> skipped{0};
+    std::atomic<std::uint64_t> cancelled{0};
+    std::atomic<std::uint64_t> queueDepth{0};
+    std::atomic<std::uint64_t> peakQueueDepth{0};
+    LatencyHistogram lateness;
+    LatencyHistogram duration;
+};
@@ -0,0 +1,324 @@
+/**
+ * @file SchedulerTrace.h
+ * @brief Per-item begin and end timestamps of scheduler updates, exported as trace files.
+ *
+ * When a tick spikes, a trace shows which actions or events took the time.
+ * A SchedulerTrace attached to a scheduler with setTrace() gives every thread
+ * that updates a scheduler its own ring buffer of fixed-size records, written
+ * without locks or allocation. The newest records of every thread can then be
+ * written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) or as a
+ * Perfetto protobuf trace.
+ */
+#pragma once
+
+#include "EventName.h"
+#include "entt/entt.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct TraceRecord
+ * @brief One executed action or event
+ */
+struct TraceRecord {
+    /// @brief What kind of work a record describes
+    enum class Source : std::uint8_t { action, event };
+
+    std::uint64_t begin;  ///< steady_clock time the item started at, in nanoseconds
+    std::uint64_t end;    ///< steady_clock time the item finished at, in nanoseconds
+    std::uint32_t id;     ///< ActionID or EventID
+    entt::id_type name;   ///< Hash of the event name, 0 for actions and unnamed events
+    std::uint32_t entity; ///< Entity of an action, entt::null for events
+    std::int32_t tick;    ///< Tick the item was due at
+    Source source;        ///< Scheduler that ran the item
+};
+
+/**
+ * @class TraceBuffer
+ * @brief Ring of the newest records written by one thread
+ *
+ * Only the owning thread writes. Older records are overwritten once the ring
+ * is full, so the ring always holds the newest capacity() records.
+ */
+class TraceBuffer {
+  public:
+    /**
+     * @param capacity Number of records kept, rounded up to a power of two
+     * @param thread Identifier of the writing thread in exported traces
+     */
+    TraceBuffer(std::size_t capacity, std::uint32_t thread) : thread(thread) {
+        std::size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        records.resize(size);
+        mask = size - 1;
+    }
+
+    /// @brief Appends a record, from the owning thread
+    void record(const TraceRecord &entry) {
+        std::uint64_t next = written.load(std::memory_order_relaxed);
+        records[next & mask] = entry;
+        written.store(next + 1, std::memory_order_release);
+    }
+
+    /// @brief Gets the number of records written so far, including overwritten ones
+    std::uint64_t recorded() const { return written.load(std::memory_order_acquire); }
+
+    /// @brief Gets the number of records the ring keeps
+    std::size_t capacity() const { return records.size(); }
+
+    /// @brief Gets the identifier of the writing thread in exported traces
+    std::uint32_t threadId() const { return thread; }
+
+    /**
+     * @brief Visits the kept records, oldest first
+     *
+     * Call while the owning thread is not updating a traced scheduler.
+     */
+    template <typename F> void forEach(F &&fn) const {
+        std::uint64_t last = recorded();
+        std::uint64_t first = last > records.size() ? last - records.size() : 0;
+        for (std::uint64_t i = first; i < last; ++i) {
+            fn(records[i & mask]);
+        }
+    }
+
+    /// @brief Forgets every record, from the owning thread or while it is idle
+    void clear() { written.store(0, std::memory_order_release); }
+
+  private:
+    std::vector<TraceRecord> records;
+    std::uint64_t mask = 0;
+    std::atomic<std::uint64_t> written{0};
+    std::uint32_t thread;
+};
+
+/**
+ * @class SchedulerTrace
+ * @brief Per-thread trace buffers shared by any number of schedulers
+ *
+ * A thread gets its buffer the first time it updates a scheduler with this
+ * trace attached; after that, local() is one thread_local lookup. Export or
+ * clear the trace between updates, since buffers are read without locking
+ * out their writers.
+ *
+ * @code
+ * SchedulerTrace trace;
+ * scheduler.setTrace(&trace);
+ * eventScheduler.setTrace(&trace);
+ * // ... a slow frame ...
+ * std::ofstream file("frame.json");
+ * trace.writeChromeJson(file);
+ * @endcode
+ */
+class SchedulerTrace {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /// @param capacity Records kept per thread
+    explicit SchedulerTrace(std::size_t capacity = 1 << 16)
+        : perThread(capacity), serial(nextSerial()) {}
+
+    SchedulerTrace(const SchedulerTrace &) = delete;
+    SchedulerTrace &operator=(const SchedulerTrace &) = delete;
+
+    /// @brief Gets the current time in the unit of TraceRecord::begin and end
+    static std::uint64_t now() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              clock::now().time_since_epoch())
+                                              .count());
+    }
+
+    /// @brief Gets the buffer of the calling thread, creating it on first use
+    TraceBuffer &local() {
+        thread_local Cached cached;
+        if (cached.owner != serial) {
+            cached.buffer = &attach();
+            cached.owner = serial;
+        }
+        return *cached.buffer;
+    }
+
+    /// @brief Visits every buffer, in the order threads first recorded
+    template <typename F> void forEachBuffer(F &&fn) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &buffer : buffers) {
+            fn(*buffer);
+        }
+    }
+
+    /// @brief Forgets every record of every thread, between updates
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &buffer : buffers) {
+            buffer->clear();
+        }
+    }
+
+    /**
+     * @brief Writes the kept records as Chrome trace event JSON
+     * @param out Stream receiving one complete JSON document
+     *
+     * Every record becomes a complete ("X") event named after the event, or
+     * "action" for actions, with the ID, tick and entity as arguments.
+     */
+    void writeChromeJson(std::ostream &out) const {
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        forEachBuffer([&](const TraceBuffer &buffer) {
+            buffer.forEach([&](const TraceRecord &record) {
+                out << (first ? "\n" : ",\n");
+                first = false;
+                out << "{\"name\":\"";
+                writeEscaped(out, label(record));
+                out << "\",\"cat\":\""
+                    << (record.source == TraceRecord::Source::action ? "action" : "event")
+                    << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.threadId() << ",\"ts\":";
+                writeMicroseconds(out, record.begin);
+                out << ",\"dur\":";
+                writeMicroseconds(out, record.end - record.begin);
+                out << ",\"args\":{\"id\":" << record.id << ",\"tick\":" << record.tick;
+                if (record.entity != entt::to_integral(entt::entity{entt::null})) {
+                    out << ",\"entity\":" << record.entity;
+                }
+                out << "}}";
+            });
+        });
+        out << "\n]}\n";
+    }
+
+    /**
+     * @brief Writes the kept records as a Perfetto protobuf trace
+     * @param out Binary stream receiving a serialized perfetto.protos.Trace
+     *
+     * Each thread becomes a track holding one slice per record. Slice
+     * arguments are left out; the Chrome JSON export carries them.
+     */
+    void writePerfetto(std::ostream &out) const {
+        std::string trace;
+        std::string packet;
+        std::string body;
+        forEachBuffer([&](const TraceBuffer &buffer) {
+            std::uint64_t track = buffer.threadId() + 1;
+            std::string name = "scheduler thread " + std::to_string(buffer.threadId());
+            body.clear();
+            putVarint(body, 1, track);             // TrackDescriptor.uuid
+            putBytes(body, 2, name);               // TrackDescriptor.name
+            packet.clear();
+            putBytes(packet, 60, body);            // TracePacket.track_descriptor
+            putVarint(packet, 10, sequenceId);     // TracePacket.trusted_packet_sequence_id
+            putBytes(trace, 1, packet);            // Trace.packet
+            buffer.forEach([&](const TraceRecord &record) {
+                for (bool begins : {true, false}) {
+                    body.clear();
+                    putVarint(body, 9, begins ? 1 : 2); // TrackEvent.type, slice begin or end
+                    putVarint(body, 11, track);         // TrackEvent.track_uuid
+                    if (begins) {
+                        putBytes(body, 23, label(record)); // TrackEvent.name
+                    }
+                    packet.clear();
+                    putVarint(packet, 8, begins ? record.begin : record.end); // timestamp
+                    putBytes(packet, 11, body);                               // track_event
+                    putVarint(packet, 10, sequenceId);
+                    putBytes(trace, 1, packet);
+                }
+            });
+        });
+        out.write(trace.data(), static_cast<std::streamsize>(trace.size()));
+    }
+
+  private:
+    struct Cached {
+        std::uint64_t owner = 0;
+        TraceBuffer *buffer = nullptr;
+    };
+
+    static std::uint64_t nextSerial() {
+        static std::atomic<std::uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    /// Finds or creates the buffer of the calling thread
+    TraceBuffer &attach() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::thread::id self = std::this_thread::get_id();
+        for (std::size_t i = 0; i < owners.size(); ++i) {
+            if (owners[i] == self) {
+                return *buffers[i];
+            }
+        }
+        owners.push_back(self);
+        buffers.push_back(
+            std::make_unique<TraceBuffer>(perThread, static_cast<std::uint32_t>(buffers.size())));
+        return *buffers.back();
+    }
+
+    static std::string label(const TraceRecord &record) {
+        if (record.source == TraceRecord::Source::action) {
+            return "action";
+        }
+        std::string_view text = EventNames::lookup(record.name);
+        if (!text.empty()) {
+            return std::string(text);
+        }
+        return record.name == 0 ? "event" : "event " + std::to_string(record.name);
+    }
+
+    static void writeEscaped(std::ostream &out, std::string_view text) {
+        static constexpr char hex[] = "0123456789abcdef";
+        for (char c : text) {
+            auto byte = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (byte < 0x20) {
+                out << "\\u00" << hex[byte >> 4] << hex[byte & 15];
+            } else {
+                out << c;
+            }
+        }
+    }
+
+    static void writeMicroseconds(std::ostream &out, std::uint64_t nanoseconds) {
+        std::string fraction = std::to_string(nanoseconds % 1000);
+        out << nanoseconds / 1000 << '.' << std::string(3 - fraction.size(), '0') << fraction;
+    }
+
+    /// Appends a protobuf varint field
+    static void putVarint(std::string &out, std::uint64_t field, std::uint64_t value) {
+        putRaw(out, field << 3);
+        putRaw(out, value);
+    }
+
+    /// Appends a length-delimited protobuf field
+    static void putBytes(std::string &out, std::uint64_t field, std::string_view bytes) {
+        putRaw(out, field << 3 | 2);
+        putRaw(out, bytes.size());
+        out.append(bytes.data(), bytes.size());
+    }
+
+    static void putRaw(std::string &out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static constexpr std::uint64_t sequenceId = 1;
+
+    std::size_t perThread;
+    std::uint64_t serial; ///< Tells thread_local caches of different traces apart
+    mutable std::mutex mutex;
+    std::vector<std::thread::id> owners;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+};
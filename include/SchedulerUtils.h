@@ -1,8 +1,13 @@
 #pragma once
 
+#include "ActionHandlers.h"
+#include "RoutedScheduler.h"
 #include "Scheduler.h"
 #include "TimedEventScheduler.h"
+#include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <type_traits>
 #include <vector>
 
 // Simple component for health
@@ -11,21 +16,37 @@ struct Health {
   int max = 100;
 };
 
+// Damage over time effects of an entity, applied by
+// SchedulerUtils::updateDamageOverTime instead of one queued action per hit
+struct DamageOverTime {
+  struct Effect {
+    int damage = 0;
+    int nextTick = 0;  // Tick of the next hit
+    int interval = 0;  // Ticks between hits
+    int remaining = 0; // Hits left, including the next one
+    std::function<void(entt::entity, int)> onDamage;
+  };
+
+  std::vector<Effect> effects; // In the order they were applied
+};
+
 namespace SchedulerUtils {
 
 // Schedule damage over time (like poison, burning, etc.)
-inline std::vector<ActionID> scheduleDamageOverTime(
+// Returns one handle for every hit, so cancelGroup() cures the effect at once.
+inline ActionGroup scheduleDamageOverTime(
     Scheduler &scheduler, entt::entity target, int damage, int totalTicks,
     int interval, int startTick,
     std::function<void(entt::entity, int)> onDamage = nullptr) {
 
-  std::vector<ActionID> actionIds;
+  std::vector<ScheduledAction> actions;
+  actions.reserve(totalTicks > 0 ? totalTicks : 0);
 
   for (int i = 0; i < totalTicks; ++i) {
     int tick = startTick + (i * interval);
 
-    ActionID id = scheduler.schedule(
-        tick, target,
+    actions.push_back(ScheduledAction{
+        0, tick, target,
         [damage, onDamage](entt::entity entity, entt::registry &registry) {
           if (registry.valid(entity) && registry.all_of<Health>(entity)) {
             auto &health = registry.get<Health>(entity);
@@ -35,12 +56,75 @@ inline std::vector<ActionID> scheduleDamageOverTime(
               onDamage(entity, damage);
             }
           }
-        });
+        },
+        nullptr});
+  }
 
-    actionIds.push_back(id);
+  // One bulk insertion instead of totalTicks separate ones
+  return scheduler.scheduleGroup(actions.begin(), actions.end());
+}
+
+// Apply damage over time as a DamageOverTime effect on the target instead of
+// totalTicks queued actions. Hits land at the same ticks as with
+// scheduleDamageOverTime once updateDamageOverTime runs every tick.
+inline void applyDamageOverTime(
+    entt::registry &registry, entt::entity target, int damage, int totalTicks,
+    int interval, int startTick,
+    std::function<void(entt::entity, int)> onDamage = nullptr) {
+
+  if (totalTicks <= 0 || !registry.valid(target)) {
+    return;
   }
+  registry.get_or_emplace<DamageOverTime>(target).effects.push_back(
+      DamageOverTime::Effect{damage, startTick, interval, totalTicks,
+                             std::move(onDamage)});
+}
+
+// Land the damage over time hits due up to currentTick, in one pass over the
+// entities that have both Health and DamageOverTime. Effects of entities
+// without Health still use up their hits, as the individual actions would.
+// onDamage may read and write components but must not destroy entities or
+// add or remove Health or DamageOverTime while the pass runs.
+inline void updateDamageOverTime(entt::registry &registry, int currentTick) {
+  auto expire = [currentTick](DamageOverTime &dot, Health *health,
+                              entt::entity entity) {
+    for (DamageOverTime::Effect &effect : dot.effects) {
+      for (; effect.remaining > 0 && effect.nextTick <= currentTick;
+           --effect.remaining, effect.nextTick += effect.interval) {
+        if (health != nullptr) {
+          health->current -= effect.damage;
+          if (effect.onDamage) {
+            effect.onDamage(entity, effect.damage);
+          }
+        }
+      }
+    }
+  };
 
-  return actionIds;
+  std::vector<entt::entity> finished;
+  auto finish = [&finished](DamageOverTime &dot, entt::entity entity) {
+    auto done = [](const DamageOverTime::Effect &effect) {
+      return effect.remaining <= 0;
+    };
+    dot.effects.erase(
+        std::remove_if(dot.effects.begin(), dot.effects.end(), done),
+        dot.effects.end());
+    if (dot.effects.empty()) {
+      finished.push_back(entity);
+    }
+  };
+
+  for (auto [entity, health, dot] :
+       registry.view<Health, DamageOverTime>().each()) {
+    expire(dot, &health, entity);
+    finish(dot, entity);
+  }
+  for (auto [entity, dot] :
+       registry.view<DamageOverTime>(entt::exclude<Health>).each()) {
+    expire(dot, nullptr, entity);
+    finish(dot, entity);
+  }
+  registry.remove<DamageOverTime>(finished.begin(), finished.end());
 }
 
 // Schedule an attack with a callback when done
@@ -68,46 +152,195 @@ inline ActionID scheduleAttack(
       });
 }
 
+// Payload of an attack whose target may live on another node
+struct RoutedAttack {
+  RemoteEntity attacker;
+  int damage;
+};
+
+// Handler of routed attacks, run on the target's node
+inline void applyRoutedAttack(entt::entity target, entt::registry &registry,
+                              const RoutedAttack &attack) {
+  if (registry.valid(target) && registry.all_of<Health>(target)) {
+    registry.get<Health>(target).current -= attack.damage;
+  }
+}
+
+// Registers applyRoutedAttack on every node taking part in routed attacks
+inline void registerRoutedAttack(ActionHandlers &handlers) {
+  using namespace entt::literals;
+  handlers.add<RoutedAttack, &applyRoutedAttack>("SchedulerUtils::attack"_hs);
+}
+
+// Schedule an attack on a target that may be owned by another node
+// Local targets are scheduled directly; remote ones are batched until the
+// router's next flush(). Returns 0 when the attack was routed.
+inline ActionID scheduleAttack(RoutedScheduler<> &router,
+                               entt::entity attacker, RemoteEntity target,
+                               int damage, int tick) {
+  using namespace entt::literals;
+  return router.schedule(tick, target, "SchedulerUtils::attack"_hs,
+                         RoutedAttack{router.local(attacker), damage});
+}
+
 // Schedule a delayed action on an entity
-inline ActionID scheduleDelayedAction(
-    Scheduler &scheduler, entt::entity entity, int delayTicks, int currentTick,
-    std::function<void(entt::entity, entt::registry &)> action) {
+inline ActionID scheduleDelayedAction(Scheduler &scheduler, entt::entity entity,
+                                      int delayTicks, int currentTick,
+                                      ActionFunction action) {
 
   return scheduler.schedule(currentTick + delayTicks, entity,
                             std::move(action));
 }
 
-// Schedule a recurring action
-inline std::vector<ActionID> scheduleRecurringAction(
+// Schedule a recurring action, returning the group of its runs
+inline ActionGroup scheduleRecurringAction(
     Scheduler &scheduler, entt::entity entity, int interval, int count,
     int startTick, std::function<void(entt::entity, entt::registry &)> action) {
 
-  std::vector<ActionID> actionIds;
+  std::vector<ScheduledAction> actions;
+  actions.reserve(count > 0 ? count : 0);
 
   for (int i = 0; i < count; ++i) {
     int tick = startTick + (i * interval);
-    ActionID id = scheduler.schedule(tick, entity, action);
-    actionIds.push_back(id);
+    actions.push_back(ScheduledAction{0, tick, entity, action, nullptr});
   }
 
-  return actionIds;
+  return scheduler.scheduleGroup(actions.begin(), actions.end());
+}
+
+// Schedule a recurring action as a single periodic entry. Unlike
+// scheduleRecurringAction, all runs share one ID and one queue slot.
+inline ActionID schedulePeriodicAction(
+    Scheduler &scheduler, entt::entity entity, int interval, int count,
+    int startTick, ActionFunction action) {
+
+  return scheduler.schedulePeriodic(startTick, interval, count, entity,
+                                    std::move(action));
 }
 
 // Schedule an action chain (one after another)
-inline std::vector<ActionID> scheduleActionChain(
+// Every step is queued up front at its absolute tick and gets its own ID; use
+// Scheduler::scheduleChain for steps that queue each other with relative delays.
+// Returns the group of the steps, so cancelGroup() stops the rest of the chain.
+inline ActionGroup scheduleActionChain(
     Scheduler &scheduler, entt::entity entity,
     std::vector<
         std::pair<int, std::function<void(entt::entity, entt::registry &)>>>
         actions) {
 
-  std::vector<ActionID> actionIds;
+  std::vector<ScheduledAction> steps;
+  steps.reserve(actions.size());
+
+  // The steps are owned by this call, so move them instead of copying
+  for (auto &[delay, action] : actions) {
+    steps.push_back(ScheduledAction{0, delay, entity, std::move(action), nullptr});
+  }
+
+  return scheduler.scheduleGroup(steps.begin(), steps.end());
+}
+
+// What every mob of a wave spawned by spawnWave gets
+struct WaveSpec {
+  EventName mobType;     // Sent in each EntitySpawnEvent
+  Health health;         // Health component of each mob
+  int thinkInterval = 0; // Ticks between AI runs, 0 for no AI action
+  int thinkSlack = 0;    // Ticks each AI run may move by, see Scheduler::enableSpreading
+  int dotDamage = 0;     // Damage per hit of a damage over time, 0 for none
+  int dotHits = 0;       // Number of damage over time hits
+  int dotInterval = 1;   // Ticks between damage over time hits
+};
+
+// Where one mob of a wave appears
+struct SpawnPoint {
+  int x;
+  int y;
+};
+
+// Handles to what spawnWave created
+struct SpawnedWave {
+  std::vector<entt::entity> mobs; // In the order of the spawn points
+  IdRange<ActionID> think;        // Periodic AI action of each mob, in mob order
+  ActionGroup damage = 0;         // Every damage over time action, 0 if none
+};
+
+// Queues one event per element of a range, with one insertion on a
+// StaticDispatcher and one enqueue per event on an entt::dispatcher
+template <typename Event, typename It>
+void enqueueAll(entt::dispatcher &dispatcher, It first, It last) {
+  for (; first != last; ++first) {
+    dispatcher.enqueue<Event>(*first);
+  }
+}
+
+template <typename Event, typename It, typename... Events>
+void enqueueAll(StaticDispatcher<Events...> &dispatcher, It first, It last) {
+  dispatcher.template enqueueBulk<Event>(first, last);
+}
+
+// Spawn a wave of mobs, one per spawn point, in a few linear passes:
+// the entities are created with one range create(), their Health with one
+// range insert(), their EntitySpawnEvents queued as one batch, and their AI
+// and damage over time actions inserted with one bulk scheduling call each.
+// think is copied into the periodic AI action of every mob, first run at
+// tick + thinkInterval; pass an ActionHandlers::Call to keep the actions
+// saveable. The damage over time hits every mob from tick + dotInterval on,
+// as one periodic action per mob, all of them in one group.
+template <typename Think = std::nullptr_t>
+SpawnedWave spawnWave(Scheduler &scheduler, entt::registry &registry,
+                      EventDispatcher &dispatcher, int tick,
+                      const WaveSpec &spec,
+                      const std::vector<SpawnPoint> &points,
+                      const Think &think = nullptr) {
+  SpawnedWave wave;
+  wave.mobs.resize(points.size());
+  if (points.empty()) {
+    return wave;
+  }
+  registry.create(wave.mobs.begin(), wave.mobs.end());
+  registry.insert<Health>(wave.mobs.begin(), wave.mobs.end(), spec.health);
 
-  for (const auto &[delay, action] : actions) {
-    ActionID id = scheduler.schedule(delay, entity, action);
-    actionIds.push_back(id);
+  std::vector<GameEvents::EntitySpawnEvent> events;
+  events.reserve(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    events.push_back(GameEvents::EntitySpawnEvent{wave.mobs[i], points[i].x,
+                                                  points[i].y, spec.mobType});
   }
+  enqueueAll<GameEvents::EntitySpawnEvent>(dispatcher, events.begin(),
+                                           events.end());
 
-  return actionIds;
+  std::vector<ScheduledAction> actions;
+  if constexpr (!std::is_null_pointer_v<Think>) {
+    if (spec.thinkInterval > 0) {
+      actions.reserve(points.size());
+      for (entt::entity mob : wave.mobs) {
+        ScheduledAction action{0, tick + spec.thinkInterval, mob, think, nullptr};
+        action.interval = spec.thinkInterval;
+        action.repeats = ScheduledAction::forever;
+        action.slack = spec.thinkSlack;
+        actions.push_back(std::move(action));
+      }
+      wave.think = scheduler.scheduleBulk(actions.begin(), actions.end());
+      actions.clear();
+    }
+  }
+
+  if (spec.dotDamage != 0 && spec.dotHits > 0 && spec.dotInterval > 0) {
+    actions.reserve(points.size());
+    auto hit = [damage = spec.dotDamage](entt::entity entity,
+                                         entt::registry &registry) {
+      if (auto *health = registry.try_get<Health>(entity)) {
+        health->current -= damage;
+      }
+    };
+    for (entt::entity mob : wave.mobs) {
+      ScheduledAction action{0, tick + spec.dotInterval, mob, hit, nullptr};
+      action.interval = spec.dotInterval;
+      action.repeats = spec.dotHits - 1;
+      actions.push_back(std::move(action));
+    }
+    wave.damage = scheduler.scheduleGroup(actions.begin(), actions.end());
+  }
+  return wave;
 }
 
 } // namespace SchedulerUtils
\ No newline at end of file
@@ -0,0 +1,307 @@
+/**
+ * @file SchedulerWatchdog.h
+ * @brief Sampled callback costs per handler or event, and a log of the slowest runs.
+ *
+ * SchedulerStats says that a tick's callbacks were slow, SchedulerTrace says
+ * which runs of the last few frames were; neither says which handler is
+ * costly over hours of play. A SchedulerWatchdog attached to either scheduler
+ * with setWatchdog() times one run in every few, adds its duration to the
+ * totals of what ran (an ActionHandlers handler, a batch handler, a lambda
+ * type, an event name or an event type), and logs every timed run over a
+ * threshold, with its tick and entity, into a fixed ring of offenders.
+ *
+ * The scheduler's thread is the only writer. A run that is not sampled costs
+ * one decrement; a sampled run takes two clock reads and a short lock, which
+ * a diagnostics thread also takes to copy the totals or the offenders.
+ */
+#pragma once
+
+#include "EventName.h"
+#include "FlatMap.h"
+#include "SchedulerTrace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+
+/// @brief What a sampled cost is attributed to
+enum class CostSource : std::uint8_t {
+    handler,   ///< A handler of ActionHandlers or EventHandlers, by its ID
+    batch,     ///< A BatchCall handler, by its address
+    callable,  ///< Any other action, by the type of its callable
+    event,     ///< A named event, by the hash of its name
+    eventType, ///< An unnamed event, by its dynamic type
+};
+
+/// @brief Gets the name of a cost source, as written in reports
+constexpr std::string_view costSourceName(CostSource source) {
+    switch (source) {
+    case CostSource::handler:
+        return "handler";
+    case CostSource::batch:
+        return "batch";
+    case CostSource::callable:
+        return "callable";
+    case CostSource::event:
+        return "event";
+    case CostSource::eventType:
+        return "event_type";
+    }
+    return "unknown";
+}
+
+/**
+ * @struct CostKey
+ * @brief What a run is attributed to
+ *
+ * Handler IDs and event names are stable across runs. The other keys are
+ * addresses, stable within one process only.
+ */
+struct CostKey {
+    CostSource source = CostSource::callable; ///< Kind of key
+    std::uint64_t value = 0;                  ///< Handler ID, name hash or address
+
+    /// @brief Keys an event by its dynamic type
+    static CostKey ofType(const std::type_info &type) {
+        return CostKey{CostSource::eventType, reinterpret_cast<std::uintptr_t>(&type)};
+    }
+
+    bool operator==(const CostKey &other) const {
+        return source == other.source && value == other.value;
+    }
+    bool operator!=(const CostKey &other) const { return !(*this == other); }
+};
+
+/// @brief Hash of a CostKey
+struct CostKeyHash {
+    std::size_t operator()(const CostKey &key) const noexcept {
+        std::uint64_t mixed = (key.value ^ static_cast<std::uint64_t>(key.source) << 59) *
+                              0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>(mixed ^ mixed >> 32);
+    }
+};
+
+/**
+ * @struct CallbackCost
+ * @brief Sampled runs of one key
+ */
+struct CallbackCost {
+    CostKey key;                  ///< What the runs are attributed to
+    std::uint64_t samples = 0;    ///< Number of timed runs
+    std::uint64_t totalNanos = 0; ///< Summed duration of the timed runs
+    std::uint64_t maxNanos = 0;   ///< Longest timed run
+    std::uint64_t slow = 0;       ///< Timed runs over the threshold
+
+    /// @brief Gets the mean duration of a timed run, 0 if none was timed
+    std::uint64_t meanNanos() const { return samples == 0 ? 0 : totalNanos / samples; }
+};
+
+/**
+ * @struct SlowRun
+ * @brief A timed run over the watchdog's threshold
+ */
+struct SlowRun {
+    std::uint64_t end = 0;    ///< steady_clock time the run finished at, in nanoseconds
+    std::uint64_t nanos = 0;  ///< Duration of the run
+    CostKey key;              ///< What ran
+    std::uint32_t id = 0;     ///< ActionID or EventID
+    std::uint32_t entity = 0; ///< Entity of an action, entt::null for events
+    std::int32_t tick = 0;    ///< Tick the run was due at
+};
+
+/**
+ * @struct WatchdogOptions
+ * @brief What a SchedulerWatchdog times and logs
+ */
+struct WatchdogOptions {
+    /// @brief Times one run in this many, 1 to time every run
+    std::uint32_t sampleEvery = 16;
+
+    /// @brief Timed runs longer than this are logged as offenders
+    std::chrono::nanoseconds threshold = std::chrono::milliseconds(1);
+
+    /// @brief Number of offenders kept, the oldest are overwritten first
+    std::size_t offenderCapacity = 256;
+};
+
+/**
+ * @class SchedulerWatchdog
+ * @brief Attributes sampled callback durations to handlers and logs slow runs
+ *
+ * One watchdog may be attached to several schedulers updated by the same
+ * thread. While statistics or a trace are attached to a scheduler, it times
+ * every run anyway, and the watchdog is given every run rather than a sample.
+ * updateParallel() runs are not sampled.
+ *
+ * @code
+ * SchedulerWatchdog watchdog({8, std::chrono::microseconds(500)});
+ * scheduler.setWatchdog(&watchdog);
+ * eventScheduler.setWatchdog(&watchdog);
+ * // On the diagnostics thread
+ * for (const CallbackCost &cost : watchdog.costs()) { ... } // Costliest first
+ * watchdog.writeJson(response);
+ * @endcode
+ */
+class SchedulerWatchdog {
+  public:
+    /// @brief Creates a watchdog, the offender ring is allocated here
+    explicit SchedulerWatchdog(const WatchdogOptions &options = {}) : settings(options) {
+        settings.sampleEvery = std::max<std::uint32_t>(settings.sampleEvery, 1);
+        countdown = settings.sampleEvery;
+        ring.resize(std::max<std::size_t>(settings.offenderCapacity, 1));
+    }
+
+    SchedulerWatchdog(const SchedulerWatchdog &) = delete;
+    SchedulerWatchdog &operator=(const SchedulerWatchdog &) = delete;
+
+    /// @brief Gets the options the watchdog was created with
+    const WatchdogOptions &options() const { return settings; }
+
+    /**
+     * @brief Decides whether the next run is timed, called by the scheduler's thread
+     * @return true for one call in sampleEvery
+     */
+    bool sample() {
+        if (--countdown != 0) {
+            return false;
+        }
+        countdown = settings.sampleEvery;
+        return true;
+    }
+
+    /**
+     * @brief Records a timed run, called by the scheduler's thread
+     * @param key What ran
+     * @param begin Time the run started at, from SchedulerTrace::now()
+     * @param end Time the run finished at
+     * @param id ActionID or EventID
+     * @param entity Entity of an action, entt::null for events
+     * @param tick Tick the run was due at
+     */
+    void record(const CostKey &key, std::uint64_t begin, std::uint64_t end, std::uint32_t id,
+                std::uint32_t entity, int tick) {
+        std::uint64_t nanos = end - begin;
+        bool slow = nanos > static_cast<std::uint64_t>(settings.threshold.count());
+        std::lock_guard<std::mutex> lock(mutex);
+        auto [it, added] = totals.try_emplace(key);
+        CallbackCost &cost = it->second;
+        if (added) {
+            cost.key = key;
+        }
+        ++cost.samples;
+        cost.totalNanos += nanos;
+        cost.maxNanos = std::max(cost.maxNanos, nanos);
+        if (slow) {
+            ++cost.slow;
+            ring[offenderTotal % ring.size()] = SlowRun{end, nanos, key, id, entity, tick};
+            ++offenderTotal;
+        }
+    }
+
+    /// @brief Copies the totals of every key, costliest first, from any thread
+    std::vector<CallbackCost> costs() const {
+        std::vector<CallbackCost> copy;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            copy.reserve(totals.size());
+            for (const auto &entry : totals) {
+                copy.push_back(entry.second);
+            }
+        }
+        std::sort(copy.begin(), copy.end(), [](const CallbackCost &a, const CallbackCost &b) {
+            return a.totalNanos > b.totalNanos;
+        });
+        return copy;
+    }
+
+    /// @brief Copies the logged offenders, oldest first, from any thread
+    std::vector<SlowRun> offenders() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::size_t kept = static_cast<std::size_t>(std::min<std::uint64_t>(offenderTotal,
+                                                                            ring.size()));
+        std::vector<SlowRun> copy;
+        copy.reserve(kept);
+        for (std::uint64_t i = offenderTotal - kept; i < offenderTotal; ++i) {
+            copy.push_back(ring[i % ring.size()]);
+        }
+        return copy;
+    }
+
+    /// @brief Gets the number of offenders logged so far, including overwritten ones
+    std::uint64_t offenderCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return offenderTotal;
+    }
+
+    /// @brief Forgets the totals and the offenders, from any thread
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        totals.clear();
+        offenderTotal = 0;
+    }
+
+    /**
+     * @brief Writes the totals and the offenders as one JSON object
+     * @param out The stream, for example the body of a diagnostics response
+     *
+     * Named events are labelled with their text when it was interned, and
+     * unnamed events with their type's implementation-defined name.
+     */
+    void writeJson(std::ostream &out) const {
+        std::vector<CallbackCost> costList = costs();
+        std::vector<SlowRun> slowList = offenders();
+        out << "{\"sampleEvery\":" << settings.sampleEvery
+            << ",\"thresholdNs\":" << settings.threshold.count() << ",\"costs\":[";
+        for (std::size_t i = 0; i < costList.size(); ++i) {
+            const CallbackCost &cost = costList[i];
+            out << (i == 0 ? "" : ",") << '{';
+            writeKey(out, cost.key);
+            out << ",\"samples\":" << cost.samples << ",\"totalNs\":" << cost.totalNanos
+                << ",\"meanNs\":" << cost.meanNanos() << ",\"maxNs\":" << cost.maxNanos
+                << ",\"slow\":" << cost.slow << '}';
+        }
+        out << "],\"offenders\":[";
+        for (std::size_t i = 0; i < slowList.size(); ++i) {
+            const SlowRun &run = slowList[i];
+            out << (i == 0 ? "" : ",") << '{';
+            writeKey(out, run.key);
+            out << ",\"id\":" << run.id << ",\"entity\":" << run.entity
+                << ",\"tick\":" << run.tick << ",\"ns\":" << run.nanos << ",\"end\":" << run.end
+                << '}';
+        }
+        out << "]}";
+    }
+
+  private:
+    static void writeKey(std::ostream &out, const CostKey &key) {
+        out << "\"source\":\"" << costSourceName(key.source) << "\",\"key\":" << key.value;
+        std::string_view label;
+        if (key.source == CostSource::event) {
+            label = EventName::fromId(static_cast<entt::id_type>(key.value)).text();
+        } else if (key.source == CostSource::eventType) {
+            label = reinterpret_cast<const std::type_info *>(key.value)->name();
+        }
+        if (!label.empty()) {
+            out << ",\"label\":\"";
+            for (char c : label) {
+                if (c == '"' || c == '\\') {
+                    out << '\\';
+                }
+                out << c;
+            }
+            out << '"';
+        }
+    }
+
+    WatchdogOptions settings;
+    std::uint32_t countdown = 1; ///< Runs left until the next sample, only the writer reads it
+    mutable std::mutex mutex;    ///< Guards the totals and the ring
+    FlatMap<CostKey, CallbackCost, CostKeyHash> totals;
+    std::vector<SlowRun> ring;
+    std::uint64_t offenderTotal = 0;
+};
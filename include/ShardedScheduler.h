@@ -0,0 +1,430 @@
+/**
+ * @file ShardedScheduler.h
+ * @brief Scheduler split into per-entity shards that update on their own threads.
+ *
+ * Every entity belongs to exactly one shard, and each shard is a complete
+ * BasicScheduler pinned to one thread of a TaskPool. An update runs all shards
+ * in parallel, then merges the follow-up actions the shards scheduled for each
+ * other once every shard has finished the tick.
+ *
+ * On multi-socket hosts a ShardPlacement pins each shard's thread to a CPU and
+ * records the NUMA node of each shard. Every shard is then built on its own
+ * pinned thread, entities can be assigned to the shards of the node that holds
+ * their data, and actions crossing nodes at the tick boundary are counted.
+ */
+#pragma once
+
+#include "Scheduler.h"
+#include "TaskPool.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/// @typedef ShardedActionID
+/// @brief Identifier of an action in a sharded scheduler
+///
+/// Holds the shard index in the upper 32 bits and the shard's ActionID in the
+/// lower 32 bits; 0 means no action.
+using ShardedActionID = std::uint64_t;
+
+/**
+ * @struct ShardPlacement
+ * @brief Where the shards of a BasicShardedScheduler run
+ *
+ * Entries are indexed by shard, and shard 0 runs on the thread calling
+ * update(). There is one shard per entry of the longer list.
+ */
+struct ShardPlacement {
+    std::vector<int> cpus;  ///< CPU each shard's thread is pinned to, negative to leave it unpinned
+    std::vector<int> nodes; ///< NUMA node of each shard's CPU, 0 where missing
+
+    /// @brief Gets the number of shards placed
+    std::size_t shards() const { return std::max<std::size_t>({cpus.size(), nodes.size(), 1}); }
+
+    /// @brief Gets the NUMA node of a shard
+    int node(std::size_t shard) const { return shard < nodes.size() ? nodes[shard] : 0; }
+};
+
+/**
+ * @struct ShardTraffic
+ * @brief Actions that shards scheduled for other shards, merged at tick boundaries
+ */
+struct ShardTraffic {
+    std::size_t crossShard = 0; ///< Actions sent through a mailbox to another shard
+    std::size_t crossNode = 0;  ///< Those of them whose target shard is on another NUMA node
+};
+
+/**
+ * @class BasicShardedScheduler
+ * @brief Runs the actions of disjoint groups of entities on separate threads
+ * @tparam Queue The queue backend of every shard
+ *
+ * An action is owned by the shard of its entity, chosen by a key function
+ * (the entity index by default) modulo the shard count. Shard 0 runs on the
+ * thread calling update() and every other shard on its own worker, so an
+ * entity's actions always run on the same thread and in the order a single
+ * BasicScheduler would run them.
+ *
+ * While a shard updates, its actions and callbacks may read and write the
+ * components of the shard's own entities, but must not touch other shards'
+ * entities or make structural changes to the registry (creating or destroying
+ * entities, emplacing or removing components). Scheduling from inside an
+ * action is allowed for any entity: an action for the shard's own entities is
+ * scheduled directly, one for another shard goes through a mailbox and joins
+ * that shard's queue after every shard has finished the tick.
+ *
+ * Completion events are enqueued on a dispatcher per shard, since dispatchers
+ * are not thread-safe. Update them from the main thread after update(), in
+ * shard order for a deterministic event order.
+ *
+ * @code
+ * ShardedScheduler scheduler(4);
+ * scheduler.schedule(10, npc, [](entt::entity e, entt::registry &r) {
+ *     r.get<Health>(e).value += 5;
+ * });
+ * scheduler.update(currentTick, registry);
+ * for (std::size_t i = 0; i < scheduler.shardCount(); ++i) {
+ *     scheduler.dispatcher(i).update();
+ * }
+ * @endcode
+ */
+template <typename Queue = HeapQueue<ScheduledAction>> class BasicShardedScheduler {
+  public:
+    /// @brief The scheduler type of every shard
+    using shard_type = BasicScheduler<Queue>;
+
+    /// @brief Maps an entity to a key, whose value modulo the shard count picks the shard
+    using key_function = std::size_t (*)(entt::entity);
+
+    /// @brief Allocator of every shard's pending actions
+    using allocator_type = typename shard_type::allocator_type;
+
+    /// @brief Gets the allocator of a shard from its index
+    using allocator_function = std::function<allocator_type(std::size_t)>;
+
+    /**
+     * @brief Creates the shards and starts one worker for each shard but the first
+     * @param shards Number of shards, at least 1
+     * @param key Key function, or nullptr to shard by entity index
+     * @param mailboxReserve IDs each mailbox can hand out between two updates
+     */
+    explicit BasicShardedScheduler(std::size_t shards = TaskPool::defaultWorkers() + 1,
+                                   key_function key = nullptr, std::size_t mailboxReserve = 256)
+        : BasicShardedScheduler(shards, allocator_function{}, key, mailboxReserve) {}
+
+    /**
+     * @brief Creates the shards, each drawing from its own allocator
+     * @param shards Number of shards, at least 1
+     * @param allocatorOf Called once per shard index, for instance to hand each
+     *        shard a memory resource local to the NUMA node its worker runs on
+     * @param key Key function, or nullptr to shard by entity index
+     * @param mailboxReserve IDs each mailbox can hand out between two updates
+     */
+    BasicShardedScheduler(std::size_t shards, const allocator_function &allocatorOf,
+                          key_function key = nullptr, std::size_t mailboxReserve = 256)
+        : BasicShardedScheduler(ShardPlacement{std::vector<int>(shards > 1 ? shards : 1, -1), {}},
+                                allocatorOf, key, mailboxReserve) {}
+
+    /**
+     * @brief Creates one shard per placed CPU, each built on its own pinned thread
+     * @param placement CPU and NUMA node of every shard
+     * @param allocatorOf Optional, called once per shard index on the shard's
+     *        thread, possibly concurrently, for instance to return memory bound to placement.node(i)
+     * @param key Key function, or nullptr to shard by entity index
+     * @param mailboxReserve IDs each mailbox can hand out between two updates
+     *
+     * Pinning shard 0 pins the calling thread for good. Building each shard
+     * on its thread lets first-touch page placement put the shard's own
+     * memory on its node even with the default allocator.
+     */
+    explicit BasicShardedScheduler(const ShardPlacement &placement,
+                                   const allocator_function &allocatorOf = allocator_function{},
+                                   key_function key = nullptr, std::size_t mailboxReserve = 256)
+        : pool(placement.shards() - 1), keyOf(key != nullptr ? key : &entityIndex) {
+        std::size_t count = pool.size() + 1;
+        parts.resize(count);
+        pinnedAll = pool.pin(placement.cpus);
+        pool.runOnEach([&](std::size_t index) {
+            parts[index] = allocatorOf ? std::make_unique<Shard>(allocatorOf(index))
+                                       : std::make_unique<Shard>();
+            Shard &target = *parts[index];
+            target.node = placement.node(index);
+            target.mailboxes.reserve(count);
+            for (std::size_t source = 0; source < count; ++source) {
+                target.mailboxes.push_back(&target.scheduler.openInbox(mailboxReserve, false));
+            }
+        });
+    }
+
+    BasicShardedScheduler(const BasicShardedScheduler &) = delete;
+    BasicShardedScheduler &operator=(const BasicShardedScheduler &) = delete;
+
+    /**
+     * @brief Schedule an action on the shard of its entity
+     * @param action The ScheduledAction to schedule
+     * @return The ID of the action, or 0 if it went through a mailbox that ran
+     *         out of reserved IDs
+     *
+     * Call it from the thread that calls update(), or from inside an action or
+     * callback of any shard during update().
+     */
+    ShardedActionID schedule(ScheduledAction &&action) {
+        std::size_t target = shardOf(action.entity);
+        const Context &context = current();
+        ActionID id;
+        if (context.owner == this && context.shard != target) {
+            Shard &source = *parts[context.shard];
+            ++source.traffic.crossShard;
+            source.traffic.crossNode += source.node != parts[target]->node;
+            id = parts[target]->mailboxes[context.shard]->submit(std::move(action));
+        } else {
+            id = parts[target]->scheduler.schedule(std::move(action));
+        }
+        return id == 0 ? 0 : (static_cast<ShardedActionID>(target) << 32) | id;
+    }
+
+    /// @brief Convenience overload of schedule() building the ScheduledAction
+    ShardedActionID schedule(int tick, entt::entity entity, ActionFunction action,
+                             CompletionFunction onComplete = nullptr) {
+        return schedule(
+            ScheduledAction{0, tick, entity, std::move(action), std::move(onComplete)});
+    }
+
+    /// @brief Schedule an action that repeats at a fixed interval
+    /// @see BasicScheduler::schedulePeriodic
+    ShardedActionID schedulePeriodic(int firstTick, int interval, int count, entt::entity entity,
+                                     ActionFunction action, CompletionFunction onComplete = nullptr) {
+        if (count == 0) {
+            return 0;
+        }
+        ScheduledAction periodic{0, firstTick, entity, std::move(action), std::move(onComplete)};
+        periodic.interval = interval > 0 ? interval : 0;
+        periodic.repeats = count == ScheduledAction::forever ? ScheduledAction::forever : count - 1;
+        return schedule(std::move(periodic));
+    }
+
+    /**
+     * @brief Cancel a scheduled action
+     * @param id The ID returned by schedule()
+     * @return true if the action was found and cancelled, false otherwise
+     *
+     * Call it from the thread that calls update(), or from inside an action of
+     * the shard that owns the action.
+     */
+    bool cancel(ShardedActionID id) {
+        std::size_t index = static_cast<std::size_t>(id >> 32);
+        return index < parts.size() && parts[index]->scheduler.cancel(static_cast<ActionID>(id));
+    }
+
+    /// @brief Move a pending action to another tick, keeping its ID
+    /// @see BasicScheduler::reschedule
+    bool reschedule(ShardedActionID id, int tick) {
+        std::size_t index = static_cast<std::size_t>(id >> 32);
+        return index < parts.size() &&
+               parts[index]->scheduler.reschedule(static_cast<ActionID>(id), tick);
+    }
+
+    /// @brief Checks whether an action is still pending
+    bool isPending(ShardedActionID id) const {
+        std::size_t index = static_cast<std::size_t>(id >> 32);
+        return index < parts.size() && parts[index]->scheduler.isPending(static_cast<ActionID>(id));
+    }
+
+    /// @brief Cancel every pending action of an entity
+    /// @return The number of actions cancelled
+    std::size_t cancelAll(entt::entity entity) {
+        return parts[shardOf(entity)]->scheduler.cancelAll(entity);
+    }
+
+    /// @brief Gets the number of pending actions of an entity
+    std::size_t pendingCount(entt::entity entity) const {
+        return parts[shardOf(entity)]->scheduler.pendingCount(entity);
+    }
+
+    /// @brief Cancel an entity's actions automatically when it is destroyed
+    void connect(entt::registry &registry) {
+        registry.on_destroy<entt::entity>()
+            .template connect<&BasicShardedScheduler::onDestroyed>(*this);
+    }
+
+    /// @brief Stop cancelling actions of destroyed entities of a registry
+    void disconnect(entt::registry &registry) { registry.on_destroy<entt::entity>().disconnect(this); }
+
+    /// @brief Sets how every shard reports completed actions to its dispatcher
+    void setCompletionReport(CompletionReport report) {
+        for (auto &part : parts) {
+            part->scheduler.setCompletionReport(report);
+        }
+    }
+
+    /**
+     * @brief Process the actions due at a tick on every shard in parallel
+     * @param current_tick The current system tick
+     * @param registry The EnTT registry the actions operate on
+     *
+     * Returns once every shard has run its due actions and taken in the actions
+     * the other shards scheduled for it. The first exception thrown by a shard
+     * is rethrown after every shard has finished.
+     */
+    void update(int current_tick, entt::registry &registry) {
+        pool.runOnEach([this, current_tick, &registry](std::size_t index) {
+            Shard &part = *parts[index];
+            Scope scope(this, index);
+            part.scheduler.update(current_tick, registry, part.dispatcher);
+        });
+        mergeMailboxes();
+    }
+
+    /// @brief Gets the number of shards
+    std::size_t shardCount() const { return parts.size(); }
+
+    /// @brief Gets the shard an entity's actions belong to
+    std::size_t shardOf(entt::entity entity) const {
+        std::size_t index = entityIndex(entity);
+        if (index < assigned.size() && assigned[index] != 0) {
+            return assigned[index] - 1;
+        }
+        return keyOf(entity) % parts.size();
+    }
+
+    /**
+     * @brief Sends an entity's actions to a chosen shard instead of its key's
+     * @param entity The entity
+     * @param shard The shard, below shardCount()
+     *
+     * Call it from the thread that calls update(), outside update(), before
+     * the entity has pending actions: actions already pending stay on their
+     * old shard. The assignment outlives the entity, so a recycled index keeps
+     * it too; unassign() it when the entity is destroyed if that matters.
+     */
+    void assign(entt::entity entity, std::size_t shard) {
+        std::size_t index = entityIndex(entity);
+        if (index >= assigned.size()) {
+            assigned.resize(index + 1, 0);
+        }
+        assigned[index] = static_cast<std::uint32_t>(shard + 1);
+    }
+
+    /**
+     * @brief Assigns an entity to one of the shards on a NUMA node, spread by its key
+     * @return false if no shard is on the node, leaving the entity as it was
+     * @see assign()
+     */
+    bool assignToNode(entt::entity entity, int node) {
+        std::size_t onNode = 0;
+        for (const auto &part : parts) {
+            onNode += part->node == node;
+        }
+        if (onNode == 0) {
+            return false;
+        }
+        std::size_t pick = keyOf(entity) % onNode;
+        for (std::size_t shard = 0; shard < parts.size(); ++shard) {
+            if (parts[shard]->node == node && pick-- == 0) {
+                assign(entity, shard);
+                break;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Returns an entity to the shard its key picks
+    void unassign(entt::entity entity) {
+        std::size_t index = entityIndex(entity);
+        if (index < assigned.size()) {
+            assigned[index] = 0;
+        }
+    }
+
+    /// @brief Checks whether every shard thread given a CPU was pinned to it
+    bool pinned() const { return pinnedAll; }
+
+    /// @brief Gets the NUMA node a shard was placed on
+    int nodeOf(std::size_t shard) const { return parts[shard]->node; }
+
+    /// @brief Gets the actions the shards sent each other since creation or resetTraffic()
+    ShardTraffic traffic() const {
+        ShardTraffic total;
+        for (const auto &part : parts) {
+            total.crossShard += part->traffic.crossShard;
+            total.crossNode += part->traffic.crossNode;
+        }
+        return total;
+    }
+
+    /// @brief Zeroes the traffic counters of every shard
+    void resetTraffic() {
+        for (auto &part : parts) {
+            part->traffic = ShardTraffic{};
+        }
+    }
+
+    /// @brief Gets the scheduler of a shard
+    shard_type &shard(std::size_t index) { return parts[index]->scheduler; }
+
+    /// @brief Gets the dispatcher a shard enqueues its completion events on
+    EventDispatcher &dispatcher(std::size_t index) { return parts[index]->dispatcher; }
+
+    /// @brief Removes every pending action from every shard
+    void clear() {
+        for (auto &part : parts) {
+            part->scheduler.clear();
+        }
+    }
+
+  private:
+    struct Shard {
+        Shard() = default;
+        explicit Shard(const allocator_type &allocator) : scheduler(allocator) {}
+
+        shard_type scheduler;
+        EventDispatcher dispatcher;
+        std::vector<typename shard_type::Inbox *> mailboxes; ///< Indexed by source shard
+        int node = 0;                                        ///< NUMA node of the shard's thread
+        ShardTraffic traffic; ///< Sent by this shard, written only by its own thread
+    };
+
+    /// The shard whose update is running on this thread
+    struct Context {
+        const BasicShardedScheduler *owner = nullptr;
+        std::size_t shard = 0;
+    };
+
+    /// Marks the current thread as running a shard for the scope's lifetime
+    struct Scope {
+        Scope(const BasicShardedScheduler *owner, std::size_t shard) : saved(current()) {
+            current() = Context{owner, shard};
+        }
+        ~Scope() { current() = saved; }
+        Context saved;
+    };
+
+    static Context &current() {
+        thread_local Context context;
+        return context;
+    }
+
+    static std::size_t entityIndex(entt::entity entity) {
+        return static_cast<std::size_t>(entt::to_entity(entity));
+    }
+
+    /// Takes in the cross-shard actions once every shard has finished its tick
+    void mergeMailboxes() {
+        pool.runOnEach([this](std::size_t index) { parts[index]->scheduler.mergeInboxes(); });
+    }
+
+    void onDestroyed(entt::registry &, entt::entity entity) { cancelAll(entity); }
+
+    TaskPool pool;
+    key_function keyOf;
+    std::vector<std::unique_ptr<Shard>> parts;
+    std::vector<std::uint32_t> assigned; ///< Shard + 1 by entity index, 0 if not assigned
+    bool pinnedAll = true;
+};
+
+/// @brief Sharded scheduler with heap-backed shards
+using ShardedScheduler = BasicShardedScheduler<>;
@@ -0,0 +1,323 @@
+/**
+ * @file SlotMap.h
+ * @brief Generational slot map used to hand out scheduler IDs.
+ *
+ * IDs pack a slot index and a generation into one integer, the same way
+ * entt::entity packs an entity index and a version. Looking up, checking and
+ * releasing an ID are all a single array access.
+ */
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @struct SlotIdTraits
+ * @brief Bit layout of a slot map ID
+ * @tparam Id The integral ID type
+ *
+ * The low bits hold the slot index and the high bits hold the generation,
+ * mirroring entt_traits. Specialize it to use a different split.
+ */
+template <typename Id> struct SlotIdTraits;
+
+/**
+ * @struct PackedIdTraits
+ * @brief ID layout with IndexBits bits of index and the remaining bits of generation
+ * @tparam Id The unsigned integral ID type
+ * @tparam IndexBits Number of low bits holding the slot index
+ *
+ * More index bits allow more IDs pending at once, more generation bits make
+ * a stale ID less likely to come back around to its slot's current ID.
+ */
+template <typename Id, std::size_t IndexBits> struct PackedIdTraits {
+    static_assert(std::is_unsigned_v<Id> && IndexBits > 0 && IndexBits < sizeof(Id) * 8,
+                  "Both the index and the generation need at least one bit");
+
+    using value_type = Id;
+
+    static constexpr value_type index_mask =
+        static_cast<value_type>((value_type{1} << IndexBits) - 1);
+    static constexpr value_type generation_mask =
+        static_cast<value_type>(~value_type{0} >> IndexBits);
+    static constexpr std::size_t index_bits = IndexBits;
+};
+
+/// @brief 20 bits of index and 12 bits of generation, like a 32-bit entt::entity
+template <> struct SlotIdTraits<std::uint32_t> : PackedIdTraits<std::uint32_t, 20> {};
+
+/// @brief 32 bits of index and 32 bits of generation, like a 64-bit entt::entity
+template <> struct SlotIdTraits<std::uint64_t> : PackedIdTraits<std::uint64_t, 32> {};
+
+/**
+ * @class IdRange
+ * @brief Contiguous block of IDs handed out by a bulk insertion
+ * @tparam Id The integral ID type
+ *
+ * Iterating the range yields every ID of the block in order, without
+ * materializing them in a container.
+ */
+template <typename Id> class IdRange {
+  public:
+    /// @brief Forward iterator over the IDs of the range
+    class iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Id;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Id *;
+        using reference = Id;
+
+        iterator() = default;
+        explicit iterator(Id value) : value(value) {}
+
+        Id operator*() const { return value; }
+        iterator &operator++() {
+            ++value;
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator copy = *this;
+            ++value;
+            return copy;
+        }
+        bool operator==(const iterator &other) const { return value == other.value; }
+        bool operator!=(const iterator &other) const { return value != other.value; }
+
+      private:
+        Id value{};
+    };
+
+    IdRange() = default;
+    IdRange(Id first, std::size_t count) : first(first), count(count) {}
+
+    iterator begin() const { return iterator{first}; }
+    iterator end() const { return iterator{static_cast<Id>(first + count)}; }
+
+    /// @brief Gets the number of IDs in the range
+    std::size_t size() const { return count; }
+
+    /// @brief Checks whether the range is empty
+    bool empty() const { return count == 0; }
+
+    /// @brief Gets the ID at a position of the range
+    Id operator[](std::size_t index) const { return static_cast<Id>(first + index); }
+
+    /// @brief Checks whether an ID belongs to the range
+    bool contains(Id id) const { return id >= first && id - first < count; }
+
+  private:
+    Id first{};
+    std::size_t count = 0;
+};
+
+/**
+ * @class SlotMap
+ * @brief Dense array of values addressed by generational IDs
+ * @tparam Value The value stored per live ID
+ * @tparam Id The integral ID type
+ * @tparam Traits Bit layout of Id
+ * @tparam Allocator Allocator of the slot array
+ *
+ * A slot stores the full ID it was handed out with. Releasing a slot bumps its
+ * generation and threads it onto a free list, so a stale ID never compares equal
+ * to the ID stored in its slot. Slot 0 is reserved, which keeps 0 free to mean
+ * "no ID" and makes the first IDs handed out 1, 2, 3...
+ *
+ * @code
+ * SlotMap<int> map;
+ * auto id = map.insert(42);
+ * map.erase(id);
+ * map.contains(id); // false, even after the slot is reused
+ * @endcode
+ */
+template <typename Value, typename Id = std::uint32_t, typename Traits = SlotIdTraits<Id>,
+          typename Allocator = std::allocator<Value>>
+class SlotMap {
+    static constexpr Id nullIndex = Traits::index_mask;
+
+    struct Slot {
+        Id id;       ///< ID of the live occupant, or next free index plus generation
+        Value value; ///< Payload of the live occupant
+    };
+
+    using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+
+  public:
+    /// @brief The ID type handed out by the map
+    using id_type = Id;
+
+    /// @brief Constructs an empty map
+    SlotMap() : slots(1, Slot{nullIndex, Value{}}) {}
+
+    /// @brief Constructs an empty map whose slots come from an allocator
+    explicit SlotMap(const Allocator &allocator)
+        : slots(1, Slot{nullIndex, Value{}}, SlotAllocator(allocator)) {}
+
+    /// @brief Gets the allocator of the map
+    Allocator get_allocator() const { return Allocator(slots.get_allocator()); }
+
+    /// @brief Gets the slot index part of an ID
+    static constexpr Id index(Id id) { return id & Traits::index_mask; }
+
+    /// @brief Gets the generation part of an ID
+    static constexpr Id generation(Id id) {
+        return (id >> Traits::index_bits) & Traits::generation_mask;
+    }
+
+    /// @brief Builds an ID from its parts
+    static constexpr Id construct(Id slotIndex, Id slotGeneration) {
+        return (slotIndex & Traits::index_mask) |
+               ((slotGeneration & Traits::generation_mask) << Traits::index_bits);
+    }
+
+    /**
+     * @brief Stores a value and returns the ID that addresses it
+     * @param value The value to store
+     * @return A fresh ID
+     * @throws std::length_error if every slot index is in use
+     */
+    Id insert(Value value) {
+        Id slotIndex;
+        Id slotGeneration;
+        if (freeHead != nullIndex) {
+            slotIndex = freeHead;
+            slotGeneration = generation(slots[slotIndex].id);
+            freeHead = index(slots[slotIndex].id);
+        } else {
+            if (slots.size() >= nullIndex) {
+                throw std::length_error("SlotMap: out of slot indices");
+            }
+            slotIndex = static_cast<Id>(slots.size());
+            slotGeneration = 0;
+            slots.push_back(Slot{});
+        }
+        Slot &slot = slots[slotIndex];
+        slot.id = construct(slotIndex, slotGeneration);
+        slot.value = std::move(value);
+        ++count;
+        return slot.id;
+    }
+
+    /**
+     * @brief Hands out a block of consecutive IDs
+     * @param blockSize Number of IDs to hand out
+     * @return The block of IDs, whose values are default constructed
+     * @throws std::length_error if there are not enough slot indices left
+     *
+     * The block always uses fresh slots at the end of the map, so the IDs are
+     * consecutive integers and can be returned as an IdRange.
+     */
+    IdRange<Id> insertBlock(std::size_t blockSize) {
+        if (blockSize > nullIndex || slots.size() > nullIndex - blockSize) {
+            throw std::length_error("SlotMap: out of slot indices");
+        }
+        auto firstIndex = static_cast<Id>(slots.size());
+        slots.resize(slots.size() + blockSize);
+        for (std::size_t offset = 0; offset < blockSize; ++offset) {
+            slots[firstIndex + offset].id = static_cast<Id>(firstIndex + offset);
+        }
+        count += blockSize;
+        return IdRange<Id>{firstIndex, blockSize};
+    }
+
+    /**
+     * @brief Checks whether an ID is live
+     * @param id The ID to check
+     * @return true if the ID was handed out and not released since
+     */
+    bool contains(Id id) const {
+        Id slotIndex = index(id);
+        return slotIndex != 0 && slotIndex < slots.size() && slots[slotIndex].id == id;
+    }
+
+    /**
+     * @brief Finds the value of a live ID
+     * @param id The ID to look up
+     * @return Pointer to the value, or nullptr if the ID is not live
+     */
+    Value *find(Id id) { return contains(id) ? &slots[index(id)].value : nullptr; }
+
+    /// @copydoc find
+    const Value *find(Id id) const { return contains(id) ? &slots[index(id)].value : nullptr; }
+
+    /**
+     * @brief Gets the value of an ID that is known to be live
+     * @param id A live ID
+     * @return Reference to the value
+     */
+    Value &get(Id id) { return slots[index(id)].value; }
+
+    /**
+     * @brief Releases an ID
+     * @param id The ID to release
+     * @return true if the ID was live and has been released
+     */
+    bool erase(Id id) {
+        if (!contains(id)) {
+            return false;
+        }
+        release(index(id));
+        return true;
+    }
+
+    /// @brief Gets the number of live IDs
+    std::size_t size() const { return count; }
+
+    /// @brief Checks whether there are no live IDs
+    bool empty() const { return count == 0; }
+
+    /**
+     * @brief Releases every live ID, keeping allocated capacity
+     *
+     * Outstanding IDs become stale and will not match reused slots.
+     */
+    void clear() {
+        for (Id slotIndex = 1; slotIndex < slots.size(); ++slotIndex) {
+            if (index(slots[slotIndex].id) == slotIndex) {
+                release(slotIndex);
+            }
+        }
+    }
+
+    /**
+     * @brief Releases every live ID whose value matches a predicate
+     * @param pred Called as pred(Id, Value &) for each live ID
+     * @return The number of IDs released
+     */
+    template <typename Pred> std::size_t eraseIf(Pred &&pred) {
+        std::size_t released = 0;
+        for (Id slotIndex = 1; slotIndex < slots.size(); ++slotIndex) {
+            Slot &slot = slots[slotIndex];
+            if (index(slot.id) == slotIndex && pred(slot.id, slot.value)) {
+                release(slotIndex);
+                ++released;
+            }
+        }
+        return released;
+    }
+
+    /// @brief Reserves room for a number of slots
+    void reserve(std::size_t capacity) { slots.reserve(capacity + 1); }
+
+    /// @brief Gets the number of slots, live or free: at least the most IDs ever live at once
+    std::size_t slotCount() const { return slots.size() - 1; }
+
+  private:
+    void release(Id slotIndex) {
+        Slot &slot = slots[slotIndex];
+        Id nextGeneration = (generation(slot.id) + 1) & Traits::generation_mask;
+        slot.id = construct(freeHead, nextGeneration);
+        slot.value = Value{};
+        freeHead = slotIndex;
+        --count;
+    }
+
+    std::vector<Slot, SlotAllocator> slots; ///< Slot 0 is reserved and never handed out
+    Id freeHead = nullIndex;                ///< Most recently released slot
+    std::size_t count = 0;                  ///< Number of live IDs
+};
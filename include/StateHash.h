@@ -0,0 +1,131 @@
+/**
+ * @file StateHash.h
+ * @brief Order-independent state hashes kept up to date on every change.
+ *
+ * Lockstep peers compare a hash of their state every tick to catch desyncs
+ * early. Hashing the whole state each tick costs time proportional to the
+ * state, so these hashes are sums of one 64-bit hash per entry instead: an
+ * entry added adds its hash, an entry removed subtracts it, and reading the
+ * hash is O(1). A sum does not depend on the order entries were added in,
+ * which differs between peers whose storages were packed differently.
+ *
+ * BasicScheduler::stateHash() covers the pending actions. A
+ * ComponentStateHash covers one component storage of a registry.
+ */
+#pragma once
+
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Scrambles a 64-bit value, the finalizer of splitmix64
+ *
+ * Nearby inputs, such as consecutive IDs or ticks, give unrelated outputs,
+ * so sums of entry hashes do not cancel out by accident.
+ */
+constexpr std::uint64_t stateHashMix(std::uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+/**
+ * @struct ComponentBytesHash
+ * @brief Hashes a component through its object representation
+ * @tparam Component A trivially copyable component without padding
+ *
+ * Components with padding or pointers need a hasher of their own that reads
+ * only the fields that matter.
+ */
+template <typename Component> struct ComponentBytesHash {
+    static_assert(std::has_unique_object_representations_v<Component>,
+                  "Padding bytes would make equal components hash differently; pass a hasher");
+
+    std::uint64_t operator()(const Component &component) const {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(&component);
+        std::uint64_t hash = 14695981039346656037ull; // FNV-1a
+        for (std::size_t i = 0; i < sizeof(Component); ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+/**
+ * @class ComponentStateHash
+ * @brief Keeps an order-independent hash of one component storage
+ * @tparam Component The component hashed
+ * @tparam Hasher Callable hashing a const Component &
+ *
+ * Follows the storage through its construct, update and destroy signals, so
+ * changes made through registry.get() without patch() or replace() are not
+ * seen. The hash of every entity's component is kept, since on_update only
+ * fires after the old value is gone. Must be destroyed before its registry.
+ *
+ * @code
+ * ComponentStateHash<Position> positions(registry);
+ * frame.checksum = scheduler.stateHash() ^ positions.value();
+ * @endcode
+ */
+template <typename Component, typename Hasher = ComponentBytesHash<Component>>
+class ComponentStateHash {
+    static_assert(!std::is_empty_v<Component>, "Empty components have no value to hash");
+
+  public:
+    /// @brief Hashes the components already in the registry and follows later changes
+    explicit ComponentStateHash(entt::registry &registry, Hasher hasher = Hasher{})
+        : registry(registry), hasher(std::move(hasher)) {
+        for (auto [entity, component] : registry.view<Component>().each()) {
+            add(entity, component);
+        }
+        registry.on_construct<Component>().template connect<&ComponentStateHash::onConstruct>(
+            *this);
+        registry.on_update<Component>().template connect<&ComponentStateHash::onUpdate>(*this);
+        registry.on_destroy<Component>().template connect<&ComponentStateHash::onDestroy>(*this);
+    }
+
+    ComponentStateHash(const ComponentStateHash &) = delete;
+    ComponentStateHash &operator=(const ComponentStateHash &) = delete;
+
+    ~ComponentStateHash() {
+        registry.on_construct<Component>().disconnect(this);
+        registry.on_update<Component>().disconnect(this);
+        registry.on_destroy<Component>().disconnect(this);
+    }
+
+    /// @brief Gets the hash of the storage, 0 when it is empty
+    std::uint64_t value() const { return sum; }
+
+  private:
+    void add(entt::entity entity, const Component &component) {
+        std::uint64_t hash =
+            stateHashMix(entt::to_integral(entity) ^ stateHashMix(hasher(component)));
+        entries[entity] = hash;
+        sum += hash;
+    }
+
+    void onConstruct(entt::registry &owner, entt::entity entity) {
+        add(entity, owner.get<Component>(entity));
+    }
+
+    void onUpdate(entt::registry &owner, entt::entity entity) {
+        onDestroy(owner, entity);
+        onConstruct(owner, entity);
+    }
+
+    void onDestroy(entt::registry &, entt::entity entity) {
+        auto it = entries.find(entity);
+        if (it != entries.end()) {
+            sum -= it->second;
+            entries.erase(it);
+        }
+    }
+
+    entt::registry &registry;
+    Hasher hasher;
+    entt::dense_map<entt::entity, std::uint64_t> entries; ///< Hash of each entity's component
+    std::uint64_t sum = 0;
+};
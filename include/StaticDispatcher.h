@@ -0,0 +1,213 @@
+/**
+ * @file StaticDispatcher.h
+ * @brief Event dispatcher for a fixed list of event types, resolved at compile time.
+ *
+ * entt::dispatcher finds the queue of an event type by hashing the type and
+ * looking it up in a dense map on every enqueue() and sink(), and publishes
+ * each queue through a virtual call. When the event types are known up front,
+ * StaticDispatcher keeps one queue per type in a std::tuple and reaches it by
+ * index, with no hashing, no map and no virtual calls. Its sink(), enqueue(),
+ * trigger() and update() calls look the same as entt::dispatcher's, so code
+ * written against EventDispatcher compiles with either.
+ */
+#pragma once
+
+#include "AllocationCounter.h"
+#include "EventBatch.h"
+#include "GameEvents.h"
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @class StaticDispatcher
+ * @brief Queues and signals of a closed set of event types
+ * @tparam Events The event types, each listed once
+ *
+ * Using a type that is not in Events fails to compile. update() publishes the
+ * queues in the order the types are listed, each in enqueue order; events a
+ * listener enqueues on the queue being published wait for the next update(),
+ * as with entt::dispatcher. Named queues (the id parameter of entt's calls)
+ * are not supported: list a distinct event type instead.
+ *
+ * @code
+ * StaticDispatcher<GameEvents::EntityDamagedEvent, GameEvents::EntityDiedEvent> dispatcher;
+ * dispatcher.sink<GameEvents::EntityDamagedEvent>().connect<&onEntityDamaged>();
+ * dispatcher.enqueue<GameEvents::EntityDamagedEvent>(enemy, 15, player, "physical"_hs);
+ * dispatcher.update();
+ * @endcode
+ */
+template <typename... Events> class StaticDispatcher {
+    static_assert((std::is_same_v<Events, std::decay_t<Events>> && ...),
+                  "Event types are plain value types");
+
+    template <typename Event> static constexpr std::size_t indexOf() {
+        constexpr bool matches[] = {std::is_same_v<Event, Events>...};
+        std::size_t index = 0;
+        while (index < sizeof...(Events) && !matches[index]) {
+            ++index;
+        }
+        return index;
+    }
+
+    template <typename Event> struct Queue {
+        entt::sigh<void(Event &)> signal;
+        entt::sigh<void(EventSpan<Event>)> batchSignal;
+        std::vector<Event> events;
+        std::vector<Event> publishing; ///< The events being published, swapped with events
+
+        void publish() {
+            SCHEDULER_ALLOCATION_SCOPE(entt::type_name<Event>::value());
+            // Events enqueued by listeners go to the emptied queue, for the next update
+            publishing.swap(events);
+            if (!signal.empty()) {
+                for (Event &event : publishing) {
+                    signal.publish(event);
+                }
+            }
+            if (!batchSignal.empty() && !publishing.empty()) {
+                batchSignal.publish(EventSpan<Event>(publishing.data(), publishing.size()));
+            }
+            publishing.clear();
+        }
+    };
+
+  public:
+    /// @brief Checks whether an event type is in the list
+    template <typename Event>
+    static constexpr bool contains = indexOf<std::decay_t<Event>>() < sizeof...(Events);
+
+    /**
+     * @brief Gets the sink listeners of an event type connect to
+     * @tparam Event The event type
+     * @return A temporary entt::sink, as returned by entt::dispatcher::sink()
+     */
+    template <typename Event> auto sink() {
+        return typename entt::sigh<void(Event &)>::sink_type{queue<Event>().signal};
+    }
+
+    /**
+     * @brief Gets the sink batch listeners of an event type connect to
+     * @tparam Event The event type
+     * @return A temporary entt::sink of void(EventSpan<Event>)
+     *
+     * update() calls each batch listener once with all of the type's queued
+     * events, straight from the queue, after the single-event listeners have
+     * seen them. trigger() does not reach batch listeners.
+     *
+     * @code
+     * dispatcher.batchSink<GameEvents::EntityDamagedEvent>().connect<&applyDamage>();
+     * @endcode
+     */
+    template <typename Event> auto batchSink() {
+        return typename entt::sigh<void(EventSpan<Event>)>::sink_type{queue<Event>().batchSignal};
+    }
+
+    /**
+     * @brief Publishes an event to the listeners of its type right away
+     * @param value The event
+     */
+    template <typename Event> void trigger(Event &&value = {}) {
+        std::decay_t<Event> event = std::forward<Event>(value);
+        queue<std::decay_t<Event>>().signal.publish(event);
+    }
+
+    /**
+     * @brief Queues an event built from arguments until the next update()
+     * @tparam Event The event type
+     * @param args Arguments to construct the event, brace-initialized for aggregates
+     */
+    template <typename Event, typename... Args> void enqueue(Args &&...args) {
+        std::vector<Event> &events = queue<Event>().events;
+        if constexpr (std::is_aggregate_v<Event> &&
+                      (sizeof...(Args) != 0 || !std::is_default_constructible_v<Event>)) {
+            events.push_back(Event{std::forward<Args>(args)...});
+        } else {
+            events.emplace_back(std::forward<Args>(args)...);
+        }
+    }
+
+    /// @brief Queues an event until the next update()
+    template <typename Event> void enqueue(Event &&value) {
+        queue<std::decay_t<Event>>().events.push_back(std::forward<Event>(value));
+    }
+
+    /**
+     * @brief Queues a range of events until the next update(), with one insertion
+     * @tparam Event The event type
+     * @param first Iterator to the first event, copied
+     * @param last Iterator past the last event
+     */
+    template <typename Event, typename It> void enqueueBulk(It first, It last) {
+        std::vector<Event> &events = queue<Event>().events;
+        events.insert(events.end(), first, last);
+    }
+
+    /// @brief Disconnects every listener bound to an instance, for all event types
+    template <typename Type> void disconnect(Type &instance) {
+        (sink<Events>().disconnect(&instance), ...);
+        (batchSink<Events>().disconnect(&instance), ...);
+    }
+
+    /// @brief Publishes the queued events of one type
+    template <typename Event> void update() { queue<Event>().publish(); }
+
+    /// @brief Publishes the queued events of every type, in list order
+    void update() {
+        SCHEDULER_ALLOCATION_SCOPE("dispatcher.update");
+        (queue<Events>().publish(), ...);
+    }
+
+    /// @brief Discards the queued events of one type
+    template <typename Event> void clear() { queue<Event>().events.clear(); }
+
+    /// @brief Discards every queued event
+    void clear() { (queue<Events>().events.clear(), ...); }
+
+    /// @brief Gets the queued events of one type, to read them before update()
+    template <typename Event> const std::vector<Event> &queued() const {
+        static_assert(contains<Event>, "Event type is not in the dispatcher's list");
+        return std::get<indexOf<Event>()>(queues).events;
+    }
+
+    /// @brief Gets the number of queued events of one type
+    template <typename Event> std::size_t size() const {
+        return std::get<indexOf<Event>()>(queues).events.size();
+    }
+
+    /// @brief Gets the number of queued events of every type
+    std::size_t size() const { return (size<Events>() + ... + std::size_t{0}); }
+
+  private:
+    template <typename Event> Queue<Event> &queue() {
+        static_assert(contains<Event>, "Event type is not in the dispatcher's list");
+        return std::get<indexOf<Event>()>(queues);
+    }
+
+    std::tuple<Queue<Events>...> queues;
+};
+
+/// @typedef GameEventDispatcher
+/// @brief StaticDispatcher of every GameEvents type
+using GameEventDispatcher =
+    StaticDispatcher<GameEvents::EntityAttackEvent, GameEvents::EntityDamagedEvent,
+                     GameEvents::EntityDiedEvent, GameEvents::EntitySpawnEvent,
+                     GameEvents::MapChangeEvent, GameEvents::PlayerMoveEvent,
+                     GameEvents::ItemPickupEvent, GameEvents::CombatStartEvent,
+                     GameEvents::CombatEndEvent, GameEvents::ActionCompletedEvent,
+                     GameEvents::ActionsCompletedEvent>;
+
+/// @typedef EventDispatcher
+/// @brief Dispatcher schedulers and completion callbacks emit events on
+///
+/// entt::dispatcher by default. Define SCHEDULER_STATIC_DISPATCHER, or point
+/// this alias at another StaticDispatcher, to resolve event types at compile
+/// time; it must list ActionCompletedEvent and ActionsCompletedEvent.
+#if defined(SCHEDULER_STATIC_DISPATCHER)
+using EventDispatcher = GameEventDispatcher;
+#else
+using EventDispatcher = entt::dispatcher;
+#endif
@@ -0,0 +1,303 @@
+/**
+ * @file StaticTimedEventScheduler.h
+ * @brief Timed event scheduler for a fixed set of event types, without virtual dispatch.
+ *
+ * TimedEventScheduler runs any TimedEvent subclass, at the price of one heap
+ * object and one virtual call per event. When the event types are known up
+ * front, StaticTimedEventScheduler keeps each type by value in its own
+ * contiguous pool and orders all of them through one shared queue of small
+ * keys. Running an event is a switch on the key's type index followed by a
+ * direct call.
+ */
+#pragma once
+
+#include "HeapQueue.h"
+#include "SlotMap.h"
+#include "TimedEventScheduler.h"
+#include "UpdateBudget.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @class StaticTimedEventScheduler
+ * @brief Schedules values of a closed set of event types by tick and priority
+ * @tparam Events The event types, each movable and exposing `void execute()`
+ *
+ * Event types do not derive from TimedEvent and carry no tick, ID or
+ * priority; the scheduler keeps those in the queue key. Any TimedEvent can
+ * still be scheduled as a std::shared_ptr: it is stored in a fallback pool,
+ * ordered together with the static events and run through its virtual
+ * execute(). Its scheduler pointer is not set, since it is not owned by a
+ * TimedEventScheduler.
+ *
+ * @code
+ * struct Explosion { entt::entity at; void execute(); };
+ * struct Heal { entt::entity target; int amount; void execute(); };
+ *
+ * StaticTimedEventScheduler<Explosion, Heal> scheduler;
+ * scheduler.schedule(100, Explosion{barrel});
+ * scheduler.emplace<Heal>(120, 5, player, 10); // priority 5
+ * scheduler.update(currentTick);
+ * @endcode
+ *
+ * An event may schedule or cancel other events while it runs; it is moved
+ * out of its pool before execute() is called.
+ */
+template <typename... Events> class StaticTimedEventScheduler {
+    /// Fallback for events whose type is not in Events
+    using Dynamic = std::shared_ptr<TimedEvent>;
+
+    static constexpr std::size_t typeCount = sizeof...(Events) + 1;
+    static_assert(typeCount <= 256, "Type indices are stored in one byte");
+
+    template <typename T> static constexpr std::size_t indexOf() {
+        constexpr bool matches[] = {std::is_same_v<T, Events>..., std::is_same_v<T, Dynamic>};
+        for (std::size_t i = 0; i < typeCount; ++i) {
+            if (matches[i]) {
+                return i;
+            }
+        }
+        return typeCount;
+    }
+
+  public:
+    /// @brief Checks whether T has its own pool in this scheduler
+    template <typename T> static constexpr bool holds = indexOf<T>() < sizeof...(Events);
+
+    /**
+     * @brief Schedules an event of one of the static types
+     * @param tick The tick at which the event runs
+     * @param event The event, moved into the pool of its type
+     * @param priority Higher priorities run first within a tick
+     * @return The ID of the scheduled event
+     */
+    template <typename Event, typename = std::enable_if_t<holds<std::decay_t<Event>>>>
+    EventID schedule(int tick, Event &&event, int priority = 0) {
+        return insert<indexOf<std::decay_t<Event>>()>(tick, priority, std::forward<Event>(event));
+    }
+
+    /**
+     * @brief Constructs an event of one of the static types in its pool
+     * @tparam Event The event type
+     * @param tick The tick at which the event runs
+     * @param priority Higher priorities run first within a tick
+     * @param args Arguments forwarded to the constructor of Event, or its
+     *        members in order if Event is an aggregate
+     * @return The ID of the scheduled event
+     */
+    template <typename Event, typename... Args>
+    EventID emplace(int tick, int priority, Args &&...args) {
+        static_assert(holds<Event>, "Event is not one of the scheduler's event types");
+        return insert<indexOf<Event>()>(tick, priority, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Schedules a TimedEvent through the dynamic fallback
+     * @param event The event; its tick and priority decide when it runs
+     * @return The ID of the scheduled event, also assigned to the event
+     */
+    EventID scheduleEvent(std::shared_ptr<TimedEvent> event) {
+        int tick = event->getTick();
+        int priority = event->getPriority();
+        TimedEvent &target = *event;
+        EventID id = insert<sizeof...(Events)>(tick, priority, std::move(event));
+        target.setId(id);
+        return id;
+    }
+
+    /**
+     * @brief Cancels a pending event
+     * @param id The ID of the event
+     * @return true if the event was pending and is now destroyed
+     */
+    bool cancelEvent(EventID id) {
+        const Ref *ref = activeEvents.find(id);
+        if (ref == nullptr) {
+            return false;
+        }
+        Ref cancelled = *ref;
+        keys.erase(cancelled.handle);
+        activeEvents.erase(id);
+        dispatch(cancelled.type, cancelled.slot, Release{}, std::make_index_sequence<typeCount>{});
+        return true;
+    }
+
+    /// @brief Checks whether an event is still waiting to run
+    bool isPending(EventID id) const { return activeEvents.contains(id); }
+
+    /**
+     * @brief Processes all events scheduled up to the given tick
+     * @param currentTick The current system tick
+     *
+     * Events run in order of tick and then priority, whatever their type.
+     */
+    void update(int currentTick) { update(currentTick, UpdateBudget{}); }
+
+    /**
+     * @brief Processes events scheduled up to the given tick within a budget
+     * @param currentTick The current system tick
+     * @param budget Limits on the time spent and the number of events run
+     * @return How many events ran and how many due events were left over
+     */
+    UpdateResult update(int currentTick, const UpdateBudget &budget) {
+        BudgetMeter meter(budget);
+        Key key;
+        while (!meter.exhausted()) {
+            if (!keys.popDue(currentTick, key)) {
+                return UpdateResult{meter.consumed(), 0};
+            }
+            activeEvents.erase(key.id);
+            dispatch(key.type, key.slot, Run{}, std::make_index_sequence<typeCount>{});
+            meter.consume();
+        }
+        return UpdateResult{meter.consumed(), keys.countDue(currentTick)};
+    }
+
+    /// @brief Gets the number of pending events
+    std::size_t pendingCount() const { return keys.size(); }
+
+    /// @brief Gets the tick of the earliest pending event, or nothing if none is pending
+    std::optional<int> nextDueTick() const { return keys.nextTick(); }
+
+    /**
+     * @brief Processes every event due up to a tick, skipping the idle ticks in between
+     * @param targetTick The tick to catch up to
+     * @return The number of ticks at which events ran
+     */
+    std::size_t advanceTo(int targetTick) {
+        std::size_t ticks = 0;
+        for (std::optional<int> next = nextDueTick(); next && *next <= targetTick;
+             next = nextDueTick()) {
+            update(*next);
+            ++ticks;
+        }
+        return ticks;
+    }
+
+    /**
+     * @brief Reserves room for a number of events of one type
+     * @tparam Event One of the static event types, or std::shared_ptr<TimedEvent>
+     * @param count Number of events of that type expected to be pending at once
+     */
+    template <typename Event> void reserve(std::size_t count) {
+        static_assert(indexOf<Event>() < typeCount, "Event is not stored by this scheduler");
+        std::get<indexOf<Event>()>(pools).slots.reserve(count);
+    }
+
+    /// @brief Destroys every pending event
+    void clear() {
+        keys.clear();
+        activeEvents.clear();
+        std::apply([](auto &...pool) { (pool.clear(), ...); }, pools);
+    }
+
+  private:
+    /// Queue entry: ordering fields plus where the event is stored
+    struct Key {
+        int tick;
+        int priority;
+        EventID id;
+        std::uint32_t slot;
+        std::uint8_t type;
+    };
+
+    struct KeyTraits {
+        static int tick(const Key &key) { return key.tick; }
+        static std::uint32_t rank(const Key &key) { return rankOfPriority(key.priority); }
+    };
+
+    using KeyQueue = HeapQueue<Key, KeyTraits>;
+
+    /// What the scheduler knows about a pending event, addressed by EventID
+    struct Ref {
+        typename KeyQueue::handle_type handle;
+        std::uint32_t slot;
+        std::uint8_t type;
+    };
+
+    /// Contiguous storage of one event type, with recycled slots
+    template <typename T> struct Pool {
+        std::vector<std::optional<T>> slots;
+        std::vector<std::uint32_t> freeSlots;
+
+        /// Constructs an event, with braces for aggregates
+        template <typename... Args> std::uint32_t put(Args &&...args) {
+            if constexpr (!std::is_constructible_v<T, Args &&...>) {
+                return put(T{std::forward<Args>(args)...});
+            } else if (freeSlots.empty()) {
+                slots.emplace_back(std::in_place, std::forward<Args>(args)...);
+                return static_cast<std::uint32_t>(slots.size() - 1);
+            } else {
+                std::uint32_t slot = freeSlots.back();
+                freeSlots.pop_back();
+                slots[slot].emplace(std::forward<Args>(args)...);
+                return slot;
+            }
+        }
+
+        T take(std::uint32_t slot) {
+            T event = std::move(*slots[slot]);
+            release(slot);
+            return event;
+        }
+
+        void release(std::uint32_t slot) {
+            slots[slot].reset();
+            freeSlots.push_back(slot);
+        }
+
+        void clear() {
+            slots.clear();
+            freeSlots.clear();
+        }
+    };
+
+    /// Dispatch operation running the event in a slot
+    struct Run {
+        template <typename T> void operator()(Pool<T> &pool, std::uint32_t slot) const {
+            T event = pool.take(slot);
+            if constexpr (std::is_same_v<T, Dynamic>) {
+                event->execute();
+            } else {
+                event.execute();
+            }
+        }
+    };
+
+    /// Dispatch operation destroying the event in a slot
+    struct Release {
+        template <typename T> void operator()(Pool<T> &pool, std::uint32_t slot) const {
+            pool.release(slot);
+        }
+    };
+
+    template <std::size_t Type, typename... Args>
+    EventID insert(int tick, int priority, Args &&...args) {
+        std::uint32_t slot = std::get<Type>(pools).put(std::forward<Args>(args)...);
+        auto type = static_cast<std::uint8_t>(Type);
+        EventID id = activeEvents.insert(Ref{0, slot, type});
+        activeEvents.get(id).handle = keys.push(Key{tick, priority, id, slot, type});
+        return id;
+    }
+
+    /// Applies op to the pool selected by a runtime type index, without virtual calls
+    template <typename Op, std::size_t... Types>
+    void dispatch(std::uint8_t type, std::uint32_t slot, Op op, std::index_sequence<Types...>) {
+        ((type == Types ? (op(std::get<Types>(pools), slot), true) : false) || ...);
+    }
+
+    /// Keys of all pending events, ordered by tick and priority
+    KeyQueue keys;
+
+    /// Location of every pending event, addressed by EventID
+    SlotMap<Ref, EventID> activeEvents;
+
+    /// One pool per static event type, followed by the dynamic fallback
+    std::tuple<Pool<Events>..., Pool<Dynamic>> pools;
+};
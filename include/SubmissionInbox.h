@@ -0,0 +1,144 @@
+/**
+ * @file SubmissionInbox.h
+ * @brief Lock-free inbox for handing work to a scheduler from other threads.
+ *
+ * Producers push items and reserve IDs without locks; the thread that owns
+ * the scheduler drains the inbox at the start of its update and tops the ID
+ * reservation back up. Only the owner thread ever touches the scheduler
+ * itself, so the schedulers stay free of synchronization on their hot paths.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ * @class SubmissionInbox
+ * @brief Multi-producer, single-consumer inbox with atomic ID reservation
+ * @tparam Item The submitted work item, moved into the inbox
+ * @tparam Id The integral ID type handed out to producers
+ *
+ * Items are pushed onto a lock-free list and come out of drain() in the
+ * order they were pushed. IDs are taken from a ring refilled by the
+ * consumer, so a producer can learn the ID of its submission right away.
+ * When the ring runs dry, reserveId() returns 0 and the item gets its ID
+ * when it is drained instead.
+ *
+ * Items pushed by one thread keep their relative order. Items pushed by
+ * several threads into the same inbox interleave in whatever order the
+ * pushes happened, so give each producer thread its own inbox when the
+ * merged order has to be reproducible.
+ */
+template <typename Item, typename Id> class SubmissionInbox {
+    struct Node {
+        Node *next;
+        Id id;
+        Item item;
+    };
+
+  public:
+    /**
+     * @brief Creates an inbox with room for a number of reserved IDs
+     * @param idCapacity Maximum number of IDs producers can take between two refills
+     */
+    explicit SubmissionInbox(std::size_t idCapacity)
+        : capacity(idCapacity > 0 ? idCapacity : 1), ids(new std::atomic<Id>[capacity]) {}
+
+    SubmissionInbox(const SubmissionInbox &) = delete;
+    SubmissionInbox &operator=(const SubmissionInbox &) = delete;
+
+    ~SubmissionInbox() { release(head.exchange(nullptr, std::memory_order_acquire)); }
+
+    /**
+     * @brief Takes an ID from the reservation, from any thread
+     * @return A reserved ID, or 0 if the reservation is used up until the next refill
+     */
+    Id reserveId() {
+        std::uint64_t position = taken.load(std::memory_order_relaxed);
+        for (;;) {
+            if (position >= available.load(std::memory_order_acquire)) {
+                return Id{};
+            }
+            Id id = ids[position % capacity].load(std::memory_order_relaxed);
+            if (taken.compare_exchange_weak(position, position + 1, std::memory_order_acq_rel,
+                                            std::memory_order_relaxed)) {
+                return id;
+            }
+        }
+    }
+
+    /**
+     * @brief Pushes an item, from any thread
+     * @param id The ID reserved for the item, or 0 to have one assigned when drained
+     * @param item The item to hand over
+     */
+    void push(Id id, Item &&item) {
+        Node *node = new Node{nullptr, id, std::move(item)};
+        node->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief Hands every pushed item to a callback, on the consumer thread
+     * @param fn Called as fn(Id, Item &&) for each item, in push order
+     */
+    template <typename F> void drain(F &&fn) {
+        Node *list = head.exchange(nullptr, std::memory_order_acquire);
+        // The list is newest first; reverse it to restore push order
+        Node *ordered = nullptr;
+        while (list != nullptr) {
+            Node *next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+        while (ordered != nullptr) {
+            std::unique_ptr<Node> node(ordered);
+            ordered = ordered->next;
+            fn(node->id, std::move(node->item));
+        }
+    }
+
+    /**
+     * @brief Tops the ID reservation back up, on the consumer thread
+     * @param makeId Called once per ID needed, returns a fresh ID
+     */
+    template <typename F> void refill(F &&makeId) {
+        std::uint64_t end = taken.load(std::memory_order_acquire) + capacity;
+        std::uint64_t position = available.load(std::memory_order_relaxed);
+        for (; position < end; ++position) {
+            ids[position % capacity].store(makeId(), std::memory_order_relaxed);
+        }
+        available.store(end, std::memory_order_release);
+    }
+
+    /**
+     * @brief Drops pending items and the unused reservation, on the consumer thread
+     *
+     * Only valid while no producer is using the inbox. The reservation is
+     * empty afterwards until the next refill().
+     */
+    void reset() {
+        release(head.exchange(nullptr, std::memory_order_acquire));
+        taken.store(0, std::memory_order_relaxed);
+        available.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    static void release(Node *list) {
+        while (list != nullptr) {
+            std::unique_ptr<Node> node(list);
+            list = list->next;
+        }
+    }
+
+    std::atomic<Node *> head{nullptr};         ///< Pushed items, newest first
+    std::size_t capacity;                      ///< Size of the ID ring
+    std::unique_ptr<std::atomic<Id>[]> ids;    ///< Reserved IDs, indexed by position % capacity
+    std::atomic<std::uint64_t> taken{0};       ///< Positions handed out to producers
+    std::atomic<std::uint64_t> available{0};   ///< Positions filled by the consumer
+};
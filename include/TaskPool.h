@@ -0,0 +1,270 @@
+/**
+ * @file TaskPool.h
+ * @brief Fixed-size worker pool used to run independent work items in parallel.
+ *
+ * parallelFor() fans a loop out over the workers and the calling thread and
+ * returns once every iteration is done; runOnEach() runs a function once on
+ * every thread, for work that is pinned to a thread.
+ * It is meant for short, frequent bursts such as the independent actions of one
+ * scheduler tick, so workers sleep on a condition variable between bursts
+ * instead of spinning. pin() binds each thread to a CPU, on Linux, so work
+ * pinned to a thread also stays on one core and its NUMA node.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+/**
+ * @class TaskPool
+ * @brief Worker threads that execute the iterations of a loop in parallel
+ *
+ * The calling thread always takes part in the work, so a pool with zero
+ * workers simply runs every iteration inline. Only one loop may be in
+ * flight at a time; the pool itself is not meant to be shared between threads
+ * that submit work concurrently.
+ *
+ * @code
+ * TaskPool pool;
+ * std::vector<int> values(1000);
+ * pool.parallelFor(values.size(), [&](std::size_t i) { values[i] = expensive(i); });
+ * @endcode
+ */
+class TaskPool {
+  public:
+    /**
+     * @brief Gets the default number of workers
+     * @return One less than the number of hardware threads, since the caller also works
+     */
+    static std::size_t defaultWorkers() {
+        unsigned hardware = std::thread::hardware_concurrency();
+        return hardware > 1 ? hardware - 1 : 0;
+    }
+
+    /**
+     * @brief Starts the worker threads
+     * @param workers Number of threads to start in addition to the calling thread
+     */
+    explicit TaskPool(std::size_t workers = defaultWorkers()) {
+        threads.reserve(workers);
+        for (std::size_t i = 0; i < workers; ++i) {
+            threads.emplace_back([this, i] { workerLoop(i + 1); });
+        }
+    }
+
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    /// @brief Stops and joins the worker threads
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    /// @brief Gets the number of worker threads, not counting the caller
+    std::size_t size() const { return threads.size(); }
+
+    /**
+     * @brief Runs fn(i) for every i in [0, count) and waits for all of them
+     * @tparam F Callable taking a std::size_t
+     * @param count Number of iterations
+     * @param fn The loop body, called concurrently from several threads
+     *
+     * Iterations are handed out in chunks, in no particular order. If an
+     * iteration throws, the remaining iterations still run and the first
+     * exception is rethrown on the calling thread once the loop is done.
+     */
+    template <typename F> void parallelFor(std::size_t count, F &&fn) {
+        if (count == 0) {
+            return;
+        }
+        if (threads.empty() || count == 1) {
+            for (std::size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+        start(fn, count, false);
+        work();
+        finish();
+    }
+
+    /**
+     * @brief Runs fn(thread) once on every thread of the pool and waits for all of them
+     * @tparam F Callable taking a std::size_t
+     * @param fn Called with 0 on the calling thread and with 1..size() on the workers
+     *
+     * Each index always runs on the same thread, which lets callers pin
+     * long-lived per-thread state such as a shard to a worker. Exceptions are
+     * handled like in parallelFor().
+     */
+    template <typename F> void runOnEach(F &&fn) {
+        if (threads.empty()) {
+            fn(std::size_t{0});
+            return;
+        }
+        start(fn, threads.size() + 1, true);
+        call(0);
+        finish();
+    }
+
+    /**
+     * @brief Binds the calling thread to one CPU
+     * @param cpu Index of the CPU, as numbered by the operating system
+     * @return false if the CPU is out of range or the platform has no thread affinity
+     *
+     * Only implemented on Linux; elsewhere it does nothing and returns false.
+     */
+    static bool pinThread(int cpu) {
+#if defined(__linux__)
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Binds every thread of the pool to a CPU
+     * @param cpus CPU of each thread, indexed like runOnEach(): the calling
+     *        thread first, then the workers. A negative entry or a missing one
+     *        leaves that thread unpinned.
+     * @return false if some thread could not be pinned
+     *
+     * Pinning the calling thread changes its affinity for good, not just
+     * for the pool's loops.
+     */
+    bool pin(const std::vector<int> &cpus) {
+        std::atomic<bool> ok{true};
+        runOnEach([&cpus, &ok](std::size_t thread) {
+            if (thread < cpus.size() && cpus[thread] >= 0 && !pinThread(cpus[thread])) {
+                ok.store(false, std::memory_order_relaxed);
+            }
+        });
+        return ok.load(std::memory_order_relaxed);
+    }
+
+  private:
+    /// Publishes a loop to the workers
+    template <typename F> void start(F &fn, std::size_t count, bool onEach) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = const_cast<void *>(static_cast<const void *>(&fn));
+            invoke = [](void *target, std::size_t i) {
+                (*static_cast<std::remove_reference_t<F> *>(target))(i);
+            };
+            taskCount = count;
+            grain = std::max<std::size_t>(1, count / ((threads.size() + 1) * 8));
+            next.store(0, std::memory_order_relaxed);
+            pinned = onEach;
+            active = threads.size();
+            ++generation;
+        }
+        wake.notify_all();
+    }
+
+    /// Waits for the workers and rethrows the first exception of the loop
+    void finish() {
+        std::exception_ptr failure;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return active == 0; });
+            task = nullptr;
+            failure = std::exchange(error, nullptr);
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    /// Claims chunks of the current loop until none are left
+    void work() {
+        for (;;) {
+            std::size_t first = next.fetch_add(grain, std::memory_order_relaxed);
+            if (first >= taskCount) {
+                return;
+            }
+            std::size_t last = std::min(first + grain, taskCount);
+            for (std::size_t i = first; i < last; ++i) {
+                call(i);
+            }
+        }
+    }
+
+    /// Runs one iteration, keeping the first exception for finish()
+    void call(std::size_t i) {
+        try {
+            invoke(task, i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    void workerLoop(std::size_t index) {
+        std::uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+            if (pinned) {
+                call(index);
+            } else {
+                work();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--active == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;  ///< Signals workers that a loop is ready or the pool stops
+    std::condition_variable done;  ///< Signals the caller that every worker has finished
+
+    void *task = nullptr;                           ///< Loop body of the current loop
+    void (*invoke)(void *, std::size_t) = nullptr;  ///< Calls the loop body
+    std::size_t taskCount = 0;                      ///< Iterations of the current loop
+    std::size_t grain = 1;                          ///< Iterations claimed at a time
+    std::atomic<std::size_t> next{0};               ///< First unclaimed iteration
+    bool pinned = false;                            ///< Current loop runs once per thread
+    std::size_t active = 0;                         ///< Workers still busy with the current loop
+    std::uint64_t generation = 0;                   ///< Bumped for every loop
+    bool stopping = false;
+    std::exception_ptr error;                       ///< First exception thrown by the loop body
+};
@@ -0,0 +1,287 @@
+/**
+ * @file TickDomainScheduler.h
+ * @brief One scheduler made of tick domains that run at their own rates.
+ *
+ * AI thinking at 10 Hz, movement at 60 Hz and economy timers at 1 Hz used to
+ * share one queue, so every 60 Hz update walked the same structure the slow
+ * timers sat in. A BasicDomainScheduler keeps one BasicScheduler per named
+ * domain, each counting its own ticks. A domain's tick lasts a fixed number
+ * of global ticks, so update(globalTick) only touches the domains that reach
+ * a new tick of their own. Actions are scheduled in domain ticks, and ticks
+ * convert from one domain to another through the global tick they start at.
+ */
+#pragma once
+
+#include "Scheduler.h"
+#include "UpdateBudget.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/// @brief Index of a domain in a BasicDomainScheduler
+using DomainID = std::uint32_t;
+
+/// @typedef DomainActionID
+/// @brief Identifier of an action in a domain scheduler
+///
+/// Holds the domain index in the upper 32 bits and the domain's ActionID in
+/// the lower 32 bits; 0 means no action.
+using DomainActionID = std::uint64_t;
+
+/**
+ * @class BasicDomainScheduler
+ * @brief Runs several schedulers at rates that are whole multiples of the global tick
+ * @tparam Queue The queue backend of every domain
+ *
+ * Domain tick n of a domain with period p and phase f starts at global tick
+ * f + n * p. Its actions, periodic intervals and coroutine delays all count
+ * domain ticks, and completion events carry the domain tick. update() may skip
+ * global ticks: a domain then runs once for the latest tick it reached.
+ *
+ * @code
+ * DomainScheduler scheduler;
+ * DomainID ai = scheduler.addDomain("ai"_hs, 6);        // 10 Hz at a 60 Hz global tick
+ * DomainID economy = scheduler.addDomain("economy"_hs, 60); // 1 Hz
+ *
+ * scheduler.schedule(ai, scheduler.toDomainTick(ai, globalTick) + 1, npc, think);
+ * // Due at the first economy tick at or after the next AI tick
+ * scheduler.schedule(economy, scheduler.convert(ai, economy, nextThink), shop, restock);
+ *
+ * // Every global tick; the economy queue is only touched once a second
+ * scheduler.update(globalTick, registry, dispatcher);
+ * @endcode
+ */
+template <typename Queue = HeapQueue<ScheduledAction>> class BasicDomainScheduler {
+  public:
+    /// @brief The scheduler type of every domain
+    using domain_type = BasicScheduler<Queue>;
+
+    BasicDomainScheduler() = default;
+    BasicDomainScheduler(const BasicDomainScheduler &) = delete;
+    BasicDomainScheduler &operator=(const BasicDomainScheduler &) = delete;
+
+    /**
+     * @brief Adds a domain, or finds the domain already added under a name
+     * @param name Name of the domain, such as "ai"_hs
+     * @param period Global ticks per domain tick, at least 1
+     * @param phase Global tick at which domain tick 0 starts
+     * @return The index of the domain
+     */
+    DomainID addDomain(entt::id_type name, int period, int phase = 0) {
+        if (std::optional<DomainID> existing = find(name)) {
+            return *existing;
+        }
+        domains.push_back(std::make_unique<Domain>(name, period > 0 ? period : 1, phase));
+        return static_cast<DomainID>(domains.size() - 1);
+    }
+
+    /// @brief Finds a domain by name
+    std::optional<DomainID> find(entt::id_type name) const {
+        for (std::size_t index = 0; index < domains.size(); ++index) {
+            if (domains[index]->name == name) {
+                return static_cast<DomainID>(index);
+            }
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Gets the number of domains
+    std::size_t domainCount() const { return domains.size(); }
+
+    /// @brief Gets the scheduler of a domain, for everything not forwarded here
+    domain_type &domain(DomainID id) { return domains[id]->scheduler; }
+
+    /// @brief Gets the scheduler of a domain
+    const domain_type &domain(DomainID id) const { return domains[id]->scheduler; }
+
+    /// @brief Gets the number of global ticks per tick of a domain
+    int period(DomainID id) const { return domains[id]->period; }
+
+    /**
+     * @brief Gets the domain tick running at a global tick
+     * @return The latest domain tick that started at or before globalTick
+     */
+    int toDomainTick(DomainID id, int globalTick) const {
+        const Domain &target = *domains[id];
+        return floorDiv(globalTick - target.phase, target.period);
+    }
+
+    /// @brief Gets the global tick a domain tick starts at
+    int toGlobalTick(DomainID id, int domainTick) const {
+        const Domain &target = *domains[id];
+        return target.phase + domainTick * target.period;
+    }
+
+    /**
+     * @brief Converts a tick of one domain to the first tick of another that is not earlier
+     * @param from The domain tick counts in
+     * @param to The domain to convert to
+     * @param tick A tick of from
+     * @return The first tick of to starting at or after the global tick of tick
+     */
+    int convert(DomainID from, DomainID to, int tick) const {
+        const Domain &target = *domains[to];
+        return -floorDiv(target.phase - toGlobalTick(from, tick), target.period);
+    }
+
+    /**
+     * @brief Schedules an action in a domain
+     * @param id The domain
+     * @param tick The domain tick at which to run the action
+     * @param entity The entity passed to the action
+     * @param action The action
+     * @param onComplete Optional callback run after the action
+     * @return The ID of the action
+     */
+    DomainActionID schedule(DomainID id, int tick, entt::entity entity, ActionFunction action,
+                            CompletionFunction onComplete = nullptr) {
+        return pack(id, domains[id]->scheduler.schedule(tick, entity, std::move(action),
+                                                        std::move(onComplete)));
+    }
+
+    /// @brief Schedules an action in a domain at its first tick at or after a global tick
+    DomainActionID scheduleAt(DomainID id, int globalTick, entt::entity entity,
+                              ActionFunction action, CompletionFunction onComplete = nullptr) {
+        const Domain &target = *domains[id];
+        int tick = -floorDiv(target.phase - globalTick, target.period);
+        return schedule(id, tick, entity, std::move(action), std::move(onComplete));
+    }
+
+    /// @brief Schedules an action repeating every interval domain ticks
+    /// @see BasicScheduler::schedulePeriodic
+    DomainActionID schedulePeriodic(DomainID id, int firstTick, int interval, int count,
+                                    entt::entity entity, ActionFunction action,
+                                    CompletionFunction onComplete = nullptr) {
+        return pack(id, domains[id]->scheduler.schedulePeriodic(
+                            firstTick, interval, count, entity, std::move(action),
+                            std::move(onComplete)));
+    }
+
+    /**
+     * @brief Cancel a scheduled action
+     * @param id The ID returned by schedule()
+     * @return true if the action was found and cancelled, false otherwise
+     */
+    bool cancel(DomainActionID id) {
+        std::size_t index = static_cast<std::size_t>(id >> 32);
+        return index < domains.size() &&
+               domains[index]->scheduler.cancel(static_cast<ActionID>(id));
+    }
+
+    /// @brief Move a pending action to another tick of its domain, keeping its ID
+    /// @see BasicScheduler::reschedule
+    bool reschedule(DomainActionID id, int tick) {
+        std::size_t index = static_cast<std::size_t>(id >> 32);
+        return index < domains.size() &&
+               domains[index]->scheduler.reschedule(static_cast<ActionID>(id), tick);
+    }
+
+    /// @brief Checks whether an action is still pending
+    bool isPending(DomainActionID id) const {
+        std::size_t index = static_cast<std::size_t>(id >> 32);
+        return index < domains.size() &&
+               domains[index]->scheduler.isPending(static_cast<ActionID>(id));
+    }
+
+    /// @brief Cancel every pending action of an entity, in every domain
+    /// @return The number of actions cancelled
+    std::size_t cancelAll(entt::entity entity) {
+        std::size_t cancelled = 0;
+        for (auto &target : domains) {
+            cancelled += target->scheduler.cancelAll(entity);
+        }
+        return cancelled;
+    }
+
+    /// @brief Gets the number of pending actions in every domain
+    std::size_t pendingCount() const {
+        std::size_t count = 0;
+        for (const auto &target : domains) {
+            count += target->scheduler.pendingCount();
+        }
+        return count;
+    }
+
+    /// @brief Gets the earliest global tick at which some domain has an action due
+    std::optional<int> nextDueTick() const {
+        std::optional<int> earliest;
+        for (std::size_t index = 0; index < domains.size(); ++index) {
+            if (std::optional<int> tick = domains[index]->scheduler.nextDueTick()) {
+                int global = toGlobalTick(static_cast<DomainID>(index), *tick);
+                earliest = earliest ? std::min(*earliest, global) : global;
+            }
+        }
+        return earliest;
+    }
+
+    /**
+     * @brief Updates the domains that reached a new tick
+     * @param globalTick The current global tick
+     * @param registry The registry passed to the actions
+     * @param dispatcher The dispatcher completion events go to
+     * @param budget Limits the work of each domain updated
+     * @return The actions run and left due, summed over the updated domains
+     *
+     * A domain that left a backlog is updated again at the next global tick,
+     * even if its tick has not changed.
+     */
+    UpdateResult update(int globalTick, entt::registry &registry, EventDispatcher &dispatcher,
+                        const UpdateBudget &budget = UpdateBudget{}) {
+        UpdateResult total;
+        for (std::size_t index = 0; index < domains.size(); ++index) {
+            Domain &target = *domains[index];
+            int tick = toDomainTick(static_cast<DomainID>(index), globalTick);
+            if (tick <= target.lastTick && target.backlog == 0) {
+                continue;
+            }
+            target.lastTick = tick;
+            UpdateResult result = target.scheduler.update(tick, registry, dispatcher, budget);
+            target.backlog = result.backlog;
+            total.executed += result.executed;
+            total.backlog += result.backlog;
+        }
+        return total;
+    }
+
+    /// @brief Clears every domain, keeping the domains themselves
+    void clear() {
+        for (auto &target : domains) {
+            target->scheduler.clear();
+            target->backlog = 0;
+        }
+    }
+
+  private:
+    struct Domain {
+        Domain(entt::id_type name, int period, int phase)
+            : name(name), period(period), phase(phase) {}
+
+        entt::id_type name;
+        int period;
+        int phase;
+        int lastTick = std::numeric_limits<int>::min(); ///< Domain tick of the last update
+        std::size_t backlog = 0;                        ///< Left due by the last update
+        domain_type scheduler;
+    };
+
+    /// Division rounding towards negative infinity, so ticks before the phase map down
+    static int floorDiv(int value, int divisor) {
+        int quotient = value / divisor;
+        return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+    }
+
+    static DomainActionID pack(DomainID id, ActionID action) {
+        return action == 0 ? 0 : (static_cast<DomainActionID>(id) << 32) | action;
+    }
+
+    std::vector<std::unique_ptr<Domain>> domains;
+};
+
+/// @brief Domain scheduler with heap-backed domains
+using DomainScheduler = BasicDomainScheduler<>;
@@ -0,0 +1,200 @@
+/**
+ * @file TickPipeline.h
+ * @brief Runs the scheduler, the dispatcher and ECS systems of a tick as a parallel task graph.
+ *
+ * A game tick usually calls scheduler.update(), then dispatcher.update(), then
+ * every system, one after the other. TickPipeline registers all of them as
+ * vertices of an entt::organizer, which orders them by the components they
+ * declare to read and write. The graph is built once and rebuilt only when
+ * the registrations change; each tick then runs it level by level on a
+ * TaskPool, so systems that touch disjoint components run concurrently.
+ */
+#pragma once
+
+#include "StaticDispatcher.h"
+#include "TaskPool.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <vector>
+
+/**
+ * @class TickPipeline
+ * @brief Task graph of the work done every tick
+ *
+ * Systems are free functions or member functions taking views, or const or
+ * non-const context variables, exactly as entt::organizer accepts them: a
+ * const component is read, a non-const one is written. The scheduler and
+ * dispatcher stages take the whole registry, since actions and listeners may
+ * touch any component, so they act as barriers: systems registered before one
+ * of them run before it, systems registered after it run after it.
+ *
+ * Systems in the same level of the graph run on different threads and must
+ * not create or destroy entities, or add or remove components.
+ *
+ * @code
+ * void moveSystem(entt::view<entt::get_t<Position, const Velocity>> view);
+ * void regenSystem(entt::view<entt::get_t<Health>> view);
+ *
+ * TickPipeline pipeline;
+ * pipeline.addScheduler(scheduler, dispatcher)
+ *     .addDispatcher(dispatcher)
+ *     .addSystem<&moveSystem>("move")
+ *     .addSystem<&regenSystem>("regen"); // Runs next to move
+ *
+ * // Every frame
+ * pipeline.run(tick, registry, pool);
+ * @endcode
+ */
+class TickPipeline {
+  public:
+    /**
+     * @brief Adds a stage updating a scheduler at the tick passed to run()
+     * @param scheduler Any scheduler with update(tick, registry, dispatcher)
+     * @param dispatcher The dispatcher the scheduler emits events on
+     * @param name Name of the vertex, for debugging
+     */
+    template <typename Scheduler>
+    TickPipeline &addScheduler(Scheduler &scheduler, EventDispatcher &dispatcher,
+                               const char *name = "scheduler") {
+        return addStage(
+            [this, &scheduler, &dispatcher](entt::registry &registry) {
+                scheduler.update(currentTick, registry, dispatcher);
+            },
+            name);
+    }
+
+    /**
+     * @brief Adds a stage publishing every queued event of a dispatcher
+     * @param dispatcher An entt::dispatcher or StaticDispatcher
+     * @param name Name of the vertex, for debugging
+     */
+    template <typename Dispatcher>
+    TickPipeline &addDispatcher(Dispatcher &dispatcher, const char *name = "dispatcher") {
+        return addStage([&dispatcher](entt::registry &) { dispatcher.update(); }, name);
+    }
+
+    /**
+     * @brief Adds a system taking views and context variables
+     * @tparam Candidate The free function
+     * @tparam Req Extra component types the system reads, as const, or writes
+     * @param name Name of the vertex, for debugging
+     */
+    template <auto Candidate, typename... Req> TickPipeline &addSystem(const char *name = nullptr) {
+        organizer.emplace<Candidate, Req...>(name);
+        dirty = true;
+        return *this;
+    }
+
+    /**
+     * @brief Adds a member function or a function with a payload as a system
+     * @tparam Candidate The function, called with instance first
+     * @tparam Req Extra component types the system reads, as const, or writes
+     * @param instance The object or payload, which must outlive the pipeline
+     * @param name Name of the vertex, for debugging
+     */
+    template <auto Candidate, typename... Req, typename Type>
+    TickPipeline &addSystem(Type &instance, const char *name = nullptr) {
+        organizer.emplace<Candidate, Req...>(instance, name);
+        dirty = true;
+        return *this;
+    }
+
+    /// @brief Removes every stage and system
+    void clear() {
+        organizer.clear();
+        stages.clear();
+        dirty = true;
+    }
+
+    /**
+     * @brief Runs every stage and system once
+     * @param tick The tick passed to the scheduler stages
+     * @param registry The registry systems read their views from
+     * @param pool Workers running the systems of a level in parallel
+     *
+     * Rebuilds the graph first if stages or systems were added since the last
+     * run, or if the registry changed. Levels run one after the other; a level
+     * with a single vertex runs on the calling thread.
+     */
+    void run(int tick, entt::registry &registry, TaskPool &pool) {
+        if (dirty || prepared != &registry) {
+            rebuild(registry);
+        }
+        currentTick = tick;
+        for (std::size_t level = 0; level + 1 < levelStarts.size(); ++level) {
+            std::size_t begin = levelStarts[level];
+            std::size_t count = levelStarts[level + 1] - begin;
+            if (count == 1) {
+                runVertex(order[begin], registry);
+            } else {
+                pool.parallelFor(count, [this, begin, &registry](std::size_t i) {
+                    runVertex(order[begin + i], registry);
+                });
+            }
+        }
+    }
+
+    /// @brief Gets the number of levels of the current graph, built by the last run()
+    std::size_t levelCount() const { return levelStarts.empty() ? 0 : levelStarts.size() - 1; }
+
+  private:
+    using Stage = std::function<void(entt::registry &)>;
+
+    TickPipeline &addStage(Stage stage, const char *name) {
+        stages.push_back(std::move(stage));
+        organizer.emplace(
+            +[](const void *payload, entt::registry &registry) {
+                (*static_cast<const Stage *>(payload))(registry);
+            },
+            &stages.back(), name);
+        dirty = true;
+        return *this;
+    }
+
+    void runVertex(std::size_t index, entt::registry &registry) const {
+        const auto &vertex = graph[index];
+        vertex.callback()(vertex.data(), registry);
+    }
+
+    /// Builds the graph and sorts its vertices into levels of independent vertices
+    void rebuild(entt::registry &registry) {
+        graph = organizer.graph();
+        std::vector<std::size_t> level(graph.size(), 0);
+        std::size_t depth = 0;
+        // Vertices are indexed in registration order, and edges only go forward
+        for (std::size_t i = 0; i < graph.size(); ++i) {
+            for (std::size_t from : graph[i].in_edges()) {
+                level[i] = std::max(level[i], level[from] + 1);
+            }
+            depth = std::max(depth, level[i] + 1);
+            // Create the storages and context variables up front, so systems never do
+            graph[i].prepare(registry);
+        }
+        order.resize(graph.size());
+        levelStarts.assign(depth + 1, 0);
+        for (std::size_t value : level) {
+            ++levelStarts[value + 1];
+        }
+        for (std::size_t i = 1; i < levelStarts.size(); ++i) {
+            levelStarts[i] += levelStarts[i - 1];
+        }
+        std::vector<std::size_t> fill(levelStarts.begin(), levelStarts.end() - 1);
+        for (std::size_t i = 0; i < graph.size(); ++i) {
+            order[fill[level[i]]++] = i;
+        }
+        prepared = &registry;
+        dirty = false;
+    }
+
+    entt::organizer organizer;
+    std::deque<Stage> stages; ///< Payloads of the stage vertices, at stable addresses
+    std::vector<entt::organizer::vertex> graph;
+    std::vector<std::size_t> order;       ///< Vertex indices grouped by level
+    std::vector<std::size_t> levelStarts; ///< Start of each level in order, plus the end
+    const entt::registry *prepared = nullptr;
+    bool dirty = true;
+    int currentTick = 0;
+};
@@ -8,14 +8,36 @@
  */
 #pragma once
 
-#include <functional>
+#include "ActionHandlers.h"
+#include "AllocationCounter.h"
+#include "BlockPool.h"
+#include "CapacityProfile.h"
+#include "EventName.h"
+#include "EventSpill.h"
+#include "HeapQueue.h"
+#include "InlineFunction.h"
+#include "SchedulerStats.h"
+#include "SchedulerTrace.h"
+#include "SchedulerWatchdog.h"
+#include "SlotMap.h"
+#include "SubmissionInbox.h"
+#include "TaskPool.h"
+#include "TimerQueue.h"
+#include "UpdateBudget.h"
+#include "WorkloadCapture.h"
+#include "entt/entt.hpp"
+#include <algorithm>
+#include <iterator>
 #include <memory>
-#include <queue>
-#include <string>
-#include <unordered_set>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
+#include <vector>
 
 /// @typedef EventID
 /// @brief Unique identifier for scheduled events
+///
+/// Packs a slot index and a generation (see SlotMap).
 using EventID = uint32_t;
 
 // Forward declaration of the TimedEventScheduler for the event
@@ -33,10 +55,9 @@ class TimedEvent {
     /**
      * @brief Constructs a timed event scheduled for a specific tick
      * @param tick The tick at which this event should execute
-     * @param name Optional name for identifying the event (default: empty string)
+     * @param name Optional name for identifying the event (default: no name)
      */
-    TimedEvent(int tick, std::string name = "")
-        : id(0), tick(tick), name(std::move(name)), priority(0) {}
+    TimedEvent(int tick, EventName name = {}) : id(0), tick(tick), name(name), priority(0) {}
 
     /// Virtual destructor for proper inheritance
     virtual ~TimedEvent() = default;
@@ -63,13 +84,22 @@ class TimedEvent {
     int getTick() const { return tick; }
 
     /// @brief Gets the name of this event
-    /// @return The event name
-    const std::string &getName() const { return name; }
+    /// @return The event name, as a hash
+    EventName getName() const { return name; }
+
+    /// @brief Gets the text of the event name
+    /// @return The text, or an empty view unless the name was interned (see EventNames)
+    std::string_view getNameText() const { return name.text(); }
 
     /// @brief Gets the unique ID of this event
     /// @return The event ID
     EventID getId() const { return id; }
 
+    /// @brief Gets the name of the event's type, for allocation counting
+    /// @return The entt::type_name of the type given to makeEvent() or
+    ///         scheduleEvent<EventType>(), "TimedEvent" for events made otherwise
+    std::string_view getTypeName() const { return typeName; }
+
     /// @brief Gets the priority of this event
     /// @return The event priority (higher values execute first within the same tick)
     int getPriority() const { return priority; }
@@ -87,10 +117,14 @@ class TimedEvent {
     TimedEventScheduler *scheduler = nullptr;
 
   private:
+    /// Moves queued events, see TimedEventScheduler::rescheduleEvent()
+    friend class TimedEventScheduler;
+
     EventID id;       ///< Unique identifier
     int tick;         ///< Tick at which to execute
-    std::string name; ///< Optional name for the event
+    EventName name;   ///< Optional name for the event
     int priority;     ///< Execution priority within the same tick
+    std::string_view typeName = "TimedEvent"; ///< Set by the scheduler's event factories
 };
 
 /**
@@ -118,11 +152,39 @@ struct TimedEventCompare {
     }
 };
 
+/**
+ * @struct TimedEventTraits
+ * @brief Queue ordering traits for scheduled events
+ *
+ * Orders events like TimedEventCompare. The queue reads the tick and rank once
+ * per push, so its comparisons never dereference the events.
+ */
+struct TimedEventTraits {
+    static int tick(const std::shared_ptr<TimedEvent> &event) { return event->getTick(); }
+
+    static std::uint32_t rank(const std::shared_ptr<TimedEvent> &event) {
+        return rankOfPriority(event->getPriority());
+    }
+};
+
+/**
+ * @struct TimedEventIds
+ * @brief Timer queue ID policy for scheduled events, see TimerNodeIds
+ */
+struct TimedEventIds {
+    using id_type = EventID;
+
+    static EventID get(const std::shared_ptr<TimedEvent> &event) { return event->getId(); }
+    template <typename Event> static void set(const std::shared_ptr<Event> &event, EventID id) {
+        event->setId(id);
+    }
+};
+
 /**
  * @class FunctionEvent
  * @brief Convenience class for simple function-based events
  *
- * This class wraps a std::function to be executed as an event,
+ * This class wraps a callable to be executed as an event,
  * simplifying the creation of one-off events without requiring
  * a full class implementation.
  */
@@ -134,8 +196,8 @@ class FunctionEvent : public TimedEvent {
      * @param func The function to call when executed
      * @param name Optional name for the event
      */
-    FunctionEvent(int tick, std::function<void()> func, std::string name = "")
-        : TimedEvent(tick, std::move(name)), func(std::move(func)) {}
+    FunctionEvent(int tick, InlineFunction<void()> func, EventName name = {})
+        : TimedEvent(tick, name), func(std::move(func)) {}
 
     /**
      * @brief Executes the wrapped function
@@ -144,8 +206,11 @@ class FunctionEvent : public TimedEvent {
      */
     void execute() override { func(); }
 
+    /// @brief Gets the wrapped function
+    const InlineFunction<void()> &function() const { return func; }
+
   private:
-    std::function<void()> func; ///< The function to execute
+    InlineFunction<void()> func; ///< The function to execute
 };
 
 /**
@@ -168,13 +233,73 @@ class FunctionEvent : public TimedEvent {
  * // Process events for the current tick
  * scheduler.update(currentTick);
  * @endcode
+ *
+ * A scheduler constructed with a std::pmr::memory_resource keeps its queue,
+ * its ID slots and the events made by scheduleEvent<EventType>() in that
+ * resource. Events made by makeEvent() or submitted through an inbox still
+ * come from BlockPool, since inboxes are fed from other threads.
  */
 class TimedEventScheduler {
   public:
+    /**
+     * @class Inbox
+     * @brief Lock-free submission path for threads other than the scheduler's own
+     *
+     * Obtained from openInbox(). Its methods may be called from any thread,
+     * concurrently with each other and with update(). Submitted events join
+     * the queue at the start of the next update, in submission order, after
+     * the inboxes opened before this one.
+     */
+    class Inbox {
+      public:
+        /**
+         * @brief Submit a pre-created event from any thread
+         * @param event The event to schedule
+         * @return The ID of the event, or 0 if the inbox ran out of reserved IDs
+         *
+         * The returned ID can be cancelled from the scheduler's thread even
+         * before the event has been merged. A submission that got no ID is
+         * still scheduled and receives its ID when it is merged.
+         */
+        EventID submit(std::shared_ptr<TimedEvent> event) {
+            EventID id = box.reserveId();
+            event->setId(id);
+            box.push(id, std::move(event));
+            return id;
+        }
+
+        /// @brief Creates an event of the given type and submits it
+        template <typename EventType, typename... Args> EventID submitEvent(Args &&...args) {
+            return submit(makeEvent<EventType>(std::forward<Args>(args)...));
+        }
+
+        /// @brief Submits a FunctionEvent, see TimedEventScheduler::scheduleFunction()
+        EventID submitFunction(int tick, InlineFunction<void()> func, EventName name = {}) {
+            return submitEvent<FunctionEvent>(tick, std::move(func), name);
+        }
+
+      private:
+        friend class TimedEventScheduler;
+
+        explicit Inbox(std::size_t idReserve) : box(idReserve) {}
+
+        SubmissionInbox<std::shared_ptr<TimedEvent>, EventID> box;
+    };
+
     /**
      * @brief Constructs a new event scheduler
      */
-    TimedEventScheduler() : nextEventId(1) {}
+    TimedEventScheduler() = default;
+
+    /**
+     * @brief Constructs an event scheduler whose queue and events draw from a memory resource
+     * @param resource The resource, which must outlive every event scheduled with it
+     */
+    explicit TimedEventScheduler(std::pmr::memory_resource *resource)
+        : timers(Timers::allocator_type(resource)), memory(resource) {}
+
+    /// @brief Gets the resource given at construction, nullptr for the default allocator
+    std::pmr::memory_resource *memoryResource() const { return memory; }
 
     /**
      * @brief Schedules a new event of specified type
@@ -197,8 +322,31 @@ class TimedEventScheduler {
      * @endcode
      */
     template <typename EventType, typename... Args> EventID scheduleEvent(Args &&...args) {
-        auto event = std::make_shared<EventType>(std::forward<Args>(args)...);
-        return scheduleEvent(event);
+        if (memory != nullptr) {
+            auto event = std::allocate_shared<EventType>(
+                std::pmr::polymorphic_allocator<EventType>(memory), std::forward<Args>(args)...);
+            event->typeName = entt::type_name<EventType>::value();
+            return scheduleEvent(std::move(event));
+        }
+        return scheduleEvent(makeEvent<EventType>(std::forward<Args>(args)...));
+    }
+
+    /**
+     * @brief Creates an event in pooled memory
+     * @tparam EventType The type of event to create (must derive from TimedEvent)
+     * @param args Arguments to forward to the EventType constructor
+     * @return The event, ready for scheduleEvent() or scheduleEvents()
+     *
+     * The event and its reference count share one block from BlockPool, so
+     * creating and destroying events is a free-list pop and push once the
+     * pool is warm. scheduleEvent<EventType>() and the inboxes use it too.
+     */
+    template <typename EventType, typename... Args>
+    static std::shared_ptr<EventType> makeEvent(Args &&...args) {
+        auto event = std::allocate_shared<EventType>(PoolAllocator<EventType>{},
+                                                     std::forward<Args>(args)...);
+        event->typeName = entt::type_name<EventType>::value();
+        return event;
     }
 
     /**
@@ -207,12 +355,87 @@ class TimedEventScheduler {
      * @return The ID of the scheduled event
      */
     EventID scheduleEvent(std::shared_ptr<TimedEvent> event) {
-        EventID eventId = nextEventId++;
-        event->setId(eventId);
+        SCHEDULER_ALLOCATION_SCOPE("TimedEventScheduler::scheduleEvent");
         event->setScheduler(this);
-        eventQueue.push(event);
-        activeEvents.insert(eventId);
-        return eventId;
+        if (spill != nullptr && spill->accepts(event->getTick())) {
+            if (const EventHandlers::Call *call = savedCall(*event)) {
+                EventID id = timers.acquire();
+                event->setId(id);
+                spillEvent(*event, *call);
+                return id;
+            }
+        }
+        TimedEvent &target = *event;
+        EventID id = timers.insert(std::move(event));
+        if (capture) {
+            captureSchedule(target);
+        }
+        return id;
+    }
+
+    /**
+     * @brief Opens a submission inbox for a producer thread
+     * @param idReserve Number of IDs the inbox can hand out between two updates
+     * @return The inbox, which lives as long as the scheduler
+     *
+     * Call it from the scheduler's thread, and give each producer thread its
+     * own inbox so that merged events keep a reproducible order.
+     */
+    Inbox &openInbox(std::size_t idReserve = 256) {
+        inboxes.push_back(std::unique_ptr<Inbox>(new Inbox(idReserve)));
+        Inbox &inbox = *inboxes.back();
+        inbox.box.refill([this] { return timers.acquire(); });
+        return inbox;
+    }
+
+    /**
+     * @brief Moves submitted events into the queue and tops up the inbox IDs
+     *
+     * update() calls this first.
+     */
+    void mergeInboxes() {
+        for (auto &inbox : inboxes) {
+            inbox->box.drain([this](EventID id, std::shared_ptr<TimedEvent> &&event) {
+                if (id == 0) {
+                    id = timers.acquire();
+                    event->setId(id);
+                } else if (!timers.contains(id)) {
+                    return; // Cancelled before it was merged
+                }
+                event->setScheduler(this);
+                if (spill != nullptr && spill->accepts(event->getTick())) {
+                    if (const EventHandlers::Call *call = savedCall(*event)) {
+                        spillEvent(*event, *call);
+                        return;
+                    }
+                }
+                if (capture) {
+                    captureSchedule(*event);
+                }
+                timers.enqueue(std::move(event));
+            });
+            inbox->box.refill([this] { return timers.acquire(); });
+        }
+    }
+
+    /**
+     * @brief Schedules a batch of pre-created events at once
+     * @tparam It Forward iterator over std::shared_ptr to TimedEvent (or a derived type)
+     * @param first Iterator to the first event, pointers are moved from
+     * @param last Iterator past the last event
+     * @return The contiguous range of IDs given to the events, in input order
+     *
+     * Reserves room for the whole batch, hands out its IDs as one block and
+     * builds the queue order once.
+     */
+    template <typename It> IdRange<EventID> scheduleEvents(It first, It last) {
+        SCHEDULER_ALLOCATION_SCOPE("TimedEventScheduler::scheduleEvents");
+        return timers.insertBulk(first, last, [this](const auto &event) {
+            event->setScheduler(this);
+            if (capture) {
+                captureSchedule(*event);
+            }
+        });
     }
 
     /**
@@ -220,17 +443,171 @@ class TimedEventScheduler {
      * @param id The ID of the event to cancel
      * @return true if the event was found and cancelled, false otherwise
      *
-     * Note: This only marks the event as inactive; it will be skipped when
-     * its turn comes up in the event queue.
+     * The event is removed from the queue and released right away. Cancelling
+     * an event that has already started executing has no effect and returns false.
      */
     bool cancelEvent(EventID id) {
-        if (activeEvents.find(id) != activeEvents.end()) {
-            activeEvents.erase(id);
-            return true;
+        if (!timers.cancel(id)) {
+            return false;
+        }
+        if (stats) {
+            stats->recordCancel();
         }
-        return false;
+        if (capture) {
+            captureCall(WorkloadRecord::Kind::cancel, 0, id);
+        }
+        forgetDependencies(id);
+        compactIfSparse();
+        return true;
     }
 
+    /**
+     * @brief Moves a scheduled event to another tick, keeping its ID
+     * @param id The ID of the event
+     * @param tick The tick at which the event now runs
+     * @return true if the event was queued and has been moved
+     *
+     * The event stays the same object and is moved within the queue, so the
+     * ID and every reference to the event stay valid. Among events of the new
+     * tick and the same priority it runs last. An event that is running or
+     * still waiting in an inbox cannot be moved.
+     */
+    bool rescheduleEvent(EventID id, int tick) {
+        return timers.modify(id, [this, tick](std::shared_ptr<TimedEvent> &event) {
+            if (capture) {
+                captureCall(WorkloadRecord::Kind::cancel, 0, event->getId());
+            }
+            event->tick = tick;
+            if (capture) {
+                captureSchedule(*event);
+            }
+        });
+    }
+
+    /**
+     * @brief Sets when the event pool is compacted after cancellations
+     * @param freeRatio Share of free pool slots above which cancelEvent() compacts
+     *        the pool, 1 to never compact
+     * @param minimumPool Pool size below which the pool is never compacted
+     *
+     * Cancelled events are removed from the queue right away, but the slots
+     * they occupied in the queue's pool stay allocated for reuse. After a
+     * burst of cancellations, compaction gives that memory back in O(n).
+     */
+    void setCompactionThreshold(double freeRatio, std::size_t minimumPool = 1024) {
+        compactionRatio = freeRatio;
+        compactionMinimum = minimumPool;
+    }
+
+    /// @brief Gets the number of times the event pool has been compacted
+    std::size_t compactionCount() const { return compactions; }
+
+    /// @brief Reserves the queue and the ID slots for a number of pending events
+    void reserve(std::size_t expectedPending) {
+        timers.reserve(expectedPending);
+        reservedPending = std::max(reservedPending, expectedPending);
+    }
+
+    /**
+     * @brief Reserves room for the sizes a profile records
+     * @param profile Typically capacityProfile() saved at the end of an earlier run
+     *
+     * Reserves the queue, the ID slots and the buffer of a tick's events.
+     * Only pending and due apply to events. Events made by scheduleEvent()
+     * come from BlockPool, which BlockPool::reserve() warms. Compaction may
+     * give reserved pool slots back after a burst of cancellations.
+     */
+    void reserve(const CapacityProfile &profile) {
+        reserve(profile.pending);
+        batch.reserve(profile.due);
+    }
+
+    /// @brief Gets the most pending and due events held at once, or the reserved sizes if larger
+    CapacityProfile capacityProfile() const {
+        CapacityProfile profile;
+        profile.pending = std::max(timers.slotCount(), reservedPending);
+        profile.due = batch.capacity();
+        return profile;
+    }
+
+    /**
+     * @brief Attaches statistics that later updates fill in
+     * @param target The statistics, or nullptr to stop recording
+     *
+     * The scheduler does not own the statistics, which must outlive it or be
+     * detached first. update() times every event; updateParallel() records
+     * lateness only.
+     */
+    void setStats(SchedulerStats *target) { stats = target; }
+
+    /// @brief Copies the attached statistics, from any thread; empty if none are attached
+    StatsSnapshot snapshotStats() const { return stats ? stats->snapshot() : StatsSnapshot{}; }
+
+    /**
+     * @brief Attaches a trace that records the start and end of every event run
+     * @param target The trace, or nullptr to stop tracing
+     *
+     * Each thread running events writes to its own buffer of the trace.
+     * Events are recorded with their ID, name and due tick.
+     */
+    void setTrace(SchedulerTrace *target) { trace = target; }
+
+    /**
+     * @brief Attaches a watchdog that attributes sampled run times to events
+     * @param target The watchdog, or nullptr to stop sampling
+     *
+     * Named events are attributed to their name, unnamed saveable events to
+     * their handler ID and any other event to its type. Runs over the
+     * watchdog's threshold are logged with their tick. See SchedulerWatchdog.h.
+     */
+    void setWatchdog(SchedulerWatchdog *target) { watchdog = target; }
+
+    /**
+     * @brief Attaches a capture that logs every schedule, cancel and update call
+     * @param target The capture, or nullptr to stop capturing
+     *
+     * See WorkloadCapture.h; replay a capture with WorkloadReplay.
+     */
+    void setCapture(WorkloadCapture *target) { capture = target; }
+
+    /**
+     * @brief Attaches a disk tier for events due beyond its horizon
+     * @param target The spill, or nullptr to stop spilling; not owned
+     * @param handlers The handlers spilled calls are bound to again when
+     *        they are read back, which must outlive the scheduler
+     *
+     * From then on, saveable events (FunctionEvents of an EventHandlers::Call)
+     * that scheduleEvent() or an inbox adds beyond the horizon are written to
+     * the spill instead of the queue. They keep their ID: isPending() and
+     * cancelEvent() work on them, but rescheduleEvent() does not until they
+     * are back. Every update reads back the buckets about to come due and
+     * appends the records of newly spilled events. nextDueTick() accounts
+     * for spilled events; pendingCount() and forEachPending() do not, so
+     * snapshots leave them out. Names come back as their hash, and events
+     * added with scheduleEvents() always stay in memory.
+     * Detaching drops the events still spilled.
+     *
+     * A bucket whose file cannot be read stays spilled, and every update
+     * tries it again; spillFailures() counts the updates where one failed.
+     */
+    void setSpill(EventSpill *target, const EventHandlers *handlers) {
+        if (spill != nullptr && spill != target) {
+            spill->clear();
+        }
+        spill = target;
+        spillHandlers = handlers;
+    }
+
+    /// @brief Gets the number of updates that could not read a spill bucket back
+    std::size_t spillFailures() const { return failedPageIns; }
+
+    /**
+     * @brief Checks whether an event is still waiting to run
+     * @param id The ID of the event
+     * @return true if the event is queued and has not been cancelled
+     */
+    bool isPending(EventID id) const { return timers.contains(id); }
+
     /**
      * @brief Processes all events scheduled up to the given tick
      * @param currentTick The current system tick
@@ -238,22 +615,151 @@ class TimedEventScheduler {
      * This method executes all events that are due at or before the current tick,
      * in order of tick and then priority.
      */
-    void update(int currentTick) {
-        while (!eventQueue.empty() && eventQueue.top()->getTick() <= currentTick) {
-            auto event = eventQueue.top();
-            eventQueue.pop();
+    void update(int currentTick) { update(currentTick, UpdateBudget{}); }
 
-            // Skip if the event was cancelled
-            if (activeEvents.find(event->getId()) == activeEvents.end()) {
-                continue;
-            }
+    /**
+     * @brief Processes events scheduled up to the given tick within a budget
+     * @param currentTick The current system tick
+     * @param budget Limits on the time spent and the number of events run
+     * @return How many events ran and how many due events were left over
+     *
+     * Runs events exactly like update() until the budget is used up. The rest
+     * of the due events stay queued in order and run first on the next call.
+     */
+    UpdateResult update(int currentTick, const UpdateBudget &budget) {
+        SCHEDULER_ALLOCATION_SCOPE("TimedEventScheduler::update");
+        mergeInboxes();
+        pageIn(currentTick);
+        if (capture) {
+            captureCall(WorkloadRecord::Kind::update, currentTick, 0);
+        }
+        if (stats) {
+            stats->beginUpdate(timers.size());
+        }
+        UpdateResult result = runDue(currentTick, budget);
+        if (spill != nullptr) {
+            spill->flush();
+        }
+        if (stats) {
+            stats->endUpdate(timers.size());
+        }
+        return result;
+    }
 
-            // Execute the event
-            event->execute();
+    /**
+     * @brief Makes one pending event wait for another in updateParallel()
+     * @param before The event to run first
+     * @param after The event to run once before has finished
+     * @return true if both events are pending and the edge was recorded
+     *
+     * The edge only orders the two events when they are due at the same
+     * tick; if before is due earlier it has already run by then, and if it
+     * is due later the edge is ignored. update() runs events in queue order
+     * and ignores edges. Edges are dropped with their events.
+     */
+    bool addDependency(EventID before, EventID after) {
+        if (before == after || !timers.contains(before) || !timers.contains(after)) {
+            return false;
+        }
+        prerequisites[after].push_back(before);
+        return true;
+    }
+
+    /// @brief Gets the number of pending events that wait for another, see addDependency()
+    std::size_t dependentCount() const { return prerequisites.size(); }
+
+    /**
+     * @brief Processes all events scheduled up to the given tick on a worker pool
+     * @param currentTick The current system tick
+     * @param pool The workers that run the events
+     * @return How many events ran
+     *
+     * The events of each due tick are taken out of the queue together and run
+     * as a graph: an event starts once the events it depends on (see
+     * addDependency()) have finished, otherwise events of one tick run
+     * concurrently. The graph of a tick completes before the next tick starts.
+     *
+     * While events run in parallel they must not call into the scheduler,
+     * though they may submit through an Inbox. If an event throws, the
+     * exception is rethrown once the events running beside it are done, and
+     * the rest of that tick is dropped.
+     */
+    UpdateResult updateParallel(int currentTick, TaskPool &pool) {
+        SCHEDULER_ALLOCATION_SCOPE("TimedEventScheduler::updateParallel");
+        mergeInboxes();
+        pageIn(currentTick);
+        if (capture) {
+            captureCall(WorkloadRecord::Kind::update, currentTick, 0);
+        }
+        if (stats) {
+            stats->beginUpdate(timers.size());
+        }
+        std::size_t executed = 0;
+        std::shared_ptr<TimedEvent> event;
+        while (timers.popDue(currentTick, event)) {
+            int tick = event->getTick();
+            // Also drops what a throwing event left of the previous batch
+            dropBatch();
+            do {
+                timers.release(event->getId());
+                if (stats) {
+                    stats->recordRun(currentTick - tick);
+                }
+                batch.push_back(std::move(event));
+            } while (timers.popDue(tick, event));
+            executed += batch.size();
+            runBatch(pool);
+            dropBatch();
+        }
+        if (spill != nullptr) {
+            spill->flush();
+        }
+        if (stats) {
+            stats->endUpdate(timers.size());
+        }
+        return UpdateResult{executed, 0};
+    }
+
+    /// @brief Gets the number of pending events, not counting those still in an inbox
+    std::size_t pendingCount() const { return timers.size(); }
 
-            // Remove from active events
-            activeEvents.erase(event->getId());
+    /**
+     * @brief Gets the tick of the earliest pending event
+     * @return The earliest due tick, or nothing if no event is pending
+     *
+     * Cancelled events are never counted, and events still waiting in an
+     * inbox are not considered. Cancelled events still in a spill bucket
+     * are, until the bucket is read back; events of a bucket that could not
+     * be read are not, until an update reads it.
+     */
+    std::optional<int> nextDueTick() const {
+        std::optional<int> next = timers.nextTick();
+        std::optional<int> spilled = spill != nullptr ? spill->nextTick() : std::nullopt;
+        if (next && spilled) {
+            return std::min(*next, *spilled);
         }
+        return next ? next : spilled;
+    }
+
+    /**
+     * @brief Processes every event due up to a tick, skipping the idle ticks in between
+     * @param targetTick The tick to catch up to
+     * @return The number of ticks at which events ran
+     *
+     * Calls update() once for each tick that has due events, in tick order.
+     * Spilled events whose bucket cannot be read are passed over, and come
+     * back late if a later update reads the bucket; see spillFailures().
+     */
+    std::size_t advanceTo(int targetTick) {
+        mergeInboxes();
+        std::size_t ticks = 0;
+        for (std::optional<int> next = nextDueTick(); next && *next <= targetTick;
+             next = nextDueTick()) {
+            if (update(*next, UpdateBudget{}).executed != 0) {
+                ++ticks;
+            }
+        }
+        return ticks;
     }
 
     /**
@@ -266,32 +772,340 @@ class TimedEventScheduler {
      * This is a convenience method for quickly scheduling function-based events
      * without creating a custom event class.
      */
-    EventID scheduleFunction(int tick, std::function<void()> func, std::string name = "") {
-        return scheduleEvent<FunctionEvent>(tick, std::move(func), std::move(name));
+    EventID scheduleFunction(int tick, InlineFunction<void()> func, EventName name = {}) {
+        return scheduleEvent<FunctionEvent>(tick, std::move(func), name);
+    }
+
+    /**
+     * @brief Visits every queued event
+     * @param fn Called with a const reference to each queued TimedEvent, in no particular order
+     *
+     * Events still waiting in an inbox are not visited.
+     */
+    template <typename F> void forEachPending(F &&fn) const {
+        timers.forEach([&fn](const std::shared_ptr<TimedEvent> &event) { fn(*event); });
     }
 
     /**
      * @brief Clears all pending events
      *
      * This removes all scheduled events from the queue and active list.
+     * Events waiting in inboxes are dropped too, so no producer may submit
+     * while clear() runs.
+     *
+     * Pending events are not destroyed here: the queue starts a new epoch, so
+     * every old ID stops being pending at once, and the old events are
+     * destroyed as update() reaches their ticks, or all together by
+     * reclaim(). Allocated capacity is kept.
      */
     void clear() {
-        std::priority_queue<std::shared_ptr<TimedEvent>, std::vector<std::shared_ptr<TimedEvent>>,
-                            TimedEventCompare>
-            empty;
-        std::swap(eventQueue, empty);
-        activeEvents.clear();
+        timers.expire();
+        prerequisites.clear();
+        if (spill != nullptr) {
+            spill->clear();
+        }
+        for (auto &inbox : inboxes) {
+            inbox->box.reset();
+            inbox->box.refill([this] { return timers.acquire(); });
+        }
     }
 
+    /**
+     * @brief Destroys the events clear() left in the queue and releases their IDs
+     * @return The number of IDs released
+     *
+     * O(n) in the ID slots; call it at a quiet moment, outside of update().
+     * Until then nextDueTick() may report the tick of an old event.
+     */
+    std::size_t reclaim() { return timers.reclaim(); }
+
   private:
-    /// Queue of pending events, ordered by tick and priority
-    std::priority_queue<std::shared_ptr<TimedEvent>, std::vector<std::shared_ptr<TimedEvent>>,
-                        TimedEventCompare>
-        eventQueue;
+    using EventQueue = HeapQueue<std::shared_ptr<TimedEvent>, TimedEventTraits, 4,
+                                 std::pmr::polymorphic_allocator<std::shared_ptr<TimedEvent>>>;
+    using Timers = BasicTimerQueue<std::shared_ptr<TimedEvent>, EventQueue, TimedEventIds>;
+
+    /// Drops the edges into an event that ran or was cancelled
+    void forgetDependencies(EventID id) {
+        if (!prerequisites.empty()) {
+            prerequisites.erase(id);
+        }
+    }
+
+    /// Forgets the events of the batch that ran, and their edges, which runBatch() read
+    void dropBatch() {
+        for (const std::shared_ptr<TimedEvent> &ran : batch) {
+            forgetDependencies(ran->getId());
+        }
+        batch.clear();
+    }
+
+    /// Runs due events until nothing is due or the budget is spent
+    UpdateResult runDue(int currentTick, const UpdateBudget &budget) {
+        BudgetMeter meter(budget);
+        std::shared_ptr<TimedEvent> event;
+        while (!meter.exhausted()) {
+            if (!timers.popDue(currentTick, event)) {
+                return UpdateResult{meter.consumed(), 0};
+            }
+            // Cancelled events never reach this point, they are erased eagerly
+            timers.release(event->getId());
+            forgetDependencies(event->getId());
+
+            // Execute the event
+            SCHEDULER_ALLOCATION_SCOPE(event->getTypeName());
+            if (stats || trace || (watchdog && watchdog->sample())) {
+                CostKey key = watchdog ? costKey(*event) : CostKey{};
+                TraceRecord record = traced(*event);
+                event->execute();
+                record.end = SchedulerTrace::now();
+                if (stats) {
+                    stats->recordRun(currentTick - record.tick,
+                                     std::chrono::nanoseconds(record.end - record.begin));
+                }
+                if (trace) {
+                    trace->local().record(record);
+                }
+                if (watchdog) {
+                    watchdog->record(key, record.begin, record.end, record.id, record.entity,
+                                     record.tick);
+                }
+            } else {
+                event->execute();
+            }
+            meter.consume();
+        }
+        return UpdateResult{meter.consumed(), timers.countDue(currentTick)};
+    }
+
+    /// Runs the events of one tick in batch as waves of the dependency graph
+    void runBatch(TaskPool &pool) {
+        // Only events with edges inside the batch are bound into the graph
+        wave.assign(batch.size(), 0);
+        if (!prerequisites.empty()) {
+            index.clear();
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                index.emplace(batch[i]->getId(), i);
+            }
+            if (before.size() < batch.size()) {
+                before.resize(batch.size());
+                after.resize(batch.size());
+            }
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                before[i].clear();
+                after[i].clear();
+            }
+            waiting.assign(batch.size(), 0);
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                auto found = prerequisites.find(batch[i]->getId());
+                if (found == prerequisites.end()) {
+                    continue;
+                }
+                for (EventID id : found->second) {
+                    if (auto it = index.find(id); it != index.end()) {
+                        before[i].push_back(it->second);
+                        after[it->second].push_back(i);
+                        ++waiting[i];
+                    }
+                }
+            }
+
+            // Bind constrained events so that writers come before their readers; an event
+            // runs one wave after the latest of the events it waits for that are bound
+            bound.assign(batch.size(), false);
+            auto bind = [this](std::size_t i) {
+                for (std::size_t j : before[i]) {
+                    if (bound[j]) {
+                        wave[i] = std::max(wave[i], wave[j] + 1);
+                    }
+                }
+                bound[i] = true;
+            };
+            ready.clear();
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                if (waiting[i] == 0 && !after[i].empty()) {
+                    ready.push_back(i);
+                }
+            }
+            for (std::size_t next = 0; next < ready.size(); ++next) {
+                bind(ready[next]);
+                for (std::size_t j : after[ready[next]]) {
+                    if (--waiting[j] == 0) {
+                        ready.push_back(j);
+                    }
+                }
+            }
+            // Events on a cycle keep only the edges from events bound before them
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                if (!bound[i] && !before[i].empty()) {
+                    bind(i);
+                }
+            }
+        }
+
+        std::size_t waves = batch.empty() ? 0 : *std::max_element(wave.begin(), wave.end()) + 1;
+        for (std::size_t level = 0; level < waves; ++level) {
+            members.clear();
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                if (wave[i] == level) {
+                    members.push_back(i);
+                }
+            }
+            pool.parallelFor(members.size(), [this](std::size_t i) {
+                TimedEvent &event = *batch[members[i]];
+                if (!trace) {
+                    event.execute();
+                    return;
+                }
+                TraceRecord record = traced(event);
+                event.execute();
+                record.end = SchedulerTrace::now();
+                trace->local().record(record);
+            });
+        }
+    }
+
+    /// Gets the handler call of a saveable event, nullptr for any other event
+    static const EventHandlers::Call *savedCall(const TimedEvent &event) {
+        const auto *function = dynamic_cast<const FunctionEvent *>(&event);
+        return function != nullptr ? function->function().target<EventHandlers::Call>() : nullptr;
+    }
+
+    /// Writes an event whose ID is acquired to the spill instead of the queue
+    void spillEvent(const TimedEvent &event, const EventHandlers::Call &call) {
+        spill->store(SpilledEventRecord{event.getId(), event.getTick(), event.getPriority(),
+                                        event.getName().value(), call.saved()});
+        if (capture) {
+            captureSchedule(event);
+        }
+    }
+
+    /// Queues the spilled events whose bucket is about to come due
+    void pageIn(int currentTick) {
+        if (spill == nullptr) {
+            return;
+        }
+        if (!spill->load(currentTick, pagedIn)) {
+            ++failedPageIns;
+        }
+        for (const SpilledEventRecord &record : pagedIn) {
+            if (!timers.contains(record.id)) {
+                continue; // Cancelled while on disk
+            }
+            std::optional<EventHandlers::Call> call =
+                spillHandlers != nullptr ? spillHandlers->restore(record.payload) : std::nullopt;
+            if (!call) {
+                timers.cancel(record.id);
+                continue;
+            }
+            auto event =
+                makeEvent<FunctionEvent>(record.tick, *call, EventName::fromId(record.name));
+            event->setPriority(record.priority);
+            event->setId(record.id);
+            event->setScheduler(this);
+            timers.enqueue(std::move(event));
+        }
+        pagedIn.clear();
+    }
+
+    /// Logs a newly queued event in the attached capture
+    void captureSchedule(const TimedEvent &event) {
+        const EventHandlers::Call *call = savedCall(event);
+        WorkloadRecord record;
+        record.kind = WorkloadRecord::Kind::schedule;
+        record.source = WorkloadRecord::Source::event;
+        record.tick = event.getTick();
+        record.id = event.getId();
+        record.handler = call != nullptr ? call->saved().handler : 0;
+        record.priority = event.getPriority();
+        capture->record(record);
+    }
+
+    /// Logs a cancel or update call in the attached capture
+    void captureCall(WorkloadRecord::Kind kind, int tick, EventID id) {
+        WorkloadRecord record;
+        record.kind = kind;
+        record.source = WorkloadRecord::Source::event;
+        record.tick = tick;
+        record.id = id;
+        capture->record(record);
+    }
+
+    /// Gets what the watchdog attributes the run of an event to
+    static CostKey costKey(const TimedEvent &event) {
+        if (event.getName().value() != 0) {
+            return CostKey{CostSource::event, event.getName().value()};
+        }
+        if (const EventHandlers::Call *call = savedCall(event)) {
+            return CostKey{CostSource::handler, call->saved().handler};
+        }
+        return CostKey::ofType(typeid(event));
+    }
+
+    /// Starts the trace record of an event that is about to run
+    static TraceRecord traced(const TimedEvent &event) {
+        return TraceRecord{SchedulerTrace::now(), 0, event.getId(), event.getName().value(),
+                           entt::to_integral(entt::entity{entt::null}), event.getTick(),
+                           TraceRecord::Source::event};
+    }
+
+    /// Compacts the queue's pool once free slots pass the threshold
+    void compactIfSparse() {
+        std::size_t pool = timers.backend().poolSize();
+        if (pool < compactionMinimum ||
+            static_cast<double>(pool - timers.size()) <= compactionRatio * pool) {
+            return;
+        }
+        timers.compact();
+        ++compactions;
+    }
+
+    /// Queue of pending events, ordered by tick and priority, and the handle of every EventID
+    Timers timers;
+
+    /// Inboxes handed out by openInbox(), in merge order
+    std::vector<std::unique_ptr<Inbox>> inboxes;
+
+    /// Events each pending event waits for in updateParallel(), see addDependency()
+    entt::dense_map<EventID, std::vector<EventID>> prerequisites;
+
+    /// Events of the tick being run by updateParallel()
+    std::vector<std::shared_ptr<TimedEvent>> batch;
+
+    /// Dependency graph of the batch, rebuilt by runBatch() in buffers reused across ticks
+    std::vector<std::size_t> wave;                   ///< Wave each batch event runs in
+    entt::dense_map<EventID, std::size_t> index;     ///< Batch position of each event
+    std::vector<std::vector<std::size_t>> before;    ///< Prerequisites of each event in the batch
+    std::vector<std::vector<std::size_t>> after;     ///< Dependents of each event in the batch
+    std::vector<std::size_t> waiting;                ///< Prerequisites not yet bound
+    std::vector<bool> bound;                         ///< Whether each event is bound
+    std::vector<std::size_t> ready;                  ///< Events to bind, in binding order
+    std::vector<std::size_t> members;                ///< Events of the wave being run
+
+    /// Statistics attached with setStats(), not owned
+    SchedulerStats *stats = nullptr;
+
+    /// Trace attached with setTrace(), not owned
+    SchedulerTrace *trace = nullptr;
+
+    /// Watchdog attached with setWatchdog(), not owned
+    SchedulerWatchdog *watchdog = nullptr;
+
+    /// Capture attached with setCapture(), not owned
+    WorkloadCapture *capture = nullptr;
+
+    /// Disk tier attached with setSpill(), not owned, and the handlers it restores with
+    EventSpill *spill = nullptr;
+    const EventHandlers *spillHandlers = nullptr;
+
+    /// Records read back by pageIn(), reused across updates
+    std::vector<SpilledEventRecord> pagedIn;
+    std::size_t failedPageIns = 0; ///< Updates whose pageIn() hit an unreadable bucket
 
-    /// Set of active event IDs (used to check if events have been cancelled)
-    std::unordered_set<EventID> activeEvents;
+    /// Resource given at construction, not owned
+    std::pmr::memory_resource *memory = nullptr;
 
-    /// Next available event ID
-    EventID nextEventId;
+    double compactionRatio = 0.5;         ///< Free share of the pool that triggers compaction
+    std::size_t compactionMinimum = 1024; ///< Smallest pool worth compacting
+    std::size_t compactions = 0;          ///< Compactions done so far
+    std::size_t reservedPending = 0;      ///< Largest reserve(), for capacityProfile()
 };
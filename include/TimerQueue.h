@@ -0,0 +1,426 @@
+/**
+ * @file TimerQueue.h
+ * @brief The queue and ID bookkeeping shared by Scheduler and TimedEventScheduler.
+ *
+ * Both schedulers keep their pending work in a queue backend and map every
+ * pending ID to the queue handle of its node through a SlotMap. BasicTimerQueue
+ * owns that pair, so the queue backend is a compile-time choice for either
+ * scheduler and improvements to the bookkeeping apply to both.
+ */
+#pragma once
+
+#include "HeapQueue.h"
+#include "SlotMap.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @struct TimerNodeIds
+ * @brief Describes how a timer queue reads and stamps the ID of a node
+ * @tparam Node The type stored in the queue
+ *
+ * The default implementation works for any node exposing a 32-bit `id`
+ * member. Pass a different policy for nodes that store their ID otherwise.
+ */
+template <typename Node> struct TimerNodeIds {
+    /// @brief The ID type handed out for nodes
+    using id_type = std::uint32_t;
+
+    /// @brief Gets the ID stamped on a node
+    static id_type get(const Node &node) { return node.id; }
+
+    /// @brief Stamps an ID on a node
+    static void set(Node &node, id_type id) { node.id = id; }
+};
+
+/**
+ * @struct TimerSlot
+ * @brief Minimal per-ID bookkeeping: the queue handle of the node and its epoch
+ * @tparam Handle The handle type of the queue backend
+ *
+ * Schedulers that track more per ID use their own slot type with `handle`
+ * and `epoch` members of the same types.
+ */
+template <typename Handle> struct TimerSlot {
+    Handle handle{};         ///< Queue handle, or one of the BasicTimerQueue states
+    std::uint32_t epoch = 0; ///< Epoch the ID was handed out in, see BasicTimerQueue::expire()
+};
+
+/**
+ * @struct QueueAllocator
+ * @brief Gets the allocator of a queue backend, std::allocator for backends without one
+ * @tparam Queue The queue backend
+ * @tparam Node The type stored in the queue
+ */
+template <typename Queue, typename Node, typename = void> struct QueueAllocator {
+    using type = std::allocator<Node>;
+};
+
+/// @cond
+template <typename Queue, typename Node>
+struct QueueAllocator<Queue, Node, std::void_t<typename Queue::allocator_type>> {
+    using type = typename Queue::allocator_type;
+};
+/// @endcond
+
+/**
+ * @struct QueueIdTraits
+ * @brief Gets the ID layout a queue backend asks for, SlotIdTraits for backends without one
+ * @tparam Queue The queue backend
+ * @tparam Id The integral ID type
+ *
+ * A backend picks the split of its IDs into index and generation bits with an
+ * `id_traits` member type, see SchedulerGeometry.
+ */
+template <typename Queue, typename Id, typename = void> struct QueueIdTraits {
+    using type = SlotIdTraits<Id>;
+};
+
+/// @cond
+template <typename Queue, typename Id>
+struct QueueIdTraits<Queue, Id, std::void_t<typename Queue::id_traits>> {
+    using type = typename Queue::id_traits;
+};
+/// @endcond
+
+/**
+ * @class BasicTimerQueue
+ * @brief Queue backend plus the SlotMap that maps pending IDs to queue handles
+ * @tparam Node The type stored in the queue
+ * @tparam Queue The queue backend (HeapQueue, TimingWheel or CalendarQueue)
+ * @tparam Ids Policy reading and stamping the ID of a node, see TimerNodeIds
+ * @tparam Slot Per-ID bookkeeping, with a `handle` member of the Queue's handle type
+ *
+ * An ID is pending from acquire() or insert() until release(). While pending,
+ * the slot holds either the queue handle of the node or one of two states:
+ * running, for a node popped by popDue() whose owner has not released or
+ * re-queued it yet, and inboxed, for an ID handed out before its node exists.
+ * The slots use the allocator of the queue backend, if it has one.
+ *
+ * @code
+ * BasicTimerQueue<ScheduledAction, TimingWheel<ScheduledAction>> timers;
+ * ActionID id = timers.insert(std::move(action));
+ * timers.cancel(id);
+ * @endcode
+ */
+template <typename Node, typename Queue = HeapQueue<Node>, typename Ids = TimerNodeIds<Node>,
+          typename Slot = TimerSlot<typename Queue::handle_type>>
+class BasicTimerQueue {
+  public:
+    using node_type = Node;
+    using queue_type = Queue;
+    using slot_type = Slot;
+    using id_type = typename Ids::id_type;
+    using handle_type = typename Queue::handle_type;
+    using allocator_type = typename QueueAllocator<Queue, Node>::type;
+    using id_traits = typename QueueIdTraits<Queue, id_type>::type;
+
+    BasicTimerQueue() = default;
+
+    /// @brief Constructs an empty queue whose backend and slots draw from an allocator
+    explicit BasicTimerQueue(const allocator_type &allocator)
+        : queue(makeQueue(allocator)), slots(SlotAllocator(allocator)) {}
+
+    /// @brief Gets the allocator of the queue
+    allocator_type get_allocator() const { return allocator_type(slots.get_allocator()); }
+
+    /// @brief Handle state of a node that has been popped and not settled yet
+    static constexpr handle_type running = ~handle_type{};
+
+    /// @brief Handle state of an ID acquired before its node was queued
+    static constexpr handle_type inboxed = running - 1;
+
+    /**
+     * @brief Hands out an ID without queueing anything yet
+     * @param slot Initial bookkeeping of the ID, inboxed unless set otherwise
+     * @return The ID, to be stamped on a node passed to enqueue()
+     */
+    id_type acquire(Slot slot = inboxedSlot()) {
+        slot.epoch = epoch;
+        return slots.insert(std::move(slot));
+    }
+
+    /**
+     * @brief Hands out a block of consecutive IDs
+     * @param count Number of IDs
+     * @return The IDs, each inboxed
+     */
+    IdRange<id_type> acquireBlock(std::size_t count) {
+        IdRange<id_type> ids = slots.insertBlock(count);
+        for (id_type id : ids) {
+            slots.get(id).handle = inboxed;
+            slots.get(id).epoch = epoch;
+        }
+        return ids;
+    }
+
+    /**
+     * @brief Acquires an ID for a node, stamps it and queues the node
+     * @param node The node to insert
+     * @return The ID of the node
+     */
+    id_type insert(Node &&node) {
+        id_type id = acquire();
+        Ids::set(node, id);
+        enqueue(std::move(node));
+        return id;
+    }
+
+    /**
+     * @brief Queues a node whose ID is already stamped and pending
+     * @param node The node, moved into the queue
+     */
+    void enqueue(Node &&node) {
+        id_type id = Ids::get(node);
+        slots.get(id).handle = queue.push(std::move(node));
+    }
+
+    /**
+     * @brief Stamps IDs on a range of nodes and queues them in one bulk insertion
+     * @param first Iterator to the first node, nodes are moved from
+     * @param last Iterator past the last node
+     * @param onStamp Called with each node after its ID is stamped, before it is queued
+     * @return The contiguous range of IDs given to the nodes, in input order
+     */
+    template <typename It, typename OnStamp>
+    IdRange<id_type> insertBulk(It first, It last, OnStamp &&onStamp) {
+        auto count = static_cast<std::size_t>(std::distance(first, last));
+        IdRange<id_type> ids = slots.insertBlock(count);
+        auto id = ids.begin();
+        for (It it = first; it != last; ++it, ++id) {
+            slots.get(*id).epoch = epoch;
+            Ids::set(*it, *id);
+            onStamp(*it);
+        }
+        queue.reserve(queue.size() + count);
+        id = ids.begin();
+        queue.pushBulk(first, last, [this, &id](handle_type handle) {
+            slots.get(*id++).handle = handle;
+        });
+        return ids;
+    }
+
+    /**
+     * @brief Removes the node of a pending ID from the queue, keeping the ID
+     * @param id The ID
+     * @return true if the node was queued and has been removed
+     */
+    bool dequeue(id_type id) {
+        Slot *slot = find(id);
+        if (slot == nullptr || slot->handle == running || slot->handle == inboxed) {
+            return false;
+        }
+        queue.erase(slot->handle);
+        slot->handle = running;
+        return true;
+    }
+
+    /**
+     * @brief Changes a queued node in place and moves it to its new position in the queue
+     * @param id The ID of the node
+     * @param fn Called with a reference to the node, may change its tick
+     * @return false if the ID has no queued node: unknown, running or inboxed
+     *
+     * The ID and the queue handle stay the same and the node is not copied.
+     */
+    template <typename F> bool modify(id_type id, F &&fn) {
+        const Slot *slot = find(id);
+        if (slot == nullptr || slot->handle == running || slot->handle == inboxed) {
+            return false;
+        }
+        return queue.modify(slot->handle, std::forward<F>(fn));
+    }
+
+    /// @brief Releases a pending ID, its node must not be queued
+    void release(id_type id) { slots.erase(id); }
+
+    /**
+     * @brief Removes the node of an ID from the queue, if queued, and releases the ID
+     * @param id The ID
+     * @return true if the ID was pending
+     */
+    bool cancel(id_type id) {
+        if (!contains(id)) {
+            return false;
+        }
+        dequeue(id);
+        slots.erase(id);
+        return true;
+    }
+
+    /**
+     * @brief Removes the next node due at or before a tick and marks its ID running
+     * @param currentTick The current system tick
+     * @param out Receives the removed node by move assignment
+     * @return true if a node was removed, false if nothing is due
+     */
+    bool popDue(int currentTick, Node &out) {
+        while (queue.popDue(currentTick, out)) {
+            Slot &slot = slots.get(Ids::get(out));
+            if (slot.epoch == epoch) {
+                slot.handle = running;
+                return true;
+            }
+            // Left behind by expire()
+            slots.erase(Ids::get(out));
+            --staleNodes;
+        }
+        return false;
+    }
+
+    /// @brief Checks whether an ID is pending
+    bool contains(id_type id) const { return find(id) != nullptr; }
+
+    /// @brief Gets the bookkeeping of an ID, nullptr if it is not pending
+    Slot *find(id_type id) {
+        Slot *slot = slots.find(id);
+        return slot != nullptr && slot->epoch == epoch ? slot : nullptr;
+    }
+
+    /// @brief Gets the bookkeeping of an ID, nullptr if it is not pending
+    const Slot *find(id_type id) const {
+        const Slot *slot = slots.find(id);
+        return slot != nullptr && slot->epoch == epoch ? slot : nullptr;
+    }
+
+    /// @brief Gets the bookkeeping of a pending ID
+    Slot &get(id_type id) { return slots.get(id); }
+
+    /// @brief Checks whether a pending ID was popped and not settled yet
+    bool isRunning(id_type id) const {
+        const Slot *slot = find(id);
+        return slot != nullptr && slot->handle == running;
+    }
+
+    /**
+     * @brief Gets the tick of the earliest queued node, or nothing if none is queued
+     *
+     * Until reclaim(), may be the tick of a node left behind by expire().
+     */
+    std::optional<int> nextTick() const { return queue.nextTick(); }
+
+    /// @brief Counts the queued nodes due at or before a tick, for backends that support it
+    /// Until reclaim(), nodes left behind by expire() are counted too.
+    std::size_t countDue(int currentTick) const { return queue.countDue(currentTick); }
+
+    /// @brief Gets the number of queued nodes
+    std::size_t size() const { return queue.size() - staleNodes; }
+
+    /// @brief Checks whether no node is queued
+    bool empty() const { return size() == 0; }
+
+    /// @brief Reserves room for a number of queued nodes and their IDs
+    void reserve(std::size_t capacity) {
+        queue.reserve(capacity);
+        slots.reserve(capacity);
+    }
+
+    /// @brief Gets the number of ID slots, at least the most IDs ever live at once
+    std::size_t slotCount() const { return slots.slotCount(); }
+
+    /// @brief Visits every queued node, in no particular order
+    template <typename F> void forEach(F &&fn) const {
+        if (staleNodes == 0) {
+            queue.forEach(fn);
+            return;
+        }
+        queue.forEach([this, &fn](const Node &node) {
+            if (slots.find(Ids::get(node))->epoch == epoch) {
+                fn(node);
+            }
+        });
+    }
+
+    /// @brief Gets the queue backend, for operations specific to it
+    const Queue &backend() const { return queue; }
+
+    /// @brief Gets the queue backend to tune it; nodes must not be added or removed through it
+    Queue &backend() { return queue; }
+
+    /**
+     * @brief Packs the queue's node pool, for backends that support it
+     *
+     * Updates the stored handle of every queued node.
+     */
+    void compact() {
+        queue.compact([this](const Node &node, handle_type handle) {
+            slots.get(Ids::get(node)).handle = handle;
+        });
+    }
+
+    /// @brief Drops every queued node and releases every ID
+    void clear() {
+        queue.clear();
+        slots.clear();
+        staleNodes = 0;
+    }
+
+    /**
+     * @brief Drops every node and ID at once, keeping allocated capacity
+     *
+     * Starts a new epoch: every ID handed out so far stops being pending
+     * right away, whether queued, running or inboxed, in O(1). Their nodes
+     * stay in the queue until popDue() reaches and destroys them, or until
+     * reclaim() destroys them all.
+     */
+    void expire() {
+        ++epoch;
+        staleNodes = queue.size();
+    }
+
+    /**
+     * @brief Destroys the nodes and releases the IDs left behind by expire()
+     * @return The number of IDs released
+     *
+     * O(n) in the ID slots. If nothing was queued since expire(), the queue
+     * is emptied in one go.
+     */
+    std::size_t reclaim() {
+        bool everything = staleNodes == queue.size();
+        if (everything) {
+            queue.clear();
+        }
+        staleNodes = 0;
+        return slots.eraseIf([this, everything](id_type, Slot &slot) {
+            if (slot.epoch == epoch) {
+                return false;
+            }
+            if (!everything && slot.handle != running && slot.handle != inboxed) {
+                queue.erase(slot.handle);
+            }
+            return true;
+        });
+    }
+
+    /// @brief Gets the number of queued nodes left behind by expire()
+    std::size_t staleCount() const { return staleNodes; }
+
+  private:
+    using SlotAllocator =
+        typename std::allocator_traits<allocator_type>::template rebind_alloc<Slot>;
+
+    /// Backends without an allocator are default-constructed
+    static Queue makeQueue(const allocator_type &allocator) {
+        if constexpr (std::is_constructible_v<Queue, const allocator_type &>) {
+            return Queue(allocator);
+        } else {
+            return Queue();
+        }
+    }
+
+    static Slot inboxedSlot() {
+        Slot slot{};
+        slot.handle = inboxed;
+        return slot;
+    }
+
+    Queue queue;                                            ///< Pending nodes
+    SlotMap<Slot, id_type, id_traits, SlotAllocator> slots; ///< Every pending ID
+    std::uint32_t epoch = 0;                                ///< Stamped on every ID handed out
+    std::size_t staleNodes = 0; ///< Queued nodes of earlier epochs, not destroyed yet
+};
@@ -0,0 +1,494 @@
+/**
+ * @file TimingWheel.h
+ * @brief Hierarchical timing-wheel queue backend for the schedulers.
+ *
+ * The wheel keeps near-future nodes in per-tick slots and far-future nodes in
+ * coarser levels that are cascaded down as time advances. Inserting is O(1) and
+ * draining a tick costs time proportional to the nodes due in that tick.
+ */
+#pragma once
+
+#include "HeapQueue.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
+/**
+ * @class TimingWheel
+ * @brief Queue backend built on a hierarchical timing wheel
+ * @tparam Node The type stored in the queue
+ * @tparam SlotBits Number of bits of the tick resolved by each level (slots = 2^SlotBits)
+ * @tparam Levels Number of wheel levels
+ * @tparam Traits Ordering traits for Node
+ * @tparam Allocator Allocator of the node pool
+ *
+ * Level 0 has one slot per tick. Each higher level covers 2^SlotBits slots of
+ * the level below it. Nodes beyond the range of the top level are parked in an
+ * overflow list and re-inserted when the wheel reaches them.
+ *
+ * Links between nodes live apart from the nodes, in 16-byte records that
+ * also cache each node's tick, so moving nodes between lists and cascading
+ * never touch the nodes themselves.
+ *
+ * Each level keeps a bitmap of its occupied slots. nextTick() and idle
+ * cursor moves find the next occupied slot with a bit scan per level
+ * instead of walking the slots.
+ *
+ * Nodes due at the same tick are returned in insertion order. Nodes scheduled
+ * for a tick the wheel has already passed are returned before anything later,
+ * in tick order, exactly as the heap backend would return them.
+ *
+ * @code
+ * BasicScheduler<TimingWheel<ScheduledAction>> scheduler;
+ * scheduler.schedule(currentTick + 3, entity, action);
+ * @endcode
+ */
+template <typename Node, std::size_t SlotBits = 8, std::size_t Levels = 4,
+          typename Traits = QueueNodeTraits<Node>, typename Allocator = std::allocator<Node>>
+class TimingWheel {
+    static_assert(SlotBits > 0 && SlotBits < 16, "Unsupported slot width");
+    static_assert(Levels > 0 && SlotBits * Levels <= 32, "Unsupported wheel geometry");
+
+    static constexpr std::uint32_t npos = ~std::uint32_t{0};
+    static constexpr std::size_t slotsPerLevel = std::size_t{1} << SlotBits;
+    static constexpr std::uint64_t slotMask = slotsPerLevel - 1;
+    static constexpr std::size_t dueList = Levels * slotsPerLevel;
+    static constexpr std::size_t overflowList = dueList + 1;
+    static constexpr std::size_t listCount = overflowList + 1;
+    static constexpr std::size_t wordsPerLevel = (slotsPerLevel + 63) / 64;
+    static constexpr std::size_t nslot = ~std::size_t{0};
+
+    /// Intrusive links of a pooled node into one of the wheel lists, and its tick
+    struct Link {
+        int tick = 0;
+        std::uint32_t prev = npos;
+        std::uint32_t next = npos;
+        std::uint32_t list = npos;
+    };
+
+    struct List {
+        std::uint32_t head = npos;
+        std::uint32_t tail = npos;
+    };
+
+    using LinkAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Link>;
+
+  public:
+    /**
+     * @brief Constructs an empty wheel
+     * @param startTick The tick the wheel cursor starts at
+     */
+    explicit TimingWheel(int startTick = 0) : now(startTick) {}
+
+    /**
+     * @brief Constructs an empty wheel whose node pool comes from an allocator
+     * @param allocator Allocator of the node pool
+     * @param startTick The tick the wheel cursor starts at
+     */
+    explicit TimingWheel(const Allocator &allocator, int startTick = 0)
+        : nodes(LinkAllocator(allocator)), values(allocator), now(startTick) {}
+
+    /// @brief Allocator the node pool draws from
+    using allocator_type = Allocator;
+
+    /// @brief Gets the allocator of the node pool
+    allocator_type get_allocator() const { return values.get_allocator(); }
+
+    /// @brief Stable reference to a queued node
+    using handle_type = std::uint32_t;
+
+    /**
+     * @brief Adds a node to the wheel
+     * @param node The node to insert, moved into the wheel's node pool
+     * @return Handle that can be used to erase the node
+     */
+    handle_type push(Node &&node) {
+        std::uint32_t index = allocate(std::move(node));
+        place(index);
+        ++count;
+        return index;
+    }
+
+    /**
+     * @brief Adds a range of nodes
+     * @param first Iterator to the first node, nodes are moved from
+     * @param last Iterator past the last node
+     * @param onPush Called with the handle of each node, in range order
+     */
+    template <typename It, typename OnPush> void pushBulk(It first, It last, OnPush &&onPush) {
+        for (; first != last; ++first) {
+            onPush(push(std::move(*first)));
+        }
+    }
+
+    /// @brief Reserves room for a number of queued nodes
+    void reserve(std::size_t capacity) {
+        nodes.reserve(capacity);
+        values.reserve(capacity);
+    }
+
+    /**
+     * @brief Removes a queued node immediately
+     * @param handle Handle returned by push()
+     * @return true if the node was queued and has been removed
+     *
+     * Unlinking from a slot list is O(1).
+     */
+    bool erase(handle_type handle) {
+        if (handle >= nodes.size() || nodes[handle].list == npos) {
+            return false;
+        }
+        unlink(handle);
+        release(handle);
+        --count;
+        return true;
+    }
+
+    /**
+     * @brief Changes a queued node in place and moves it to the slot of its new tick
+     * @param handle Handle returned by push()
+     * @param fn Called with a reference to the node, may change its tick
+     * @return true if the node was queued and has been modified
+     *
+     * O(1) unless the node becomes due, which inserts it into the sorted due list.
+     */
+    template <typename F> bool modify(handle_type handle, F &&fn) {
+        if (handle >= nodes.size() || nodes[handle].list == npos) {
+            return false;
+        }
+        unlink(handle);
+        fn(values[handle]);
+        nodes[handle].tick = Traits::tick(values[handle]);
+        place(handle);
+        return true;
+    }
+
+    /**
+     * @brief Removes the next node that is due at or before the given tick
+     * @param currentTick The current system tick
+     * @param out Receives the removed node by move assignment
+     * @return true if a node was removed, false if nothing is due
+     *
+     * Advances the wheel cursor towards currentTick as needed, cascading
+     * coarser levels on the way.
+     */
+    bool popDue(int currentTick, Node &out) {
+        for (;;) {
+            List &due = lists[dueList];
+            if (due.head != npos) {
+                if (nodes[due.head].tick > currentTick) {
+                    return false;
+                }
+                std::uint32_t index = due.head;
+                unlink(index);
+                out = std::move(values[index]);
+                release(index);
+                --count;
+                return true;
+            }
+            if (!advance(currentTick)) {
+                return false;
+            }
+        }
+    }
+
+    /// @brief Gets the number of queued nodes
+    /// @return The queue size
+    std::size_t size() const { return count; }
+
+    /// @brief Checks whether the wheel is empty
+    /// @return true if no nodes are queued
+    bool empty() const { return count == 0; }
+
+    /**
+     * @brief Visits every queued node, in no particular order
+     * @param fn Called with a const reference to each node
+     */
+    template <typename F> void forEach(F &&fn) const {
+        for (std::size_t index = 0; index < nodes.size(); ++index) {
+            if (nodes[index].list != npos) {
+                fn(values[index]);
+            }
+        }
+    }
+
+    /**
+     * @brief Gets the tick of the earliest queued node
+     * @return The earliest due tick, or nothing if the queue is empty
+     *
+     * Costs a bit scan per level plus a pass over the nodes of the first
+     * occupied slot, so it is meant for idle checks rather than for every pop.
+     */
+    std::optional<int> nextTick() const {
+        if (lists[dueList].head != npos) {
+            return nodes[lists[dueList].head].tick;
+        }
+        for (std::size_t level = 0; level < Levels; ++level) {
+            std::size_t slot = nextSlot(level);
+            if (slot != nslot) {
+                return earliest(lists[level * slotsPerLevel + slot]);
+            }
+        }
+        if (overflowCount > 0) {
+            return earliest(lists[overflowList]);
+        }
+        return std::nullopt;
+    }
+
+    /// @brief Gets the tick the wheel cursor has advanced to
+    /// @return The cursor tick
+    int cursor() const { return static_cast<int>(now); }
+
+    /// @brief Removes every queued node, keeping the cursor and allocated capacity
+    void clear() {
+        nodes.clear();
+        values.clear();
+        freeHead = npos;
+        lists.fill(List{});
+        for (auto &bitmap : occupied) {
+            bitmap.fill(0);
+        }
+        overflowCount = 0;
+        count = 0;
+    }
+
+  private:
+    /// Smallest tick among the nodes of a non-empty list
+    int earliest(const List &list) const {
+        int tick = nodes[list.head].tick;
+        for (std::uint32_t index = nodes[list.head].next; index != npos;
+             index = nodes[index].next) {
+            tick = std::min(tick, nodes[index].tick);
+        }
+        return tick;
+    }
+
+    std::uint32_t allocate(Node &&node) {
+        std::uint32_t index;
+        if (freeHead != npos) {
+            index = freeHead;
+            freeHead = nodes[index].next;
+            values[index] = std::move(node);
+        } else {
+            index = static_cast<std::uint32_t>(nodes.size());
+            nodes.push_back(Link{});
+            values.push_back(std::move(node));
+        }
+        nodes[index].tick = Traits::tick(values[index]);
+        nodes[index].prev = npos;
+        nodes[index].next = npos;
+        nodes[index].list = npos;
+        return index;
+    }
+
+    void release(std::uint32_t index) {
+        values[index] = Node{};
+        nodes[index].list = npos;
+        nodes[index].next = freeHead;
+        freeHead = index;
+    }
+
+    void append(std::size_t listId, std::uint32_t index) {
+        List &list = lists[listId];
+        Link &link = nodes[index];
+        link.list = static_cast<std::uint32_t>(listId);
+        link.next = npos;
+        link.prev = list.tail;
+        if (list.tail != npos) {
+            nodes[list.tail].next = index;
+        } else {
+            list.head = index;
+        }
+        list.tail = index;
+        countList(listId, true);
+    }
+
+    void unlink(std::uint32_t index) {
+        Link &link = nodes[index];
+        List &list = lists[link.list];
+        if (link.prev != npos) {
+            nodes[link.prev].next = link.next;
+        } else {
+            list.head = link.next;
+        }
+        if (link.next != npos) {
+            nodes[link.next].prev = link.prev;
+        } else {
+            list.tail = link.prev;
+        }
+        countList(link.list, false);
+        link.prev = link.next = npos;
+        link.list = npos;
+    }
+
+    /// Keeps the slot bitmaps and the overflow counter in sync; the due list is not tracked
+    void countList(std::size_t listId, bool added) {
+        if (listId < dueList) {
+            std::uint64_t &word = occupied[listId / slotsPerLevel][(listId & slotMask) / 64];
+            std::uint64_t bit = std::uint64_t{1} << ((listId & slotMask) % 64);
+            word = lists[listId].head != npos ? word | bit : word & ~bit;
+        } else if (listId == overflowList) {
+            overflowCount = added ? overflowCount + 1 : overflowCount - 1;
+        }
+    }
+
+    /// Index of the lowest set bit of a non-zero word
+    static std::size_t countrZero(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_ctzll(word));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return index;
+#else
+        std::size_t index = 0;
+        for (; (word & 1) == 0; word >>= 1) {
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    /**
+     * First occupied slot of a level, or nslot. Occupied slots always lie after
+     * the cursor's digit at that level: a node goes to the lowest level whose
+     * higher digits match the cursor's, and a slot is cascaded as soon as the
+     * cursor reaches it.
+     */
+    std::size_t nextSlot(std::size_t level) const {
+        auto from = static_cast<std::size_t>(
+            ((static_cast<std::uint64_t>(now) >> (SlotBits * level)) & slotMask) + 1);
+        if (from == slotsPerLevel) {
+            return nslot;
+        }
+        const auto &bitmap = occupied[level];
+        std::uint64_t bits = bitmap[from / 64] & (~std::uint64_t{0} << (from % 64));
+        for (std::size_t word = from / 64;;) {
+            if (bits != 0) {
+                return word * 64 + countrZero(bits);
+            }
+            if (++word == wordsPerLevel) {
+                return nslot;
+            }
+            bits = bitmap[word];
+        }
+    }
+
+    /// Inserts into the due list, keeping it sorted by tick (stable for equal ticks)
+    void insertDue(std::uint32_t index) {
+        List &due = lists[dueList];
+        int tick = nodes[index].tick;
+        std::uint32_t after = due.tail;
+        while (after != npos && nodes[after].tick > tick) {
+            after = nodes[after].prev;
+        }
+        Link &link = nodes[index];
+        link.list = static_cast<std::uint32_t>(dueList);
+        link.prev = after;
+        link.next = after != npos ? nodes[after].next : due.head;
+        if (link.next != npos) {
+            nodes[link.next].prev = index;
+        } else {
+            due.tail = index;
+        }
+        if (after != npos) {
+            nodes[after].next = index;
+        } else {
+            due.head = index;
+        }
+    }
+
+    /// Chooses the list for a node relative to the current cursor
+    void place(std::uint32_t index) {
+        std::int64_t tick = nodes[index].tick;
+        if (tick <= now) {
+            insertDue(index);
+            return;
+        }
+        auto t = static_cast<std::uint64_t>(tick);
+        auto n = static_cast<std::uint64_t>(now);
+        for (std::size_t level = 0; level < Levels; ++level) {
+            std::size_t shift = SlotBits * (level + 1);
+            if ((t >> shift) == (n >> shift)) {
+                append(level * slotsPerLevel + ((t >> (SlotBits * level)) & slotMask), index);
+                return;
+            }
+        }
+        append(overflowList, index);
+    }
+
+    /// Re-places every node of a list relative to the current cursor
+    void cascade(std::size_t listId) {
+        // Detach the list first: overflow nodes still out of range are appended back to it
+        std::uint32_t index = lists[listId].head;
+        lists[listId] = List{};
+        while (index != npos) {
+            std::uint32_t next = nodes[index].next;
+            countList(listId, false);
+            place(index);
+            index = next;
+        }
+    }
+
+    /**
+     * Moves the cursor forward by one step towards target, skipping ranges that are
+     * known to be empty, and moves the nodes of the reached tick into the due list.
+     * Returns false if the cursor has already reached target.
+     */
+    bool advance(int target) {
+        if (now >= target) {
+            return false;
+        }
+        if (count == 0) {
+            now = target;
+            return true;
+        }
+
+        // Jump straight to the next occupied slot of the lowest occupied level, or past
+        // the top level when only the overflow list holds nodes
+        std::size_t level = 0;
+        std::size_t slot = nslot;
+        while (level < Levels && (slot = nextSlot(level)) == nslot) {
+            ++level;
+        }
+        std::int64_t step;
+        if (level < Levels) {
+            std::size_t shift = SlotBits * level;
+            std::size_t above = shift + SlotBits;
+            step = ((now >> above) << above) + (static_cast<std::int64_t>(slot) << shift);
+        } else {
+            std::size_t shift = SlotBits * Levels;
+            step = ((now >> shift) + 1) << shift;
+        }
+        now = step < target ? step : static_cast<std::int64_t>(target);
+
+        auto n = static_cast<std::uint64_t>(now);
+        if (SlotBits * Levels < 64 && (n & ((std::uint64_t{1} << (SlotBits * Levels)) - 1)) == 0) {
+            cascade(overflowList);
+        }
+        for (std::size_t level = Levels - 1; level > 0; --level) {
+            std::size_t shift = SlotBits * level;
+            if ((n & ((std::uint64_t{1} << shift) - 1)) == 0) {
+                cascade(level * slotsPerLevel + ((n >> shift) & slotMask));
+            }
+        }
+        cascade(n & slotMask);
+        return true;
+    }
+
+    std::vector<Link, LinkAllocator> nodes;   ///< Links and ticks of the node pool
+    std::vector<Node, Allocator> values;      ///< Node pool, indexed like nodes
+    std::uint32_t freeHead = npos;            ///< Head of the free node list
+    std::array<List, listCount> lists{};      ///< Wheel slots, due list and overflow list
+    std::array<std::array<std::uint64_t, wordsPerLevel>, Levels> occupied{}; ///< Slot bitmaps
+    std::size_t overflowCount = 0;            ///< Nodes beyond the top level
+    std::size_t count = 0;                    ///< Total queued nodes
+    std::int64_t now;                         ///< Cursor tick
+};
@@ -0,0 +1,106 @@
+/**
+ * @file UpdateBudget.h
+ * @brief Limits on how much work a single scheduler update may do.
+ *
+ * A budgeted update stops once its budget is used up and leaves the rest of
+ * the due work, in order, for the next call. The result tells the caller how
+ * much work was left behind so a frame governor can react.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <limits>
+
+/**
+ * @struct UpdateBudget
+ * @brief Wall-clock and work-item limits of one update call
+ *
+ * Both limits apply at once; the default budget is unlimited. The budget is
+ * checked before each work item, so the item that crosses the time limit still
+ * runs to completion. A time limit always lets at least one item run, so
+ * successive calls make progress however small the limit is.
+ *
+ * @code
+ * // Spend at most 4 ms on scheduled actions this frame
+ * UpdateResult result = scheduler.update(tick, registry, dispatcher,
+ *                                        UpdateBudget::time(std::chrono::milliseconds(4)));
+ * @endcode
+ */
+struct UpdateBudget {
+    using clock = std::chrono::steady_clock;
+
+    /// @brief Maximum number of work items to run
+    std::size_t items = std::numeric_limits<std::size_t>::max();
+
+    /// @brief Maximum wall-clock time to spend
+    clock::duration duration = clock::duration::max();
+
+    /// @brief Budget limited to a number of work items
+    static UpdateBudget count(std::size_t items) {
+        UpdateBudget budget;
+        budget.items = items;
+        return budget;
+    }
+
+    /// @brief Budget limited to an amount of wall-clock time
+    static UpdateBudget time(clock::duration duration) {
+        UpdateBudget budget;
+        budget.duration = duration;
+        return budget;
+    }
+
+    /// @brief Checks whether the wall-clock limit is set
+    bool timed() const { return duration != clock::duration::max(); }
+};
+
+/**
+ * @struct UpdateResult
+ * @brief What a budgeted update got through
+ */
+struct UpdateResult {
+    /// @brief Work items run by the call
+    std::size_t executed = 0;
+
+    /// @brief Due work items left for the next call, 0 if everything due was run
+    std::size_t backlog = 0;
+
+    /// @brief Checks whether the call ran everything that was due
+    bool complete() const { return backlog == 0; }
+};
+
+/**
+ * @class BudgetMeter
+ * @brief Tracks the consumption of an UpdateBudget during one update call
+ *
+ * Reads the clock only when the budget has a wall-clock limit.
+ */
+class BudgetMeter {
+  public:
+    /// @brief Starts measuring against a budget
+    explicit BudgetMeter(const UpdateBudget &budget) : budget(budget) {
+        if (budget.timed()) {
+            deadline = UpdateBudget::clock::now() + budget.duration;
+        }
+    }
+
+    /// @brief Checks whether another work item may run
+    bool exhausted() const {
+        return used >= budget.items ||
+               (budget.timed() && used > 0 && UpdateBudget::clock::now() >= deadline);
+    }
+
+    /// @brief Records that work items have run
+    void consume(std::size_t count = 1) { used += count; }
+
+    /// @brief Gets the number of work items the item limit still allows
+    std::size_t remaining() const { return used < budget.items ? budget.items - used : 0; }
+
+    /// @brief Gets the number of work items recorded so far
+    std::size_t consumed() const { return used; }
+
+  private:
+    UpdateBudget budget;
+    UpdateBudget::clock::time_point deadline{};
+    std::size_t used = 0;
+};
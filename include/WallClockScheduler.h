@@ -0,0 +1,333 @@
+/**
+ * @file WallClockScheduler.h
+ * @brief Real-time deadlines on top of TimedEventScheduler, with a loop that sleeps between them.
+ *
+ * Services without a fixed-rate game loop, such as lobbies or matchmaking,
+ * schedule work for points in time rather than for ticks. WallClockScheduler
+ * maps std::chrono::steady_clock time points onto the ticks of a
+ * TimedEventScheduler and blocks until the next deadline instead of polling.
+ * On Linux the wait is a timerfd and an eventfd in an epoll set, which can
+ * also be polled by an outside event loop; elsewhere, or with
+ * SCHEDULER_NO_TIMERFD defined, it is a condition variable.
+ */
+#pragma once
+
+#include "TimedEventScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#if defined(__linux__) && !defined(SCHEDULER_NO_TIMERFD)
+#define SCHEDULER_HAS_TIMERFD 1
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <system_error>
+#include <unistd.h>
+#endif
+
+/**
+ * @class DeadlineWaiter
+ * @brief Blocks a thread until a deadline passes or another thread wakes it
+ *
+ * wait() is called by one thread at a time; notify() may be called from any
+ * thread, and a notification sent while nobody waits ends the next wait()
+ * right away.
+ */
+class DeadlineWaiter {
+  public:
+    using clock = std::chrono::steady_clock;
+
+#if defined(SCHEDULER_HAS_TIMERFD)
+    /// @throws std::system_error if the descriptors cannot be created
+    DeadlineWaiter() {
+        pollFd = epoll_create1(EPOLL_CLOEXEC);
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (pollFd < 0 || timerFd < 0 || wakeFd < 0 || !watch(timerFd) || !watch(wakeFd)) {
+            int error = errno;
+            close();
+            throw std::system_error(error, std::system_category(), "DeadlineWaiter");
+        }
+    }
+
+    DeadlineWaiter(const DeadlineWaiter &) = delete;
+    DeadlineWaiter &operator=(const DeadlineWaiter &) = delete;
+    ~DeadlineWaiter() { close(); }
+
+    /**
+     * @brief Blocks until the deadline passes or notify() is called
+     * @param deadline When to stop waiting, or nothing to wait for notify() only
+     */
+    void wait(std::optional<clock::time_point> deadline) {
+        itimerspec spec{};
+        if (deadline) {
+            auto since = std::max(deadline->time_since_epoch(), clock::duration{1});
+            auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since);
+            spec.it_value.tv_sec = static_cast<time_t>(seconds.count());
+            spec.it_value.tv_nsec = static_cast<long>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(since - seconds).count());
+        }
+        timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+        epoll_event events[2];
+        while (epoll_wait(pollFd, events, 2, -1) < 0 && errno == EINTR) {
+        }
+        std::uint64_t count;
+        while (read(timerFd, &count, sizeof(count)) > 0) {
+        }
+        while (read(wakeFd, &count, sizeof(count)) > 0) {
+        }
+    }
+
+    /// @brief Ends the current or next wait()
+    void notify() {
+        std::uint64_t one = 1;
+        while (write(wakeFd, &one, sizeof(one)) < 0 && errno == EINTR) {
+        }
+    }
+
+    /**
+     * @brief Gets a descriptor that becomes readable when wait() would return
+     *
+     * Lets an outside epoll or poll loop wait for the scheduler. It only
+     * reflects a deadline while wait() armed it, so outside loops should
+     * call the scheduler with a zero timeout once it is readable.
+     */
+    int fileDescriptor() const { return pollFd; }
+
+  private:
+    bool watch(int fd) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        return epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    void close() {
+        for (int fd : {wakeFd, timerFd, pollFd}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    int pollFd = -1;  ///< epoll set of the two descriptors below
+    int timerFd = -1; ///< Armed with the deadline of each wait()
+    int wakeFd = -1;  ///< Written by notify()
+#else
+    /**
+     * @brief Blocks until the deadline passes or notify() is called
+     * @param deadline When to stop waiting, or nothing to wait for notify() only
+     */
+    void wait(std::optional<clock::time_point> deadline) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (deadline) {
+            woken.wait_until(lock, *deadline, [this] { return notified; });
+        } else {
+            woken.wait(lock, [this] { return notified; });
+        }
+        notified = false;
+    }
+
+    /// @brief Ends the current or next wait()
+    void notify() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            notified = true;
+        }
+        woken.notify_one();
+    }
+
+  private:
+    std::mutex mutex;
+    std::condition_variable woken;
+    bool notified = false;
+#endif
+};
+
+/**
+ * @class WallClockScheduler
+ * @brief Runs timed events at steady_clock deadlines
+ *
+ * Deadlines are converted to ticks of an owned TimedEventScheduler counted
+ * from the moment of construction, at a fixed resolution (1 ms by default).
+ * An event never runs before its deadline and, with the loop idle, runs at
+ * most one resolution step and the wake-up latency of the OS after it. Ticks
+ * are ints, so a scheduler covers about 24 days of uptime at 1 ms resolution;
+ * pick a coarser resolution for longer-running processes.
+ *
+ * The scheduler itself belongs to the thread that runs it. Other threads
+ * schedule through an Inbox, which also wakes the loop, so a deadline earlier
+ * than the one being waited for is picked up right away.
+ *
+ * @code
+ * WallClockScheduler lobby;
+ * auto &matchmaker = lobby.openInbox();
+ * lobby.scheduleAfter(std::chrono::seconds(30), closeIdleRooms);
+ * std::thread worker([&] { matchmaker.submitAfter(std::chrono::milliseconds(250), pairUp); });
+ * lobby.runUntil(shutdownTime);
+ * @endcode
+ */
+class WallClockScheduler {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @class Inbox
+     * @brief Thread-safe submission of deadlines, see TimedEventScheduler::Inbox
+     */
+    class Inbox {
+      public:
+        /**
+         * @brief Submits a function to run at a deadline, from any thread
+         * @return The ID of the event, or 0 as described in TimedEventScheduler::Inbox::submit()
+         */
+        EventID submitAt(clock::time_point deadline, InlineFunction<void()> func,
+                         EventName name = {}) {
+            EventID id = box.submitFunction(owner.tickAt(deadline), std::move(func), name);
+            owner.waiter.notify();
+            return id;
+        }
+
+        /// @brief Submits a function to run once a delay has passed, from any thread
+        EventID submitAfter(clock::duration delay, InlineFunction<void()> func,
+                            EventName name = {}) {
+            return submitAt(clock::now() + delay, std::move(func), name);
+        }
+
+      private:
+        friend class WallClockScheduler;
+
+        Inbox(TimedEventScheduler::Inbox &box, WallClockScheduler &owner)
+            : box(box), owner(owner) {}
+
+        TimedEventScheduler::Inbox &box;
+        WallClockScheduler &owner;
+    };
+
+    /**
+     * @brief Constructs a scheduler whose tick 0 is now
+     * @param resolution Length of one tick
+     */
+    explicit WallClockScheduler(clock::duration resolution = std::chrono::milliseconds(1))
+        : epoch(clock::now()), resolution(std::max(resolution, clock::duration{1})) {}
+
+    /// @brief Gets the underlying event scheduler, whose ticks are resolution steps
+    TimedEventScheduler &events() { return scheduler; }
+
+    /// @brief Converts a deadline to the first tick at or after it
+    int tickAt(clock::time_point deadline) const {
+        auto steps = (deadline - epoch + resolution - clock::duration{1}) / resolution;
+        return clampTick(deadline < epoch ? (deadline - epoch) / resolution : steps);
+    }
+
+    /// @brief Gets the point in time at which a tick starts
+    clock::time_point timeOf(int tick) const { return epoch + resolution * tick; }
+
+    /// @brief Gets the tick that is current now
+    int currentTick() const { return clampTick((clock::now() - epoch) / resolution); }
+
+    /// @brief Schedules a function to run at a deadline
+    EventID scheduleAt(clock::time_point deadline, InlineFunction<void()> func,
+                       EventName name = {}) {
+        return scheduler.scheduleFunction(tickAt(deadline), std::move(func), name);
+    }
+
+    /// @brief Schedules a function to run once a delay has passed
+    EventID scheduleAfter(clock::duration delay, InlineFunction<void()> func,
+                          EventName name = {}) {
+        return scheduleAt(clock::now() + delay, std::move(func), name);
+    }
+
+    /// @brief Cancels a pending event
+    bool cancel(EventID id) { return scheduler.cancelEvent(id); }
+
+    /**
+     * @brief Opens an inbox for a producer thread
+     * @param idReserve Number of IDs the inbox can hand out between two runs
+     * @return The inbox, which lives as long as the scheduler
+     */
+    Inbox &openInbox(std::size_t idReserve = 256) {
+        inboxes.push_back(
+            std::unique_ptr<Inbox>(new Inbox(scheduler.openInbox(idReserve), *this)));
+        return *inboxes.back();
+    }
+
+    /**
+     * @brief Runs every event whose deadline has passed
+     * @return The number of events run
+     */
+    std::size_t runDue() { return scheduler.update(currentTick(), UpdateBudget{}).executed; }
+
+    /**
+     * @brief Sleeps until the next deadline, a submission or stop()
+     * @param limit Latest time to wake up at even if nothing happened
+     * @return The deadline of the earliest pending event, if there is one
+     *
+     * Returns right away if an event is already due. Does not run anything.
+     */
+    std::optional<clock::time_point> waitNext(std::optional<clock::time_point> limit = {}) {
+        scheduler.mergeInboxes();
+        std::optional<clock::time_point> next;
+        if (std::optional<int> tick = scheduler.nextDueTick()) {
+            next = timeOf(*tick);
+        }
+        std::optional<clock::time_point> deadline = next;
+        if (limit && (!deadline || *limit < *deadline)) {
+            deadline = limit;
+        }
+        if (!deadline || *deadline > clock::now()) {
+            waiter.wait(deadline);
+        }
+        return next;
+    }
+
+    /**
+     * @brief Runs events as their deadlines pass until a point in time or stop()
+     * @param end When to return
+     * @return The number of events run
+     */
+    std::size_t runUntil(clock::time_point end) {
+        std::size_t executed = 0;
+        while (!stopping.exchange(false, std::memory_order_relaxed)) {
+            executed += runDue();
+            if (clock::now() >= end) {
+                break;
+            }
+            waitNext(end);
+        }
+        return executed;
+    }
+
+    /// @brief Makes the current or next runUntil() return soon, callable from any thread
+    void stop() {
+        stopping.store(true, std::memory_order_relaxed);
+        waiter.notify();
+    }
+
+#if defined(SCHEDULER_HAS_TIMERFD)
+    /// @brief Gets a descriptor for outside poll loops, see DeadlineWaiter::fileDescriptor()
+    int fileDescriptor() const { return waiter.fileDescriptor(); }
+#endif
+
+  private:
+    static int clampTick(clock::rep steps) {
+        return static_cast<int>(std::clamp<clock::rep>(steps, std::numeric_limits<int>::min(),
+                                                       std::numeric_limits<int>::max()));
+    }
+
+    clock::time_point epoch;                  ///< Start of tick 0
+    clock::duration resolution;               ///< Length of one tick
+    TimedEventScheduler scheduler;            ///< Events, keyed by tick
+    DeadlineWaiter waiter;                    ///< Sleeps between deadlines
+    std::vector<std::unique_ptr<Inbox>> inboxes;
+    std::atomic<bool> stopping{false};
+};
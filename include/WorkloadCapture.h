@@ -0,0 +1,120 @@
+/**
+ * @file WorkloadCapture.h
+ * @brief Compact binary log of the schedule, cancel and update calls a scheduler receives.
+ *
+ * A WorkloadCapture attached to a Scheduler or TimedEventScheduler with
+ * setCapture() appends one fixed-size record per call, so a production
+ * session can be saved and later replayed against any queue backend with
+ * WorkloadReplay (see WorkloadReplay.h). Records only describe the shape of
+ * the work, never the work itself: replayed items run an empty function.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @struct WorkloadRecord
+ * @brief One captured scheduler call
+ */
+struct WorkloadRecord {
+    /// @brief The call a record describes
+    enum class Kind : std::uint8_t { schedule, cancel, update };
+
+    /// @brief The scheduler that received the call
+    enum class Source : std::uint8_t { action, event };
+
+    std::int32_t tick = 0;     ///< Due tick of a schedule, current tick of an update
+    std::uint32_t id = 0;      ///< ID handed out by a schedule or passed to a cancel
+    std::uint32_t entity = 0;  ///< Entity of an action, as an integral
+    std::uint32_t handler = 0; ///< Registered handler ID, 0 if the work was not a handler call
+    std::int32_t priority = 0; ///< Priority of an event
+    std::int32_t interval = 0; ///< ScheduledAction::interval
+    std::int32_t repeats = 0;  ///< ScheduledAction::repeats
+    Kind kind = Kind::update;
+    Source source = Source::action;
+};
+
+static_assert(std::is_trivially_copyable_v<WorkloadRecord>, "Records are written as raw bytes");
+
+/**
+ * @class WorkloadCapture
+ * @brief Records appended by the schedulers it is attached to
+ *
+ * Schedulers append from their own thread; one capture should only be
+ * attached to schedulers updated by the same thread. Actions submitted
+ * through an inbox are recorded when they are merged.
+ *
+ * @code
+ * WorkloadCapture capture;
+ * scheduler.setCapture(&capture);
+ * // ... an hour of play ...
+ * std::ofstream file("raid.workload", std::ios::binary);
+ * capture.save(file);
+ * @endcode
+ */
+class WorkloadCapture {
+  public:
+    /// @brief Appends a record
+    void record(const WorkloadRecord &entry) { entries.push_back(entry); }
+
+    /// @brief Gets the records in call order
+    const std::vector<WorkloadRecord> &records() const { return entries; }
+
+    /// @brief Reserves room for a number of records
+    void reserve(std::size_t count) { entries.reserve(count); }
+
+    /// @brief Forgets every record
+    void clear() { entries.clear(); }
+
+    /**
+     * @brief Writes the records as a header followed by the raw record array
+     * @param out Binary stream
+     * @return true if the stream accepted every byte
+     */
+    bool save(std::ostream &out) const {
+        Header header{{'S', 'W', 'L', 'C'}, version, sizeof(WorkloadRecord), entries.size()};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(entries.data()),
+                  static_cast<std::streamsize>(entries.size() * sizeof(WorkloadRecord)));
+        return static_cast<bool>(out);
+    }
+
+    /**
+     * @brief Replaces the records with those written by save()
+     * @param in Binary stream positioned at the header
+     * @return false, with no records kept, if the stream is not a capture of this version
+     */
+    bool load(std::istream &in) {
+        entries.clear();
+        Header header{};
+        if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, "SWLC", 4) != 0 || header.version != version ||
+            header.recordSize != sizeof(WorkloadRecord)) {
+            return false;
+        }
+        entries.resize(header.count);
+        if (!in.read(reinterpret_cast<char *>(entries.data()),
+                     static_cast<std::streamsize>(entries.size() * sizeof(WorkloadRecord)))) {
+            entries.clear();
+            return false;
+        }
+        return true;
+    }
+
+  private:
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t recordSize;
+        std::uint64_t count;
+    };
+
+    static constexpr std::uint32_t version = 1;
+
+    std::vector<WorkloadRecord> entries;
+};
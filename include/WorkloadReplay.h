@@ -0,0 +1,162 @@
+/**
+ * @file WorkloadReplay.h
+ * @brief Drives a scheduler from a WorkloadCapture as fast as it can and times every call.
+ *
+ * Replaying the same capture against schedulers with different queue
+ * backends compares them on real traffic instead of synthetic distributions.
+ */
+#pragma once
+
+#include "Scheduler.h"
+#include "SchedulerStats.h"
+#include "TimedEventScheduler.h"
+#include "WorkloadCapture.h"
+#include "entt/entt.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @struct ReplayResult
+ * @brief Counts and call latencies of one replay
+ */
+struct ReplayResult {
+    std::size_t schedules = 0;          ///< Schedule calls replayed
+    std::size_t cancels = 0;            ///< Cancel calls replayed, for IDs scheduled in the capture
+    std::size_t updates = 0;            ///< Update calls replayed
+    std::chrono::nanoseconds elapsed{}; ///< Time spent inside the replayed calls
+    HistogramSnapshot scheduleLatency;  ///< Nanoseconds per schedule call
+    HistogramSnapshot cancelLatency;    ///< Nanoseconds per cancel call
+    HistogramSnapshot updateLatency;    ///< Nanoseconds per update call
+
+    /// @brief Gets the number of replayed calls per second spent inside them
+    double callsPerSecond() const {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        return seconds > 0 ? static_cast<double>(schedules + cancels + updates) / seconds : 0;
+    }
+};
+
+/**
+ * @class WorkloadReplay
+ * @brief Replays the records of one scheduler kind from a capture
+ *
+ * Actions replay into a BasicScheduler, events into a TimedEventScheduler;
+ * records of the other kind are skipped. Every replayed item runs an empty
+ * function, so the result measures the scheduler rather than the game.
+ * Captured IDs are mapped to the IDs the replayed scheduler hands out, and
+ * captured entities to entities created in the replay registry. Chains and
+ * coroutines replay as their first step only.
+ *
+ * @code
+ * WorkloadCapture capture;
+ * capture.load(file);
+ * WheelScheduler wheel;
+ * entt::registry registry;
+ * EventDispatcher dispatcher;
+ * ReplayResult result = WorkloadReplay{capture}.run(wheel, registry, dispatcher);
+ * std::cout << result.updateLatency.percentile(0.99) << " ns p99 update\n";
+ * @endcode
+ */
+class WorkloadReplay {
+  public:
+    explicit WorkloadReplay(const WorkloadCapture &capture) : capture(capture) {}
+
+    /**
+     * @brief Replays the captured actions
+     * @param scheduler The scheduler to drive, normally empty
+     * @param registry Registry the replayed entities are created in
+     * @param dispatcher Dispatcher passed to update()
+     */
+    template <typename Queue>
+    ReplayResult run(BasicScheduler<Queue> &scheduler, entt::registry &registry,
+                     EventDispatcher &dispatcher) const {
+        entt::dense_map<std::uint32_t, entt::entity> entities;
+        auto call = [&](const WorkloadRecord &record) -> ActionID {
+            switch (record.kind) {
+            case WorkloadRecord::Kind::schedule: {
+                auto [it, created] = entities.try_emplace(record.entity, entt::null);
+                if (created) {
+                    it->second = registry.create();
+                }
+                ScheduledAction action{0, record.tick, it->second, noopAction, nullptr};
+                action.interval = record.interval;
+                action.repeats = record.repeats;
+                return scheduler.schedule(std::move(action));
+            }
+            case WorkloadRecord::Kind::cancel:
+                scheduler.cancel(record.id);
+                return 0;
+            default:
+                scheduler.update(record.tick, registry, dispatcher);
+                return 0;
+            }
+        };
+        return replay(WorkloadRecord::Source::action, call);
+    }
+
+    /**
+     * @brief Replays the captured events
+     * @param scheduler The scheduler to drive, normally empty
+     */
+    ReplayResult run(TimedEventScheduler &scheduler) const {
+        auto call = [&](const WorkloadRecord &record) -> EventID {
+            switch (record.kind) {
+            case WorkloadRecord::Kind::schedule: {
+                auto event = TimedEventScheduler::makeEvent<FunctionEvent>(record.tick, [] {});
+                event->setPriority(record.priority);
+                return scheduler.scheduleEvent(std::move(event));
+            }
+            case WorkloadRecord::Kind::cancel:
+                scheduler.cancelEvent(record.id);
+                return 0;
+            default:
+                scheduler.update(record.tick);
+                return 0;
+            }
+        };
+        return replay(WorkloadRecord::Source::event, call);
+    }
+
+  private:
+    static void noopAction(entt::entity, entt::registry &) {}
+
+    /// Replays the records of one source through call, which gets cancel IDs already mapped
+    template <typename Call>
+    ReplayResult replay(WorkloadRecord::Source source, Call &&call) const {
+        using clock = SchedulerStats::clock;
+        entt::dense_map<std::uint32_t, std::uint32_t> ids;
+        LatencyHistogram latency[3];
+        ReplayResult result;
+        for (WorkloadRecord record : capture.records()) {
+            if (record.source != source) {
+                continue;
+            }
+            if (record.kind == WorkloadRecord::Kind::cancel) {
+                auto it = ids.find(record.id);
+                if (it == ids.end()) {
+                    continue; // Never scheduled within the capture
+                }
+                record.id = it->second;
+                ids.erase(it);
+            }
+            clock::time_point started = clock::now();
+            std::uint32_t id = call(record);
+            clock::duration spent = clock::now() - started;
+            if (record.kind == WorkloadRecord::Kind::schedule) {
+                ids.insert_or_assign(record.id, id);
+            }
+            result.elapsed += spent;
+            latency[static_cast<std::size_t>(record.kind)].record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(spent).count()));
+        }
+        result.scheduleLatency = latency[0].snapshot();
+        result.cancelLatency = latency[1].snapshot();
+        result.updateLatency = latency[2].snapshot();
+        result.schedules = result.scheduleLatency.count();
+        result.cancels = result.cancelLatency.count();
+        result.updates = result.updateLatency.count();
+        return result;
+    }
+
+    const WorkloadCapture &capture;
+};
@@ -0,0 +1,333 @@
+/**
+ * @file WorldScheduler.h
+ * @brief One scheduler for many small worlds, each with its own registry and dispatcher.
+ *
+ * Hundreds of dungeon instances per process each used to own a Scheduler
+ * that every tick had to update, whether or not anything was due in it. A
+ * BasicWorldScheduler keeps the pending actions of each world apart, so a
+ * world's batch is extracted from its own queue against its own registry, and
+ * shares a single wake-up queue holding the next due tick of every world
+ * that has one. An update pops the worlds due at the tick, runs them, on a
+ * TaskPool if given one, and queues them again at their new next due tick.
+ * Idle worlds are never visited.
+ */
+#pragma once
+
+#include "HeapQueue.h"
+#include "Scheduler.h"
+#include "SlotMap.h"
+#include "TaskPool.h"
+#include "UpdateBudget.h"
+#include "entt/entt.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/// @typedef WorldID
+/// @brief Identifier of a world, a SlotMap ID so a removed world's ID is never reused
+using WorldID = std::uint32_t;
+
+/// @typedef WorldActionID
+/// @brief Identifier of an action in a world scheduler
+///
+/// Holds the WorldID in the upper 32 bits and the world's ActionID in the
+/// lower 32 bits; 0 means no action.
+using WorldActionID = std::uint64_t;
+
+/**
+ * @class BasicWorldScheduler
+ * @brief Runs the actions of many worlds, visiting only the worlds with something due
+ * @tparam Queue The queue backend of every world
+ *
+ * A world is a registry and a dispatcher, which must outlive it, plus the
+ * actions scheduled on its entities. Actions run against their own world's
+ * registry and report to its dispatcher, exactly as a BasicScheduler
+ * updated with them would.
+ *
+ * Schedule through this class, or call wake() after changing a world through
+ * world(), so the wake-up queue learns about earlier ticks. Actions may
+ * schedule into their own world while it updates. In updateParallel() worlds
+ * run concurrently, so an action must not touch any other world, nor call
+ * into this class.
+ *
+ * @code
+ * WorldScheduler worlds;
+ * WorldID dungeon = worlds.addWorld(instance.registry, instance.dispatcher);
+ * worlds.schedule(dungeon, tick + 30, boss, enrage);
+ *
+ * // Only the dungeons with an action due this tick are updated
+ * worlds.updateParallel(tick, pool);
+ * @endcode
+ */
+template <typename Queue = HeapQueue<ScheduledAction>> class BasicWorldScheduler {
+  public:
+    /// @brief The scheduler type of every world
+    using world_type = BasicScheduler<Queue>;
+
+    BasicWorldScheduler() = default;
+    BasicWorldScheduler(const BasicWorldScheduler &) = delete;
+    BasicWorldScheduler &operator=(const BasicWorldScheduler &) = delete;
+
+    /**
+     * @brief Adds a world
+     * @param registry The world's registry
+     * @param dispatcher The dispatcher the world's completions go to
+     * @return The ID of the world
+     */
+    WorldID addWorld(entt::registry &registry, EventDispatcher &dispatcher) {
+        WorldID id = worlds.insert(std::make_shared<World>(registry, dispatcher));
+        worlds.get(id)->id = id;
+        return id;
+    }
+
+    /**
+     * @brief Removes a world and drops its pending actions
+     * @return true if the world existed
+     *
+     * Must not be called from inside an update.
+     */
+    bool removeWorld(WorldID id) {
+        std::shared_ptr<World> *world = worlds.find(id);
+        if (world == nullptr) {
+            return false;
+        }
+        if ((*world)->queued) {
+            wakes.erase((*world)->wake);
+        }
+        return worlds.erase(id);
+    }
+
+    /// @brief Checks whether a world exists
+    bool contains(WorldID id) const { return worlds.contains(id); }
+
+    /// @brief Gets the number of worlds
+    std::size_t worldCount() const { return worlds.size(); }
+
+    /// @brief Gets the number of worlds with a pending action
+    std::size_t activeCount() const { return wakes.size(); }
+
+    /// @brief Gets the scheduler of a world, for everything not forwarded here; see wake()
+    world_type &world(WorldID id) { return worlds.get(id)->scheduler; }
+
+    /// @brief Gets the scheduler of a world
+    const world_type &world(WorldID id) const { return worlds.get(id)->scheduler; }
+
+    /// @brief Gets the registry of a world
+    entt::registry &registry(WorldID id) { return *worlds.get(id)->registry; }
+
+    /// @brief Gets the dispatcher of a world
+    EventDispatcher &dispatcher(WorldID id) { return *worlds.get(id)->dispatcher; }
+
+    /**
+     * @brief Schedules an action in a world
+     * @param id The world
+     * @param tick The tick at which to run the action
+     * @param entity An entity of the world's registry
+     * @param action The action
+     * @param onComplete Optional callback run after the action
+     * @return The ID of the action
+     */
+    WorldActionID schedule(WorldID id, int tick, entt::entity entity, ActionFunction action,
+                           CompletionFunction onComplete = nullptr) {
+        ActionID actionId =
+            world(id).schedule(tick, entity, std::move(action), std::move(onComplete));
+        wake(id);
+        return pack(id, actionId);
+    }
+
+    /// @brief Schedules an action repeating every interval ticks in a world
+    /// @see BasicScheduler::schedulePeriodic
+    WorldActionID schedulePeriodic(WorldID id, int firstTick, int interval, int count,
+                                   entt::entity entity, ActionFunction action,
+                                   CompletionFunction onComplete = nullptr) {
+        ActionID actionId = world(id).schedulePeriodic(firstTick, interval, count, entity,
+                                                        std::move(action), std::move(onComplete));
+        wake(id);
+        return pack(id, actionId);
+    }
+
+    /**
+     * @brief Cancel a scheduled action
+     * @param id The ID returned by schedule()
+     * @return true if the action was found and cancelled, false otherwise
+     */
+    bool cancel(WorldActionID id) {
+        WorldID at = static_cast<WorldID>(id >> 32);
+        if (!worlds.contains(at) || !world(at).cancel(static_cast<ActionID>(id))) {
+            return false;
+        }
+        wake(at);
+        return true;
+    }
+
+    /// @brief Move a pending action to another tick of its world, keeping its ID
+    /// @see BasicScheduler::reschedule
+    bool reschedule(WorldActionID id, int tick) {
+        WorldID at = static_cast<WorldID>(id >> 32);
+        if (!worlds.contains(at) || !world(at).reschedule(static_cast<ActionID>(id), tick)) {
+            return false;
+        }
+        wake(at);
+        return true;
+    }
+
+    /// @brief Checks whether an action is still pending
+    bool isPending(WorldActionID id) const {
+        WorldID at = static_cast<WorldID>(id >> 32);
+        return worlds.contains(at) && world(at).isPending(static_cast<ActionID>(id));
+    }
+
+    /// @brief Gets the number of pending actions of a world
+    std::size_t pendingCount(WorldID id) const { return world(id).pendingCount(); }
+
+    /// @brief Gets the earliest tick at which some world has an action due
+    std::optional<int> nextDueTick() const { return wakes.nextTick(); }
+
+    /**
+     * @brief Brings a world's place in the wake-up queue in line with its next due tick
+     *
+     * Called by every method of this class that changes a world; call it
+     * after scheduling, cancelling or clearing through world() directly.
+     * Does nothing for a world being updated, which is queued again once its
+     * update is done.
+     */
+    void wake(WorldID id) {
+        World &target = *worlds.get(id);
+        if (target.updating) {
+            return;
+        }
+        std::optional<int> next = target.scheduler.nextDueTick();
+        if (!next) {
+            if (target.queued) {
+                wakes.erase(target.wake);
+                target.queued = false;
+            }
+        } else if (!target.queued) {
+            target.wake = wakes.push(Wake{*next, id});
+            target.queued = true;
+        } else {
+            wakes.modify(target.wake, [&next](Wake &wake) { wake.tick = *next; });
+        }
+    }
+
+    /**
+     * @brief Updates the worlds with actions due up to a tick, one after another
+     * @param current_tick The current system tick
+     * @param budget Limits the work of each world updated
+     * @return The actions run and left due, summed over the updated worlds
+     */
+    UpdateResult update(int current_tick, const UpdateBudget &budget = UpdateBudget{}) {
+        UpdateResult total;
+        takeDue(current_tick);
+        for (World *target : due) {
+            UpdateResult result = target->scheduler.update(current_tick, *target->registry,
+                                                           *target->dispatcher, budget);
+            total.executed += result.executed;
+            total.backlog += result.backlog;
+        }
+        requeue();
+        return total;
+    }
+
+    /**
+     * @brief Updates the worlds with actions due up to a tick on a worker pool
+     * @param current_tick The current system tick
+     * @param pool The workers the due worlds are spread over
+     * @param budget Limits the work of each world updated
+     * @return The actions run and left due, summed over the updated worlds
+     *
+     * Each world runs on one thread, in the same order as update() would run
+     * it. If a world throws, the exception is rethrown once every due world
+     * has run.
+     */
+    UpdateResult updateParallel(int current_tick, TaskPool &pool,
+                                const UpdateBudget &budget = UpdateBudget{}) {
+        takeDue(current_tick);
+        results.assign(due.size(), UpdateResult{});
+        try {
+            pool.parallelFor(due.size(), [this, current_tick, &budget](std::size_t i) {
+                World &target = *due[i];
+                results[i] = target.scheduler.update(current_tick, *target.registry,
+                                                     *target.dispatcher, budget);
+            });
+        } catch (...) {
+            requeue();
+            throw;
+        }
+        requeue();
+        UpdateResult total;
+        for (const UpdateResult &result : results) {
+            total.executed += result.executed;
+            total.backlog += result.backlog;
+        }
+        return total;
+    }
+
+    /// @brief Drops the pending actions of every world, keeping the worlds
+    void clear() {
+        wakes.forEach([this](const Wake &wake) {
+            World &target = *worlds.get(wake.world);
+            target.scheduler.clear();
+            target.queued = false;
+        });
+        wakes.clear();
+    }
+
+  private:
+    /// Next due tick of a world
+    struct Wake {
+        int tick;
+        WorldID world;
+    };
+
+    struct World {
+        World(entt::registry &registry, EventDispatcher &dispatcher)
+            : registry(&registry), dispatcher(&dispatcher) {}
+
+        WorldID id = 0;
+        entt::registry *registry;
+        EventDispatcher *dispatcher;
+        world_type scheduler;
+        typename HeapQueue<Wake>::handle_type wake{}; ///< Entry in the wake-up queue
+        bool queued = false;                           ///< Whether wake is valid
+        bool updating = false;                         ///< Whether an update has taken it
+    };
+
+    static WorldActionID pack(WorldID id, ActionID action) {
+        return action == 0 ? 0 : (static_cast<WorldActionID>(id) << 32) | action;
+    }
+
+    /// Moves the worlds due at or before a tick from the wake-up queue to due, in wake order
+    void takeDue(int current_tick) {
+        due.clear();
+        Wake wake{};
+        while (wakes.popDue(current_tick, wake)) {
+            World &target = *worlds.get(wake.world);
+            target.queued = false;
+            target.updating = true;
+            due.push_back(&target);
+        }
+    }
+
+    /// Queues the worlds just updated at their new next due tick
+    void requeue() {
+        for (World *target : due) {
+            target->updating = false;
+            wake(target->id);
+        }
+        due.clear();
+    }
+
+    /// Every world; shared_ptr because SlotMap copies its empty value into new slots
+    SlotMap<std::shared_ptr<World>, WorldID> worlds;
+
+    HeapQueue<Wake> wakes;             ///< Next due tick of every world that has one
+    std::vector<World *> due;          ///< Worlds taken by the update in progress
+    std::vector<UpdateResult> results; ///< Per due world, reused by updateParallel()
+};
+
+/// @brief World scheduler with heap-backed worlds
+using WorldScheduler = BasicWorldScheduler<>;
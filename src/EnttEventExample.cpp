@@ -14,7 +14,7 @@ void EnttEventExample::onEntityAttack(const GameEvents::EntityAttackEvent &event
 
 void EnttEventExample::onEntityDamaged(const GameEvents::EntityDamagedEvent &event) {
     std::cout << "Damage event: Entity " << static_cast<int>(event.entity) << " takes "
-              << event.damage << " damage of type " << event.damageType;
+              << event.damage << " damage of type " << event.damageType.text();
 
     if (event.source != entt::null) {
         std::cout << " from entity " << static_cast<int>(event.source);
@@ -40,7 +40,7 @@ void EnttEventExample::onPlayerMove(const GameEvents::PlayerMoveEvent &event) {
 }
 
 void EnttEventExample::onMapChange(const GameEvents::MapChangeEvent &event) {
-    std::cout << "Map changed to " << event.mapName;
+    std::cout << "Map changed to " << event.mapName.text();
 
     if (event.isReload) {
         std::cout << " (reloaded)";
@@ -53,6 +53,9 @@ void EnttEventExample::onMapChange(const GameEvents::MapChangeEvent &event) {
 void EnttEventExample::runEnttDispatcherExample() {
     std::cout << "=== EnTT Event Dispatcher Example ===" << std::endl;
 
+    // Keep the text of damage types and map names for the listeners to print
+    EventNames::setInterning(true);
+
     // Create registry and dispatcher
     entt::registry registry;
     entt::dispatcher dispatcher;
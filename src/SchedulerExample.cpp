@@ -57,7 +57,7 @@ void SchedulerExample::runSchedulerExample() {
       },
       // onComplete callback
       [enemy](ActionID id, entt::entity attacker, entt::registry &reg,
-              entt::dispatcher &disp) {
+              EventDispatcher &disp) {
         if (reg.valid(attacker) && reg.valid(enemy)) {
           // Check if enemy health is low and enqueue a follow-up event
           auto &enemyHealth = reg.get<Health>(enemy);
@@ -80,7 +80,7 @@ void SchedulerExample::runSchedulerExample() {
     std::cout << "\n-- Tick " << tick << " --" << std::endl;
 
     // Create a dispatcher to handle action completion events
-    entt::dispatcher dispatcher;
+    EventDispatcher dispatcher;
 
     // Connect a listener for ActionCompletedEvent
     // Create named lambdas
@@ -164,7 +164,7 @@ void SchedulerExample::runEventIntegrationExample() {
   // Create registry, scheduler, and dispatcher
   entt::registry registry;
   Scheduler scheduler;
-  entt::dispatcher dispatcher;
+  EventDispatcher dispatcher;
 
   // Connect event handlers
 // ActionCompletedEvent handler with connect_arg
@@ -215,7 +215,7 @@ void SchedulerExample::runEventIntegrationExample() {
       },
       // onComplete callback
       [enemy](ActionID id, entt::entity attacker, entt::registry &reg,
-              entt::dispatcher &disp) {
+              EventDispatcher &disp) {
         // Publish an event about the damage
         disp.enqueue<GameEvents::EntityDamagedEvent>(enemy,    // entity damaged
                                                      15,       // damage amount
@@ -1,6 +1,10 @@
 #include <iostream>
+#include "../include/AllocationCounter.h"
 #include "../include/EnttEventExample.h"
 
+// Counting operator new, when built with SCHEDULER_COUNT_ALLOCATIONS
+SCHEDULER_ALLOCATION_HOOKS
+
 // === Direction enum (optional movement logic) ===
 enum class Direction { NONE, UP, DOWN, LEFT, RIGHT };
 
@@ -28,6 +32,9 @@ int main() {
     runSchedulerExamples();
     runEnttEventExamples();
     std::cout << "Hello, World!" << std::endl;
+#if defined(SCHEDULER_COUNT_ALLOCATIONS)
+    AllocationCounter::report(std::cout);
+#endif
     return 0;
 }
 
@@ -0,0 +1,106 @@
+// Regression tests of TimedEventScheduler
+#include "EventSpill.h"
+#include "TaskPool.h"
+#include "TimedEventScheduler.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#define CHECK(condition)                                                                          \
+    do {                                                                                          \
+        if (!(condition)) {                                                                       \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);  \
+            std::exit(1);                                                                         \
+        }                                                                                         \
+    } while (false)
+
+using namespace entt::literals;
+
+namespace {
+
+// Edges are dropped with their events, whichever update ran them
+template <typename Update> void dependenciesDroppedWithEvents(Update update) {
+    TimedEventScheduler events;
+    int runs = 0;
+    for (int tick = 1; tick <= 100; ++tick) {
+        EventID first = events.scheduleFunction(tick, [&runs] { ++runs; });
+        EventID second = events.scheduleFunction(tick, [&runs] { ++runs; });
+        CHECK(events.addDependency(first, second));
+        CHECK(events.dependentCount() == 1);
+        update(events, tick);
+        CHECK(events.dependentCount() == 0);
+    }
+    CHECK(runs == 200);
+}
+
+struct Ping {
+    int value = 0;
+};
+
+int pings = 0;
+
+void ping(const Ping &payload) { pings += payload.value; }
+
+// A bucket that cannot be read is passed over by advanceTo() and counted,
+// and its events come back once an update can read it
+void unreadableSpillBucket() {
+    std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / "TimedEventSchedulerTest.spill";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    EventHandlers handlers;
+    handlers.add<Ping, &ping>("ping"_hs);
+    TimedEventScheduler events;
+    {
+        EventSpill spill(directory.string(), 10, 10);
+        events.setSpill(&spill, &handlers);
+        EventID id = events.scheduleFunction(100, handlers.bind("ping"_hs, Ping{1}));
+        events.update(0);
+        CHECK(events.nextDueTick() == 100);
+
+        // Cut the bucket file short, keeping its bytes to put back later
+        std::filesystem::path file = directory / "10.spill";
+        std::string bytes;
+        {
+            std::ifstream in(file, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        CHECK(!bytes.empty());
+        std::filesystem::resize_file(file, bytes.size() / 2);
+
+        CHECK(events.advanceTo(200) == 0);
+        CHECK(events.spillFailures() == 1);
+        CHECK(spill.unreadableCount() == 1);
+        CHECK(std::filesystem::exists(file));
+        CHECK(events.isPending(id));
+        CHECK(pings == 0);
+
+        std::ofstream(file, std::ios::binary | std::ios::trunc) << bytes;
+        events.update(201);
+        CHECK(events.spillFailures() == 1);
+        CHECK(spill.unreadableCount() == 0);
+        CHECK(!std::filesystem::exists(file));
+        CHECK(!events.isPending(id));
+        CHECK(pings == 1);
+        events.setSpill(nullptr, nullptr);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+} // namespace
+
+int main() {
+    dependenciesDroppedWithEvents(
+        [](TimedEventScheduler &events, int tick) { events.update(tick); });
+
+    TaskPool pool(2);
+    dependenciesDroppedWithEvents(
+        [&pool](TimedEventScheduler &events, int tick) { events.updateParallel(tick, pool); });
+
+    unreadableSpillBucket();
+    return 0;
+}
@@ -0,0 +1,50 @@
+// Regression tests of BasicWorldScheduler's wake-up queue
+#include "WorldScheduler.h"
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(condition)                                                                          \
+    do {                                                                                          \
+        if (!(condition)) {                                                                       \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);  \
+            std::exit(1);                                                                         \
+        }                                                                                         \
+    } while (false)
+
+namespace {
+
+// An action that schedules into its own world keeps one wake-up entry, so the
+// world can be removed and later updates never visit it
+template <typename Update> void selfSchedulingWorld(Update update) {
+    WorldScheduler worlds;
+    entt::registry registry;
+    EventDispatcher dispatcher;
+    entt::entity mob = registry.create();
+    WorldID world = worlds.addWorld(registry, dispatcher);
+    int runs = 0;
+    worlds.schedule(world, 1, mob, [&](entt::entity entity, entt::registry &) {
+        ++runs;
+        worlds.schedule(world, 5, entity, [&](entt::entity, entt::registry &) { ++runs; });
+    });
+
+    update(worlds, 1);
+    CHECK(runs == 1);
+    CHECK(worlds.activeCount() == 1);
+    CHECK(worlds.nextDueTick() == 5);
+
+    CHECK(worlds.removeWorld(world));
+    CHECK(worlds.activeCount() == 0);
+    update(worlds, 5);
+    CHECK(runs == 1);
+}
+
+} // namespace
+
+int main() {
+    selfSchedulingWorld([](WorldScheduler &worlds, int tick) { worlds.update(tick); });
+
+    TaskPool pool(2);
+    selfSchedulingWorld(
+        [&pool](WorldScheduler &worlds, int tick) { worlds.updateParallel(tick, pool); });
+    return 0;
+}